@@ -0,0 +1,231 @@
+﻿#pragma once
+
+#include "../RubiksCubeRecognition/CubeRecognition.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+/*************************************************************
+ * 稳态分配计数，基准测试与零分配测试共用。
+ * 本文件替换全局 operator new 与 C 运行库的分配函数，
+ * 每个可执行文件只能有一个翻译单元包含它
+ *************************************************************/
+
+/*************************************************************
+ * 堆分配计数：替换全局 operator new 统计标准容器等的分配，
+ * 计数用的 MatAllocator 统计 Mat 缓冲的分配；OpenCV 算法内部
+ * fastMalloc/AutoBuffer 的临时缓冲由下面的原生分配计数统计
+ *************************************************************/
+static atomic<uint64_t> heapAllocations{ 0 };
+static atomic<uint64_t> matAllocations{ 0 };
+
+void* operator new(size_t size) {
+    heapAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+/*************************************************************
+ * 原生分配计数：统计直接走 C 运行库的分配（OpenCV 的 fastMalloc、
+ * AutoBuffer 与其模块内的 operator new 都落到这里）。
+ * Linux（glibc）：可执行文件定义的 malloc 系列函数覆盖共享库中的同名符号，
+ * 计数后转发给 __libc_*，统计整个进程；
+ * Windows：改写 OpenCV 各模块导入表中 C 运行库的 malloc / calloc /
+ * realloc / _aligned_malloc 项，只统计 OpenCV 内部的分配。
+ * 其他平台不统计（installNativeCounting 返回 false）
+ *************************************************************/
+static atomic<uint64_t> nativeAllocations{ 0 };
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+    nativeAllocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    nativeAllocations++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) {
+    nativeAllocations++;
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    nativeAllocations++;
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    nativeAllocations++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1))) return EINVAL;
+    nativeAllocations++;
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+}
+
+static bool installNativeCounting() {
+    return true;
+}
+#elif defined(_WIN32)
+static void* (__cdecl* crtMalloc)(size_t) = nullptr;
+static void* (__cdecl* crtCalloc)(size_t, size_t) = nullptr;
+static void* (__cdecl* crtRealloc)(void*, size_t) = nullptr;
+static void* (__cdecl* crtAlignedMalloc)(size_t, size_t) = nullptr;
+
+static void* __cdecl countingMalloc(size_t size) {
+    nativeAllocations++;
+    return crtMalloc(size);
+}
+
+static void* __cdecl countingCalloc(size_t count, size_t size) {
+    nativeAllocations++;
+    return crtCalloc(count, size);
+}
+
+static void* __cdecl countingRealloc(void* p, size_t size) {
+    nativeAllocations++;
+    return crtRealloc(p, size);
+}
+
+static void* __cdecl countingAlignedMalloc(size_t size, size_t alignment) {
+    nativeAllocations++;
+    return crtAlignedMalloc(size, alignment);
+}
+
+// 把模块导入表中名为 name 的函数改为 hook，original 为空时记下原地址；返回是否找到
+template<typename Fn>
+static bool patchImport(HMODULE module, const char* name, Fn hook, Fn& original) {
+    BYTE* base = (BYTE*)module;
+    IMAGE_NT_HEADERS* nt = (IMAGE_NT_HEADERS*)(base + ((IMAGE_DOS_HEADER*)base)->e_lfanew);
+    const IMAGE_DATA_DIRECTORY& dir = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+    if (!dir.VirtualAddress) return false;
+
+    bool found = false;
+    for (IMAGE_IMPORT_DESCRIPTOR* imp = (IMAGE_IMPORT_DESCRIPTOR*)(base + dir.VirtualAddress); imp->Name; imp++) {
+        if (!imp->OriginalFirstThunk) continue;
+        IMAGE_THUNK_DATA* names = (IMAGE_THUNK_DATA*)(base + imp->OriginalFirstThunk);
+        IMAGE_THUNK_DATA* slots = (IMAGE_THUNK_DATA*)(base + imp->FirstThunk);
+        for (; names->u1.AddressOfData; names++, slots++) {
+            if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal)) continue;
+            IMAGE_IMPORT_BY_NAME* byName = (IMAGE_IMPORT_BY_NAME*)(base + names->u1.AddressOfData);
+            if (strcmp((const char*)byName->Name, name) != 0) continue;
+
+            DWORD protect;
+            if (!VirtualProtect(&slots->u1.Function, sizeof(slots->u1.Function), PAGE_READWRITE, &protect)) continue;
+            if (!original) original = (Fn)slots->u1.Function;
+            slots->u1.Function = (ULONG_PTR)hook;
+            VirtualProtect(&slots->u1.Function, sizeof(slots->u1.Function), protect, &protect);
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool installNativeCounting() {
+    HMODULE modules[1024];
+    DWORD bytes = 0;
+    if (!EnumProcessModules(GetCurrentProcess(), modules, sizeof(modules), &bytes)) return false;
+
+    bool patched = false;
+    for (DWORD i = 0; i < bytes / sizeof(HMODULE); i++) {
+        char name[MAX_PATH];
+        if (!GetModuleBaseNameA(GetCurrentProcess(), modules[i], name, sizeof(name))) continue;
+        if (_strnicmp(name, "opencv_", 7) != 0) continue;
+        patched |= patchImport(modules[i], "malloc", &countingMalloc, crtMalloc);
+        patched |= patchImport(modules[i], "calloc", &countingCalloc, crtCalloc);
+        patched |= patchImport(modules[i], "realloc", &countingRealloc, crtRealloc);
+        patched |= patchImport(modules[i], "_aligned_malloc", &countingAlignedMalloc, crtAlignedMalloc);
+    }
+    return patched;
+}
+#else
+static bool installNativeCounting() {
+    return false;
+}
+#endif
+
+class CountingMatAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+        AccessFlag flags, UMatUsageFlags usageFlags) const override {
+        matAllocations++;
+        return Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(UMatData* data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override {
+        return Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(UMatData* data) const override {
+        Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+/*************************************************************
+ * 一组设置下预热后每个面的平均分配次数
+ *************************************************************/
+struct AllocationCounts {
+    double heapPerFace = 0;     // operator new 次数
+    double matPerFace = 0;      // Mat 缓冲分配次数
+    double nativePerFace = -1;  // 原生分配次数（-1 = 本平台不统计）
+};
+
+/*************************************************************
+ * 一份帧上下文先把每张图各分析一次预热，再统计 iterations 轮分析
+ * （含 fillColorMatrix）中的分配次数。draw 为 true 时每次先把原图
+ * 复制到该图自己的叠加图再绘制（叠加图缓冲在预热时分配）。
+ * 调用前需已安装 CountingMatAllocator，nativeCounting 为 installNativeCounting 的结果
+ *************************************************************/
+inline AllocationCounts countSteadyStateAllocations(const CubeFaceAnalyzer& analyzer, const vector<Mat>& images,
+    int iterations, bool nativeCounting, bool draw = false) {
+    FrameContext ctx;
+    FaceMatrix<3> matrix;
+    vector<Mat> overlays(images.size());
+    auto analyze = [&](size_t i) {
+        if (draw) images[i].copyTo(overlays[i]);
+        analyzer.fillColorMatrix(analyzer.analyzeCubeFace(images[i], ctx, draw ? overlays[i] : ctx.overlay, draw), matrix);
+    };
+    for (size_t i = 0; i < images.size(); i++) {
+        analyze(i);
+    }
+
+    uint64_t heap0 = heapAllocations, mat0 = matAllocations, native0 = nativeAllocations;
+    int faces = 0;
+    for (int k = 0; k < iterations; k++) {
+        for (size_t i = 0; i < images.size(); i++) {
+            analyze(i);
+            faces++;
+        }
+    }
+
+    AllocationCounts r;
+    r.heapPerFace = (double)(heapAllocations - heap0) / faces;
+    r.matPerFace = (double)(matAllocations - mat0) / faces;
+    if (nativeCounting) r.nativePerFace = (double)(nativeAllocations - native0) / faces;
+    return r;
+}
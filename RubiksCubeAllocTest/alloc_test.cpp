@@ -0,0 +1,92 @@
+﻿#include "AllocationCounting.h"
+#include <iostream>
+#include <filesystem>
+
+using namespace std;
+using namespace cv;
+
+/*************************************************************
+ * 零分配测试：不跑基准测试的全部项目，只检查帧上下文复用的保证——
+ * 默认分割设置、不绘制时，两个提取后端预热后每个面都不再分配
+ * （operator new、Mat 缓冲与 OpenCV 内部的原生分配）。
+ * 叠加绘制不在保证之内（批处理 full 级别），只输出其分配次数供参考。
+ * 全部通过返回 0，有分配返回 2
+ *************************************************************/
+int main(int argc, char** argv) {
+    string dataDir = "../RubiksCubeRecognition/data";
+    int iterations = 5;
+    vector<double> scales = { 0.5, 1.0 };
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc) {
+            dataDir = argv[++i];
+        }
+        else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = max(1, atoi(argv[++i]));
+        }
+        else {
+            cerr << "用法：" << argv[0] << " [--data 目录] [--iterations N]" << endl;
+            return 1;
+        }
+    }
+
+    vector<Mat> originals;
+    for (int i = 1; i <= 6; i++) {
+        string path = (filesystem::path(dataDir) / ("cubeface" + to_string(i) + ".jpg")).string();
+        Mat img = imread(path);
+        if (img.empty()) {
+            cerr << "无法加载图像：" << path << endl;
+            return 1;
+        }
+        originals.push_back(img);
+    }
+
+    static CountingMatAllocator countingAllocator;
+    Mat::setDefaultAllocator(&countingAllocator);
+    bool nativeCounting = installNativeCounting();
+    if (!nativeCounting) {
+        cerr << "警告：本平台无法统计 OpenCV 内部的原生分配，只检查 operator new 与 Mat" << endl;
+    }
+
+    CubeFaceAnalyzer contours;
+    contours.setVerbose(false);
+    CubeFaceAnalyzer components;
+    components.setVerbose(false);
+    components.setExtractBackend(EXTRACT_COMPONENTS);
+
+    auto report = [](const Size& size, const string& name, const AllocationCounts& r) {
+        cout << size.width << "x" << size.height << " " << name << ": 每面 operator new " << r.heapPerFace
+            << " 次，Mat " << r.matPerFace << " 次，原生 ";
+        if (r.nativePerFace < 0) cout << "-";
+        else cout << r.nativePerFace << " 次";
+        cout << endl;
+    };
+
+    int status = 0;
+    for (double scale : scales) {
+        vector<Mat> images;
+        for (const Mat& img : originals) {
+            Mat scaled;
+            resize(img, scaled, Size(), scale, scale, scale < 1.0 ? INTER_AREA : INTER_LINEAR);
+            images.push_back(scaled);
+        }
+        Size size = images[0].size();
+
+        for (const CubeFaceAnalyzer* a : { &contours, &components }) {
+            string name = a == &contours ? "contours" : "components";
+            AllocationCounts r = countSteadyStateAllocations(*a, images, iterations, nativeCounting);
+            report(size, name, r);
+            if (r.heapPerFace > 0 || r.matPerFace > 0 || r.nativePerFace > 0) {
+                cerr << "错误：" << size.width << "x" << size.height << " " << name << " 后端稳态仍有分配" << endl;
+                status = 2;
+            }
+        }
+
+        // 叠加绘制：OpenCV 的粗线抗锯齿与 putText 在内部分配，不做要求
+        report(size, "contours + 叠加图（不检查）",
+            countSteadyStateAllocations(contours, images, iterations, nativeCounting, true));
+    }
+
+    cout << (status == 0 ? "零分配检查通过" : "零分配检查失败") << endl;
+    return status;
+}
@@ -0,0 +1,1415 @@
+﻿#include "../RubiksCubeRecognition/CubeRecognition.h"
+#include "../RubiksCubeRecognition/ResultCache.h"
+#include "../RubiksCubeLib/RubiksCubeApi.h"
+#include "../RubiksCubeAllocTest/AllocationCounting.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+/*************************************************************
+ * 识别流程分阶段基准测试
+ * 在 data/ 的六张图像上按多个分辨率分别计时每个阶段，
+ * 输出 JSON（mean / p50 / p99，单位毫秒），便于比较两次构建
+ *************************************************************/
+struct BenchOptions {
+    string dataDir = "../RubiksCubeRecognition/data";
+    string outputFile;                       // 为空时输出到标准输出
+    int iterations = 20;                     // 每张图每个阶段的计时次数
+    vector<double> scales = { 0.5, 1.0, 2.0, 4.0 };
+    double scalingScale = 4.0;               // 分块并行扩展曲线使用的图像缩放倍数
+    int maxThreads = 0;                      // 扩展曲线的最大线程数，0 = 全部硬件线程
+    double streamScale = 8.0;                // 流式内存测试使用的图像缩放倍数
+    int streamRows = 64;                     // 流式内存测试的条带行数
+    string processExe;                       // 识别程序路径（为空时跳过每个魔方一个进程的对照）
+    string baselineFile;                     // 上一次的结果 JSON（为空时不与基线比较）
+};
+
+struct OverheadResult {
+    Size resolution;
+    double offMs;   // 关闭指标时 analyzeCubeFace + 绘制的平均耗时
+    double onMs;    // 开启指标时的平均耗时
+};
+
+struct AgreementResult {
+    Size resolution;
+    int faces = 0;             // 比较的面数
+    int countMatches = 0;      // 两个后端色块数相同的面数
+    int blockMatches = 0;      // 两个后端色块列表逐位相同的面数
+    int matrixMatches = 0;     // 颜色矩阵相同的面数
+    double maxCenterDelta = 0; // 同一网格位置色块中心的最大偏差（像素）
+    int gridPerturbed = 0;     // 做了扰动网格拟合的面数
+    int gridRecovered = 0;     // 扰动后仍得到原行列的面数
+};
+
+struct AllocationResult {
+    Size resolution;
+    string backend;
+    double heapPerFace;  // 预热后每个面的 operator new 次数
+    double matPerFace;   // 预热后每个面的 Mat 缓冲分配次数
+    double nativePerFace = -1;  // 预热后每个面的原生分配次数（-1 = 本平台不统计）
+};
+
+struct RenderResult {
+    string target;        // standard_face / cube_net / cube_net_panel
+    double atlasMs = 0;   // 模板绘制的平均耗时（cube_net_panel：在旧展开图上重画一个面）
+    double directMs = 0;  // 直接 rectangle/putText 绘制的平均耗时（cube_net_panel：整张模板绘制）
+    int compared = 0;     // 逐像素比较的图像数
+    int identical = 0;    // 两种绘制完全一致的图像数
+};
+
+struct ScalingResult {
+    Size resolution;
+    int threads = 1;         // 分块数与 OpenCV 线程数
+    double segmentMs = 0;    // 分类 + 开运算的平均耗时
+    double analyzeMs = 0;    // analyzeCubeFace（连通域后端、不绘制）的平均耗时
+    int compared = 0;        // 与单线程结果比较的面数
+    int identical = 0;       // 位掩码与色块都逐位相同的面数
+};
+
+// 只计网格拟合与颜色矩阵填充（合成的色块中心，不含分割）；端到端的 3x3 耗时见 FaceTimingResult
+struct GridSizeResult {
+    int n = 3;               // 网格边长
+    int faces = 0;           // 合成的面数
+    int recovered = 0;       // 每个色块都回到原格子、离群点全部剔除的面数
+    double assignUs = 0;     // assignToGrid<N> 的平均耗时（微秒）
+    double fillUs = 0;       // 写入定长 FaceMatrix<N> 的平均耗时（微秒）
+    double vectorFillUs = 0; // 写入嵌套 vector 的平均耗时（仅 3x3，对照）
+};
+
+struct StreamMemoryResult {
+    Size resolution;
+    int stripRows = 0;
+    size_t inputBytes = 0;    // 输入 BGR 图像本身（两条路径都不计入）
+    size_t bufferBytes = 0;   // streamingBufferBytes 估计的条带缓冲
+    size_t streamPeak = 0;    // 流式分析使 peak RSS 增长的字节数
+    size_t fullPeak = 0;      // 整幅分析使 peak RSS 增长的字节数
+    bool identical = false;   // 两条路径的色块逐位相同
+};
+
+struct CacheTestResult {
+    bool opened = false;
+    int entries = 0;          // 写入的条目数
+    int roundTrips = 0;       // 读回的结果与写入逐字节相同的条目数
+    int corruptions = 0;      // 构造的损坏条目数（截断、magic、多余字节、空文件、错位条目）
+    int corruptMisses = 0;    // 损坏条目按未命中处理的个数
+    int rewrites = 0;         // 损坏后重新写入并再次命中的个数
+    int concurrentReads = 0;  // 并发读写期间命中的读取次数
+    int concurrentBad = 0;    // 并发读写期间读到的内容不是任何一次写入的次数
+    double lookupUs = 0;      // 命中时 lookup 的平均耗时（微秒）
+};
+
+struct BenchResult {
+    string stage;
+    Size resolution;
+    size_t samples;
+    double meanMs;
+    double p50Ms;
+    double p99Ms;
+};
+
+struct ApiResult {
+    BenchResult inProcess;    // 每个魔方解码六份 JPEG 字节 + 一次 rcr_analyze_batch
+    BenchResult perProcess;   // 每个魔方把同样的字节写成六个文件、启动一次识别程序并解析输出
+    bool processRun = false;
+    int faces = 0;            // 比较的面数
+    int cppMatches = 0;       // C 接口与直接调用分析器颜色矩阵相同的面数
+    int processFaces = 0;     // 子进程输出中解析到的面数
+    int processMatches = 0;   // 子进程与 C 接口颜色矩阵相同的面数（两边解码同一份字节）
+};
+
+// 端到端的 3x3 面：analyzeCubeFace + 填充颜色矩阵 + 绘制标准面，
+// 定长 FaceMatrix<3> 与嵌套 vector 两条路径交替计时
+struct FaceTimingResult {
+    Size resolution;
+    BenchResult fixed;        // FaceMatrix<3> 路径
+    BenchResult nested;       // 嵌套 vector 路径（对照）
+    int faces = 0;            // 每轮的面数
+    int identical = 0;        // 两条路径颜色矩阵与标准面逐像素相同的面数
+    double baselineMs = 0;    // --baseline 中的 fixed_mean_ms（0 = 无基线）
+};
+
+/*************************************************************
+ * 计时工具：先预热一次，再计时 iterations 次，样本追加到 samples
+ *************************************************************/
+template<typename Fn>
+static void timeStage(int iterations, vector<double>& samples, Fn&& fn) {
+    fn();
+    for (int i = 0; i < iterations; i++) {
+        int64 t = getTickCount();
+        fn();
+        samples.push_back((getTickCount() - t) * 1000.0 / getTickFrequency());
+    }
+}
+
+static BenchResult summarize(const string& stage, Size resolution, const vector<double>& samples) {
+    BenchResult r;
+    r.stage = stage;
+    r.resolution = resolution;
+    r.samples = samples.size();
+    double sum = 0;
+    for (double ms : samples) sum += ms;
+    r.meanMs = samples.empty() ? 0 : sum / samples.size();
+    r.p50Ms = percentile(samples, 50);
+    r.p99Ms = percentile(samples, 99);
+    return r;
+}
+
+/*************************************************************
+ * 扰动一个已分好网格的面：绕中心旋转 25°，去掉两个对角的角块，
+ * 在对角外侧加两个离群色块（模拟相邻面或背景）。
+ * expected 为每个扰动后色块应得的格子下标（离群为 -1）
+ *************************************************************/
+static vector<ColorBlock> perturbGrid(const vector<ColorBlock>& grid, vector<int>& expected) {
+    Point2f mean(0, 0);
+    for (const ColorBlock& b : grid) mean += b.center * (1.0f / grid.size());
+    float c = cos(25 * CV_PI / 180), s = sin(25 * CV_PI / 180);
+    auto rotate = [&](Point2f p) {
+        Point2f d = p - mean;
+        return mean + Point2f(c * d.x - s * d.y, s * d.x + c * d.y);
+    };
+
+    vector<ColorBlock> blocks;
+    expected.clear();
+    for (const ColorBlock& b : grid) {
+        int cell = b.row * 3 + b.col;
+        if (cell == 0 || cell == 8) continue;
+        ColorBlock moved = b;
+        moved.center = rotate(b.center);
+        blocks.push_back(moved);
+        expected.push_back(cell);
+    }
+    for (int corner : { 0, 8 }) {
+        ColorBlock outlier = grid[corner];
+        outlier.center = rotate(mean + (grid[corner].center - mean) * 2.2f);
+        blocks.push_back(outlier);
+        expected.push_back(-1);
+    }
+    return blocks;
+}
+
+// 两组色块逐位相同（顺序、中心、边界框、面积、颜色与网格位置）
+static bool sameBlocks(const vector<ColorBlock>& a, const vector<ColorBlock>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].center != b[i].center || a[i].colorName != b[i].colorName || a[i].boundingBox != b[i].boundingBox ||
+            a[i].row != b[i].row || a[i].col != b[i].col || a[i].area != b[i].area || a[i].inferred != b[i].inferred) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 缓存读回的结果与写入的逐字节相同
+static bool sameResult(const rcr_face_result& a, const rcr_face_result& b) {
+    return memcmp(&a, &b, sizeof(rcr_face_result)) == 0;
+}
+
+/*************************************************************
+ * 对一个分辨率下的全部图像计时所有阶段
+ *************************************************************/
+static void benchResolution(const vector<Mat>& images, const BenchOptions& opt,
+    const CubeFaceAnalyzer& analyzer, const CubeFaceAnalyzer& componentAnalyzer,
+    const CubeFaceAnalyzer& quadAnalyzer, const CubeVisualizer& visualizer, vector<BenchResult>& results, vector<AgreementResult>& agreements) {
+    const vector<ColorRange>& colorTable = analyzer.getColorTable();
+    map<char, Scalar> colorCodeMap = analyzer.getColorCodeMap();
+    Size resolution = images[0].size();
+    int n = opt.iterations;
+
+    // 阶段名 -> 样本（保持插入顺序）
+    vector<pair<string, vector<double>>> stages;
+    auto samplesFor = [&stages](const string& name) -> vector<double>& {
+        for (auto& s : stages) {
+            if (s.first == name) return s.second;
+        }
+        stages.emplace_back(name, vector<double>());
+        return stages.back().second;
+    };
+
+    vector<vector<vector<char>>> colorMatrices;
+    vector<vector<Vec3b>> calibrationSamples; // 六个面的色面样本（颜色标定用）
+    AgreementResult agreement;
+    agreement.resolution = resolution;
+    string tmpPath = (filesystem::temp_directory_path() / "rubiks_bench.jpg").string();
+
+    for (const Mat& img : images) {
+        // 解码：同一份 JPEG 数据按全尺寸与 1/2、1/4、1/8 缩小解码
+        vector<uchar> encoded;
+        imencode(".jpg", img, encoded);
+        Mat encodedMat(1, (int)encoded.size(), CV_8U, encoded.data());
+        Mat decoded;
+        timeStage(n, samplesFor("imdecode"), [&] { decoded = imdecode(encodedMat, IMREAD_COLOR); });
+        for (int factor : { 2, 4, 8 }) {
+            int flag = factor == 2 ? IMREAD_REDUCED_COLOR_2 : factor == 4 ? IMREAD_REDUCED_COLOR_4 : IMREAD_REDUCED_COLOR_8;
+            timeStage(n, samplesFor("imdecode_reduced_" + to_string(factor)), [&] {
+                decoded = imdecode(encodedMat, flag);
+            });
+        }
+
+        // 旧流程的各阶段：cvtColor、逐色 inRange、morphologyEx
+        Mat imgLab;
+        timeStage(n, samplesFor("cvtColor_Lab"), [&] { cvtColor(img, imgLab, COLOR_BGR2Lab); });
+
+        vector<Mat> masks(colorTable.size());
+        for (size_t ci = 0; ci < colorTable.size(); ci++) {
+            timeStage(n, samplesFor("inRange_" + colorTable[ci].name), [&] {
+                inRange(imgLab, colorTable[ci].minVal, colorTable[ci].maxVal, masks[ci]);
+            });
+        }
+
+        // 旧流程对每种颜色的掩码各做一次开运算，阶段耗时为全部颜色之和
+        vector<Mat> opened(masks.size());
+        timeStage(n, samplesFor("morphologyEx"), [&] {
+            for (size_t ci = 0; ci < masks.size(); ci++) {
+                morphologyEx(masks[ci], opened[ci], MORPH_OPEN, Mat(), Point(-1, -1), 2);
+            }
+        });
+
+        // 当前流程：查表分类与位掩码形态学
+        Mat labels, eroded, openedLabels;
+        timeStage(n, samplesFor("classifyPixels"), [&] { analyzer.classifyPixels(img, labels); });
+        timeStage(n, samplesFor("morphBitwise_open"), [&] {
+            CubeFaceAnalyzer::morphBitwise(labels, eroded, 2, true);
+            CubeFaceAnalyzer::morphBitwise(eroded, openedLabels, 2, false);
+        });
+
+        // 轮廓提取（全部颜色）
+        vector<vector<Point>> allContours;
+        timeStage(n, samplesFor("findContours"), [&] {
+            allContours.clear();
+            Mat mask;
+            for (size_t ci = 0; ci < colorTable.size(); ci++) {
+                bitwise_and(openedLabels, Scalar(1 << ci), mask);
+                vector<vector<Point>> contours;
+                findContours(mask, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+                allContours.insert(allContours.end(), contours.begin(), contours.end());
+            }
+        });
+
+        // 连通域标记（全部颜色一遍）
+        vector<RegionStats> regions;
+        timeStage(n, samplesFor("labelRegions"), [&] {
+            CubeFaceAnalyzer::labelRegions(openedLabels, (int)colorTable.size(), regions);
+        });
+
+        // 只保留色块大小的轮廓用于逼近与绘制
+        double minArea = 0.01 * img.rows * img.cols;
+        vector<vector<Point>> blobContours;
+        for (const auto& contour : allContours) {
+            if (contourArea(contour) >= minArea) blobContours.push_back(contour);
+        }
+
+        vector<vector<Point>> approxes(blobContours.size());
+        timeStage(n, samplesFor("approxPolyDP"), [&] {
+            for (size_t i = 0; i < blobContours.size(); i++) {
+                double peri = arcLength(blobContours[i], true);
+                approxPolyDP(blobContours[i], approxes[i], 0.01 * peri, true);
+            }
+        });
+
+        Mat overlay = img.clone();
+        timeStage(n, samplesFor("drawDashedContour"), [&] {
+            for (const auto& approx : approxes) {
+                analyzer.drawDashedContour(overlay, approx, Scalar(0, 255, 0));
+            }
+        });
+
+        // 完整分析（用于得到色块与颜色矩阵）
+        Mat processedImg = img.clone();
+        vector<ColorBlock> blocks;
+        timeStage(n, samplesFor("analyzeCubeFace"), [&] {
+            blocks = analyzer.analyzeCubeFace(img, processedImg, false);
+        });
+
+        // 连通域后端，并与轮廓后端的结果比较
+        vector<ColorBlock> componentBlocks;
+        timeStage(n, samplesFor("analyzeCubeFace_components"), [&] {
+            componentBlocks = componentAnalyzer.analyzeCubeFace(img, processedImg, false);
+        });
+        agreement.faces++;
+        if (componentBlocks.size() == blocks.size()) agreement.countMatches++;
+        if (sameBlocks(componentBlocks, blocks)) agreement.blockMatches++;
+        if (componentAnalyzer.createColorMatrix(componentBlocks) == analyzer.createColorMatrix(blocks)) {
+            agreement.matrixMatches++;
+        }
+        if (blocks.size() == 9 && componentBlocks.size() == 9) {
+            for (const ColorBlock& a : blocks) {
+                for (const ColorBlock& b : componentBlocks) {
+                    if (a.row == b.row && a.col == b.col) {
+                        Point2f d = a.center - b.center;
+                        agreement.maxCenterDelta = max(agreement.maxCenterDelta, (double)sqrt(d.x * d.x + d.y * d.y));
+                    }
+                }
+            }
+        }
+
+        vector<Vec3b> samples;
+        if (analyzer.sampleFace(img, samples)) {
+            calibrationSamples.push_back(samples);
+        }
+
+        // 四边形检测模式（找轮廓 + 透视校正 + 逐格取色）
+        timeStage(n, samplesFor("analyzeCubeFace_quad"), [&] {
+            quadAnalyzer.analyzeCubeFace(img, processedImg, false);
+        });
+
+        // full 输出级别：克隆原图并绘制检测叠加图
+        timeStage(n, samplesFor("analyzeCubeFace_overlay"), [&] {
+            processedImg = img.clone();
+            analyzer.analyzeCubeFace(img, processedImg, true);
+        });
+
+        if (blocks.size() == 9) {
+            vector<ColorBlock> gridBlocks;
+            timeStage(n, samplesFor("assignToGrid"), [&] {
+                gridBlocks = blocks;
+                analyzer.assignToGrid(gridBlocks);
+            });
+
+            // 旋转 + 缺格 + 离群点：拟合后每个色块应回到原来的格子，离群点被剔除
+            vector<int> expected;
+            vector<ColorBlock> perturbed = perturbGrid(blocks, expected);
+            vector<ColorBlock> fitted;
+            LatticeFit fit;
+            timeStage(n, samplesFor("assignToGrid_perturbed"), [&] {
+                fitted = perturbed;
+                fit = analyzer.assignToGrid(fitted);
+            });
+            bool recovered = fit.ok && fitted.size() == 7;
+            for (const ColorBlock& b : fitted) {
+                for (size_t k = 0; k < perturbed.size(); k++) {
+                    if (perturbed[k].center == b.center && expected[k] != b.row * 3 + b.col) recovered = false;
+                }
+            }
+            agreement.gridPerturbed++;
+            if (recovered) agreement.gridRecovered++;
+        }
+
+        vector<vector<char>> colorMatrix = analyzer.createColorMatrix(blocks);
+        colorMatrices.push_back(colorMatrix);
+
+        Mat standardFace;
+        timeStage(n, samplesFor("drawStandardFace"), [&] {
+            standardFace = visualizer.drawStandardFace(colorMatrix, colorCodeMap, "Front");
+        });
+
+        Mat comparison;
+        timeStage(n, samplesFor("createComparisonImage"), [&] {
+            comparison = visualizer.createComparisonImage(overlay, colorMatrix, colorCodeMap, "Front");
+        });
+
+        timeStage(n, samplesFor("imwrite_processed"), [&] { imwrite(tmpPath, overlay); });
+        timeStage(n, samplesFor("imwrite_comparison"), [&] { imwrite(tmpPath, comparison); });
+    }
+
+    Mat cubeNet;
+    timeStage(n, samplesFor("drawCubeNet"), [&] {
+        cubeNet = visualizer.drawCubeNet(colorMatrices, colorCodeMap);
+    });
+
+    // 颜色标定：54 个色面的受限聚类（六张图都采到样本时）
+    if (calibrationSamples.size() == 6) {
+        ColorModel model;
+        timeStage(n, samplesFor("calibrate_cluster"), [&] {
+            analyzer.calibrate(calibrationSamples, "bench", model);
+        });
+    }
+
+    filesystem::remove(tmpPath);
+
+    for (const auto& s : stages) {
+        results.push_back(summarize(s.first, resolution, s.second));
+    }
+    agreements.push_back(agreement);
+}
+
+/*************************************************************
+ * 稳态分配计数：两个提取后端各统计一次（见 countSteadyStateAllocations；
+ * 不绘制叠加图的检查也可以单独运行 RubiksCubeAllocTest）
+ *************************************************************/
+static void benchSteadyStateAllocations(const vector<Mat>& images, const BenchOptions& opt,
+    const CubeFaceAnalyzer& analyzer, const CubeFaceAnalyzer& componentAnalyzer, bool nativeCounting,
+    vector<AllocationResult>& allocations) {
+    for (const CubeFaceAnalyzer* a : { &analyzer, &componentAnalyzer }) {
+        AllocationCounts counts = countSteadyStateAllocations(*a, images, opt.iterations, nativeCounting);
+        AllocationResult r;
+        r.resolution = images[0].size();
+        r.backend = a == &analyzer ? "contours" : "components";
+        r.heapPerFace = counts.heapPerFace;
+        r.matPerFace = counts.matPerFace;
+        r.nativePerFace = counts.nativePerFace;
+        allocations.push_back(r);
+    }
+}
+
+/*************************************************************
+ * 测量指标开销：同一分析器交替关闭/开启指标，比较 analyzeCubeFace
+ * （含叠加绘制）与 drawStandardFace 的平均耗时
+ *************************************************************/
+static OverheadResult benchMetricsOverhead(const vector<Mat>& images, const BenchOptions& opt,
+    CubeFaceAnalyzer& analyzer, CubeVisualizer& visualizer) {
+    PipelineMetrics metrics(analyzer.getColorNames());
+    map<char, Scalar> colorCodeMap = analyzer.getColorCodeMap();
+
+    double total[2] = { 0, 0 };
+    int runs = 0;
+    for (int i = 0; i < opt.iterations; i++) {
+        for (const Mat& img : images) {
+            for (int on = 0; on < 2; on++) {
+                analyzer.setMetrics(on ? &metrics : nullptr);
+                visualizer.setMetrics(on ? &metrics : nullptr);
+                Mat processedImg = img.clone();
+                int64 t = getTickCount();
+                vector<ColorBlock> blocks = analyzer.analyzeCubeFace(img, processedImg, true);
+                visualizer.drawStandardFace(analyzer.createColorMatrix(blocks), colorCodeMap);
+                total[on] += (getTickCount() - t) * 1000.0 / getTickFrequency();
+            }
+            runs++;
+        }
+    }
+    analyzer.setMetrics(nullptr);
+    visualizer.setMetrics(nullptr);
+
+    OverheadResult r;
+    r.resolution = images[0].size();
+    r.offMs = total[0] / runs;
+    r.onMs = total[1] / runs;
+    return r;
+}
+
+/*************************************************************
+ * 模板绘制与直接绘制的对照：先用若干组矩阵轮流覆盖全部可打印字符，
+ * 其余为随机颜色代码，面名称含一个没有模板的名称；逐像素比较并分别计时
+ *************************************************************/
+static vector<RenderResult> benchRendering(const BenchOptions& opt,
+    const CubeFaceAnalyzer& analyzer, const CubeVisualizer& visualizer) {
+    map<char, Scalar> colorCodeMap = analyzer.getColorCodeMap();
+    string codes = analyzer.getColorCodeString();
+    vector<string> names = { "Front", "Back", "Left", "Right", "Up", "Down", "", "Custom" };
+
+    RNG rng(12345);
+    int nextPrintable = 32;
+    vector<vector<vector<vector<char>>>> nets;
+    for (int n = 0; n < max(8, opt.iterations); n++) {
+        vector<vector<vector<char>>> net(6, vector<vector<char>>(3, vector<char>(3)));
+        for (auto& face : net) {
+            for (auto& row : face) {
+                for (char& code : row) {
+                    code = nextPrintable < 127 ? (char)nextPrintable++ : codes[rng.uniform(0, (int)codes.size())];
+                }
+            }
+        }
+        nets.push_back(net);
+    }
+
+    RenderResult face, net, panel;
+    face.target = "standard_face";
+    net.target = "cube_net";
+    panel.target = "cube_net_panel";
+    Mat canvas, reference, previous;
+    for (size_t n = 0; n < nets.size(); n++) {
+        for (int f = 0; f < 6; f++) {
+            const string& name = names[(n * 6 + f) % names.size()];
+            int64 t = getTickCount();
+            visualizer.drawStandardFace(nets[n][f], colorCodeMap, name, canvas);
+            face.atlasMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+            reference.create(canvas.size(), CV_8UC3);
+            t = getTickCount();
+            visualizer.renderStandardFaceDirect(reference, nets[n][f], colorCodeMap, name);
+            face.directMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+            face.compared++;
+            if (norm(canvas, reference, NORM_INF) == 0) face.identical++;
+        }
+
+        int64 t = getTickCount();
+        visualizer.drawCubeNet(nets[n], colorCodeMap, canvas);
+        net.atlasMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+        t = getTickCount();
+        reference = visualizer.drawCubeNetDirect(nets[n], colorCodeMap);
+        net.directMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+        net.compared++;
+        if (norm(canvas, reference, NORM_INF) == 0) net.identical++;
+
+        // 在上一张展开图上只重画一个面，必须与整张重新绘制的结果相同
+        if (n > 0) {
+            int p = (int)(n % 6);
+            vector<vector<vector<char>>> patched = nets[n - 1];
+            patched[p] = nets[n][p];
+            visualizer.drawCubeNet(nets[n - 1], colorCodeMap, previous);
+            t = getTickCount();
+            visualizer.redrawCubeNetPanel(previous, p, patched[p], colorCodeMap);
+            panel.atlasMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+            t = getTickCount();
+            visualizer.drawCubeNet(patched, colorCodeMap, reference);
+            panel.directMs += (getTickCount() - t) * 1000.0 / getTickFrequency();
+
+            panel.compared++;
+            if (norm(previous, reference, NORM_INF) == 0) panel.identical++;
+        }
+    }
+    for (RenderResult* r : { &face, &net, &panel }) {
+        r->atlasMs /= r->compared;
+        r->directMs /= r->compared;
+    }
+    return { face, net, panel };
+}
+
+/*************************************************************
+ * 分块并行分割的扩展曲线：线程数按 1, 2, 4, ... 直到 maxThreads，
+ * 每档同时设置 OpenCV 线程数与分块数；位掩码和色块与单线程结果逐位比较
+ *************************************************************/
+static vector<ScalingResult> benchSegmentScaling(const vector<Mat>& images, const BenchOptions& opt,
+    CubeFaceAnalyzer& analyzer) {
+    int maxThreads = opt.maxThreads > 0 ? opt.maxThreads : getNumberOfCPUs();
+    vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    int savedThreads = getNumThreads();
+    Mat unused;
+    int radius = max(1, 2 >> analyzer.resolvePyramidLevels(images[0]));
+    vector<Mat> refLabels(images.size());
+    vector<vector<ColorBlock>> refBlocks(images.size());
+    vector<ScalingResult> curve;
+    for (int threads : counts) {
+        setNumThreads(threads);
+        analyzer.setSegmentThreads(threads);
+        FrameContext ctx;
+        vector<double> segmentSamples, analyzeSamples;
+
+        ScalingResult r;
+        r.resolution = images[0].size();
+        r.threads = threads;
+        for (size_t i = 0; i < images.size(); i++) {
+            timeStage(opt.iterations, segmentSamples, [&] {
+                analyzer.segmentLabelsTiled(images[i], ctx.labels, radius, ctx);
+            });
+            timeStage(opt.iterations, analyzeSamples, [&] {
+                analyzer.analyzeCubeFace(images[i], ctx, unused, false);
+            });
+
+            if (threads == 1) {
+                refLabels[i] = ctx.labels.clone();
+                refBlocks[i] = ctx.blocks;
+            }
+            r.compared++;
+            if (norm(ctx.labels, refLabels[i], NORM_INF) == 0 && sameBlocks(ctx.blocks, refBlocks[i])) {
+                r.identical++;
+            }
+        }
+        r.segmentMs = summarize("", r.resolution, segmentSamples).meanMs;
+        r.analyzeMs = summarize("", r.resolution, analyzeSamples).meanMs;
+        curve.push_back(r);
+    }
+    analyzer.setSegmentThreads(1);
+    setNumThreads(savedThreads);
+    return curve;
+}
+
+/*************************************************************
+ * N x N 网格的合成测试：格子中心绕中心旋转 ±20°、随机缺格（至少留 N + 1 格）、
+ * 面外侧加两个离群色块，计时网格拟合与颜色矩阵填充并检查行列
+ *************************************************************/
+template<int N>
+static GridSizeResult benchGridSize(const BenchOptions& opt, const CubeFaceAnalyzer& analyzer) {
+    const vector<ColorRange>& colors = analyzer.getColorTable();
+    RNG rng(1000 + N);
+    GridSizeResult r;
+    r.n = N;
+    r.faces = max(50, opt.iterations * 10);
+
+    FaceMatrix<N> matrix;
+    vector<vector<char>> vectorMatrix;
+    vector<ColorBlock> blocks, fitted;
+    vector<int> expected;
+    for (int face = 0; face < r.faces; face++) {
+        float pitch = 60, angle = (float)rng.uniform(-20.0, 20.0) * (float)CV_PI / 180;
+        float c = cos(angle), s = sin(angle), mid = (N - 1) * pitch / 2;
+        auto place = [&](float x, float y) {
+            return Point2f(500 + c * (x - mid) - s * (y - mid), 500 + s * (x - mid) + c * (y - mid));
+        };
+
+        blocks.clear();
+        expected.clear();
+        for (int cell = 0; cell < N * N; cell++) {
+            if (N * N - (int)blocks.size() > LatticeFitN<N>::MIN_CELLS && rng.uniform(0.0, 1.0) < 0.1) continue;
+            ColorBlock b;
+            b.center = place(cell % N * pitch, cell / N * pitch);
+            b.colorName = colors[(cell + face) % colors.size()].name;
+            b.area = 0.64 * pitch * pitch;
+            blocks.push_back(b);
+            expected.push_back(cell);
+        }
+        for (int k = 0; k < 2; k++) {
+            ColorBlock outlier = blocks[k];
+            outlier.center = place(-1.6f * pitch, (k * (N - 1) + 0.5f) * pitch);
+            blocks.push_back(outlier);
+            expected.push_back(-1);
+        }
+
+        fitted = blocks;
+        int64 t = getTickCount();
+        LatticeFitN<N> fit = analyzer.assignToGrid<N>(fitted);
+        r.assignUs += (getTickCount() - t) * 1e6 / getTickFrequency();
+
+        bool recovered = fit.ok && fitted.size() == blocks.size() - 2;
+        for (const ColorBlock& b : fitted) {
+            for (size_t k = 0; k < blocks.size(); k++) {
+                if (blocks[k].center == b.center && expected[k] != b.row * N + b.col) recovered = false;
+            }
+        }
+        if (recovered) r.recovered++;
+
+        t = getTickCount();
+        analyzer.fillColorMatrix(fitted, matrix);
+        r.fillUs += (getTickCount() - t) * 1e6 / getTickFrequency();
+        if (N == 3) {
+            t = getTickCount();
+            analyzer.fillColorMatrix(fitted, vectorMatrix);
+            r.vectorFillUs += (getTickCount() - t) * 1e6 / getTickFrequency();
+        }
+    }
+    r.assignUs /= r.faces;
+    r.fillUs /= r.faces;
+    r.vectorFillUs /= r.faces;
+    return r;
+}
+
+static vector<GridSizeResult> benchGridSizes(const BenchOptions& opt, const CubeFaceAnalyzer& analyzer) {
+    return { benchGridSize<2>(opt, analyzer), benchGridSize<3>(opt, analyzer), benchGridSize<4>(opt, analyzer),
+        benchGridSize<5>(opt, analyzer), benchGridSize<6>(opt, analyzer), benchGridSize<7>(opt, analyzer) };
+}
+
+/*************************************************************
+ * 端到端的 3x3 面计时：真实图像上分割、填充颜色矩阵并绘制标准面，
+ * 定长矩阵与嵌套 vector 两条路径逐面交替，各用自己的帧上下文与画布，
+ * 两者受到的缓存与频率波动相同
+ *************************************************************/
+static FaceTimingResult benchFace3x3(const vector<Mat>& images, const BenchOptions& opt,
+    const CubeFaceAnalyzer& analyzer, const CubeVisualizer& visualizer) {
+    map<char, Scalar> colorCodeMap = analyzer.getColorCodeMap();
+    FaceTimingResult r;
+    r.resolution = images[0].size();
+    r.faces = (int)images.size();
+
+    FrameContext fixedCtx, nestedCtx;
+    FaceMatrix<3> fixedMatrix;
+    vector<vector<char>> nestedMatrix;
+    Mat fixedCanvas, nestedCanvas, unused;
+    auto runFixed = [&](const Mat& img) {
+        const vector<ColorBlock>& blocks = analyzer.analyzeCubeFace(img, fixedCtx, unused, false);
+        analyzer.fillColorMatrix(blocks, fixedMatrix);
+        visualizer.drawStandardFace(fixedMatrix, colorCodeMap, "Front", fixedCanvas);
+    };
+    auto runNested = [&](const Mat& img) {
+        const vector<ColorBlock>& blocks = analyzer.analyzeCubeFace(img, nestedCtx, unused, false);
+        analyzer.fillColorMatrix(blocks, nestedMatrix);
+        visualizer.drawStandardFace(nestedMatrix, colorCodeMap, "Front", nestedCanvas);
+    };
+
+    vector<double> fixedSamples, nestedSamples;
+    for (const Mat& img : images) {
+        runFixed(img);
+        runNested(img);
+        if (fixedMatrix.toVector() == nestedMatrix && fixedCanvas.size() == nestedCanvas.size()
+            && norm(fixedCanvas, nestedCanvas, NORM_INF) == 0) {
+            r.identical++;
+        }
+    }
+    for (int i = 0; i < opt.iterations; i++) {
+        for (const Mat& img : images) {
+            int64 t = getTickCount();
+            runFixed(img);
+            fixedSamples.push_back((getTickCount() - t) * 1000.0 / getTickFrequency());
+            t = getTickCount();
+            runNested(img);
+            nestedSamples.push_back((getTickCount() - t) * 1000.0 / getTickFrequency());
+        }
+    }
+    r.fixed = summarize("face_3x3_fixed", r.resolution, fixedSamples);
+    r.nested = summarize("face_3x3_vector", r.resolution, nestedSamples);
+    return r;
+}
+
+/*************************************************************
+ * 从上一次的结果 JSON 中取 "section": {... "key": 数值 ...}，
+ * 找不到时返回 0（只认本程序 writeJson 写出的格式）
+ *************************************************************/
+static double readBaseline(const string& path, const string& section, const string& key) {
+    ifstream in(path);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+    size_t pos = text.find("\"" + section + "\"");
+    if (pos == string::npos) return 0;
+    size_t end = text.find('}', pos);
+    pos = text.find("\"" + key + "\":", pos);
+    if (pos == string::npos || pos > end) return 0;
+    return atof(text.c_str() + pos + key.size() + 3);
+}
+
+/*************************************************************
+ * 流式模式的内存上限：peak RSS 只增不减，所以先跑流式再跑整幅，
+ * 各自记录 peak RSS 的增量；两个分析器与输入图像都在测量前准备好。
+ * 解码后的输入图像（input_bytes）不计入增量：这里验证的是分析本身
+ * 只占 O(宽 x 条带高度)，不是整个进程端到端的内存
+ *************************************************************/
+static StreamMemoryResult benchStreamMemory(const Mat& face, const BenchOptions& opt) {
+    Mat img;
+    resize(face, img, Size(), opt.streamScale, opt.streamScale, INTER_LINEAR);
+
+    CubeFaceAnalyzer streamAnalyzer;
+    streamAnalyzer.setVerbose(false);
+    streamAnalyzer.setStreaming(opt.streamRows);
+    CubeFaceAnalyzer fullAnalyzer;
+    fullAnalyzer.setVerbose(false);
+    fullAnalyzer.setExtractBackend(EXTRACT_COMPONENTS);
+    FrameContext streamCtx, fullCtx;
+    Mat unused;
+
+    StreamMemoryResult r;
+    r.resolution = img.size();
+    r.stripRows = opt.streamRows;
+    r.inputBytes = img.total() * img.elemSize();
+    r.bufferBytes = streamAnalyzer.streamingBufferBytes(img);
+
+    size_t before = peakRssBytes();
+    streamAnalyzer.analyzeCubeFace(img, streamCtx, unused, false);
+    size_t afterStream = peakRssBytes();
+    fullAnalyzer.analyzeCubeFace(img, fullCtx, unused, false);
+    size_t afterFull = peakRssBytes();
+
+    r.streamPeak = afterStream - before;
+    r.fullPeak = afterFull - before;
+    r.identical = sameBlocks(streamCtx.blocks, fullCtx.blocks);
+    return r;
+}
+
+/*************************************************************
+ * 从识别程序 codes 级别的输出中取出一个魔方六个面的颜色代码：
+ * 行首为 "<魔方名>:"，之后每面为 " <面名>=XXXXXXXXX"（'.' 为未识别）
+ *************************************************************/
+static int parseProcessFaces(const string& output, const string& cubeName, char colors[6][9]) {
+    istringstream in(output);
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, cubeName.size() + 1, cubeName + ":") != 0) continue;
+        int parsed = 0;
+        for (int f = 0; f < 6; f++) {
+            size_t pos = line.find(" " + faceNames[f] + "=");
+            if (pos == string::npos) continue;
+            pos += faceNames[f].size() + 2;
+            if (pos + 9 > line.size()) continue;
+            for (int i = 0; i < 9; i++) {
+                colors[f][i] = line[pos + i] == '.' ? ' ' : line[pos + i];
+            }
+            parsed++;
+        }
+        return parsed;
+    }
+    return 0;
+}
+
+/*************************************************************
+ * 嵌入式调用与每个魔方一个进程的对照（原始分辨率，单线程）：
+ * 六个面先编码成 JPEG 字节（不计时），两边都从这份字节开始：
+ * 进程内解码后交给 rcr_analyze_batch；对照流程把字节写成六个文件，
+ * 启动识别程序批处理这个目录，再从标准输出解析颜色代码。
+ * 两边的差只剩进程启动与文件读写
+ *************************************************************/
+static ApiResult benchApi(const vector<Mat>& originals, const BenchOptions& opt) {
+    ApiResult r;
+    rcr_options options;
+    rcr_default_options(&options);
+    rcr_analyzer* library = nullptr;
+    if (rcr_create(&options, &library) != RCR_OK) {
+        cerr << "无法创建识别库分析器" << endl;
+        return r;
+    }
+
+    vector<vector<uchar>> jpegs(originals.size());
+    for (size_t f = 0; f < originals.size(); f++) {
+        imencode(".jpg", originals[f], jpegs[f]);
+    }
+    vector<Mat> decoded(originals.size());
+    vector<rcr_image> images(originals.size());
+    vector<rcr_face_result> results(originals.size());
+
+    vector<double> samples;
+    int status = RCR_OK;
+    timeStage(opt.iterations, samples, [&] {
+        for (size_t f = 0; f < jpegs.size(); f++) {
+            decoded[f] = imdecode(jpegs[f], IMREAD_COLOR);
+            images[f] = { decoded[f].data, decoded[f].cols, decoded[f].rows, (int64_t)decoded[f].step };
+        }
+        status = rcr_analyze_batch(library, images.size(), images.data(), sizeof(rcr_image),
+            results.data(), sizeof(rcr_face_result), nullptr, 0);
+    });
+    if (status != RCR_OK) {
+        cerr << "识别库批量分析失败：" << rcr_status_message(status) << endl;
+        rcr_destroy(library);
+        return r;
+    }
+    r.inProcess = summarize("api_batch", originals[0].size(), samples);
+
+    // C 接口只是包装，颜色矩阵必须与直接调用分析器相同
+    CubeFaceAnalyzer analyzer;
+    analyzer.setVerbose(false);
+    FrameContext ctx;
+    FaceMatrix<3> matrix;
+    Mat unused;
+    for (size_t f = 0; f < decoded.size(); f++) {
+        analyzer.fillColorMatrix(analyzer.analyzeCubeFace(decoded[f], ctx, unused, false), matrix);
+        r.faces++;
+        if (memcmp(matrix.cells, results[f].colors, 9) == 0) r.cppMatches++;
+    }
+    rcr_destroy(library);
+
+    if (opt.processExe.empty()) return r;
+
+    filesystem::path cubeDir = filesystem::temp_directory_path() / "RubiksCubeBenchmark" / "cube";
+    filesystem::create_directories(cubeDir);
+    string command = "\"" + opt.processExe + "\" --batch \"" + cubeDir.string()
+        + "\" --output-level codes --threads 1";
+    string output;
+    samples.clear();
+    for (int i = 0; i <= opt.iterations; i++) {
+        int64 t = getTickCount();
+        for (size_t f = 0; f < jpegs.size(); f++) {
+            ofstream file(cubeDir / ("cubeface" + to_string(f + 1) + ".jpg"), ios::binary | ios::trunc);
+            file.write((const char*)jpegs[f].data(), jpegs[f].size());
+        }
+        int exitCode = runCommand(command, output);
+        double ms = (getTickCount() - t) * 1000.0 / getTickFrequency();
+        if (exitCode != 0) {
+            cerr << "识别程序运行失败（退出码 " << exitCode << "）：" << command << endl;
+            break;
+        }
+        if (i > 0) samples.push_back(ms);  // 第一次为预热
+    }
+    if (!samples.empty()) {
+        char colors[6][9];
+        r.processRun = true;
+        r.perProcess = summarize("process_per_cube", originals[0].size(), samples);
+        r.processFaces = parseProcessFaces(output, cubeDir.filename().string(), colors);
+        for (int f = 0; f < 6 && r.processFaces == 6; f++) {
+            if (memcmp(colors[f], results[f].colors, 9) == 0) r.processMatches++;
+        }
+    }
+    error_code ec;
+    filesystem::remove_all(cubeDir.parent_path(), ec);
+    return r;
+}
+
+/*************************************************************
+ * 结果缓存的正确性：在临时目录中
+ * 1) 写入六个面的识别库结果，外加一张找不到网格的纯色图的结果，读回逐字节比较（往返）；
+ * 2) 把条目截断、改坏 magic、追加字节、清空、用别的条目覆盖，都必须按未命中处理，
+ *    重新写入后再次命中；
+ * 3) 多个线程对同一组键交替写入两个版本并同时读取，读到的必须是其中之一
+ *************************************************************/
+static CacheTestResult benchResultCache(const vector<Mat>& images) {
+    CacheTestResult r;
+    rcr_options options;
+    rcr_default_options(&options);
+    rcr_analyzer* library = nullptr;
+    if (rcr_create(&options, &library) != RCR_OK) return r;
+
+    vector<Mat> faces = images;
+    faces.push_back(Mat(images[0].size(), CV_8UC3, Scalar(128, 128, 128)));
+    size_t n = faces.size();
+    vector<rcr_image> views;
+    for (const Mat& img : faces) {
+        views.push_back({ img.data, img.cols, img.rows, (int64_t)img.step });
+    }
+    // 每个键两个版本：识别库的结果，以及第一个格子面积加 1 的副本
+    vector<rcr_face_result> results[2] = { vector<rcr_face_result>(n), vector<rcr_face_result>(n) };
+    int status = rcr_analyze_batch(library, n, views.data(), sizeof(rcr_image),
+        results[0].data(), sizeof(rcr_face_result), nullptr, 0);
+    uint64_t settings = rcr_settings_hash(library);
+    rcr_destroy(library);
+    if (status != RCR_OK) return r;
+    for (size_t i = 0; i < n; i++) {
+        results[1][i] = results[0][i];
+        results[1][i].cells[0].area += 1;
+    }
+
+    filesystem::path root = filesystem::temp_directory_path() / ("rcr_cache_test_" + to_string(random_device{}()));
+    ImageLoader loader(false);
+    {
+        ResultCache cache(root.string(), settings, loader);
+        r.opened = cache.isOpen();
+        if (!r.opened) return r;
+
+        vector<uint64_t> keys(n);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = hashBytes(&i, sizeof(i), 0x5eed);
+        }
+
+        // 1) 往返
+        rcr_face_result face;
+        for (size_t i = 0; i < n; i++) {
+            if (!cache.store(keys[i], results[0][i])) continue;
+            r.entries++;
+            int64 t = getTickCount();
+            bool hit = cache.lookup(keys[i], face);
+            r.lookupUs += (getTickCount() - t) * 1e6 / getTickFrequency();
+            if (hit && sameResult(face, results[0][i])) r.roundTrips++;
+        }
+        r.lookupUs /= max(1, r.entries);
+
+        // 2) 损坏：按键取条目文件，逐个套用一种损坏方式
+        auto entryFile = [&](size_t i) {
+            return filesystem::path(cache.getEntryPath(keys[i]));
+        };
+        auto readAll = [](const filesystem::path& path) {
+            ifstream in(path, ios::binary);
+            return vector<char>(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        };
+        auto writeAll = [](const filesystem::path& path, const vector<char>& data) {
+            ofstream out(path, ios::binary | ios::trunc);
+            out.write(data.data(), (streamsize)data.size());
+        };
+        for (size_t i = 0; i < n; i++) {
+            vector<char> data = readAll(entryFile(i));
+            if (data.empty()) continue;
+            switch (i % 5) {
+            case 0: data.resize(data.size() / 2); break;         // 截断
+            case 1: data[0] ^= 0x20; break;                      // magic
+            case 2: data.insert(data.end(), 7, '\0'); break;     // 多余字节
+            case 3: data.clear(); break;                         // 空文件
+            case 4: data = readAll(entryFile((i + 1) % n)); break; // 别的键的条目
+            }
+            writeAll(entryFile(i), data);
+            r.corruptions++;
+            if (!cache.lookup(keys[i], face)) r.corruptMisses++;
+            if (cache.store(keys[i], results[0][i]) && cache.lookup(keys[i], face) && sameResult(face, results[0][i])) {
+                r.rewrites++;
+            }
+        }
+
+        // 3) 并发：写线程交替写两个版本（改名失败时跳过，如 Windows 上目标正被映射），
+        //    读线程命中时必须与某个版本完全相同
+        const int rounds = 200;
+        atomic<int> reads{ 0 }, bad{ 0 };
+        vector<thread> workers;
+        for (int w = 0; w < 4; w++) {
+            workers.emplace_back([&, w] {
+                rcr_face_result local;
+                for (int k = 0; k < rounds; k++) {
+                    size_t i = (size_t)(k + w) % n;
+                    if (w < 2) {
+                        cache.store(keys[i], results[(k + w) & 1][i]);
+                    }
+                    else if (cache.lookup(keys[i], local)) {
+                        reads++;
+                        if (!sameResult(local, results[0][i]) && !sameResult(local, results[1][i])) bad++;
+                    }
+                }
+            });
+        }
+        for (auto& t : workers) t.join();
+        r.concurrentReads = reads;
+        r.concurrentBad = bad;
+    }
+    error_code ec;
+    filesystem::remove_all(root, ec);
+    return r;
+}
+
+/*************************************************************
+ * 输出 JSON
+ *************************************************************/
+static void writeJson(ostream& out, const BenchOptions& opt, double lutBuildMs,
+    const vector<BenchResult>& results, const vector<OverheadResult>& overheads,
+    const vector<AgreementResult>& agreements, const vector<AllocationResult>& allocations,
+    const vector<RenderResult>& renders, const vector<ScalingResult>& scaling,
+    const vector<GridSizeResult>& gridSizes, const FaceTimingResult& face3, const StreamMemoryResult& stream,
+    const ApiResult& api, const CacheTestResult& cacheTest) {
+    out << fixed << setprecision(4);
+    out << "{\n";
+    out << "  \"iterations\": " << opt.iterations << ",\n";
+    out << "  \"lut_build_ms\": " << lutBuildMs << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"stage\": \"" << r.stage << "\", "
+            << "\"width\": " << r.resolution.width << ", "
+            << "\"height\": " << r.resolution.height << ", "
+            << "\"samples\": " << r.samples << ", "
+            << "\"mean_ms\": " << r.meanMs << ", "
+            << "\"p50_ms\": " << r.p50Ms << ", "
+            << "\"p99_ms\": " << r.p99Ms << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"metrics_overhead\": [\n";
+    for (size_t i = 0; i < overheads.size(); i++) {
+        const OverheadResult& r = overheads[i];
+        out << "    {\"width\": " << r.resolution.width << ", "
+            << "\"height\": " << r.resolution.height << ", "
+            << "\"off_ms\": " << r.offMs << ", "
+            << "\"on_ms\": " << r.onMs << ", "
+            << "\"overhead_pct\": " << (r.offMs > 0 ? 100.0 * (r.onMs - r.offMs) / r.offMs : 0.0) << "}"
+            << (i + 1 < overheads.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"backend_agreement\": [\n";
+    for (size_t i = 0; i < agreements.size(); i++) {
+        const AgreementResult& r = agreements[i];
+        out << "    {\"width\": " << r.resolution.width << ", "
+            << "\"height\": " << r.resolution.height << ", "
+            << "\"faces\": " << r.faces << ", "
+            << "\"count_matches\": " << r.countMatches << ", "
+            << "\"block_matches\": " << r.blockMatches << ", "
+            << "\"matrix_matches\": " << r.matrixMatches << ", "
+            << "\"max_center_delta_px\": " << r.maxCenterDelta << ", "
+            << "\"grid_perturbed\": " << r.gridPerturbed << ", "
+            << "\"grid_recovered\": " << r.gridRecovered << "}"
+            << (i + 1 < agreements.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"steady_state_allocations\": [\n";
+    for (size_t i = 0; i < allocations.size(); i++) {
+        const AllocationResult& r = allocations[i];
+        out << "    {\"width\": " << r.resolution.width << ", "
+            << "\"height\": " << r.resolution.height << ", "
+            << "\"backend\": \"" << r.backend << "\", "
+            << "\"heap_allocs_per_face\": " << r.heapPerFace << ", "
+            << "\"mat_allocs_per_face\": " << r.matPerFace << ", "
+            << "\"native_allocs_per_face\": " << r.nativePerFace << "}"
+            << (i + 1 < allocations.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"rendering\": [\n";
+    for (size_t i = 0; i < renders.size(); i++) {
+        const RenderResult& r = renders[i];
+        out << "    {\"target\": \"" << r.target << "\", "
+            << "\"atlas_mean_ms\": " << r.atlasMs << ", "
+            << "\"direct_mean_ms\": " << r.directMs << ", "
+            << "\"speedup\": " << (r.atlasMs > 0 ? r.directMs / r.atlasMs : 0.0) << ", "
+            << "\"compared\": " << r.compared << ", "
+            << "\"identical\": " << r.identical << "}"
+            << (i + 1 < renders.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"segment_scaling\": [\n";
+    for (size_t i = 0; i < scaling.size(); i++) {
+        const ScalingResult& r = scaling[i];
+        out << "    {\"width\": " << r.resolution.width << ", "
+            << "\"height\": " << r.resolution.height << ", "
+            << "\"threads\": " << r.threads << ", "
+            << "\"segment_mean_ms\": " << r.segmentMs << ", "
+            << "\"segment_speedup\": " << (r.segmentMs > 0 ? scaling[0].segmentMs / r.segmentMs : 0.0) << ", "
+            << "\"analyze_mean_ms\": " << r.analyzeMs << ", "
+            << "\"analyze_speedup\": " << (r.analyzeMs > 0 ? scaling[0].analyzeMs / r.analyzeMs : 0.0) << ", "
+            << "\"compared\": " << r.compared << ", "
+            << "\"identical\": " << r.identical << "}"
+            << (i + 1 < scaling.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"grid_sizes\": [\n";
+    for (size_t i = 0; i < gridSizes.size(); i++) {
+        const GridSizeResult& r = gridSizes[i];
+        out << "    {\"n\": " << r.n << ", "
+            << "\"scope\": \"assign_and_fill\", "
+            << "\"faces\": " << r.faces << ", "
+            << "\"recovered\": " << r.recovered << ", "
+            << "\"assign_mean_us\": " << r.assignUs << ", "
+            << "\"fill_mean_us\": " << r.fillUs;
+        if (r.n == 3) out << ", \"vector_fill_mean_us\": " << r.vectorFillUs;
+        out << "}" << (i + 1 < gridSizes.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"face_3x3\": {\"width\": " << face3.resolution.width << ", "
+        << "\"height\": " << face3.resolution.height << ", "
+        << "\"scope\": \"analyze_fill_draw\", "
+        << "\"samples\": " << face3.fixed.samples << ", "
+        << "\"identical\": " << face3.identical << ", "
+        << "\"faces\": " << face3.faces << ", "
+        << "\"fixed_mean_ms\": " << face3.fixed.meanMs << ", "
+        << "\"fixed_p50_ms\": " << face3.fixed.p50Ms << ", "
+        << "\"vector_mean_ms\": " << face3.nested.meanMs << ", "
+        << "\"vector_p50_ms\": " << face3.nested.p50Ms << ", "
+        << "\"baseline_mean_ms\": " << face3.baselineMs << "},\n";
+    out << "  \"stream_memory\": {\"width\": " << stream.resolution.width << ", "
+        << "\"height\": " << stream.resolution.height << ", "
+        << "\"strip_rows\": " << stream.stripRows << ", "
+        << "\"input_bytes\": " << stream.inputBytes << ", "
+        << "\"buffer_bytes\": " << stream.bufferBytes << ", "
+        << "\"stream_peak_delta_bytes\": " << stream.streamPeak << ", "
+        << "\"peak_excludes_input\": true, "
+        << "\"full_peak_delta_bytes\": " << stream.fullPeak << ", "
+        << "\"identical\": " << (stream.identical ? "true" : "false") << "},\n";
+    out << "  \"api_vs_process\": {\"width\": " << api.inProcess.resolution.width << ", "
+        << "\"height\": " << api.inProcess.resolution.height << ", "
+        << "\"api_mean_ms\": " << api.inProcess.meanMs << ", "
+        << "\"api_p50_ms\": " << api.inProcess.p50Ms << ", "
+        << "\"api_p99_ms\": " << api.inProcess.p99Ms << ", "
+        << "\"faces\": " << api.faces << ", "
+        << "\"api_matches_cpp\": " << api.cppMatches;
+    if (api.processRun) {
+        out << ", \"process_mean_ms\": " << api.perProcess.meanMs << ", "
+            << "\"process_p50_ms\": " << api.perProcess.p50Ms << ", "
+            << "\"process_p99_ms\": " << api.perProcess.p99Ms << ", "
+            << "\"speedup\": " << (api.inProcess.meanMs > 0 ? api.perProcess.meanMs / api.inProcess.meanMs : 0.0) << ", "
+            << "\"process_faces\": " << api.processFaces << ", "
+            << "\"process_matches\": " << api.processMatches;
+    }
+    out << "},\n";
+    out << "  \"result_cache\": {\"opened\": " << (cacheTest.opened ? "true" : "false") << ", "
+        << "\"entries\": " << cacheTest.entries << ", "
+        << "\"round_trips\": " << cacheTest.roundTrips << ", "
+        << "\"corruptions\": " << cacheTest.corruptions << ", "
+        << "\"corrupt_misses\": " << cacheTest.corruptMisses << ", "
+        << "\"rewrites\": " << cacheTest.rewrites << ", "
+        << "\"concurrent_reads\": " << cacheTest.concurrentReads << ", "
+        << "\"concurrent_bad\": " << cacheTest.concurrentBad << ", "
+        << "\"lookup_mean_us\": " << cacheTest.lookupUs << "}\n";
+    out << "}\n";
+}
+
+static vector<double> parseScales(const string& text) {
+    vector<double> scales;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) scales.push_back(atof(item.c_str()));
+    }
+    return scales;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc) {
+            opt.dataDir = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            opt.outputFile = argv[++i];
+        }
+        else if (arg == "--iterations" && i + 1 < argc) {
+            opt.iterations = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--scales" && i + 1 < argc) {
+            opt.scales = parseScales(argv[++i]);
+        }
+        else if (arg == "--scaling-scale" && i + 1 < argc) {
+            opt.scalingScale = atof(argv[++i]);
+        }
+        else if (arg == "--max-threads" && i + 1 < argc) {
+            opt.maxThreads = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--stream-scale" && i + 1 < argc) {
+            opt.streamScale = atof(argv[++i]);
+        }
+        else if (arg == "--stream-rows" && i + 1 < argc) {
+            opt.streamRows = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--process-exe" && i + 1 < argc) {
+            opt.processExe = argv[++i];
+        }
+        else if (arg == "--baseline" && i + 1 < argc) {
+            opt.baselineFile = argv[++i];
+        }
+        else {
+            cerr << "用法：" << argv[0]
+                << " [--data 目录] [--output 结果.json] [--iterations N] [--scales 0.5,1,2,4]"
+                << " [--scaling-scale 4] [--max-threads N] [--stream-scale 8] [--stream-rows N]"
+                << " [--process-exe RubiksCubeRecognition 路径] [--baseline 上次结果.json]" << endl;
+            return 1;
+        }
+    }
+
+    vector<Mat> originals;
+    for (int i = 1; i <= 6; i++) {
+        string path = (filesystem::path(opt.dataDir) / ("cubeface" + to_string(i) + ".jpg")).string();
+        Mat img = imread(path);
+        if (img.empty()) {
+            cerr << "无法加载图像：" << path << endl;
+            return 1;
+        }
+        originals.push_back(img);
+    }
+
+    // 流式内存测试必须最先运行：之后的大图测试会抬高 peak RSS
+    cerr << "流式分割内存 " << opt.streamScale << "x ..." << endl;
+    StreamMemoryResult stream = benchStreamMemory(originals[0], opt);
+
+    static CountingMatAllocator countingAllocator;
+    Mat::setDefaultAllocator(&countingAllocator);
+    bool nativeCounting = installNativeCounting();
+    if (!nativeCounting) {
+        cerr << "警告：本平台无法统计 OpenCV 内部的原生分配，零分配检查只覆盖 operator new 与 Mat" << endl;
+    }
+
+    CubeFaceAnalyzer analyzer;
+    analyzer.setVerbose(false);
+    CubeFaceAnalyzer componentAnalyzer;
+    componentAnalyzer.setVerbose(false);
+    componentAnalyzer.setExtractBackend(EXTRACT_COMPONENTS);
+    CubeFaceAnalyzer quadAnalyzer;
+    quadAnalyzer.setVerbose(false);
+    quadAnalyzer.setDetectMode(DETECT_QUAD);
+    CubeVisualizer visualizer;
+
+    vector<BenchResult> results;
+    vector<OverheadResult> overheads;
+    vector<AgreementResult> agreements;
+    vector<AllocationResult> allocations;
+    for (double scale : opt.scales) {
+        vector<Mat> images;
+        for (const Mat& img : originals) {
+            Mat scaled;
+            resize(img, scaled, Size(), scale, scale, scale < 1.0 ? INTER_AREA : INTER_LINEAR);
+            images.push_back(scaled);
+        }
+        cerr << "基准测试分辨率 " << images[0].cols << "x" << images[0].rows << " ..." << endl;
+        benchResolution(images, opt, analyzer, componentAnalyzer, quadAnalyzer, visualizer, results, agreements);
+        overheads.push_back(benchMetricsOverhead(images, opt, analyzer, visualizer));
+        benchSteadyStateAllocations(images, opt, analyzer, componentAnalyzer, nativeCounting, allocations);
+    }
+    vector<RenderResult> renders = benchRendering(opt, analyzer, visualizer);
+
+    // 大图上的分块并行扩展曲线（连通域后端，全分辨率检测）
+    vector<Mat> largeImages;
+    for (const Mat& img : originals) {
+        Mat scaled;
+        resize(img, scaled, Size(), opt.scalingScale, opt.scalingScale,
+            opt.scalingScale < 1.0 ? INTER_AREA : INTER_LINEAR);
+        largeImages.push_back(scaled);
+    }
+    cerr << "分块并行扩展曲线 " << largeImages[0].cols << "x" << largeImages[0].rows << " ..." << endl;
+    vector<ScalingResult> scaling = benchSegmentScaling(largeImages, opt, componentAnalyzer);
+
+    cerr << "网格大小 2x2 ~ 7x7 ..." << endl;
+    vector<GridSizeResult> gridSizes = benchGridSizes(opt, analyzer);
+
+    cerr << "端到端 3x3 面（定长矩阵 / 嵌套 vector）..." << endl;
+    FaceTimingResult face3 = benchFace3x3(originals, opt, analyzer, visualizer);
+    if (!opt.baselineFile.empty()) {
+        face3.baselineMs = readBaseline(opt.baselineFile, "face_3x3", "fixed_mean_ms");
+        if (face3.baselineMs <= 0) cerr << "警告：基线文件中没有 face_3x3 的 fixed_mean_ms：" << opt.baselineFile << endl;
+    }
+
+    cerr << "C 接口批量调用" << (opt.processExe.empty() ? "" : " / 每个魔方一个进程") << " ..." << endl;
+    ApiResult api = benchApi(originals, opt);
+
+    cerr << "结果缓存往返 / 损坏 / 并发 ..." << endl;
+    CacheTestResult cacheTest = benchResultCache(originals);
+
+    if (opt.outputFile.empty()) {
+        writeJson(cout, opt, analyzer.getLutBuildMs(), results, overheads, agreements, allocations, renders, scaling, gridSizes, face3, stream, api, cacheTest);
+    }
+    else {
+        ofstream out(opt.outputFile);
+        writeJson(out, opt, analyzer.getLutBuildMs(), results, overheads, agreements, allocations, renders, scaling, gridSizes, face3, stream, api, cacheTest);
+        cerr << "结果已保存到 " << opt.outputFile << endl;
+    }
+
+    // 零分配检查：两个提取后端（默认设置、不绘制）预热后每个面都不应再分配，
+    // 包括 OpenCV 内部的原生分配
+    int status = 0;
+    for (const AllocationResult& r : allocations) {
+        if (r.heapPerFace > 0 || r.matPerFace > 0 || r.nativePerFace > 0) {
+            cerr << "错误：" << r.resolution.width << "x" << r.resolution.height << " " << r.backend
+                << " 后端稳态仍有分配（每面 operator new " << r.heapPerFace << " 次，Mat " << r.matPerFace
+                << " 次，原生 " << r.nativePerFace << " 次）" << endl;
+            status = 2;
+        }
+    }
+
+    // 连通域后端跟踪与 findContours 相同的外轮廓，色块列表必须与轮廓后端逐位相同
+    for (const AgreementResult& r : agreements) {
+        if (r.blockMatches != r.faces) {
+            cerr << "错误：" << r.resolution.width << "x" << r.resolution.height << " 有 " << r.faces - r.blockMatches
+                << " / " << r.faces << " 个面的连通域后端色块与轮廓后端不一致" << endl;
+            status = 2;
+        }
+    }
+
+    // 模板绘制必须与直接绘制逐像素一致
+    for (const RenderResult& r : renders) {
+        if (r.identical != r.compared) {
+            cerr << "错误：" << r.target << " 模板绘制与直接绘制有 " << r.compared - r.identical
+                << " / " << r.compared << " 张图不一致" << endl;
+            status = 2;
+        }
+    }
+
+    // 分块并行结果必须与单线程逐位一致
+    for (const ScalingResult& r : scaling) {
+        if (r.identical != r.compared) {
+            cerr << "错误：" << r.threads << " 线程分块分割有 " << r.compared - r.identical
+                << " / " << r.compared << " 个面与单线程结果不一致" << endl;
+            status = 2;
+        }
+    }
+
+    // 端到端 3x3 面：定长矩阵与嵌套 vector 结果相同，中位数不慢于嵌套 vector 5%；
+    // 给了基线时平均耗时不比基线慢 10%
+    if (face3.identical != face3.faces) {
+        cerr << "错误：端到端 3x3 面有 " << face3.faces - face3.identical << " / " << face3.faces
+            << " 个面定长矩阵与嵌套 vector 的结果不一致" << endl;
+        status = 2;
+    }
+    if (face3.fixed.p50Ms > face3.nested.p50Ms * 1.05) {
+        cerr << "错误：端到端 3x3 面定长矩阵中位数 " << face3.fixed.p50Ms << " ms，慢于嵌套 vector 的 "
+            << face3.nested.p50Ms << " ms" << endl;
+        status = 2;
+    }
+    if (face3.baselineMs > 0 && face3.fixed.meanMs > face3.baselineMs * 1.10) {
+        cerr << "错误：端到端 3x3 面平均 " << face3.fixed.meanMs << " ms，比基线 " << face3.baselineMs
+            << " ms 慢 " << (face3.fixed.meanMs / face3.baselineMs - 1) * 100 << "%" << endl;
+        status = 2;
+    }
+
+    // 流式模式的 peak RSS 增量应与条带缓冲同一量级（留出线程栈与分配器的余量），
+    // 且色块与整幅分析逐位相同
+    size_t streamLimit = 2 * stream.bufferBytes + (16 << 20);
+    if (stream.streamPeak > streamLimit) {
+        cerr << "错误：流式分割 peak RSS 增加 " << stream.streamPeak / 1024 << " KB，超过上限 "
+            << streamLimit / 1024 << " KB（整幅分析增加 " << stream.fullPeak / 1024 << " KB）" << endl;
+        status = 2;
+    }
+    if (!stream.identical) {
+        cerr << "错误：流式分割的色块与整幅分析不一致" << endl;
+        status = 2;
+    }
+
+    // C 接口与直接调用分析器的结果必须相同；子进程解码同一份 JPEG 字节，也必须相同
+    if (api.cppMatches != api.faces || api.faces == 0) {
+        cerr << "错误：C 接口有 " << api.faces - api.cppMatches << " / " << api.faces
+            << " 个面与直接调用分析器的颜色矩阵不一致" << endl;
+        status = 2;
+    }
+    if (api.processRun && api.processMatches != api.faces) {
+        cerr << "错误：子进程有 " << api.faces - api.processMatches << " / " << api.faces
+            << " 个面与 C 接口的颜色矩阵不一致" << endl;
+        status = 2;
+    }
+
+    // 结果缓存：往返逐位相同，损坏条目一律未命中且可重新写入，并发读不到残缺或混合的条目
+    if (!cacheTest.opened || cacheTest.entries == 0 || cacheTest.roundTrips != cacheTest.entries
+        || cacheTest.corruptMisses != cacheTest.corruptions || cacheTest.rewrites != cacheTest.corruptions
+        || cacheTest.concurrentBad > 0) {
+        cerr << "错误：结果缓存测试失败（往返 " << cacheTest.roundTrips << " / " << cacheTest.entries
+            << "，损坏未命中 " << cacheTest.corruptMisses << " / " << cacheTest.corruptions
+            << "，重新写入 " << cacheTest.rewrites << "，并发读错 " << cacheTest.concurrentBad << "）" << endl;
+        status = 2;
+    }
+    return status;
+}
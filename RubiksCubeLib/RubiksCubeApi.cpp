@@ -0,0 +1,633 @@
+﻿#include "RubiksCubeApi.h"
+#include "../RubiksCubeRecognition/CubeRecognition.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+
+// 第 1 版结构体的大小：批量接口接受的元素大小下限（结构体只在末尾追加字段，目前即第 1 版）
+static const size_t IMAGE_SIZE_V1 = sizeof(rcr_image);
+static const size_t RESULT_SIZE_V1 = sizeof(rcr_face_result);
+static const size_t CANVAS_SIZE_V1 = sizeof(rcr_canvas);
+
+/*************************************************************
+ * 一次 rcr_analyze_batch 调用：调用线程与空闲的常驻工作线程按下标领取面。
+ * 数组按调用方给出的元素大小寻址，逐个复制到本地结构体（不要求对齐）
+ *************************************************************/
+struct BatchCall {
+    size_t count = 0;
+    const uint8_t* images = nullptr;
+    size_t imageSize = 0;
+    uint8_t* results = nullptr;
+    size_t resultSize = 0;
+    const uint8_t* overlays = nullptr;  // 可为空
+    size_t overlaySize = 0;
+    atomic<size_t> next{ 0 };
+    int helpers = 0;                    // 正在处理这次调用的工作线程数（poolMutex 保护）
+};
+
+static void analyzeFace(const rcr_analyzer& handle, FrameContext& ctx, BatchCall& call, size_t i);
+
+/*************************************************************
+ * 句柄：一个配置好的分析器与可视化器（构造后只读，所有调用共享），
+ * 帧上下文池，以及 threads - 1 个常驻工作线程。
+ * 每个分析线程从池中取一份帧上下文，用完放回，
+ * 缓冲在调用之间复用，稳定负载下（默认分割设置、不要叠加图）分析一个面不再分配；
+ * 工作线程在句柄创建时启动、销毁时结束，批量调用不再临时创建线程
+ *************************************************************/
+struct rcr_analyzer {
+    CubeFaceAnalyzer analyzer;
+    CubeVisualizer visualizer;
+    map<char, Scalar> colorCodeMap;
+    string colorCodes;
+    vector<string> colorNames;
+    unique_ptr<PipelineMetrics> metrics;  // collect_metrics 为 0 时为空
+
+    mutex contextMutex;
+    vector<unique_ptr<FrameContext>> idleContexts;
+
+    mutex poolMutex;
+    condition_variable workAvailable;     // 有新的批量调用或要求退出
+    condition_variable helperDone;        // 某次调用的工作线程数降为 0
+    deque<BatchCall*> pending;            // 还有面未领取的调用
+    vector<thread> workers;
+    bool stopping = false;
+
+    ~rcr_analyzer() {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    unique_ptr<FrameContext> acquireContext() {
+        {
+            lock_guard<mutex> lock(contextMutex);
+            if (!idleContexts.empty()) {
+                unique_ptr<FrameContext> ctx = move(idleContexts.back());
+                idleContexts.pop_back();
+                return ctx;
+            }
+        }
+        return make_unique<FrameContext>();
+    }
+
+    void releaseContext(unique_ptr<FrameContext> ctx) {
+        lock_guard<mutex> lock(contextMutex);
+        idleContexts.push_back(move(ctx));
+    }
+
+    // 领取并分析 call 中剩余的面，直到全部领完
+    void analyzeRemaining(BatchCall& call) {
+        unique_ptr<FrameContext> ctx = acquireContext();
+        for (size_t i; (i = call.next++) < call.count;) {
+            analyzeFace(*this, *ctx, call, i);
+        }
+        releaseContext(move(ctx));
+    }
+
+    // 从队列中移除已领完的调用（持有 poolMutex 时调用）
+    void retire(BatchCall* call) {
+        auto it = find(pending.begin(), pending.end(), call);
+        if (it != pending.end()) pending.erase(it);
+    }
+
+    /*********************************************************
+     * 常驻工作线程：等待队首的调用并帮它领取面。
+     * 取不到帧上下文（内存不足）时放弃这次帮忙，剩下的面由调用线程完成
+     *********************************************************/
+    void workerLoop() {
+        unique_lock<mutex> lock(poolMutex);
+        for (;;) {
+            workAvailable.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (stopping) return;
+            BatchCall* call = pending.front();
+            call->helpers++;
+            lock.unlock();
+            try {
+                analyzeRemaining(*call);
+            }
+            catch (...) {
+            }
+            lock.lock();
+            retire(call);
+            if (--call->helpers == 0) helperDone.notify_all();
+        }
+    }
+};
+
+/*************************************************************
+ * 调用方的图像、画布按指针与行跨度包装，不复制
+ *************************************************************/
+static bool validImage(const rcr_image& image) {
+    return image.data && image.width > 0 && image.height > 0 && image.stride >= (int64_t)image.width * 3;
+}
+
+static Mat wrapImage(const rcr_image& image) {
+    return Mat(image.height, image.width, CV_8UC3, (void*)image.data, (size_t)image.stride);
+}
+
+// 画布须可写且尺寸等于 size；成功时 target 直接指向调用方的缓冲
+static bool wrapCanvas(const rcr_canvas* canvas, Size size, Mat& target) {
+    if (!canvas || !canvas->data || canvas->width != size.width || canvas->height != size.height ||
+        canvas->stride < (int64_t)canvas->width * 3) {
+        return false;
+    }
+    target = Mat(canvas->height, canvas->width, CV_8UC3, canvas->data, (size_t)canvas->stride);
+    return true;
+}
+
+// 9 个颜色代码（行优先）-> 3x3 颜色矩阵（定长，不分配堆内存）
+static FaceMatrix<3> toMatrix(const char* colors) {
+    FaceMatrix<3> matrix;
+    matrix.assign(colors);
+    return matrix;
+}
+
+static string labelText(const char* label) {
+    return label ? string(label) : string();
+}
+
+/*************************************************************
+ * 分析一个面并填写结果；需要叠加图时先把原图复制到调用方的画布再绘制
+ *************************************************************/
+static void analyzeFace(const rcr_analyzer& handle, FrameContext& ctx, const rcr_image& image,
+    const rcr_canvas* overlay, rcr_face_result& result) {
+    memset(&result, 0, sizeof(result));
+    memset(result.colors, ' ', sizeof(result.colors));
+    for (rcr_cell& cell : result.cells) {
+        cell.color = ' ';
+    }
+
+    Mat canvas;
+    bool draw = overlay && overlay->data;
+    if (!validImage(image) || (draw && !wrapCanvas(overlay, Size(image.width, image.height), canvas))) {
+        result.status = RCR_FACE_INVALID_IMAGE;
+        return;
+    }
+
+    try {
+        Mat img = wrapImage(image);
+        if (draw) img.copyTo(canvas);
+        const vector<ColorBlock>& blocks = handle.analyzer.analyzeCubeFace(img, ctx, draw ? canvas : ctx.overlay, draw);
+        FaceMatrix<3> matrix;
+        handle.analyzer.fillColorMatrix(blocks, matrix);
+
+        for (const ColorBlock& block : blocks) {
+            if (block.row < 0 || block.row >= 3 || block.col < 0 || block.col >= 3) continue;
+            rcr_cell& cell = result.cells[block.row * 3 + block.col];
+            cell.center_x = block.center.x;
+            cell.center_y = block.center.y;
+            cell.x = block.boundingBox.x;
+            cell.y = block.boundingBox.y;
+            cell.width = block.boundingBox.width;
+            cell.height = block.boundingBox.height;
+            cell.area = block.area;
+            cell.color = matrix.at(block.row, block.col);
+            cell.inferred = block.inferred ? 1 : 0;
+        }
+
+        memcpy(result.colors, matrix.cells, sizeof(result.colors));
+        result.block_count = (int32_t)blocks.size();
+        result.grid_confidence = ctx.grid.confidence;
+        if (memchr(result.colors, ' ', sizeof(result.colors))) {
+            result.status = RCR_FACE_INCOMPLETE;
+        }
+        else if (ctx.grid.confidence < handle.analyzer.getMinGridConfidence()) {
+            result.status = RCR_FACE_LOW_CONFIDENCE;
+        }
+        else {
+            result.status = RCR_FACE_OK;
+        }
+    }
+    catch (...) {
+        memset(result.colors, ' ', sizeof(result.colors));
+        result.status = RCR_FACE_ERROR;
+    }
+}
+
+// 批量调用的第 i 个面：按元素大小取出图像与画布，结果写回调用方并清零库不认识的尾部字段
+static void analyzeFace(const rcr_analyzer& handle, FrameContext& ctx, BatchCall& call, size_t i) {
+    rcr_image image;
+    memcpy(&image, call.images + i * call.imageSize, sizeof(image));
+    rcr_canvas overlay;
+    if (call.overlays) {
+        memcpy(&overlay, call.overlays + i * call.overlaySize, sizeof(overlay));
+    }
+    rcr_face_result result;
+    analyzeFace(handle, ctx, image, call.overlays ? &overlay : nullptr, result);
+
+    uint8_t* out = call.results + i * call.resultSize;
+    memcpy(out, &result, sizeof(result));
+    memset(out + sizeof(result), 0, call.resultSize - sizeof(result));
+}
+
+extern "C" {
+
+RCR_API int rcr_api_version(void) {
+    return RCR_API_VERSION;
+}
+
+RCR_API void rcr_default_options(rcr_options* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(rcr_options);
+    options->threads = 1;
+    options->segment_threads = 1;
+    options->pyramid_levels = 0;
+    options->refine = 0;
+    options->extract_backend = RCR_EXTRACT_CONTOURS;
+    options->detect_mode = RCR_DETECT_SEGMENT;
+    options->stream_rows = 0;
+    options->min_grid_confidence = 0.5f;
+    options->collect_metrics = 0;
+}
+
+RCR_API int rcr_create(const rcr_options* options, rcr_analyzer** analyzer) {
+    if (!analyzer) return RCR_ERROR_INVALID_ARGUMENT;
+    *analyzer = nullptr;
+
+    // 调用方的结构体可能比本库的旧（字段少）或新（字段多）：只复制双方都有的前缀，
+    // 其余字段保持默认值
+    rcr_options opt;
+    rcr_default_options(&opt);
+    if (options) {
+        if (options->struct_size < sizeof(options->struct_size)) return RCR_ERROR_INVALID_ARGUMENT;
+        memcpy(&opt, options, min((size_t)options->struct_size, sizeof(rcr_options)));
+        opt.struct_size = sizeof(rcr_options);
+    }
+    if (opt.threads < 1 || opt.segment_threads < 1 || opt.pyramid_levels < -1 || opt.stream_rows < 0 ||
+        (opt.extract_backend != RCR_EXTRACT_CONTOURS && opt.extract_backend != RCR_EXTRACT_COMPONENTS) ||
+        (opt.detect_mode != RCR_DETECT_SEGMENT && opt.detect_mode != RCR_DETECT_QUAD) ||
+        (opt.collect_metrics != 0 && opt.collect_metrics != 1)) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        unique_ptr<rcr_analyzer> handle = make_unique<rcr_analyzer>();
+        CubeFaceAnalyzer& a = handle->analyzer;
+        a.setVerbose(false);
+        a.setPyramid(opt.pyramid_levels, opt.refine != 0);
+        a.setExtractBackend((ExtractBackend)opt.extract_backend);
+        a.setSegmentThreads(opt.segment_threads);
+        a.setStreaming(opt.stream_rows);
+        a.setDetectMode((DetectMode)opt.detect_mode);
+        a.setMinGridConfidence(opt.min_grid_confidence);
+        handle->colorCodeMap = a.getColorCodeMap();
+        handle->colorCodes = a.getColorCodeString();
+        handle->colorNames = a.getColorNames();
+        if (opt.collect_metrics) {
+            handle->metrics = make_unique<PipelineMetrics>(handle->colorNames);
+            a.setMetrics(handle->metrics.get());
+            handle->visualizer.setMetrics(handle->metrics.get());
+        }
+
+        // 创建线程失败时抛出异常：handle 析构会结束并回收已启动的线程
+        rcr_analyzer* h = handle.get();
+        handle->workers.reserve((size_t)opt.threads - 1);
+        for (int t = 1; t < opt.threads; t++) {
+            handle->workers.emplace_back([h] { h->workerLoop(); });
+        }
+        *analyzer = handle.release();
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API void rcr_destroy(rcr_analyzer* analyzer) {
+    delete analyzer;
+}
+
+RCR_API int rcr_set_color_model(rcr_analyzer* analyzer, const float centers[18], const float radii[6]) {
+    if (!analyzer || !centers || !radii) return RCR_ERROR_INVALID_ARGUMENT;
+
+    ColorModel model;
+    for (int k = 0; k < ColorModel::COLORS; k++) {
+        for (int c = 0; c < 3; c++) {
+            float v = centers[k * 3 + c];
+            if (!(v >= 0 && v <= 255)) return RCR_ERROR_INVALID_ARGUMENT;
+            model.center[k][c] = v;
+        }
+        if (!(radii[k] > 0 && radii[k] < FLT_MAX)) return RCR_ERROR_INVALID_ARGUMENT;
+        model.radius[k] = radii[k];
+    }
+    model.valid = true;
+
+    try {
+        analyzer->analyzer.setColorModel(model);
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API int rcr_calibrate(const rcr_analyzer* analyzer, const rcr_image* images, size_t image_size,
+    float centers[18], float radii[6], int32_t* iterations) {
+    if (!analyzer || !images || !centers || !radii) return RCR_ERROR_INVALID_ARGUMENT;
+    if (image_size < IMAGE_SIZE_V1) return RCR_ERROR_VERSION;
+
+    try {
+        vector<vector<Vec3b>> samples(ColorCalibrator::FACES);
+        for (int f = 0; f < ColorCalibrator::FACES; f++) {
+            rcr_image image;
+            memcpy(&image, (const uint8_t*)images + f * image_size, sizeof(image));
+            if (!validImage(image)) return RCR_ERROR_INVALID_ARGUMENT;
+            if (!analyzer->analyzer.sampleFace(wrapImage(image), samples[f])) return RCR_ERROR_CALIBRATION;
+        }
+
+        ColorModel model;
+        ColorCalibrator::Result result = analyzer->analyzer.calibrate(samples, "", model);
+        if (!result.ok) return RCR_ERROR_CALIBRATION;
+        for (int k = 0; k < ColorModel::COLORS; k++) {
+            for (int c = 0; c < 3; c++) {
+                centers[k * 3 + c] = model.center[k][c];
+            }
+            radii[k] = model.radius[k];
+        }
+        if (iterations) *iterations = result.iterations;
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API int rcr_format_color_model(const rcr_analyzer* analyzer, const float centers[18], const float radii[6],
+    const char* profile, char* buffer, size_t capacity, size_t* length) {
+    if (!analyzer || !centers || !radii || !length) return RCR_ERROR_INVALID_ARGUMENT;
+
+    try {
+        ColorModel model;
+        model.profile = profile ? profile : "";
+        for (int k = 0; k < ColorModel::COLORS; k++) {
+            for (int c = 0; c < 3; c++) {
+                model.center[k][c] = centers[k * 3 + c];
+            }
+            model.radius[k] = radii[k];
+        }
+        ostringstream out;
+        model.write(out, analyzer->colorNames);
+        string text = out.str();
+        *length = text.size();
+        if (!buffer || capacity <= text.size()) return RCR_ERROR_BUFFER_TOO_SMALL;
+        memcpy(buffer, text.c_str(), text.size() + 1);
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API int rcr_parse_color_model(const rcr_analyzer* analyzer, const char* text, float centers[18], float radii[6]) {
+    if (!analyzer || !text || !centers || !radii) return RCR_ERROR_INVALID_ARGUMENT;
+
+    try {
+        ColorModel model;
+        istringstream in(text);
+        if (!model.read(in, analyzer->colorNames)) return RCR_ERROR_MODEL_FORMAT;
+        for (int k = 0; k < ColorModel::COLORS; k++) {
+            for (int c = 0; c < 3; c++) {
+                centers[k * 3 + c] = model.center[k][c];
+            }
+            radii[k] = model.radius[k];
+        }
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API const char* rcr_color_codes(const rcr_analyzer* analyzer) {
+    return analyzer ? analyzer->colorCodes.c_str() : "";
+}
+
+RCR_API const char* rcr_color_name(const rcr_analyzer* analyzer, int32_t index) {
+    if (!analyzer || index < 0 || index >= (int32_t)analyzer->colorNames.size()) return "";
+    return analyzer->colorNames[index].c_str();
+}
+
+RCR_API int rcr_color_bgr(const rcr_analyzer* analyzer, int32_t index, uint8_t bgr[3]) {
+    if (!analyzer || !bgr) return RCR_ERROR_INVALID_ARGUMENT;
+    const vector<ColorRange>& colorTable = analyzer->analyzer.getColorTable();
+    if (index < 0 || index >= (int32_t)colorTable.size()) return RCR_ERROR_INVALID_ARGUMENT;
+    for (int c = 0; c < 3; c++) {
+        bgr[c] = saturate_cast<uint8_t>(colorTable[index].drawColor[c]);
+    }
+    return RCR_OK;
+}
+
+RCR_API uint64_t rcr_settings_hash(const rcr_analyzer* analyzer) {
+    return analyzer ? analyzer->analyzer.settingsHash() : 0;
+}
+
+RCR_API int rcr_analyze_batch(rcr_analyzer* analyzer, size_t count,
+    const rcr_image* images, size_t image_size,
+    rcr_face_result* results, size_t result_size,
+    const rcr_canvas* overlays, size_t overlay_size) {
+    if (!analyzer || (count > 0 && (!images || !results))) return RCR_ERROR_INVALID_ARGUMENT;
+    if (image_size < IMAGE_SIZE_V1 || result_size < RESULT_SIZE_V1 || (overlays && overlay_size < CANVAS_SIZE_V1)) {
+        return RCR_ERROR_VERSION;
+    }
+    if (count == 0) return RCR_OK;
+
+    BatchCall call;
+    call.count = count;
+    call.images = (const uint8_t*)images;
+    call.imageSize = image_size;
+    call.results = (uint8_t*)results;
+    call.resultSize = result_size;
+    call.overlays = (const uint8_t*)overlays;
+    call.overlaySize = overlay_size;
+
+    // 调用线程也参与分析；有常驻工作线程且不止一个面时把调用挂到队列上请它们帮忙
+    bool shared = !analyzer->workers.empty() && count > 1;
+    if (shared) {
+        {
+            lock_guard<mutex> lock(analyzer->poolMutex);
+            analyzer->pending.push_back(&call);
+        }
+        analyzer->workAvailable.notify_all();
+    }
+
+    int status = RCR_OK;
+    try {
+        analyzer->analyzeRemaining(call);
+    }
+    catch (...) {
+        status = RCR_ERROR_INTERNAL;
+    }
+
+    // call 在栈上：返回前移出队列，并等帮忙的工作线程都放手
+    if (shared) {
+        unique_lock<mutex> lock(analyzer->poolMutex);
+        analyzer->retire(&call);
+        analyzer->helperDone.wait(lock, [&] { return call.helpers == 0; });
+    }
+    return status;
+}
+
+RCR_API int rcr_classify_pixels(const rcr_analyzer* analyzer, const rcr_image* image,
+    uint8_t* labels, int64_t labels_stride) {
+    if (!analyzer || !image || !labels || !validImage(*image) || labels_stride < image->width) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        Mat target(image->height, image->width, CV_8UC1, labels, (size_t)labels_stride);
+        analyzer->analyzer.classifyPixels(wrapImage(*image), target);
+        return target.data == labels ? RCR_OK : RCR_ERROR_INTERNAL;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API int rcr_check_color_totals(const rcr_analyzer* analyzer, const char colors[54]) {
+    if (!analyzer || !colors) return RCR_ERROR_INVALID_ARGUMENT;
+
+    CubeMatrices<3> matrices;
+    for (int f = 0; f < 6; f++) {
+        matrices[f].assign(colors + f * 9);
+    }
+    return analyzer->analyzer.checkColorTotals(matrices) ? 1 : 0;
+}
+
+RCR_API void rcr_standard_face_size(const char* label, int32_t* width, int32_t* height) {
+    Size size = CubeVisualizer::standardFaceSize(labelText(label));
+    if (width) *width = size.width;
+    if (height) *height = size.height;
+}
+
+RCR_API int rcr_render_standard_face(const rcr_analyzer* analyzer, const char colors[9], const char* label,
+    const rcr_canvas* canvas) {
+    string name = labelText(label);
+    Mat target;
+    if (!analyzer || !colors || !wrapCanvas(canvas, CubeVisualizer::standardFaceSize(name), target)) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        analyzer->visualizer.drawStandardFace(toMatrix(colors), analyzer->colorCodeMap, name, target);
+        return target.data == canvas->data ? RCR_OK : RCR_ERROR_INTERNAL;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API void rcr_comparison_size(int32_t* width, int32_t* height) {
+    Size size = CubeVisualizer::comparisonSize();
+    if (width) *width = size.width;
+    if (height) *height = size.height;
+}
+
+RCR_API int rcr_render_comparison(const rcr_analyzer* analyzer, const rcr_image* detection,
+    const char colors[9], const char* label, const rcr_canvas* canvas) {
+    Mat target;
+    if (!analyzer || !detection || !validImage(*detection) || !colors ||
+        !wrapCanvas(canvas, CubeVisualizer::comparisonSize(), target)) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        analyzer->visualizer.createComparisonImage(wrapImage(*detection), toMatrix(colors), analyzer->colorCodeMap,
+            labelText(label), target);
+        return target.data == canvas->data ? RCR_OK : RCR_ERROR_INTERNAL;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API void rcr_cube_net_size(int32_t* width, int32_t* height) {
+    Size size = CubeVisualizer::cubeNetSize();
+    if (width) *width = size.width;
+    if (height) *height = size.height;
+}
+
+RCR_API int rcr_render_cube_net(const rcr_analyzer* analyzer, const char colors[54], uint32_t faces,
+    const rcr_canvas* canvas) {
+    Mat target;
+    if (!analyzer || !colors || faces == 0 || (faces & ~RCR_NET_ALL_FACES) ||
+        !wrapCanvas(canvas, CubeVisualizer::cubeNetSize(), target)) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        // 展开图按 netOrder 排列各面；画布尺寸与类型已匹配，绘制直接写入调用方的缓冲
+        CubeMatrices<3> reorderedMatrices;
+        for (int i = 0; i < 6; i++) {
+            reorderedMatrices[i].assign(colors + netOrder[i] * 9);
+        }
+        if (faces == RCR_NET_ALL_FACES) {
+            analyzer->visualizer.drawCubeNet(reorderedMatrices, analyzer->colorCodeMap, target);
+        }
+        else {
+            for (int i = 0; i < 6; i++) {
+                if (!(faces & (1u << netOrder[i]))) continue;
+                analyzer->visualizer.redrawCubeNetPanel(target, i, reorderedMatrices[i], analyzer->colorCodeMap);
+            }
+        }
+        return target.data == canvas->data ? RCR_OK : RCR_ERROR_INTERNAL;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API int rcr_export_metrics(const rcr_analyzer* analyzer, int32_t format, char* buffer, size_t capacity,
+    size_t* length) {
+    if (!analyzer || !analyzer->metrics || !length ||
+        (format != RCR_METRICS_PROMETHEUS && format != RCR_METRICS_JSONL)) {
+        return RCR_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        string text = format == RCR_METRICS_JSONL ? analyzer->metrics->toJsonLine() : analyzer->metrics->toPrometheus();
+        *length = text.size();
+        if (!buffer || capacity <= text.size()) return RCR_ERROR_BUFFER_TOO_SMALL;
+        memcpy(buffer, text.c_str(), text.size() + 1);
+        return RCR_OK;
+    }
+    catch (...) {
+        return RCR_ERROR_INTERNAL;
+    }
+}
+
+RCR_API const char* rcr_status_message(int code) {
+    switch (code) {
+    case RCR_OK: return "成功";
+    case RCR_ERROR_INVALID_ARGUMENT: return "参数无效";
+    case RCR_ERROR_VERSION: return "结构体版本过旧";
+    case RCR_ERROR_INTERNAL: return "库内部错误";
+    case RCR_ERROR_BUFFER_TOO_SMALL: return "缓冲区不够";
+    case RCR_ERROR_CALIBRATION: return "颜色标定失败";
+    case RCR_ERROR_MODEL_FORMAT: return "颜色模型格式不对";
+    default: return "未知返回码";
+    }
+}
+
+RCR_API const char* rcr_face_status_message(int status) {
+    switch (status) {
+    case RCR_FACE_OK: return "识别完整";
+    case RCR_FACE_LOW_CONFIDENCE: return "网格置信度低，建议重拍";
+    case RCR_FACE_INCOMPLETE: return "有格子未识别出颜色";
+    case RCR_FACE_INVALID_IMAGE: return "图像无效";
+    case RCR_FACE_ERROR: return "分析时出错";
+    default: return "未知状态";
+    }
+}
+
+}
@@ -0,0 +1,252 @@
+﻿#pragma once
+
+/*************************************************************
+ * 魔方识别库的 C 接口（稳定 ABI，可从 C、C# P/Invoke、Python ctypes 等调用）
+ * 调用方持有全部图像与结果内存：批量接口直接包装调用方的 BGR 缓冲，
+ * 不复制像素、不读写文件、不向控制台输出。
+ * 结构体只在末尾追加字段：rcr_options 以 struct_size 区分版本，
+ * 批量接口的数组以调用方传入的元素大小为跨度，新旧头文件编译的调用方都能使用
+ *************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(RCR_BUILD_DLL)
+#    define RCR_API __declspec(dllexport)
+#  else
+#    define RCR_API __declspec(dllimport)
+#  endif
+#else
+#  define RCR_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCR_API_VERSION 3
+
+// 调用返回码
+#define RCR_OK                        0
+#define RCR_ERROR_INVALID_ARGUMENT   -1  // 空指针、数量或选项超出范围
+#define RCR_ERROR_VERSION            -2  // 数组元素大小小于第 1 版结构体
+#define RCR_ERROR_INTERNAL           -3  // 库内部异常（如内存不足、无法创建线程）
+#define RCR_ERROR_BUFFER_TOO_SMALL   -4  // 调用方的缓冲区不够，所需长度已写回
+#define RCR_ERROR_CALIBRATION        -5  // 颜色标定失败（采不到全部色面或中心块颜色无法区分）
+#define RCR_ERROR_MODEL_FORMAT       -6  // 颜色模型文本的版本标记不对或缺少某种颜色
+
+// 每个面的状态
+#define RCR_FACE_OK                   0  // 9 个格子都识别出颜色，网格置信度达标
+#define RCR_FACE_LOW_CONFIDENCE       1  // 9 个格子都有颜色，但网格置信度低于阈值（建议重拍）
+#define RCR_FACE_INCOMPLETE           2  // 有格子没有识别出颜色（colors 中为空格）
+#define RCR_FACE_INVALID_IMAGE       -1  // 图像（或叠加图画布）指针为空、尺寸或行跨度不合法
+#define RCR_FACE_ERROR               -2  // 分析这个面时库内部出错
+
+// 色块提取后端与检测模式（取值同 CubeRecognition.h 中的枚举）
+#define RCR_EXTRACT_CONTOURS          0
+#define RCR_EXTRACT_COMPONENTS        1
+#define RCR_DETECT_SEGMENT            0
+#define RCR_DETECT_QUAD               1
+
+// 指标导出格式
+#define RCR_METRICS_PROMETHEUS        0  // Prometheus 文本
+#define RCR_METRICS_JSONL             1  // 一行 JSON（不含换行符）
+
+// rcr_render_cube_net 的面掩码：第 i 位为输入顺序的第 i 个面
+#define RCR_NET_ALL_FACES          0x3Fu
+
+typedef struct rcr_analyzer rcr_analyzer;  // 不透明句柄
+
+/*************************************************************
+ * 分析器选项：先用 rcr_default_options 填默认值再修改
+ *************************************************************/
+typedef struct rcr_options {
+    uint32_t struct_size;       // sizeof(rcr_options)，由 rcr_default_options 填写
+    int32_t threads;            // 一次批量调用内并行分析的线程数（1 = 在调用线程中完成）
+    int32_t segment_threads;    // 单张图分割的分块并行数（1 = 串行）
+    int32_t pyramid_levels;     // 金字塔检测层数（0 = 全分辨率，-1 = 自动）
+    int32_t refine;             // 粗层检测后是否在原图上细化（0/1）
+    int32_t extract_backend;    // RCR_EXTRACT_*
+    int32_t detect_mode;        // RCR_DETECT_*
+    int32_t stream_rows;        // 条带流式分割的每条行数（0 = 关闭）
+    float min_grid_confidence;  // 低于此值的面报告 RCR_FACE_LOW_CONFIDENCE
+    int32_t collect_metrics;    // 记录阶段耗时与颜色统计（0/1），由 rcr_export_metrics 导出
+} rcr_options;
+
+/*************************************************************
+ * 调用方持有的 BGR 图像（每像素 3 字节，行跨度以字节计，
+ * 至少为 width * 3；可以是更大图像中的一块区域）
+ *************************************************************/
+typedef struct rcr_image {
+    const uint8_t* data;
+    int32_t width;
+    int32_t height;
+    int64_t stride;
+} rcr_image;
+
+/*************************************************************
+ * 调用方持有、由库写入的 BGR 画布，布局同 rcr_image
+ *************************************************************/
+typedef struct rcr_canvas {
+    uint8_t* data;
+    int32_t width;
+    int32_t height;
+    int64_t stride;
+} rcr_canvas;
+
+/*************************************************************
+ * 一个格子的识别结果（按行优先排列在 cells[9] 中）
+ * 没有色块的格子 color 为空格，其余字段为 0
+ *************************************************************/
+typedef struct rcr_cell {
+    float center_x, center_y;   // 色块中心（原图坐标）
+    int32_t x, y, width, height; // 色块外接矩形
+    double area;                // 色块面积（像素）
+    char color;                 // 颜色代码（见 rcr_color_codes）
+    uint8_t inferred;           // 由网格推断的格子（没有检测到对应的色块）
+    uint8_t reserved[6];
+} rcr_cell;
+
+/*************************************************************
+ * 一个面的识别结果，由调用方分配，rcr_analyze_batch 填写
+ *************************************************************/
+typedef struct rcr_face_result {
+    int32_t status;             // RCR_FACE_*
+    int32_t block_count;        // 检测到的色块数（含网格补出的格子）
+    float grid_confidence;      // 网格拟合置信度 0..1
+    char colors[9];             // 3x3 颜色矩阵（行优先），未识别的格子为空格
+    char reserved[3];
+    rcr_cell cells[9];
+} rcr_face_result;
+
+// 库的接口版本（RCR_API_VERSION），调用方可据此检查头文件与库是否匹配
+RCR_API int rcr_api_version(void);
+
+// 用默认值填写选项
+RCR_API void rcr_default_options(rcr_options* options);
+
+/*************************************************************
+ * 创建分析器；options 为空时使用默认值。成功时 *analyzer 为新句柄。
+ * 只读取 options 的前 struct_size 字节，其余字段取默认值（旧调用方不必重新编译）；
+ * threads > 1 时句柄带 threads - 1 个常驻工作线程，在 rcr_destroy 时结束
+ *************************************************************/
+RCR_API int rcr_create(const rcr_options* options, rcr_analyzer** analyzer);
+
+// 销毁分析器（可传空指针）；不能与同一句柄上的其它调用同时进行
+RCR_API void rcr_destroy(rcr_analyzer* analyzer);
+
+/*************************************************************
+ * 用标定得到的颜色模型替代固定阈值（会重建查找表）：
+ * centers 为六种颜色的 Lab 中心（6 x 3，OpenCV 8 位 Lab），
+ * radii 为各颜色的接受半径，颜色顺序同 rcr_color_codes。
+ * 不能与同一句柄上的 rcr_analyze_batch 同时调用
+ *************************************************************/
+RCR_API int rcr_set_color_model(rcr_analyzer* analyzer, const float centers[18], const float radii[6]);
+
+/*************************************************************
+ * 由一个魔方的六张图（输入顺序，每面都须采到 9 个色面）拟合颜色模型，
+ * 写入 centers / radii（格式同 rcr_set_color_model，不应用到句柄）；
+ * iterations 可为空。images 的元素大小为 image_size
+ *************************************************************/
+RCR_API int rcr_calibrate(const rcr_analyzer* analyzer, const rcr_image* images, size_t image_size,
+    float centers[18], float radii[6], int32_t* iterations);
+
+/*************************************************************
+ * 颜色模型与文本互转（格式同识别程序的标定缓存文件，颜色按名称对应），
+ * 文件由调用方读写。rcr_format_color_model 的 buffer 约定同 rcr_export_metrics，
+ * profile 可为空；rcr_parse_color_model 只写出 centers / radii，不应用到句柄
+ *************************************************************/
+RCR_API int rcr_format_color_model(const rcr_analyzer* analyzer, const float centers[18], const float radii[6],
+    const char* profile, char* buffer, size_t capacity, size_t* length);
+RCR_API int rcr_parse_color_model(const rcr_analyzer* analyzer, const char* text, float centers[18], float radii[6]);
+
+// 颜色代码字符串（第 i 个字符为第 i 种颜色），在句柄销毁前有效
+RCR_API const char* rcr_color_codes(const rcr_analyzer* analyzer);
+
+// 第 index 种颜色的名称（UTF-8，在句柄销毁前有效），下标越界时返回空串
+RCR_API const char* rcr_color_name(const rcr_analyzer* analyzer, int32_t index);
+
+// 第 index 种颜色的绘制颜色（B、G、R）
+RCR_API int rcr_color_bgr(const rcr_analyzer* analyzer, int32_t index, uint8_t bgr[3]);
+
+/*************************************************************
+ * 影响识别结果的全部设置（颜色表、颜色模型、检测选项）的摘要：
+ * 摘要相同的句柄对同一张图给出相同的结果，可用作结果缓存的键
+ *************************************************************/
+RCR_API uint64_t rcr_settings_hash(const rcr_analyzer* analyzer);
+
+/*************************************************************
+ * 批量分析 count 个面：images[i] 的结果写入 results[i]。
+ * 数组以元素大小为跨度：image_size、result_size 通常为 sizeof(rcr_image)、
+ * sizeof(rcr_face_result)，不得小于第 1 版结构体；库只读写自己认识的前缀，
+ * 结果中库不认识的尾部字段清零。
+ * overlays 可为空；不为空时 overlays[i].data 非空的面把检测叠加图
+ * （原图加色块轮廓与标签）写入该画布，画布尺寸须与 images[i] 相同。
+ * 图像不复制、不修改；单个面出错只影响它自己的 status。
+ * 同一句柄可在多个线程中同时调用（各调用的帧缓冲取自句柄内的池）
+ *************************************************************/
+RCR_API int rcr_analyze_batch(rcr_analyzer* analyzer, size_t count,
+    const rcr_image* images, size_t image_size,
+    rcr_face_result* results, size_t result_size,
+    const rcr_canvas* overlays, size_t overlay_size);
+
+/*************************************************************
+ * 逐像素分类：labels 的每个字节为该像素所属颜色的位掩码
+ * （第 i 位对应第 i 种颜色，可同时属于多种颜色），行跨度 labels_stride 字节
+ *************************************************************/
+RCR_API int rcr_classify_pixels(const rcr_analyzer* analyzer, const rcr_image* image,
+    uint8_t* labels, int64_t labels_stride);
+
+/*************************************************************
+ * 六个面（54 个颜色代码）中每种颜色是否恰好 9 个：是返回 1，否返回 0，
+ * 参数无效时返回 RCR_ERROR_INVALID_ARGUMENT；记录指标时计入魔方统计
+ *************************************************************/
+RCR_API int rcr_check_color_totals(const rcr_analyzer* analyzer, const char colors[54]);
+
+// 标准面画布的尺寸（label 为空指针或空串时没有标签栏）
+RCR_API void rcr_standard_face_size(const char* label, int32_t* width, int32_t* height);
+
+// 把一个面的 9 个颜色代码绘制成标准面，canvas 尺寸须等于 rcr_standard_face_size
+RCR_API int rcr_render_standard_face(const rcr_analyzer* analyzer, const char colors[9], const char* label,
+    const rcr_canvas* canvas);
+
+// 对比图画布的尺寸
+RCR_API void rcr_comparison_size(int32_t* width, int32_t* height);
+
+/*************************************************************
+ * 对比图：左半为缩放后的检测图（通常是 rcr_analyze_batch 输出的叠加图），
+ * 右半为标准面。canvas 尺寸须等于 rcr_comparison_size
+ *************************************************************/
+RCR_API int rcr_render_comparison(const rcr_analyzer* analyzer, const rcr_image* detection,
+    const char colors[9], const char* label, const rcr_canvas* canvas);
+
+// 展开图画布的尺寸（BGR，标准 4x3 网格布局）
+RCR_API void rcr_cube_net_size(int32_t* width, int32_t* height);
+
+/*************************************************************
+ * 把六个面的颜色矩阵（按输入顺序 Front、Back、Left、Right、Up、Down，
+ * 每面 9 个颜色代码）绘制成展开图，写入调用方的画布：
+ * canvas 尺寸须等于 rcr_cube_net_size。faces 为 RCR_NET_ALL_FACES 时整张重画；
+ * 否则画布须是已有的展开图，只重画 faces 中各位对应的面，其余像素不动
+ *************************************************************/
+RCR_API int rcr_render_cube_net(const rcr_analyzer* analyzer, const char colors[54], uint32_t faces,
+    const rcr_canvas* canvas);
+
+/*************************************************************
+ * 导出指标（rcr_options.collect_metrics 为 1 时记录）：文本写入 buffer
+ * 并以 0 结尾，*length 为文本长度（不含结尾的 0）。
+ * buffer 为空或容量不够时返回 RCR_ERROR_BUFFER_TOO_SMALL，*length 仍为所需长度
+ *************************************************************/
+RCR_API int rcr_export_metrics(const rcr_analyzer* analyzer, int32_t format, char* buffer, size_t capacity,
+    size_t* length);
+
+// 调用返回码（RCR_OK、RCR_ERROR_*）的说明文字（UTF-8 静态字符串）
+RCR_API const char* rcr_status_message(int code);
+
+// 面状态（RCR_FACE_*）的说明文字（UTF-8 静态字符串）
+RCR_API const char* rcr_face_status_message(int status);
+
+#ifdef __cplusplus
+}
+#endif
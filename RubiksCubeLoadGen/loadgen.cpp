@@ -0,0 +1,301 @@
+﻿#include "../RubiksCubeRecognition/ServerProtocol.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+using namespace std;
+
+/*************************************************************
+ * 识别服务的本地压测客户端
+ * 若干连接并发，每个连接同一时刻只有一个请求（闭环），
+ * 收到 busy 时退避后重试；统计吞吐量与延迟分位数。
+ * --smoke 先跑一小轮负载，再检查错误请求、超限帧与连接上限的处理，
+ * 任何一项不符合预期时返回非零（可作为服务的冒烟测试）
+ *************************************************************/
+struct LoadOptions {
+    string socketPath = "rubiks.sock";
+    string dataDir = "../RubiksCubeRecognition/data"; // 读取 cubeface1..6.jpg
+    int requests = 200;       // 成功请求总数
+    int concurrency = 4;      // 并发连接数
+    int retryDelayMs = 2;     // busy 后的退避时间
+    string outputFile;        // 结果 JSON（为空时不写）
+    bool smoke = false;       // 冒烟测试：小负载 + 协议边界检查
+    int maxConnections = 0;   // 冒烟测试中验证的服务连接上限（0 = 不检查）
+};
+
+struct ClientStats {
+    vector<double> latencies; // 成功请求的端到端延迟（含 busy 重试，毫秒）
+    int busy = 0;             // 收到 busy 的次数
+    int errors = 0;           // 非 ok 响应或连接错误
+    string firstBody;         // 第一个成功响应（用于检查结果一致性）
+    int mismatches = 0;       // faces 与第一个成功响应不同的次数
+};
+
+static double percentileMs(vector<double> values, double p) {
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    size_t idx = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[min(idx, values.size() - 1)];
+}
+
+// 从响应正文中取出 "faces":[...] 部分（延迟字段每次都不同，不参与比较）
+static string facesField(const string& body) {
+    size_t begin = body.find("\"faces\":");
+    if (begin == string::npos) return "";
+    size_t end = body.find(']', begin);
+    return body.substr(begin, end == string::npos ? string::npos : end - begin + 1);
+}
+
+static bool readFile(const string& path, vector<uint8_t>& data) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+static void runClient(const LoadOptions& opt, const ServerProtocol::Request& templ,
+    atomic<int>& remaining, ClientStats& stats) {
+    LocalSocket socket;
+    if (!socket.connect(opt.socketPath)) {
+        stats.errors++;
+        return;
+    }
+
+    ServerProtocol::Request request = templ;
+    ServerProtocol::Response response;
+    while (remaining.fetch_sub(1) > 0) {
+        auto start = chrono::steady_clock::now();
+        for (;;) {
+            request.id++;
+            if (!ServerProtocol::writeRequest(socket, request) || !ServerProtocol::readResponse(socket, response)) {
+                stats.errors++;
+                return;
+            }
+            if (response.status != ServerProtocol::STATUS_BUSY) break;
+            stats.busy++;
+            this_thread::sleep_for(chrono::milliseconds(opt.retryDelayMs));
+        }
+
+        if (response.status != ServerProtocol::STATUS_OK) {
+            stats.errors++;
+            continue;
+        }
+        stats.latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        if (stats.firstBody.empty()) {
+            stats.firstBody = response.body;
+        }
+        else if (facesField(response.body) != facesField(stats.firstBody)) {
+            stats.mismatches++;
+        }
+    }
+}
+
+static void putLe32(vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+// 在新连接上发送一个请求并读取响应；连接失败或被服务关闭时返回 false
+static bool roundTrip(const string& socketPath, const ServerProtocol::Request& request,
+    ServerProtocol::Response& response) {
+    LocalSocket socket;
+    return socket.connect(socketPath) && ServerProtocol::writeRequest(socket, request)
+        && ServerProtocol::readResponse(socket, response);
+}
+
+// 发送一段原始帧头，期望服务不回复而直接关闭连接
+static bool closedAfterRaw(const string& socketPath, const vector<uint8_t>& frame) {
+    LocalSocket socket;
+    if (!socket.connect(socketPath)) return false;
+    ServerProtocol::Response response;
+    return !socket.writeAll(frame.data(), frame.size()) || !ServerProtocol::readResponse(socket, response);
+}
+
+/*************************************************************
+ * 协议边界检查，返回失败项数
+ *************************************************************/
+static int runSmokeChecks(const LoadOptions& opt, const ServerProtocol::Request& templ) {
+    int failures = 0;
+    auto check = [&](const char* name, bool ok) {
+        cout << (ok ? "  通过  " : "  失败  ") << name << endl;
+        if (!ok) failures++;
+    };
+    ServerProtocol::Response response;
+
+    ServerProtocol::Request fewer = templ;
+    fewer.images.pop_back();
+    check("图像数少于 6 -> bad_request",
+        roundTrip(opt.socketPath, fewer, response) && response.status == ServerProtocol::STATUS_BAD_REQUEST);
+
+    ServerProtocol::Request garbage = templ;
+    garbage.images[0].assign(64, 0x5a);
+    check("无法解码的图像 -> decode_error",
+        roundTrip(opt.socketPath, garbage, response) && response.status == ServerProtocol::STATUS_DECODE_ERROR);
+
+    vector<uint8_t> frame;
+    putLe32(frame, ServerProtocol::REQUEST_MAGIC);
+    putLe32(frame, 1);
+    putLe32(frame, ServerProtocol::FACES + 1);
+    check("图像数超过 6 -> 断开连接", closedAfterRaw(opt.socketPath, frame));
+
+    frame.clear();
+    putLe32(frame, ServerProtocol::REQUEST_MAGIC);
+    putLe32(frame, 2);
+    putLe32(frame, ServerProtocol::FACES);
+    putLe32(frame, ServerProtocol::MAX_IMAGE_BYTES + 1);
+    check("单张图超过上限 -> 断开连接", closedAfterRaw(opt.socketPath, frame));
+
+    frame.clear();
+    putLe32(frame, ServerProtocol::REQUEST_MAGIC);
+    putLe32(frame, 3);
+    putLe32(frame, ServerProtocol::FACES);
+    for (uint32_t sent = 0; sent + ServerProtocol::MAX_IMAGE_BYTES <= ServerProtocol::MAX_REQUEST_BYTES;
+        sent += ServerProtocol::MAX_IMAGE_BYTES) {
+        putLe32(frame, ServerProtocol::MAX_IMAGE_BYTES);
+        frame.resize(frame.size() + ServerProtocol::MAX_IMAGE_BYTES);
+    }
+    putLe32(frame, 1); // 合计恰好超过上限 1 字节，服务在读数据前断开
+    check("请求合计超过上限 -> 断开连接", closedAfterRaw(opt.socketPath, frame));
+    frame = vector<uint8_t>();
+
+    if (opt.maxConnections > 0) {
+        // 先让上限内的连接各完成一次往返（确认已被服务接纳），再多开一个
+        ServerProtocol::Request empty;
+        vector<LocalSocket> held(opt.maxConnections);
+        bool accepted = true;
+        for (auto& socket : held) {
+            accepted = accepted && socket.connect(opt.socketPath) && ServerProtocol::writeRequest(socket, empty)
+                && ServerProtocol::readResponse(socket, response);
+        }
+        check("连接上限内的连接均被接纳", accepted);
+        check("超过连接上限的连接被关闭", !roundTrip(opt.socketPath, empty, response));
+    }
+
+    check("边界检查后服务仍正常响应",
+        roundTrip(opt.socketPath, templ, response) && response.status == ServerProtocol::STATUS_OK);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    LoadOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            opt.socketPath = argv[++i];
+        }
+        else if (arg == "--data" && i + 1 < argc) {
+            opt.dataDir = argv[++i];
+        }
+        else if (arg == "--requests" && i + 1 < argc) {
+            opt.requests = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--concurrency" && i + 1 < argc) {
+            opt.concurrency = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--retry-delay" && i + 1 < argc) {
+            opt.retryDelayMs = max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            opt.outputFile = argv[++i];
+        }
+        else if (arg == "--smoke") {
+            opt.smoke = true;
+        }
+        else if (arg == "--max-connections" && i + 1 < argc) {
+            opt.maxConnections = max(0, atoi(argv[++i]));
+        }
+        else {
+            cerr << "用法：" << argv[0] << " [--socket 路径] [--data 目录] [--requests N] [--concurrency N]"
+                << " [--retry-delay 毫秒] [--output 结果.json] [--smoke [--max-connections N]]" << endl;
+            return 1;
+        }
+    }
+
+    // 所有请求都发送同一个魔方的六张图
+    ServerProtocol::Request templ;
+    for (int i = 1; i <= 6; i++) {
+        string path = (filesystem::path(opt.dataDir) / ("cubeface" + to_string(i) + ".jpg")).string();
+        vector<uint8_t> data;
+        if (!readFile(path, data)) {
+            cerr << "无法读取图像：" << path << endl;
+            return 1;
+        }
+        templ.images.push_back(std::move(data));
+    }
+
+    if (opt.smoke) {
+        opt.requests = min(opt.requests, 12);
+        opt.concurrency = min(opt.concurrency, 2);
+    }
+
+    atomic<int> remaining{ opt.requests };
+    vector<ClientStats> stats(opt.concurrency);
+    vector<thread> clients;
+    auto start = chrono::steady_clock::now();
+    for (int c = 0; c < opt.concurrency; c++) {
+        clients.emplace_back([&, c] {
+            ServerProtocol::Request request = templ;
+            request.id = (uint32_t)c << 24; // 各连接的 id 区间互不重叠
+            runClient(opt, request, remaining, stats[c]);
+        });
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+    double wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    vector<double> latencies;
+    int busy = 0, errors = 0, mismatches = 0;
+    string reference;
+    for (const ClientStats& s : stats) {
+        latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+        busy += s.busy;
+        errors += s.errors;
+        mismatches += s.mismatches;
+        if (reference.empty()) {
+            reference = s.firstBody;
+        }
+        else if (!s.firstBody.empty() && facesField(s.firstBody) != facesField(reference)) {
+            mismatches++;
+        }
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "完成: " << latencies.size() << " / " << opt.requests << "，并发 " << opt.concurrency
+        << "，busy 重试 " << busy << " 次，错误 " << errors << "，结果不一致 " << mismatches << endl;
+    cout << "吞吐量: " << latencies.size() * 1000.0 / wallMs << " 个魔方/秒（墙钟 " << wallMs << " ms）" << endl;
+    cout << "延迟: p50 " << percentileMs(latencies, 50) << " ms, p90 " << percentileMs(latencies, 90)
+        << " ms, p99 " << percentileMs(latencies, 99) << " ms, 最大 " << percentileMs(latencies, 100) << " ms" << endl;
+    if (!reference.empty()) {
+        cout << "响应示例: " << reference << endl;
+    }
+
+    if (!opt.outputFile.empty()) {
+        ofstream out(opt.outputFile);
+        out << fixed << setprecision(4);
+        out << "{\"requests\": " << opt.requests << ", \"completed\": " << latencies.size()
+            << ", \"concurrency\": " << opt.concurrency << ", \"busy\": " << busy << ", \"errors\": " << errors
+            << ", \"mismatches\": " << mismatches << ", \"wall_ms\": " << wallMs
+            << ", \"throughput_per_s\": " << latencies.size() * 1000.0 / wallMs
+            << ", \"p50_ms\": " << percentileMs(latencies, 50) << ", \"p90_ms\": " << percentileMs(latencies, 90)
+            << ", \"p99_ms\": " << percentileMs(latencies, 99) << ", \"max_ms\": " << percentileMs(latencies, 100)
+            << "}\n";
+        cerr << "结果已保存到 " << opt.outputFile << endl;
+    }
+
+    int smokeFailures = 0;
+    if (opt.smoke) {
+        cout << "冒烟检查：" << endl;
+        smokeFailures = runSmokeChecks(opt, templ);
+        if ((int)latencies.size() != opt.requests) smokeFailures++;
+        cout << (smokeFailures == 0 ? "冒烟测试通过" : "冒烟测试失败") << endl;
+    }
+    return errors > 0 || mismatches > 0 || smokeFailures > 0 ? 1 : 0;
+}
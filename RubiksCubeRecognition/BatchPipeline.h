@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/*************************************************************
+ * 有界无锁队列（多生产者多消费者，Vyukov 环形缓冲）
+ * 每个槽位带序号：序号等于写位置时可写，等于写位置 + 1 时可读，
+ * 入队/出队各只有一次 CAS，不加锁、不分配内存。
+ * 满或空时在条件变量上阻塞，由对端的入队/出队或 close() 唤醒；
+ * 没有等待者时入队/出队只多读一次等待计数，不碰互斥量。
+ * 容量向上取整为 2 的幂；close() 之后不再入队，队列取空后 pop 返回 false
+ *************************************************************/
+template<typename T>
+class LockFreeQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+    alignas(64) std::atomic<size_t> dequeuePos{ 0 };
+    std::atomic<bool> closed{ false };
+
+    // 阻塞等待：等待者持锁登记后重试，对端在成功之后检查登记数，
+    // 两边的 seq_cst 栅栏保证要么等待者重试成功，要么对端看到登记并唤醒。
+    // 等待者持锁期间只用不唤醒的 pushSlot/popSlot，离开锁之后再唤醒对端
+    std::mutex waitMutex;
+    std::condition_variable notEmpty, notFull;
+    std::atomic<int> popWaiters{ 0 }, pushWaiters{ 0 };
+
+    void wake(std::atomic<int>& waiters, std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            cv.notify_one();
+        }
+    }
+
+    void registerWaiter(std::atomic<int>& waiters) {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    bool pushSlot(const T& item) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool popSlot(T& item) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        item = cell->data;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+public:
+    explicit LockFreeQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    bool tryPush(const T& item) {
+        if (!pushSlot(item)) return false;  // 已满
+        wake(popWaiters, notEmpty);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        if (!popSlot(item)) return false;   // 为空
+        wake(pushWaiters, notFull);
+        return true;
+    }
+
+    // 入队，队列满时阻塞；返回等待的纳秒数
+    int64_t push(const T& item) {
+        if (tryPush(item)) return 0;
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            registerWaiter(pushWaiters);
+            while (!pushSlot(item)) notFull.wait(lock);
+            pushWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        wake(popWaiters, notEmpty);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // 出队，队列空时阻塞；队列已关闭且为空时返回 false。waitedNs 为等待的纳秒数
+    bool pop(T& item, int64_t& waitedNs) {
+        waitedNs = 0;
+        if (tryPop(item)) return true;
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok;
+        {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            registerWaiter(popWaiters);
+            for (;;) {
+                if (popSlot(item)) { ok = true; break; }
+                // 先读关闭标志再检查一次：关闭前入队的元素不会漏掉
+                if (closed.load(std::memory_order_acquire)) { ok = popSlot(item); break; }
+                notEmpty.wait(lock);
+            }
+            popWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (ok) wake(pushWaiters, notFull);
+        waitedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        return ok;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(waitMutex);
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    // 当前元素数（并发时为近似值，用于统计队列深度）
+    size_t size() const {
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+};
+
+/*************************************************************
+ * 流水线一个阶段的统计（该阶段所有工作线程累加）：
+ * 忙碌时间、等待输入（上游跟不上）与等待输出（下游队列满）的时间，
+ * 以及取元素时输入队列的平均深度。
+ * 占用率 = 忙碌时间 / (墙钟 × 宽度)，接近 100% 的阶段限制吞吐量
+ *************************************************************/
+struct StageStats {
+    std::string name;
+    int width = 1;
+    std::atomic<uint64_t> items{ 0 };
+    std::atomic<int64_t> busyNs{ 0 };
+    std::atomic<int64_t> starvedNs{ 0 };  // 等待输入
+    std::atomic<int64_t> blockedNs{ 0 };  // 等待输出
+    std::atomic<uint64_t> depthSum{ 0 };  // 每次取元素时输入队列的深度之和
+
+    StageStats(const std::string& name, int width) : name(name), width(width) {}
+
+    double occupancy(double wallMs) const {
+        return wallMs > 0 ? busyNs.load() / 1e6 / (wallMs * width) : 0.0;
+    }
+
+    double meanDepth() const {
+        uint64_t n = items.load();
+        return n ? (double)depthSum.load() / n : 0.0;
+    }
+};
+
+/*************************************************************
+ * 阶段的一个工作线程：emit 把结果推到下游队列，
+ * 队列满时的等待计入本阶段的等待输出时间，不计入忙碌时间
+ *************************************************************/
+class StageWorker {
+private:
+    StageStats& stats;
+    int64_t blocked = 0;    // 本次处理中等待输出的纳秒数
+
+public:
+    explicit StageWorker(StageStats& stats) : stats(stats) {}
+
+    template<typename T>
+    void emit(LockFreeQueue<T>& queue, const T& item) {
+        int64_t waited = queue.push(item);
+        blocked += waited;
+        stats.blockedNs += waited;
+    }
+
+    // 处理一个元素：计时 fn()，扣除其中等待输出的时间
+    template<typename Fn>
+    void process(Fn&& fn) {
+        blocked = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        stats.busyNs += elapsed - blocked;
+        stats.items++;
+    }
+
+    // 从 input 取元素交给 fn(item, worker)，直到 input 关闭且为空
+    template<typename In, typename Fn>
+    void run(LockFreeQueue<In>& input, Fn&& fn) {
+        In item;
+        int64_t waited;
+        for (;;) {
+            size_t depth = input.size();
+            if (!input.pop(item, waited)) break;
+            stats.starvedNs += waited;
+            stats.depthSum += depth;
+            process([&] { fn(item, *this); });
+        }
+        stats.starvedNs += waited;
+    }
+};
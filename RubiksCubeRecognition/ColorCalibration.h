@@ -0,0 +1,255 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+/*************************************************************
+ * 颜色模型：六种颜色在 Lab 空间中的中心与接受半径
+ * 下标与颜色阈值表一致，取值为 OpenCV 8 位 Lab（L、a、b 均为 0..255）。
+ * 由一个魔方的 54 个色面聚类得到，按相机/光照配置（profile）
+ * 缓存到文本文件，之后的魔方直接复用，替代固定的 Lab 阈值盒
+ *************************************************************/
+struct ColorModel {
+    static const int COLORS = 6;
+
+    std::string profile;         // 相机/光照配置名称
+    float center[COLORS][3];     // 各颜色的 Lab 中心
+    float radius[COLORS];        // 接受半径（加权 Lab 距离）
+    bool valid = false;
+
+    // 加权 Lab 距离的平方：亮度受光照影响最大，权重减半
+    static float distance2(const float* p, const float* c) {
+        float dl = 0.5f * (p[0] - c[0]);
+        float da = p[1] - c[1];
+        float db = p[2] - c[2];
+        return dl * dl + da * da + db * db;
+    }
+
+    // 最近的颜色下标，超出该颜色的接受半径时返回 -1
+    int nearest(const float* lab) const {
+        int best = 0;
+        float bestD = distance2(lab, center[0]);
+        for (int k = 1; k < COLORS; k++) {
+            float d = distance2(lab, center[k]);
+            if (d < bestD) {
+                bestD = d;
+                best = k;
+            }
+        }
+        return bestD <= radius[best] * radius[best] ? best : -1;
+    }
+
+    /*********************************************************
+     * 写成文本：首行为版本标记，之后每行 “颜色名 L a b 半径”
+     *********************************************************/
+    bool write(std::ostream& out, const std::vector<std::string>& names) const {
+        out << "# RubiksCubeRecognition color model v1\n";
+        out << "profile " << profile << "\n";
+        for (int k = 0; k < COLORS && k < (int)names.size(); k++) {
+            out << names[k] << " " << center[k][0] << " " << center[k][1] << " "
+                << center[k][2] << " " << radius[k] << "\n";
+        }
+        return (bool)out;
+    }
+
+    bool save(const std::string& path, const std::vector<std::string>& names) const {
+        std::ofstream out(path, std::ios::trunc);
+        return out && write(out, names);
+    }
+
+    /*********************************************************
+     * 读取 write 写出的文本；颜色按名称匹配，缺少任何一种颜色即失败
+     *********************************************************/
+    bool read(std::istream& in, const std::vector<std::string>& names) {
+        std::string line;
+        if (!in || !std::getline(in, line) || line != "# RubiksCubeRecognition color model v1") {
+            return false;
+        }
+
+        int found = 0;
+        while (std::getline(in, line)) {
+            std::istringstream iss(line);
+            std::string key;
+            if (!(iss >> key)) continue;
+            if (key == "profile") {
+                iss >> profile;
+                continue;
+            }
+            auto it = std::find(names.begin(), names.end(), key);
+            if (it == names.end() || it - names.begin() >= COLORS) continue;
+            int k = (int)(it - names.begin());
+            if (iss >> center[k][0] >> center[k][1] >> center[k][2] >> radius[k]) {
+                found |= 1 << k;
+            }
+        }
+        valid = found == (1 << COLORS) - 1;
+        return valid;
+    }
+
+    bool load(const std::string& path, const std::vector<std::string>& names) {
+        std::ifstream in(path);
+        return read(in, names);
+    }
+};
+
+/*************************************************************
+ * 颜色标定：把六个面的 54 个色面样本聚为恰好 6 组、每组 9 个
+ * 以六个中心块为锚点（中心块固定属于自己那一组），
+ * 交替进行“容量受限的指派”与“重算组中心”，直到指派不再变化；
+ * 再用各组中心与颜色阈值盒的距离为六组确定颜色名称
+ *************************************************************/
+class ColorCalibrator {
+public:
+    static const int FACES = 6;
+    static const int STICKERS = 9;
+    static const int SAMPLES = FACES * STICKERS;
+
+    struct Result {
+        bool ok = false;
+        int colorOf[SAMPLES];    // 每个色面的颜色下标（样本顺序）
+        int iterations = 0;      // 指派/重算的轮数
+        double ms = 0;           // 聚类 + 命名总耗时
+    };
+
+private:
+    // 组容量受限的指派：中心块固定，其余 48 个按代价从小到大贪心放入未满的组，
+    // 再做两两交换直到总代价不能再降低
+    static void assign(const float cost[SAMPLES][FACES], int label[SAMPLES]) {
+        struct Pair { float cost; uint8_t sample, cluster; };
+        Pair pairs[(SAMPLES - FACES) * FACES];
+        int n = 0;
+        for (int i = 0; i < SAMPLES; i++) {
+            if (i % STICKERS == STICKERS / 2) continue;
+            for (int k = 0; k < FACES; k++) {
+                pairs[n++] = { cost[i][k], (uint8_t)i, (uint8_t)k };
+            }
+        }
+        std::sort(pairs, pairs + n, [](const Pair& a, const Pair& b) { return a.cost < b.cost; });
+
+        int fill[FACES];
+        for (int k = 0; k < FACES; k++) fill[k] = 1;
+        for (int i = 0; i < SAMPLES; i++) {
+            label[i] = i % STICKERS == STICKERS / 2 ? i / STICKERS : -1;
+        }
+        for (int p = 0; p < n; p++) {
+            const Pair& pr = pairs[p];
+            if (label[pr.sample] >= 0 || fill[pr.cluster] == STICKERS) continue;
+            label[pr.sample] = pr.cluster;
+            fill[pr.cluster]++;
+        }
+
+        // 两两交换改进（组大小不变）
+        for (bool improved = true; improved;) {
+            improved = false;
+            for (int i = 0; i < SAMPLES; i++) {
+                if (i % STICKERS == STICKERS / 2) continue;
+                for (int j = i + 1; j < SAMPLES; j++) {
+                    int li = label[i], lj = label[j];
+                    if (li == lj || j % STICKERS == STICKERS / 2) continue;
+                    if (cost[i][lj] + cost[j][li] < cost[i][li] + cost[j][lj] - 1e-4f) {
+                        label[i] = lj;
+                        label[j] = li;
+                        improved = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // 点到阈值盒的距离平方（盒内为 0），与 ColorModel 使用同样的亮度权重
+    static float boxDistance2(const float* p, const float* lo, const float* hi) {
+        float d2 = 0;
+        for (int c = 0; c < 3; c++) {
+            float d = p[c] < lo[c] ? lo[c] - p[c] : (p[c] > hi[c] ? p[c] - hi[c] : 0.0f);
+            if (c == 0) d *= 0.5f;
+            d2 += d * d;
+        }
+        return d2;
+    }
+
+public:
+    /*********************************************************
+     * 聚类并拟合颜色模型
+     * samples：54 个 Lab 样本，按面排列，每面 9 个（行优先，第 5 个为中心块）
+     * boxLo/boxHi：颜色阈值表中各颜色的 Lab 下限/上限，仅用于给六组命名
+     * 中心块两两颜色过近（无法区分六种颜色）时返回失败
+     *********************************************************/
+    static Result fit(const float samples[SAMPLES][3], const float boxLo[FACES][3],
+        const float boxHi[FACES][3], const std::string& profile, ColorModel& model) {
+        auto t0 = std::chrono::steady_clock::now();
+        Result result;
+
+        float centroid[FACES][3];
+        for (int k = 0; k < FACES; k++) {
+            const float* c = samples[k * STICKERS + STICKERS / 2];
+            for (int ch = 0; ch < 3; ch++) centroid[k][ch] = c[ch];
+        }
+        for (int a = 0; a < FACES; a++) {
+            for (int b = a + 1; b < FACES; b++) {
+                if (ColorModel::distance2(centroid[a], centroid[b]) < 8.0f * 8.0f) return result;
+            }
+        }
+
+        int label[SAMPLES], previous[SAMPLES];
+        float cost[SAMPLES][FACES];
+        for (int i = 0; i < SAMPLES; i++) previous[i] = -1;
+
+        for (result.iterations = 1; result.iterations <= 20; result.iterations++) {
+            for (int i = 0; i < SAMPLES; i++) {
+                for (int k = 0; k < FACES; k++) {
+                    cost[i][k] = ColorModel::distance2(samples[i], centroid[k]);
+                }
+            }
+            assign(cost, label);
+            if (std::equal(label, label + SAMPLES, previous)) break;
+            std::copy(label, label + SAMPLES, previous);
+
+            float sum[FACES][3] = {};
+            for (int i = 0; i < SAMPLES; i++) {
+                for (int ch = 0; ch < 3; ch++) sum[label[i]][ch] += samples[i][ch];
+            }
+            for (int k = 0; k < FACES; k++) {
+                for (int ch = 0; ch < 3; ch++) centroid[k][ch] = sum[k][ch] / STICKERS;
+            }
+        }
+
+        // 六组到六种颜色的一一对应：枚举 720 种排列，取到阈值盒距离之和最小者
+        int perm[FACES], bestPerm[FACES];
+        for (int k = 0; k < FACES; k++) perm[k] = bestPerm[k] = k;
+        float bestCost = -1;
+        do {
+            float total = 0;
+            for (int k = 0; k < FACES; k++) {
+                total += boxDistance2(centroid[k], boxLo[perm[k]], boxHi[perm[k]]);
+            }
+            if (bestCost < 0 || total < bestCost) {
+                bestCost = total;
+                std::copy(perm, perm + FACES, bestPerm);
+            }
+        } while (std::next_permutation(perm, perm + FACES));
+
+        // 接受半径：组内最远样本距离的 1.5 倍，至少 15
+        model.profile = profile;
+        for (int k = 0; k < FACES; k++) {
+            int color = bestPerm[k];
+            float maxD2 = 0;
+            for (int i = 0; i < SAMPLES; i++) {
+                if (label[i] == k) maxD2 = std::max(maxD2, cost[i][k]);
+            }
+            for (int ch = 0; ch < 3; ch++) model.center[color][ch] = centroid[k][ch];
+            model.radius[color] = std::max(15.0f, 1.5f * std::sqrt(maxD2));
+        }
+        model.valid = true;
+
+        for (int i = 0; i < SAMPLES; i++) result.colorOf[i] = bestPerm[label[i]];
+        result.ok = true;
+        result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return result;
+    }
+};
@@ -0,0 +1,2833 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cmath>
+
+#include "PipelineMetrics.h"
+#include "PlatformUtil.h"
+#include "ColorCalibration.h"
+#include "GridLattice.h"
+#include "FaceMatrix.h"
+#include "ImageIO.h"
+
+using namespace std;
+using namespace cv;
+
+/*************************************************************
+ * 数据结构
+ *************************************************************/
+struct ColorRange {
+    Scalar minVal;     // LAB 最小阈值
+    Scalar maxVal;     // LAB 最大阈值
+    string name;       // 颜色名称
+    Scalar drawColor;  // 绘制颜色
+    char code;         // 颜色代码（用于输出）
+};
+
+struct ColorBlock {
+    Point2f center;    // 色块中心点
+    string colorName;  // 颜色名称
+    Scalar colorValue; // 颜色值
+    Rect boundingBox;  // 边界框
+    int row = -1;      // 网格中的行索引（未分配时为 -1）
+    int col = -1;      // 网格中的列索引
+    double area;       // 面积
+    bool inferred = false; // 由网格推断的缺失色块（没有检测到对应的色块，颜色取格子中心的分类结果）
+};
+
+// 连通区域统计（labelRegions 的输出，坐标为检测层坐标）
+struct RegionStats {
+    int color;          // 颜色下标
+    Rect box;           // 边界框
+    Point start;        // 扫描顺序的第一个像素（外边界跟踪的起点）
+};
+
+// 区域的外轮廓（检测层坐标，同 findContours CHAIN_APPROX_SIMPLE），
+// 轮廓点在一个共享的点数组中首尾相接，[first, first + count)
+struct RegionOutline {
+    int color;
+    Rect box;
+    Point start;
+    double area;        // 轮廓面积（同 contourArea）
+    int first, count;
+    bool nested;        // 在另一个同色区域的外轮廓内（RETR_EXTERNAL 不输出）
+};
+
+// labelRegions 的工作缓冲（游程、并查集与合并结果），在多次调用之间复用
+struct RegionScratch {
+    struct Run {
+        int x0, x1;  // 闭区间
+        int node;    // 并查集节点（每个游程一个）
+    };
+
+    vector<int> parent;
+    vector<RegionStats> nodes;
+    vector<vector<Run>> prev, cur;
+    vector<size_t> prevIdx;
+    vector<int> runStart;
+    vector<int> regionOf;
+    vector<RegionStats> merged;     // 按首次出现的扫描顺序，不分颜色
+    vector<vector<Run>> first;      // 第一行的游程（node 已换成 merged 下标，用于分块拼接）
+    vector<int> base;               // 分块拼接：各分块区域在全局编号中的起点
+};
+
+// 分块并行分割的单块缓冲：分类与腐蚀结果带有上下光晕行，只在本块内使用
+struct SegmentTile {
+    Mat raw, eroded, tmp;
+    RegionScratch regions;          // 本块行范围内的连通域标记
+};
+
+// 流式连通域标记的状态：只保留上一行的游程和尚未结束的区域（连同其游程），
+// 区域结束时跟踪外轮廓、按面积过滤后回收编号与游程；占用为窗口宽度乘条带高度
+// 加上尚未结束区域的游程数，与图像高度无关
+struct RegionStream {
+    struct Run {
+        int x0, x1;  // 闭区间
+        int id;      // 区域编号（行末规范为根）
+    };
+    struct RunNode {
+        int y, x0, x1;
+        int next;    // 同一区域的下一个游程（或空闲链表中的下一个），-1 为结尾
+    };
+
+    int colorCount = 0;
+    int cols = 0;
+    double minArea = 0, maxArea = 0;
+    vector<vector<Run>> prev, cur;
+    vector<size_t> prevIdx;
+    vector<int> runStart;
+    vector<int> parent;             // 并查集（按区域编号）
+    vector<RegionStats> stats;      // 根上累加的统计量
+    vector<int64> firstKey;         // 区域第一个游程的生成顺序（决定输出顺序）
+    vector<uchar> mark;             // 行末：1 = 本行仍有游程，2 = 已输出
+    vector<int> freeIds;            // 可复用的编号
+    vector<int> retired;            // 本行被合并掉或已输出的编号，行末回收
+    vector<RunNode> runNodes;       // 尚未结束区域的游程（链表节点池）
+    int freeRun = -1;               // 空闲节点链表
+    vector<int> runHead, runTail;   // 各区域游程链表的首尾（按区域编号）
+    vector<RunNode> sortedRuns;     // 区域结束时按 (y, x0) 排序的游程
+    vector<int> rowStart;           // sortedRuns 中各行的起点
+    vector<Point> contour;          // 区域结束时跟踪的外轮廓
+    vector<pair<int64, RegionOutline>> done;  // 已结束且面积在范围内的区域（含首次出现顺序）
+    vector<Point> points;           // done 的轮廓点
+    vector<RegionOutline> outlines; // finishRegionStream 的结果：去掉嵌套区域，按颜色分组
+    int rejected = 0;               // 面积不在范围内的区域数（含嵌套在同色区域内的）
+    size_t peakIds = 0;             // 同时在用的编号数峰值
+};
+
+// 条带流式分割的缓冲：行数为条带高度加形态学光晕，不随图像高度增长
+struct StripScratch {
+    Mat work;                       // 新进入窗口的检测层行（金字塔时为缩小结果）
+    Mat raw, eroded, opened, tmp;   // 滚动窗口：分类结果保留上一条末尾的光晕行
+    Mat patch, patchLabels;         // 补格时格子附近的小块分割
+    Mat patchRaw, patchEroded, patchTmp;
+    RegionStream regions;
+};
+
+/*************************************************************
+ * 帧上下文：每个工作线程一份，持有分析一个面所需的图像缓冲与向量容量，
+ * 在面与帧之间复用（Mat::create 尺寸不变时不重新分配，clear 保留容量）。
+ * 用同尺寸图像预热后，默认分割设置（全分辨率分割，两个提取后端均可）且不绘制时，
+ * 分析一个面不再分配堆内存，包括 OpenCV 内部的 fastMalloc/AutoBuffer。
+ * 只有这一组合有保证（批处理 none/codes/standard 级别、服务与视频流模式、
+ * 不带叠加图的 rcr_analyze_batch）；以下情况每个面仍有分配：
+ * 金字塔缩放与细化、分块并行、条带流式、四边形模式，以及叠加绘制——
+ * 叠加图的虚线段与粗多边形复用本结构的缓冲，但 OpenCV 的粗线抗锯齿绘制
+ * 与 putText 在内部分配，批处理默认的 full 级别因此不是零分配
+ *************************************************************/
+struct FrameContext {
+    Mat work;                          // 金字塔粗层图像
+    Mat raw, eroded, labels;           // 查表分类结果、腐蚀结果、开运算后的位掩码
+    Mat morphTmp;                      // 可分离形态学的水平方向中间结果
+    Mat mask;                          // 四周补 0 的单色二值图（轮廓后端的扫描与标记）
+    Mat overlay;                       // 检测叠加图（由调用方复制原图）
+
+    vector<Point> contour;             // 换算到原图坐标或细化后的轮廓
+    vector<RegionStats> regions;       // 连通域后端
+    RegionScratch regionScratch;
+    vector<RegionOutline> candidates;  // 连通域后端：当前颜色需要跟踪外轮廓的区域
+    vector<RegionOutline> outlines;    // 两个后端：通过面积过滤的外轮廓（按颜色分组、组内按发现顺序）
+    vector<Point> outlinePoints;       // outlines（连通域后端另含 candidates）的轮廓点
+    vector<Point> outline;             // 当前色块的检测层轮廓
+    vector<SegmentTile> tiles;         // 分块并行分割（segmentThreads > 1）
+    StripScratch strip;                // 条带流式分割（streamRows > 0）
+
+    vector<Point> dashPoints;          // 叠加图：当前颜色的虚线段（每段两个端点，依次存放）
+    vector<const Point*> dashHeads;    // 叠加图：各虚线段的起点（polylines 的指针数组）
+    vector<int> dashCounts;            // 叠加图：各虚线段的点数（均为 2）
+    vector<Point> approx;              // 叠加图：色块轮廓的粗多边形
+    vector<Rect> labelBoxes;           // 叠加图：当前颜色的标签位置
+
+    vector<ColorBlock> blocks;         // analyzeCubeFace 的结果
+    LatticeFit grid;                   // analyzeCubeFace 的网格拟合结果（含置信度）
+    bool quadFound = false;            // 四边形模式下本面找到了四边形（否则已回退到全图分割）
+    vector<vector<char>> colorMatrix;  // fillColorMatrix 的结果
+};
+
+// 展开图顺序（Up, Left, Front, Right, Back, Down）在输入顺序中的下标
+const vector<int> netOrder = { 4, 2, 0, 3, 1, 5 };
+
+// 色块提取后端
+enum ExtractBackend {
+    EXTRACT_CONTOURS,    // 逐色扫描外轮廓（同 findContours RETR_EXTERNAL）+ contourArea/moments/boundingRect
+    EXTRACT_COMPONENTS   // 位掩码图上一遍游程并查集得到所有颜色的区域，只跟踪可能通过面积过滤的区域的外轮廓
+};
+
+// 解析提取后端名称（contours/components），无法识别时返回 false
+inline bool parseExtractBackend(const string& name, ExtractBackend& backend) {
+    if (name == "contours") backend = EXTRACT_CONTOURS;
+    else if (name == "components") backend = EXTRACT_COMPONENTS;
+    else return false;
+    return true;
+}
+
+// 检测模式
+enum DetectMode {
+    DETECT_SEGMENT,  // 全图逐像素分割色块，再按行列阈值分配到网格
+    DETECT_QUAD      // 找魔方面四边形，透视校正到小方图后逐格取色
+};
+
+// 解析检测模式名称（segment/quad），无法识别时返回 false
+inline bool parseDetectMode(const string& name, DetectMode& mode) {
+    if (name == "segment") mode = DETECT_SEGMENT;
+    else if (name == "quad") mode = DETECT_QUAD;
+    else return false;
+    return true;
+}
+
+/*************************************************************
+ * 色块检测与分析类
+ *************************************************************/
+class CubeFaceAnalyzer {
+private:
+    vector<ColorRange> colorTable; // 六种魔方颜色阈值
+    map<string, char> colorCodes;  // 颜色名称到代码的映射
+
+    // BGR -> 颜色位掩码查找表：第 i 位表示像素落在 colorTable[i] 的LAB范围内。
+    // 各颜色范围允许重叠（例如 Blue 的 L 为 0..255 会吞掉暗像素），
+    // 位掩码保留了原先六张独立掩码的重叠语义。
+    vector<uchar> colorLut;
+    int lutBits = 8;          // 每通道量化位数（8 为全精度 256^3）
+    double lutBuildMs = 0;    // 查找表构建耗时（毫秒）
+
+    // 色块面积范围（占图像面积的比例），与分辨率无关。
+    // 默认值对应原先 1024x1024 图像上的 15000 ~ 150000 像素。
+    double minAreaFraction = 15000.0 / (1024 * 1024);
+    double maxAreaFraction = 150000.0 / (1024 * 1024);
+
+    // 金字塔检测：先在缩小 2^pyramidLevels 倍的图像上找色块，
+    // refineBlocks 为真时再在原图的色块 ROI 内重新计算轮廓、中心和边界框
+    int pyramidLevels = 0;    // 0 = 全分辨率，-1 = 按图像大小自动选择
+    bool refineBlocks = false;
+
+    bool verbose = true;      // 是否打印色块数量警告（视频流模式下关闭）
+
+    // 网格拟合置信度低于此值时建议重拍（由调用方决定是否重试）
+    float minGridConfidence = 0.5f;
+
+    ExtractBackend extractBackend = EXTRACT_CONTOURS;
+
+    // 单张图的分类、形态学与连通域标记按水平分块并行（1 = 串行）；
+    // 每块至少 minTileRows 行，避免光晕行的重复计算占比过高
+    int segmentThreads = 1;
+    static constexpr int minTileRows = 64;
+
+    // 条带流式模式：检测层每次只处理 streamRows 行（0 = 关闭），
+    // 不保留整幅位掩码，连通域统计随条带增量更新，适合超大图像
+    int streamRows = 0;
+
+    // 四边形检测模式：魔方面透视校正后的目标边长，每格取内部中央区域的 Lab 中位数。
+    // 实际校正边长按阶数取整为 quadCell(N) * N，保证 N x N 格正好铺满
+    DetectMode detectMode = DETECT_SEGMENT;
+    int quadSize = 150;
+
+    // 标定得到的颜色模型：有效时查找表与 classifyLab 按最近的颜色中心分类，
+    // 不再使用 colorTable 的固定阈值盒
+    ColorModel colorModel;
+
+    PipelineMetrics* metrics = nullptr; // 指标（为空时不记录）
+
+public:
+    CubeFaceAnalyzer(int lutBits = 8) {
+        // 初始化颜色阈值表，包含六个颜色的LAB范围
+        colorTable = {
+            {{  0,146, 92}, { 94,187,155}, "Red",    Scalar(0,0,255), 'R'},
+            {{139, 80,146}, {255,111,255}, "Yellow", Scalar(0,255,255), 'Y'},
+            {{ 82, 42,  0}, {177,101,169}, "Green",  Scalar(0,255,0), 'G'},
+            {{  0,  0,  0}, {255,255, 94}, "Blue",   Scalar(255,0,0), 'B'},
+            {{160,127, 90}, {226,177,110}, "White",  Scalar(255,255,255), 'W'},
+            {{ 87,158,106}, {163,255,172}, "Pink",   Scalar(203,192,255), 'P'}
+        };
+
+        // 初始化颜色代码映射
+        for (auto& c : colorTable) {
+            colorCodes[c.name] = c.code;
+        }
+
+        // 将颜色阈值表编译为查找表（只做一次）
+        buildColorLut(lutBits);
+    }
+
+    /*********************************************************
+     * 构建 BGR -> 颜色位掩码查找表
+     * bits = 8 时逐个枚举全部 256^3 种颜色，结果与逐色 inRange 完全一致；
+     * bits < 8 时按量化格中心取值，表更小、缓存更友好，但边界处可能有偏差。
+     *********************************************************/
+    void buildColorLut(int bits) {
+        int64 t0 = getTickCount();
+
+        lutBits = bits;
+        int levels = 1 << bits;
+        int shift = 8 - bits;
+        int half = (1 << shift) >> 1;
+
+        // 把所有量化颜色排成一张图：行 = b * levels + g，列 = r
+        Mat bgr(levels * levels, levels, CV_8UC3);
+        for (int b = 0; b < levels; b++) {
+            for (int g = 0; g < levels; g++) {
+                Vec3b* p = bgr.ptr<Vec3b>(b * levels + g);
+                for (int r = 0; r < levels; r++) {
+                    p[r] = Vec3b((uchar)((b << shift) + half),
+                        (uchar)((g << shift) + half),
+                        (uchar)((r << shift) + half));
+                }
+            }
+        }
+
+        // 使用与检测时相同的 cvtColor 转换，保证LAB取值一致
+        Mat lab;
+        cvtColor(bgr, lab, COLOR_BGR2Lab);
+
+        colorLut.assign((size_t)levels * levels * levels, 0);
+        if (colorModel.valid) {
+            // 颜色模型：每种颜色只占最近中心的区域，位掩码互不重叠
+            const uchar* p = lab.ptr<uchar>(0);
+            for (size_t j = 0; j < colorLut.size(); j++, p += 3) {
+                float v[3] = { (float)p[0], (float)p[1], (float)p[2] };
+                int ci = colorModel.nearest(v);
+                if (ci >= 0) colorLut[j] = (uchar)(1 << ci);
+            }
+            lutBuildMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+            return;
+        }
+        for (size_t i = 0; i < colorTable.size(); i++) {
+            Mat mask;
+            inRange(lab, colorTable[i].minVal, colorTable[i].maxVal, mask);
+
+            uchar bit = (uchar)(1 << i);
+            const uchar* m = mask.ptr<uchar>(0);
+            for (size_t j = 0; j < colorLut.size(); j++) {
+                if (m[j]) colorLut[j] |= bit;
+            }
+        }
+
+        lutBuildMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+    }
+
+    /*********************************************************
+     * 单遍分类：BGR 图像 -> 单字节颜色位掩码图
+     *********************************************************/
+    void classifyPixels(const Mat& img, Mat& labels) const {
+        labels.create(img.size(), CV_8UC1);
+
+        const uchar* lut = colorLut.data();
+        int shift = 8 - lutBits;
+        int bits = lutBits;
+
+        for (int y = 0; y < img.rows; y++) {
+            const uchar* src = img.ptr<uchar>(y);
+            uchar* dst = labels.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; x++, src += 3) {
+                size_t idx = ((size_t)(src[0] >> shift) << (2 * bits)) |
+                    ((size_t)(src[1] >> shift) << bits) |
+                    (size_t)(src[2] >> shift);
+                dst[x] = lut[idx];
+            }
+        }
+    }
+
+    /*********************************************************
+     * 位掩码形态学：一次处理全部六种颜色
+     * 腐蚀 = 邻域按位与，膨胀 = 邻域按位或；可分离的矩形核。
+     * 与 morphologyEx(MORPH_OPEN, 3x3, 2次) 等价：迭代两次的 3x3 矩形核
+     * 等同于一次 5x5 矩形核；图像外的像素对腐蚀视为全1、对膨胀视为全0。
+     *********************************************************/
+    static void morphBitwise(const Mat& src, Mat& dst, int radius, bool erodeOp) {
+        Mat tmp;
+        morphBitwise(src, dst, radius, erodeOp, tmp);
+    }
+
+    // tmp 为水平方向的中间结果缓冲（尺寸不变时复用）
+    static void morphBitwise(const Mat& src, Mat& dst, int radius, bool erodeOp, Mat& tmp) {
+        morphBitwise(src, dst, radius, erodeOp, tmp, 0, src.rows);
+    }
+
+    // 只计算 dst 的 [y0, y1) 行：水平方向只处理这些行上下 radius 行以内，
+    // 垂直方向把 src 的首末行当作图像边界（分块时由调用方保证光晕行足够）
+    static void morphBitwise(const Mat& src, Mat& dst, int radius, bool erodeOp, Mat& tmp, int y0, int y1) {
+        tmp.create(src.size(), CV_8UC1);
+        dst.create(src.size(), CV_8UC1);
+        uchar border = erodeOp ? 0xFF : 0x00;
+
+        // 水平方向
+        for (int y = max(0, y0 - radius); y < min(src.rows, y1 + radius); y++) {
+            const uchar* s = src.ptr<uchar>(y);
+            uchar* t = tmp.ptr<uchar>(y);
+            for (int x = 0; x < src.cols; x++) {
+                uchar v = s[x];
+                for (int k = -radius; k <= radius; k++) {
+                    int xx = x + k;
+                    uchar n = (xx < 0 || xx >= src.cols) ? border : s[xx];
+                    v = erodeOp ? (uchar)(v & n) : (uchar)(v | n);
+                }
+                t[x] = v;
+            }
+        }
+
+        // 垂直方向
+        for (int y = y0; y < y1; y++) {
+            uchar* d = dst.ptr<uchar>(y);
+            const uchar* t0 = tmp.ptr<uchar>(y);
+            memcpy(d, t0, src.cols);
+            for (int k = -radius; k <= radius; k++) {
+                int yy = y + k;
+                // 图像外的行对腐蚀（全1）和膨胀（全0）都不改变结果
+                if (k == 0 || yy < 0 || yy >= src.rows) continue;
+                const uchar* t = tmp.ptr<uchar>(yy);
+                if (erodeOp) {
+                    for (int x = 0; x < src.cols; x++) d[x] &= t[x];
+                }
+                else {
+                    for (int x = 0; x < src.cols; x++) d[x] |= t[x];
+                }
+            }
+        }
+    }
+
+    /*********************************************************
+     * 使用标定得到的颜色模型替代固定阈值（会重建查找表）
+     * 需在多线程共享分析器之前设置
+     *********************************************************/
+    void setColorModel(const ColorModel& model) {
+        colorModel = model;
+        buildColorLut(lutBits);
+    }
+
+    bool hasColorModel() const {
+        return colorModel.valid;
+    }
+
+    const ColorModel& getColorModel() const {
+        return colorModel;
+    }
+
+    /*********************************************************
+     * 设置色块面积范围（占图像面积的比例）
+     *********************************************************/
+    void setAreaLimits(double minFraction, double maxFraction) {
+        minAreaFraction = minFraction;
+        maxAreaFraction = maxFraction;
+    }
+
+    /*********************************************************
+     * N x N 面的色块面积范围（检测层像素）：面积比例按 3x3 面设置，
+     * 同样大小的面分成 N x N 格时每格面积按 (3/N)^2 缩放
+     *********************************************************/
+    template<int N>
+    void gridAreaLimits(double workArea, double& minArea, double& maxArea) const {
+        constexpr double cellScale = 9.0 / (N * N);
+        minArea = minAreaFraction * cellScale * workArea;
+        maxArea = maxAreaFraction * cellScale * workArea;
+    }
+
+    /*********************************************************
+     * 设置金字塔检测层数（0 = 全分辨率，-1 = 自动）及是否在原图上细化
+     * 需在多线程共享分析器之前设置
+     *********************************************************/
+    void setPyramid(int levels, bool refine) {
+        pyramidLevels = levels;
+        refineBlocks = refine;
+    }
+
+    /*********************************************************
+     * 设置检测模式及四边形模式的校正边长，需在多线程共享分析器之前设置
+     *********************************************************/
+    void setDetectMode(DetectMode mode, int canonicalSize = 150) {
+        detectMode = mode;
+        quadSize = max(30, canonicalSize);
+    }
+
+    /*********************************************************
+     * N 阶四边形检测的格子边长（像素），校正图边长为 quadCell(n) * n
+     *********************************************************/
+    int quadCell(int n) const {
+        return max(10, quadSize / n);
+    }
+
+    /*********************************************************
+     * 设置色块提取后端，需在多线程共享分析器之前设置
+     *********************************************************/
+    void setExtractBackend(ExtractBackend backend) {
+        extractBackend = backend;
+    }
+
+    /*********************************************************
+     * 设置单张图分割的分块并行数（1 = 串行），需在多线程共享分析器之前设置。
+     * 实际并发还受 OpenCV 线程池大小（setNumThreads）限制；结果与串行逐位相同
+     *********************************************************/
+    void setSegmentThreads(int threads) {
+        segmentThreads = max(1, threads);
+    }
+
+    /*********************************************************
+     * 设置条带流式模式的条带行数（检测层行数，0 = 关闭），需在多线程共享分析器之前设置。
+     * 打开后分割模式总是用游程统计提取色块（忽略提取后端与分块并行），
+     * 除输入图像与叠加图外只占用 O(宽 x 条带高度) 的内存。
+     * 输入仍是整幅解码后的图像，所以进程的内存并不是端到端的 O(宽 x 条带高度)
+     *********************************************************/
+    void setStreaming(int stripRows) {
+        streamRows = max(0, stripRows);
+    }
+
+    int getStreamRows() const {
+        return streamRows;
+    }
+
+    /*********************************************************
+     * 流式模式下条带缓冲的字节数（不含输入图像）：
+     * 检测层 BGR 条带（金字塔时）、四个单通道窗口与每色两行游程
+     *********************************************************/
+    size_t streamingBufferBytes(const Mat& img) const {
+        int levels = resolvePyramidLevels(img);
+        size_t cols = (size_t)(img.cols >> levels);
+        size_t rows = (size_t)(streamRows + 4 * max(1, 2 >> levels));
+        size_t strips = cols * rows * ((levels > 0 ? 3 : 0) + 4);
+        size_t runs = 2 * colorTable.size() * ((cols + 1) / 2) * sizeof(RegionStream::Run);
+        return strips + runs;
+    }
+
+    /*********************************************************
+     * 设置指标记录对象（为空时关闭），需在多线程共享分析器之前设置
+     *********************************************************/
+    void setMetrics(PipelineMetrics* m) {
+        metrics = m;
+    }
+
+    /*********************************************************
+     * 获取颜色名称列表（顺序与颜色阈值表一致，用于构造指标对象）
+     *********************************************************/
+    vector<string> getColorNames() const {
+        vector<string> names;
+        for (const auto& c : colorTable) {
+            names.push_back(c.name);
+        }
+        return names;
+    }
+
+    /*********************************************************
+     * 设置是否打印警告信息
+     *********************************************************/
+    void setVerbose(bool enabled) {
+        verbose = enabled;
+    }
+
+    /*********************************************************
+     * 设置/获取网格置信度阈值（低于此值的面视为需要重拍）
+     *********************************************************/
+    void setMinGridConfidence(float value) {
+        minGridConfidence = value;
+    }
+
+    float getMinGridConfidence() const {
+        return minGridConfidence;
+    }
+
+    /*********************************************************
+     * 影响识别结果的设置的摘要（结果缓存的键的一部分）：查找表内容
+     * （已包含颜色阈值或标定的颜色模型）、颜色阈值表与颜色模型
+     * （四边形模式直接使用）、面积范围、金字塔、提取后端与检测模式。
+     * 分块并行数与条带行数不改变结果，只计入是否流式。
+     * 要摘要整张查找表（8 位精度时 16 MB），每次运行只需计算一次
+     *********************************************************/
+    uint64_t settingsHash() const {
+        uint64_t h = hashBytes(colorLut.data(), colorLut.size(), (uint64_t)lutBits);
+        for (const ColorRange& c : colorTable) {
+            double range[6] = { c.minVal[0], c.minVal[1], c.minVal[2], c.maxVal[0], c.maxVal[1], c.maxVal[2] };
+            h = hashBytes(range, sizeof(range), h);
+            h = hashBytes(c.name.data(), c.name.size(), h);
+            h = hashBytes(&c.code, 1, h);
+        }
+        if (colorModel.valid) {
+            h = hashBytes(colorModel.center, sizeof(colorModel.center), h);
+            h = hashBytes(colorModel.radius, sizeof(colorModel.radius), h);
+        }
+        double fractions[2] = { minAreaFraction, maxAreaFraction };
+        int64 flags[6] = { pyramidLevels, refineBlocks, extractBackend, detectMode, quadSize, streamRows > 0 };
+        h = hashBytes(fractions, sizeof(fractions), h);
+        return hashBytes(flags, sizeof(flags), h);
+    }
+
+    /*********************************************************
+     * 计算实际使用的金字塔层数：自动模式下使粗层短边不小于 256 像素
+     *********************************************************/
+    int resolvePyramidLevels(const Mat& img) const {
+        if (pyramidLevels >= 0) return pyramidLevels;
+
+        int levels = 0;
+        int shortSide = min(img.rows, img.cols);
+        while ((shortSide >> (levels + 1)) >= 256) {
+            levels++;
+        }
+        return levels;
+    }
+
+    /*********************************************************
+     * 分类 + 形态学开运算，得到去噪后的颜色位掩码图
+     *********************************************************/
+    void segmentLabels(const Mat& img, Mat& labels, int radius) const {
+        Mat raw, eroded, tmp;
+        segmentLabels(img, labels, radius, raw, eroded, tmp);
+    }
+
+    // 使用调用方提供的中间缓冲（帧上下文）
+    void segmentLabels(const Mat& img, Mat& labels, int radius, Mat& raw, Mat& eroded, Mat& tmp) const {
+        classifyPixels(img, raw);
+        morphBitwise(raw, eroded, radius, true, tmp);
+        morphBitwise(eroded, labels, radius, false, tmp);
+    }
+
+    /*********************************************************
+     * 分块数：segmentThreads 个水平条带，每块不少于 minTileRows 行
+     *********************************************************/
+    int segmentTileCount(int rows) const {
+        if (segmentThreads <= 1) return 1;
+        return max(1, min(segmentThreads, rows / minTileRows));
+    }
+
+    // 第 t 块的行范围 [y0, y1)
+    static void tileRows(int rows, int tiles, int t, int& y0, int& y1) {
+        y0 = (int)((int64)rows * t / tiles);
+        y1 = (int)((int64)rows * (t + 1) / tiles);
+    }
+
+    /*********************************************************
+     * 分块并行的分类 + 开运算：每块输出 [y0, y1) 行，
+     * 分类多算上下各 2*radius 行、腐蚀多算各 radius 行作为光晕，
+     * 块之间没有同步；只在光晕被图像边界截断处才触到首末行，
+     * 因此与 segmentLabels 逐位相同。tiles 为 1 时退回串行
+     *********************************************************/
+    void segmentLabelsTiled(const Mat& img, Mat& labels, int radius, FrameContext& ctx) const {
+        int tiles = segmentTileCount(img.rows);
+        if (tiles <= 1) {
+            segmentLabels(img, labels, radius, ctx.raw, ctx.eroded, ctx.morphTmp);
+            return;
+        }
+
+        labels.create(img.size(), CV_8UC1);
+        if ((int)ctx.tiles.size() < tiles) ctx.tiles.resize(tiles);
+        parallel_for_(Range(0, tiles), [&](const Range& range) {
+            for (int t = range.start; t < range.end; t++) {
+                SegmentTile& tile = ctx.tiles[t];
+                int y0, y1;
+                tileRows(img.rows, tiles, t, y0, y1);
+                int a0 = max(0, y0 - 2 * radius), a1 = min(img.rows, y1 + 2 * radius);
+
+                classifyPixels(img.rowRange(a0, a1), tile.raw);
+                // 腐蚀只需覆盖 [y0 - radius, y1 + radius)，膨胀只写本块的行
+                morphBitwise(tile.raw, tile.eroded, radius, true, tile.tmp,
+                    max(a0, y0 - radius) - a0, min(a1, y1 + radius) - a0);
+                Mat out = labels.rowRange(a0, a1);
+                morphBitwise(tile.eroded, out, radius, false, tile.tmp, y0 - a0, y1 - a0);
+            }
+        }, tiles);
+    }
+
+    /*********************************************************
+     * 在原图 ROI 内细化色块轮廓：重新分类该区域，取面积最大的同色轮廓
+     * 返回的轮廓为原图坐标；ROI 内没有该颜色时返回 false
+     *********************************************************/
+    bool refineContour(const Mat& img, size_t colorIndex, Rect roi, vector<Point>& contour) const {
+        roi &= Rect(0, 0, img.cols, img.rows);
+        if (roi.empty()) return false;
+
+        Mat roiLabels, mask;
+        segmentLabels(img(roi), roiLabels, 2);
+        bitwise_and(roiLabels, Scalar(1 << colorIndex), mask);
+
+        vector<vector<Point>> contours;
+        findContours(mask, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE, roi.tl());
+
+        double bestArea = 0;
+        int best = -1;
+        for (int i = 0; i < contours.size(); i++) {
+            double area = contourArea(contours[i]);
+            if (area > bestArea) {
+                bestArea = area;
+                best = i;
+            }
+        }
+        if (best < 0) return false;
+
+        contour = std::move(contours[best]);
+        return true;
+    }
+
+    /*********************************************************
+     * 获取查找表构建耗时（毫秒）
+     *********************************************************/
+    double getLutBuildMs() const { return lutBuildMs; }
+
+    /*********************************************************
+     * 把轮廓的虚线段追加到 points（每段两个端点，依次存放），
+     * 之后用一次 polylines 批量绘制
+     *********************************************************/
+    static void appendDashes(vector<Point>& points, const vector<Point>& contour) {
+        int segments = 8;      // 增加分段数，让虚线更密集
+
+        for (int i = 0; i < contour.size(); i++) {
+            Point p1 = contour[i];
+            Point p2 = contour[(i + 1) % contour.size()];
+
+            for (int k = 0; k < segments; k++) {
+                float t1 = k / (float)segments;
+                float t2 = (k + 0.5f) / (float)segments;  // 虚线的一半长度
+
+                points.push_back(p1 + (p2 - p1) * t1);
+                points.push_back(p1 + (p2 - p1) * t2);
+            }
+        }
+    }
+
+    /*********************************************************
+     * 一次 polylines 画出 points 中的全部虚线段（线宽 5，抗锯齿）；
+     * heads、counts 为指针数组与点数的工作缓冲，容量在调用之间保留
+     *********************************************************/
+    static void drawDashes(Mat& img, const vector<Point>& points, vector<const Point*>& heads,
+        vector<int>& counts, const Scalar& color) {
+        heads.clear();
+        for (size_t i = 0; i + 1 < points.size(); i += 2) {
+            heads.push_back(&points[i]);
+        }
+        counts.assign(heads.size(), 2);
+        if (heads.empty()) return;
+        polylines(img, heads.data(), counts.data(), (int)heads.size(), false, color, 5, LINE_AA);
+    }
+
+    /*********************************************************
+     * 绘制虚线轮廓
+     *********************************************************/
+    void drawDashedContour(Mat& img, const vector<Point>& contour, Scalar color) const {
+        vector<Point> points;
+        vector<const Point*> heads;
+        vector<int> counts;
+        appendDashes(points, contour);
+        drawDashes(img, points, heads, counts, color);
+    }
+
+    /*********************************************************
+     * 比较函数：用于色块排序（先按行，再按列）
+     *********************************************************/
+    static bool compareColorBlocks(const ColorBlock& a, const ColorBlock& b) {
+        if (a.row != b.row) {
+            return a.row < b.row;
+        }
+        return a.col < b.col;
+    }
+
+    /*********************************************************
+     * 叠加图：把色块轮廓的粗多边形（1% 周长容差）追加为虚线段
+     *********************************************************/
+    static void appendOverlayOutline(FrameContext& ctx, const vector<Point>& contour) {
+        // 色块是圆角方形，粗多边形只剩十几个顶点
+        float peri = arcLength(contour, true);
+        approxPolyDP(contour, ctx.approx, 0.01 * peri, true);
+        appendDashes(ctx.dashPoints, ctx.approx);
+    }
+
+    /*********************************************************
+     * 叠加图：同色的全部虚线一次绘制，再逐个绘制标签
+     *********************************************************/
+    void drawColorOverlay(Mat& outputImg, const ColorRange& c, FrameContext& ctx) const {
+        if (ctx.labelBoxes.empty()) return;
+        ScopedStageTimer overlayTimer(metrics, STAGE_OVERLAY);
+
+        drawDashes(outputImg, ctx.dashPoints, ctx.dashHeads, ctx.dashCounts, c.drawColor);
+
+        for (const Rect& boundRect : ctx.labelBoxes) {
+            // 在文字下加黑色背景条（增强对比）
+            rectangle(outputImg, Point(boundRect.x - 2, boundRect.y - 25),
+                Point(boundRect.x + 80, boundRect.y), Scalar(0, 0, 0), FILLED);
+
+            // 白色文字，字号更大
+            putText(outputImg, c.name, Point(boundRect.x, boundRect.y - 5),
+                FONT_HERSHEY_SIMPLEX, 1.0, Scalar(255, 255, 255), 2);
+        }
+    }
+
+    /*********************************************************
+     * 由原图坐标下的轮廓生成色块
+     *********************************************************/
+    ColorBlock blockFromContour(const vector<Point>& contour, size_t colorIndex, double area) const {
+        Moments m = moments(contour);
+
+        ColorBlock block;
+        block.center = Point2f(m.m10 / m.m00, m.m01 / m.m00);
+        block.colorName = colorTable[colorIndex].name;
+        block.colorValue = colorTable[colorIndex].drawColor;
+        block.boundingBox = boundingRect(contour);
+        block.area = area;
+        return block;
+    }
+
+    /*********************************************************
+     * 粗层色块的边界框对应的原图 ROI（细化时使用）
+     *********************************************************/
+    static Rect refineRoi(const Rect& coarse, int scale) {
+        int pad = scale * 2;
+        return Rect(coarse.x * scale - pad, coarse.y * scale - pad,
+            coarse.width * scale + 2 * pad, coarse.height * scale + 2 * pad);
+    }
+
+    /*********************************************************
+     * 提取后端一：逐色轮廓。当前颜色的位取到四周补 0 的二值图上，按
+     * findContours（RETR_EXTERNAL, CHAIN_APPROX_SIMPLE）的规则扫描：
+     * 逐行从左到右，遇到左侧为背景的前景像素、且本行左侧最近的已标记
+     * 边界不是外轮廓的右边界时（即不在已跟踪区域的内部）跟踪一次外边界；
+     * 跟踪时标记边界像素。外轮廓与发现顺序都与 findContours 相同，
+     * 缓冲在帧上下文中复用，预热后不再分配
+     *********************************************************/
+    void extractByContours(const Mat& img, int levels, double minArea, double maxArea,
+        bool draw, Mat& outputImg, FrameContext& ctx) const {
+        const Mat& labels = ctx.labels;
+        Mat& padded = ctx.mask;
+        padded.create(labels.rows + 2, labels.cols + 2, CV_8SC1);
+        vector<Point>& points = ctx.outlinePoints;
+        ctx.outlines.clear();
+        points.clear();
+        for (int ci = 0; ci < (int)colorTable.size(); ci++) {
+            // 从位掩码图中取出当前颜色（0/1）
+            uchar bit = (uchar)(1 << ci);
+            memset(padded.ptr(0), 0, padded.cols);
+            memset(padded.ptr(padded.rows - 1), 0, padded.cols);
+            for (int y = 0; y < labels.rows; y++) {
+                const uchar* src = labels.ptr<uchar>(y);
+                schar* dst = padded.ptr<schar>(y + 1);
+                dst[0] = dst[labels.cols + 1] = 0;
+                for (int x = 0; x < labels.cols; x++) {
+                    dst[x + 1] = (schar)((src[x] & bit) != 0);
+                }
+            }
+
+            PaddedMask mask = { padded.ptr<schar>(1) + 1, (ptrdiff_t)padded.step };
+            for (int y = 0; y < labels.rows; y++) {
+                const schar* row = padded.ptr<schar>(y + 1);
+                int prev = 0, lnbd = 0;  // lnbd：本行左侧最近的已标记边界像素（补边后的列）
+                for (int x = 1; x <= labels.cols; x++) {
+                    int v = row[x];
+                    if (v == prev) continue;
+                    if (prev == 0 && v == 1 && row[lnbd] <= 0) {
+                        int first = (int)points.size();
+                        traceOuterBorder(mask, Point(x - 1, y), points);
+                        int count = (int)points.size() - first;
+                        double area = polygonArea(&points[first], count);
+                        if (area < minArea || area > maxArea) { // 过滤掉小面积噪声轮廓、阴影轮廓
+                            if (metrics) metrics->addRejectedContour();
+                            points.resize(first);
+                        }
+                        else {
+                            ctx.outlines.push_back({ ci, Rect(), Point(x - 1, y), area, first, count, false });
+                        }
+                        prev = row[x];
+                        continue;
+                    }
+                    prev = v;
+                    if (prev & -2) lnbd = x;
+                }
+            }
+        }
+        blocksFromOutlines(img, levels, draw, outputImg, ctx, ctx.outlines, points);
+    }
+
+    /*********************************************************
+     * 由检测层外轮廓（已通过面积过滤）生成色块：粗层轮廓换算回
+     * 原图坐标（或在原图 ROI 内细化），需要绘制时记下虚线段与标签位置。
+     * 两个提取后端共用，同一轮廓得到逐位相同的色块
+     *********************************************************/
+    void addContourBlock(const Mat& img, int levels, size_t ci, const vector<Point>& coarse, double area,
+        bool draw, FrameContext& ctx) const {
+        const vector<Point>* contour = &coarse;
+        if (levels > 0) {
+            int scale = 1 << levels;
+            vector<Point>& fullRes = ctx.contour;
+            Rect roi = refineRoi(boundingRect(coarse), scale);
+            if (!refineBlocks || !refineContour(img, ci, roi, fullRes)) {
+                fullRes.clear();
+                for (const Point& p : coarse) {
+                    fullRes.push_back(p * scale);
+                }
+            }
+            contour = &fullRes;
+            area = contourArea(fullRes);
+        }
+
+        ctx.blocks.push_back(blockFromContour(*contour, ci, area));
+        if (metrics) metrics->addColorHit(ci);
+
+        if (draw) {
+            appendOverlayOutline(ctx, *contour);
+            ctx.labelBoxes.push_back(ctx.blocks.back().boundingBox);
+        }
+    }
+
+    /*********************************************************
+     * 外边界跟踪（与 findContours 的 RETR_EXTERNAL + CHAIN_APPROX_SIMPLE
+     * 相同的走法）：从区域扫描顺序的第一个像素出发，沿 8 邻域逆时针
+     * 绕行一周，只记下方向改变处的点，追加到 contour。
+     * image.at(p) 返回 p 是否属于该颜色（图外为否）；image.mark(p, right)
+     * 在扫描用的二值图上标记边界像素（right：右侧为背景），其余输入不标记
+     *********************************************************/
+    template<typename Image>
+    static void traceOuterBorder(const Image& image, Point start, vector<Point>& contour) {
+        // 方向 0..7：右、右上、上、左上、左、左下、下、右下
+        static const Point steps[8] = { Point(1, 0), Point(1, -1), Point(0, -1), Point(-1, -1),
+            Point(-1, 0), Point(-1, 1), Point(0, 1), Point(1, 1) };
+
+        // 从左侧（扫描时的背景一侧）顺时针找第一个邻居；没有邻居为孤立像素
+        int s = 4;
+        Point p1;
+        do {
+            s = (s - 1) & 7;
+            p1 = start + steps[s];
+        } while (!image.at(p1) && s != 4);
+        if (s == 4) {
+            image.mark(start, true);
+            contour.push_back(start);
+            return;
+        }
+
+        Point p3 = start, p4;
+        int prevS = s ^ 4;
+        for (;;) {
+            // 从来向的下一个方向起逆时针找下一个边界像素
+            int sEnd = s;
+            do {
+                s++;
+                p4 = p3 + steps[s & 7];
+            } while (!image.at(p4));
+            s &= 7;
+            image.mark(p3, (unsigned)(s - 1) < (unsigned)sEnd);
+            if (s != prevS) {
+                contour.push_back(p3);
+                prevS = s;
+            }
+            if (p4 == start && p3 == p1) break;
+            p3 = p4;
+            s = (s + 4) & 7;
+        }
+    }
+
+    // 四周补 0 的单色二值图（轮廓后端，标记规则同 findContours）
+    struct PaddedMask {
+        schar* origin;   // 图像 (0, 0) 处
+        ptrdiff_t step;
+        bool at(Point p) const {
+            return origin[p.y * step + p.x] != 0;
+        }
+        void mark(Point p, bool right) const {
+            schar& v = origin[p.y * step + p.x];
+            if (right) v = (schar)-126;  // 右侧为背景的边界像素（扫描时据此判断是否在区域内部）
+            else if (v == 1) v = 2;      // 其余已访问的边界像素
+        }
+    };
+
+    // 位掩码图中的一种颜色（连通域后端）
+    struct LabelBitImage {
+        const Mat& labels;
+        uchar bit;
+        bool at(Point p) const {
+            return (unsigned)p.x < (unsigned)labels.cols && (unsigned)p.y < (unsigned)labels.rows &&
+                (labels.ptr<uchar>(p.y)[p.x] & bit);
+        }
+        void mark(Point, bool) const {}
+    };
+
+    // 一个区域按 (y, x0) 排序的游程（流式模式，traceOuterBorder 的输入）
+    struct RunImage {
+        const RegionStream::RunNode* runs;
+        const int* rowStart;  // 第 r 行（box.y + r）的游程为 [rowStart[r], rowStart[r + 1])
+        Rect box;
+        bool at(Point p) const {
+            int r = p.y - box.y;
+            if ((unsigned)r >= (unsigned)box.height) return false;
+            const RegionStream::RunNode* end = runs + rowStart[r + 1];
+            const RegionStream::RunNode* it = lower_bound(runs + rowStart[r], end, p.x,
+                [](const RegionStream::RunNode& run, int x) { return run.x1 < x; });
+            return it != end && it->x0 <= p.x;
+        }
+        void mark(Point, bool) const {}
+    };
+
+    // 整数点多边形的面积（鞋带公式，整数累加，与 contourArea 相同）
+    static double polygonArea(const Point* poly, int count) {
+        int64 sum = 0;
+        for (int i = 0, j = count - 1; i < count; j = i++) {
+            sum += (int64)poly[j].x * poly[i].y - (int64)poly[i].x * poly[j].y;
+        }
+        return std::abs((double)sum) * 0.5;
+    }
+
+    /*********************************************************
+     * 同色区域 inner 是否嵌套在 outer 的外轮廓内（inner 的起点在
+     * outer 的轮廓多边形内部；两区域不相连，起点不会落在轮廓上）
+     *********************************************************/
+    static bool enclosedBy(const RegionOutline& outer, const Point* poly, Point p) {
+        if (p.x <= outer.box.x || p.x >= outer.box.x + outer.box.width - 1 ||
+            p.y <= outer.box.y || p.y >= outer.box.y + outer.box.height - 1) {
+            return false;
+        }
+        bool inside = false;
+        for (int i = 0, j = outer.count - 1; i < outer.count; j = i++) {
+            const Point& a = poly[j];
+            const Point& b = poly[i];
+            if ((a.y > p.y) != (b.y > p.y)) {
+                int64 lhs = (int64)(p.x - a.x) * (b.y - a.y), rhs = (int64)(b.x - a.x) * (p.y - a.y);
+                if (b.y > a.y ? lhs < rhs : lhs > rhs) inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    /*********************************************************
+     * 游程并查集连通域标记：一遍扫描位掩码图，同时得到每种颜色
+     * 每个 8 连通区域的边界框与扫描顺序的第一个像素。一个像素可同时
+     * 属于多种颜色（位掩码重叠），各颜色的区域互相独立。
+     * 输出按颜色分组，组内按区域首次出现的扫描顺序排列。
+     *********************************************************/
+    static void labelRegions(const Mat& labels, int colorCount, vector<RegionStats>& regions) {
+        RegionScratch scratch;
+        labelRegions(labels, colorCount, regions, scratch);
+    }
+
+    // 使用调用方提供的工作缓冲（预热后不再分配）
+    static void labelRegions(const Mat& labels, int colorCount, vector<RegionStats>& regions,
+        RegionScratch& scratch) {
+        labelRuns(labels, colorCount, 0, scratch);
+        groupByColor(scratch.merged, colorCount, regions);
+    }
+
+    /*********************************************************
+     * labelRegions 的扫描部分：区域按首次出现的顺序留在 scratch.merged，
+     * 坐标加上 yOffset（分块时为块的起始行）；结束后 scratch.first 与
+     * scratch.prev 分别是第一行和最后一行的游程，node 已换成 merged 下标
+     *********************************************************/
+    static void labelRuns(const Mat& labels, int colorCount, int yOffset, RegionScratch& scratch) {
+        using Run = RegionScratch::Run;
+
+        vector<int>& parent = scratch.parent;
+        vector<RegionStats>& nodes = scratch.nodes;
+        parent.clear();
+        nodes.clear();
+        auto find = [&parent](int a) {
+            while (parent[a] != a) {
+                parent[a] = parent[parent[a]];
+                a = parent[a];
+            }
+            return a;
+        };
+
+        vector<vector<Run>>& prev = scratch.prev;
+        vector<vector<Run>>& cur = scratch.cur;
+        vector<vector<Run>>& first = scratch.first;
+        prev.resize(colorCount);
+        cur.resize(colorCount);
+        first.resize(colorCount);
+        // 每行每色最多 (cols + 1) / 2 个游程；按上限预留，prev/cur 逐行交换后容量也足够
+        size_t maxRuns = (size_t)(labels.cols + 1) / 2;
+        for (int ci = 0; ci < colorCount; ci++) {
+            prev[ci].clear();
+            first[ci].clear();
+            prev[ci].reserve(maxRuns);
+            cur[ci].reserve(maxRuns);
+        }
+        vector<size_t>& prevIdx = scratch.prevIdx;
+        vector<int>& runStart = scratch.runStart;
+        prevIdx.assign(colorCount, 0);
+        runStart.assign(colorCount, 0);
+        const uchar colorBits = (uchar)((1 << colorCount) - 1);
+
+        for (int y = 0; y < labels.rows; y++) {
+            const uchar* row = labels.ptr<uchar>(y);
+            for (int ci = 0; ci < colorCount; ci++) {
+                cur[ci].clear();
+                prevIdx[ci] = 0;
+            }
+
+            // 只在位发生变化处处理：置位 = 游程开始，清位 = 游程结束
+            uchar active = 0;
+            for (int x = 0; x <= labels.cols; x++) {
+                uchar v = x < labels.cols ? (uchar)(row[x] & colorBits) : 0;
+                uchar changed = v ^ active;
+                if (!changed) continue;
+
+                for (int ci = 0; ci < colorCount; ci++) {
+                    if (!(changed & (1 << ci))) continue;
+                    if (v & (1 << ci)) {
+                        runStart[ci] = x;
+                        continue;
+                    }
+
+                    int x0 = runStart[ci], x1 = x - 1, len = x - x0;
+                    int node = (int)nodes.size();
+                    parent.push_back(node);
+                    nodes.push_back({ ci, Rect(x0, y + yOffset, len, 1), Point(x0, y + yOffset) });
+
+                    // 与上一行同色、8 邻接的游程合并（游程按 x 递增产生，指针单调前进）
+                    const vector<Run>& above = prev[ci];
+                    size_t& k = prevIdx[ci];
+                    while (k < above.size() && above[k].x1 < x0 - 1) k++;
+                    for (size_t j = k; j < above.size() && above[j].x0 <= x1 + 1; j++) {
+                        int ra = find(above[j].node), rb = find(node);
+                        if (ra != rb) parent[rb] = ra;
+                    }
+                    cur[ci].push_back({ x0, x1, node });
+                }
+                active = v;
+            }
+            if (y == 0) {
+                for (int ci = 0; ci < colorCount; ci++) first[ci].assign(cur[ci].begin(), cur[ci].end());
+            }
+            swap(prev, cur);
+        }
+
+        // 把各游程的边界框合并到根节点；同一区域最先生成的游程在最上一行的最左侧，
+        // 其起点即区域扫描顺序的第一个像素
+        vector<int>& regionOf = scratch.regionOf;
+        vector<RegionStats>& merged = scratch.merged;
+        regionOf.assign(nodes.size(), -1);
+        merged.clear();
+        for (size_t i = 0; i < nodes.size(); i++) {
+            int root = find((int)i);
+            if (regionOf[root] < 0) {
+                regionOf[root] = (int)merged.size();
+                merged.push_back(nodes[i]);
+                continue;
+            }
+            merged[regionOf[root]].box |= nodes[i].box;
+        }
+
+        for (int ci = 0; ci < colorCount; ci++) {
+            for (Run& run : first[ci]) run.node = regionOf[find(run.node)];
+            for (Run& run : prev[ci]) run.node = regionOf[find(run.node)];
+        }
+    }
+
+    // 按颜色分组，组内保持 merged 的顺序
+    static void groupByColor(const vector<RegionStats>& merged, int colorCount, vector<RegionStats>& regions) {
+        regions.clear();
+        for (int ci = 0; ci < colorCount; ci++) {
+            for (const RegionStats& r : merged) {
+                if (r.color == ci) regions.push_back(r);
+            }
+        }
+    }
+
+    /*********************************************************
+     * 分块并行的连通域标记：各块独立标记自己的行，再把相邻块
+     * 上块末行与下块首行中同色且 8 邻接的游程所属区域合并。
+     * 按（块序, 块内首次出现序）遍历即为整图的首次出现顺序，
+     * 区域的起点取最先出现的部分，因此输出与 labelRegions 相同
+     *********************************************************/
+    void labelRegionsTiled(const Mat& labels, int colorCount, vector<RegionStats>& regions,
+        FrameContext& ctx) const {
+        int tiles = segmentTileCount(labels.rows);
+        if (tiles <= 1) {
+            labelRegions(labels, colorCount, regions, ctx.regionScratch);
+            return;
+        }
+
+        if ((int)ctx.tiles.size() < tiles) ctx.tiles.resize(tiles);
+        parallel_for_(Range(0, tiles), [&](const Range& range) {
+            for (int t = range.start; t < range.end; t++) {
+                int y0, y1;
+                tileRows(labels.rows, tiles, t, y0, y1);
+                labelRuns(labels.rowRange(y0, y1), colorCount, y0, ctx.tiles[t].regions);
+            }
+        }, tiles);
+
+        using Run = RegionScratch::Run;
+        RegionScratch& scratch = ctx.regionScratch;
+        vector<int>& base = scratch.base;
+        vector<int>& parent = scratch.parent;
+        base.assign(tiles + 1, 0);
+        for (int t = 0; t < tiles; t++) {
+            base[t + 1] = base[t] + (int)ctx.tiles[t].regions.merged.size();
+        }
+        parent.resize(base[tiles]);
+        for (int i = 0; i < base[tiles]; i++) parent[i] = i;
+        auto find = [&parent](int a) {
+            while (parent[a] != a) {
+                parent[a] = parent[parent[a]];
+                a = parent[a];
+            }
+            return a;
+        };
+
+        // 拼接相邻块的边界行
+        for (int t = 0; t + 1 < tiles; t++) {
+            for (int ci = 0; ci < colorCount; ci++) {
+                const vector<Run>& above = ctx.tiles[t].regions.prev[ci];
+                const vector<Run>& below = ctx.tiles[t + 1].regions.first[ci];
+                size_t k = 0;
+                for (const Run& b : below) {
+                    while (k < above.size() && above[k].x1 < b.x0 - 1) k++;
+                    for (size_t j = k; j < above.size() && above[j].x0 <= b.x1 + 1; j++) {
+                        int ra = find(base[t] + above[j].node), rb = find(base[t + 1] + b.node);
+                        if (ra != rb) parent[rb] = ra;
+                    }
+                }
+            }
+        }
+
+        vector<int>& regionOf = scratch.regionOf;
+        vector<RegionStats>& merged = scratch.merged;
+        regionOf.assign(base[tiles], -1);
+        merged.clear();
+        for (int t = 0; t < tiles; t++) {
+            const vector<RegionStats>& local = ctx.tiles[t].regions.merged;
+            for (size_t i = 0; i < local.size(); i++) {
+                int root = find(base[t] + (int)i);
+                if (regionOf[root] < 0) {
+                    regionOf[root] = (int)merged.size();
+                    merged.push_back(local[i]);
+                    continue;
+                }
+                merged[regionOf[root]].box |= local[i].box;
+            }
+        }
+        groupByColor(merged, colorCount, regions);
+    }
+
+    static int streamFind(vector<int>& parent, int a) {
+        while (parent[a] != a) {
+            parent[a] = parent[parent[a]];
+            a = parent[a];
+        }
+        return a;
+    }
+
+    /*********************************************************
+     * 流式连通域标记：开始一幅图（宽 cols），区域结束时跟踪外轮廓，
+     * 轮廓面积不在 [minArea, maxArea] 的区域直接丢弃，只计数
+     *********************************************************/
+    static void beginRegionStream(RegionStream& s, int colorCount, int cols, double minArea, double maxArea) {
+        s.colorCount = colorCount;
+        s.cols = cols;
+        s.minArea = minArea;
+        s.maxArea = maxArea;
+        s.prev.resize(colorCount);
+        s.cur.resize(colorCount);
+        size_t maxRuns = (size_t)(cols + 1) / 2;
+        for (int ci = 0; ci < colorCount; ci++) {
+            s.prev[ci].clear();
+            s.cur[ci].clear();
+            s.prev[ci].reserve(maxRuns);
+            s.cur[ci].reserve(maxRuns);
+        }
+        s.prevIdx.assign(colorCount, 0);
+        s.runStart.assign(colorCount, 0);
+        s.parent.clear();
+        s.stats.clear();
+        s.firstKey.clear();
+        s.mark.clear();
+        s.freeIds.clear();
+        s.retired.clear();
+        s.runNodes.clear();
+        s.freeRun = -1;
+        s.runHead.clear();
+        s.runTail.clear();
+        s.done.clear();
+        s.points.clear();
+        s.outlines.clear();
+        s.rejected = 0;
+        s.peakIds = 0;
+    }
+
+    /*********************************************************
+     * 输入第 y 行位掩码：游程的生成与合并规则同 labelRuns，
+     * 但边界框与起点在合并时立即合并到根上，游程链表接到根的链表后；
+     * 行末把上一行有游程、本行已没有游程的区域作为已结束区域处理，
+     * 并回收编号
+     *********************************************************/
+    static void feedRegionRow(RegionStream& s, const uchar* row, int y) {
+        const int colorCount = s.colorCount;
+        const uchar colorBits = (uchar)((1 << colorCount) - 1);
+        for (int ci = 0; ci < colorCount; ci++) {
+            s.cur[ci].clear();
+            s.prevIdx[ci] = 0;
+        }
+
+        uchar active = 0;
+        for (int x = 0; x <= s.cols; x++) {
+            uchar v = x < s.cols ? (uchar)(row[x] & colorBits) : 0;
+            uchar changed = v ^ active;
+            if (!changed) continue;
+
+            for (int ci = 0; ci < colorCount; ci++) {
+                if (!(changed & (1 << ci))) continue;
+                if (v & (1 << ci)) {
+                    s.runStart[ci] = x;
+                    continue;
+                }
+
+                int x0 = s.runStart[ci], x1 = x - 1, len = x - x0;
+                RegionStats run = { ci, Rect(x0, y, len, 1), Point(x0, y) };
+                int64 key = ((int64)y * (s.cols + 1) + x) * 8 + ci;  // labelRuns 中游程的生成顺序
+                int node;
+                if (s.freeRun >= 0) {
+                    node = s.freeRun;
+                    s.freeRun = s.runNodes[node].next;
+                    s.runNodes[node] = { y, x0, x1, -1 };
+                }
+                else {
+                    node = (int)s.runNodes.size();
+                    s.runNodes.push_back({ y, x0, x1, -1 });
+                }
+                int id;
+                if (!s.freeIds.empty()) {
+                    id = s.freeIds.back();
+                    s.freeIds.pop_back();
+                    s.parent[id] = id;
+                    s.stats[id] = run;
+                    s.firstKey[id] = key;
+                    s.mark[id] = 0;
+                    s.runHead[id] = s.runTail[id] = node;
+                }
+                else {
+                    id = (int)s.parent.size();
+                    s.parent.push_back(id);
+                    s.stats.push_back(run);
+                    s.firstKey.push_back(key);
+                    s.mark.push_back(0);
+                    s.runHead.push_back(node);
+                    s.runTail.push_back(node);
+                }
+
+                const vector<RegionStream::Run>& above = s.prev[ci];
+                size_t& k = s.prevIdx[ci];
+                while (k < above.size() && above[k].x1 < x0 - 1) k++;
+                for (size_t j = k; j < above.size() && above[j].x0 <= x1 + 1; j++) {
+                    int ra = streamFind(s.parent, above[j].id), rb = streamFind(s.parent, id);
+                    if (ra == rb) continue;
+                    s.parent[rb] = ra;
+                    RegionStats& r = s.stats[ra];
+                    const RegionStats& b = s.stats[rb];
+                    r.box |= b.box;
+                    if (s.firstKey[rb] < s.firstKey[ra]) {
+                        s.firstKey[ra] = s.firstKey[rb];
+                        r.start = b.start;
+                    }
+                    s.runNodes[s.runTail[ra]].next = s.runHead[rb];
+                    s.runTail[ra] = s.runTail[rb];
+                    s.retired.push_back(rb);
+                }
+                s.cur[ci].push_back({ x0, x1, id });
+            }
+            active = v;
+        }
+        endRegionRow(s);
+    }
+
+    // 行末：游程编号规范为根，处理已结束的区域，回收不再被引用的编号
+    static void endRegionRow(RegionStream& s) {
+        for (int ci = 0; ci < s.colorCount; ci++) {
+            for (RegionStream::Run& run : s.cur[ci]) {
+                run.id = streamFind(s.parent, run.id);
+                s.mark[run.id] = 1;
+            }
+        }
+        for (int ci = 0; ci < s.colorCount; ci++) {
+            for (const RegionStream::Run& run : s.prev[ci]) {
+                int root = streamFind(s.parent, run.id);
+                if (s.mark[root] != 0) continue;
+                s.mark[root] = 2;
+                finishRegion(s, root);
+                s.retired.push_back(root);
+            }
+        }
+        for (int ci = 0; ci < s.colorCount; ci++) {
+            for (const RegionStream::Run& run : s.cur[ci]) s.mark[run.id] = 0;
+        }
+        s.freeIds.insert(s.freeIds.end(), s.retired.begin(), s.retired.end());
+        s.retired.clear();
+        s.peakIds = max(s.peakIds, s.parent.size() - s.freeIds.size());
+        swap(s.prev, s.cur);
+    }
+
+    /*********************************************************
+     * 一个区域结束：在它的游程上跟踪外轮廓并按轮廓面积过滤，
+     * 已保留的同色区域若起点在它的轮廓内即为嵌套；之后回收游程。
+     * 嵌套的区域总是先于包围它的区域结束（外轮廓在其下方还有像素）
+     *********************************************************/
+    static void finishRegion(RegionStream& s, int root) {
+        const RegionStats& r = s.stats[root];
+        s.sortedRuns.clear();
+        for (int n = s.runHead[root]; n >= 0; n = s.runNodes[n].next) {
+            s.sortedRuns.push_back(s.runNodes[n]);
+        }
+        s.runNodes[s.runTail[root]].next = s.freeRun;
+        s.freeRun = s.runHead[root];
+
+        // 轮廓面积不超过边界框内像素中心围成的矩形，不可能达到 minArea 的区域不跟踪
+        if ((double)(r.box.width - 1) * (r.box.height - 1) < s.minArea) {
+            s.rejected++;
+            return;
+        }
+
+        sort(s.sortedRuns.begin(), s.sortedRuns.end(), [](const RegionStream::RunNode& a, const RegionStream::RunNode& b) {
+            return a.y != b.y ? a.y < b.y : a.x0 < b.x0;
+        });
+        s.rowStart.assign(r.box.height + 1, 0);
+        for (const RegionStream::RunNode& run : s.sortedRuns) s.rowStart[run.y - r.box.y + 1]++;
+        for (int i = 0; i < r.box.height; i++) s.rowStart[i + 1] += s.rowStart[i];
+
+        s.contour.clear();
+        traceOuterBorder(RunImage{ s.sortedRuns.data(), s.rowStart.data(), r.box }, r.start, s.contour);
+        RegionOutline outline = { r.color, r.box, r.start, polygonArea(s.contour.data(), (int)s.contour.size()),
+            (int)s.points.size(), (int)s.contour.size(), false };
+
+        for (auto& d : s.done) {
+            RegionOutline& inner = d.second;
+            if (inner.color == r.color && !inner.nested && enclosedBy(outline, s.contour.data(), inner.start)) {
+                inner.nested = true;
+            }
+        }
+
+        if (outline.area < s.minArea || outline.area > s.maxArea) {
+            s.rejected++;
+            return;
+        }
+        s.points.insert(s.points.end(), s.contour.begin(), s.contour.end());
+        s.done.push_back({ s.firstKey[root], outline });
+    }
+
+    /*********************************************************
+     * 结束一幅图：处理剩余区域，去掉嵌套的区域，按颜色分组、
+     * 组内按首次出现顺序排列（与整幅分割的连通域后端相同）
+     *********************************************************/
+    static void finishRegionStream(RegionStream& s) {
+        for (int ci = 0; ci < s.colorCount; ci++) s.cur[ci].clear();
+        endRegionRow(s);
+        sort(s.done.begin(), s.done.end(), [](const pair<int64, RegionOutline>& a, const pair<int64, RegionOutline>& b) {
+            return a.second.color != b.second.color ? a.second.color < b.second.color : a.first < b.first;
+        });
+        s.outlines.clear();
+        for (const auto& d : s.done) {
+            if (!d.second.nested) s.outlines.push_back(d.second);
+        }
+    }
+
+    /*********************************************************
+     * 条带流式分割：检测层按 streamRows 行一条处理，每条只对新进入窗口的行
+     * 缩放（金字塔时）并查表分类，窗口保留上一条末尾 4*radius 行的分类结果
+     * 作为形态学光晕；开运算后的行直接送入流式连通域标记。
+     * 光晕只在图像边界处截断，开运算结果与整幅分割逐位相同；原图宽高
+     * 是 2^levels 的整数倍时缩放也与整幅缩放相同（INTER_AREA 整数倍为块平均），
+     * 输出的外轮廓（s.regions.outlines）因此与整幅分割的连通域后端相同
+     *********************************************************/
+    void streamRegions(const Mat& img, int levels, int radius, double minArea, double maxArea,
+        StripScratch& s) const {
+        int scale = 1 << levels;
+        int cols = img.cols / scale, rows = img.rows / scale;
+        int halo = 2 * radius;
+        int capacity = streamRows + 2 * halo;
+        if (levels > 0) s.work.create(capacity, cols, CV_8UC3);
+        s.raw.create(capacity, cols, CV_8UC1);
+        s.eroded.create(capacity, cols, CV_8UC1);
+        s.opened.create(capacity, cols, CV_8UC1);
+        s.tmp.create(capacity, cols, CV_8UC1);
+        beginRegionStream(s.regions, (int)colorTable.size(), cols, minArea, maxArea);
+
+        int a0 = 0, a1 = 0;  // 窗口中已有分类结果的行范围 [a0, a1)
+        for (int y0 = 0; y0 < rows; y0 += streamRows) {
+            int y1 = min(rows, y0 + streamRows);
+            int b0 = max(0, y0 - halo), b1 = min(rows, y1 + halo);
+
+            // 与上一条重叠的分类结果移到窗口顶部，只分类新进入的行
+            if (b0 > a0) {
+                for (int y = b0; y < a1; y++) {
+                    memcpy(s.raw.ptr<uchar>(y - b0), s.raw.ptr<uchar>(y - a0), cols);
+                }
+            }
+            int fresh = max(a1, b0);
+            if (fresh < b1) {
+                Mat dst = s.raw.rowRange(fresh - b0, b1 - b0);
+                if (levels > 0) {
+                    Mat work = s.work.rowRange(0, b1 - fresh);
+                    resize(img(Rect(0, fresh * scale, cols * scale, (b1 - fresh) * scale)), work, work.size(),
+                        0, 0, INTER_AREA);
+                    classifyPixels(work, dst);
+                }
+                else {
+                    classifyPixels(img.rowRange(fresh, b1), dst);
+                }
+            }
+            a0 = b0;
+            a1 = b1;
+
+            // 腐蚀覆盖 [y0 - radius, y1 + radius)，膨胀只写本条的行
+            Mat window = s.raw.rowRange(0, b1 - b0), eroded = s.eroded.rowRange(0, b1 - b0);
+            Mat opened = s.opened.rowRange(0, b1 - b0), tmp = s.tmp.rowRange(0, b1 - b0);
+            morphBitwise(window, eroded, radius, true, tmp, max(b0, y0 - radius) - b0, min(b1, y1 + radius) - b0);
+            morphBitwise(eroded, opened, radius, false, tmp, y0 - b0, y1 - b0);
+            for (int y = y0; y < y1; y++) {
+                feedRegionRow(s.regions, opened.ptr<uchar>(y - b0), y);
+            }
+        }
+        finishRegionStream(s.regions);
+    }
+
+    /*********************************************************
+     * 提取后端二：一遍连通域标记得到全部区域的边界框与起点，只对边界框
+     * 可能容纳 minArea 的区域跟踪外轮廓。外轮廓、面积过滤、嵌套规则与
+     * 输出顺序都与轮廓后端（findContours RETR_EXTERNAL）相同，
+     * 两个后端的色块逐位相同
+     *********************************************************/
+    void extractByComponents(const Mat& img, int levels, double minArea, double maxArea,
+        bool draw, Mat& outputImg, FrameContext& ctx) const {
+        labelRegionsTiled(ctx.labels, (int)colorTable.size(), ctx.regions, ctx);
+        outlineRegions(ctx.labels, minArea, maxArea, ctx);
+        blocksFromOutlines(img, levels, draw, outputImg, ctx, ctx.outlines, ctx.outlinePoints);
+    }
+
+    /*********************************************************
+     * 在位掩码图上跟踪 ctx.regions 中各区域的外轮廓，按轮廓面积过滤，
+     * 去掉起点落在另一个同色区域外轮廓内的区域，结果放入 ctx.outlines。
+     * 能包围保留区域的区域面积更大，必然也被跟踪，嵌套只需在跟踪过的区域间判断
+     *********************************************************/
+    void outlineRegions(const Mat& labels, double minArea, double maxArea, FrameContext& ctx) const {
+        const vector<RegionStats>& regions = ctx.regions;
+        vector<RegionOutline>& candidates = ctx.candidates;
+        vector<Point>& points = ctx.outlinePoints;
+        ctx.outlines.clear();
+        points.clear();
+        size_t next = 0;
+        for (int ci = 0; ci < (int)colorTable.size(); ci++) {
+            candidates.clear();
+            for (; next < regions.size() && regions[next].color == ci; next++) {
+                const RegionStats& r = regions[next];
+                // 轮廓面积不超过边界框内像素中心围成的矩形
+                if ((double)(r.box.width - 1) * (r.box.height - 1) < minArea) {
+                    if (metrics) metrics->addRejectedContour();
+                    continue;
+                }
+                int first = (int)points.size();
+                traceOuterBorder(LabelBitImage{ labels, (uchar)(1 << ci) }, r.start, points);
+                int count = (int)points.size() - first;
+                candidates.push_back({ ci, r.box, r.start, polygonArea(&points[first], count), first, count, false });
+            }
+
+            for (const RegionOutline& o : candidates) {
+                if (o.area < minArea || o.area > maxArea) { // 过滤掉小面积噪声、阴影区域
+                    if (metrics) metrics->addRejectedContour();
+                    continue;
+                }
+                bool nested = false;
+                for (const RegionOutline& outer : candidates) {
+                    if (&outer != &o && enclosedBy(outer, &points[outer.first], o.start)) {
+                        nested = true;
+                        break;
+                    }
+                }
+                if (!nested) ctx.outlines.push_back(o);
+            }
+        }
+    }
+
+    /*********************************************************
+     * 由按颜色分组、组内按首次出现顺序排列的外轮廓生成色块；
+     * 同色色块按出现顺序倒序输出（findContours 的输出顺序）
+     *********************************************************/
+    void blocksFromOutlines(const Mat& img, int levels, bool draw, Mat& outputImg, FrameContext& ctx,
+        const vector<RegionOutline>& outlines, const vector<Point>& points) const {
+        size_t end = 0;
+        for (size_t ci = 0; ci < colorTable.size(); ci++) {
+            ctx.dashPoints.clear();
+            ctx.labelBoxes.clear();
+
+            size_t begin = end;
+            while (end < outlines.size() && outlines[end].color == (int)ci) end++;
+            for (size_t k = end; k-- > begin;) {
+                const RegionOutline& o = outlines[k];
+                ctx.outline.assign(points.begin() + o.first, points.begin() + o.first + o.count);
+                addContourBlock(img, levels, ci, ctx.outline, o.area, draw, ctx);
+            }
+
+            if (draw) {
+                drawColorOverlay(outputImg, colorTable[ci], ctx);
+            }
+        }
+    }
+
+    /*********************************************************
+     * 寻找魔方面的外轮廓四边形（原图坐标，顺序为左上、右上、右下、左下）
+     * 在短边约 256 像素的缩小图上用 Otsu 阈值分出底座：底座可能比背景深
+     * （黑色底座）也可能比背景浅（白色底座、深色桌面），两种极性都试。
+     * 闭运算连通、开运算去掉细小的背景结构后，在足够大的外轮廓中取
+     * 最像矩形的一个（面积占其凸包最小外接矩形的比例最大，杂乱背景中
+     * 粘连出的不规则区域比例低），再把其凸包逼近为四边形
+     *********************************************************/
+    bool findFaceQuad(const Mat& img, vector<Point2f>& quad) const {
+        double s = min(1.0, 256.0 / min(img.cols, img.rows));
+        Mat small, gray, body;
+        resize(img, small, Size(), s, s, INTER_AREA);
+        cvtColor(small, gray, COLOR_BGR2GRAY);
+        GaussianBlur(gray, gray, Size(5, 5), 0);
+
+        // 魔方面至少占画面的 1/5，且不能是整幅图像
+        double imageArea = (double)small.rows * small.cols;
+        Mat kernel = getStructuringElement(MORPH_RECT, Size(5, 5));
+        vector<vector<Point>> contours;
+        vector<Point> hull, bestHull;
+        double bestScore = 0;
+        for (int polarity : { THRESH_BINARY_INV, THRESH_BINARY }) {
+            threshold(gray, body, 0, 255, polarity | THRESH_OTSU);
+            morphologyEx(body, body, MORPH_CLOSE, kernel, Point(-1, -1), 2);
+            morphologyEx(body, body, MORPH_OPEN, kernel, Point(-1, -1), 2);
+
+            findContours(body, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+            for (const auto& contour : contours) {
+                double area = contourArea(contour);
+                if (area < 0.2 * imageArea || area > 0.98 * imageArea) continue;
+                convexHull(contour, hull);
+                double score = area / max(1.0, (double)minAreaRect(hull).size.area());
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestHull = hull;
+                }
+            }
+        }
+        // 圆角与透视下的魔方面约 0.85 以上，低于 0.7 的不是一个完整的面
+        if (bestScore < 0.7) return false;
+
+        vector<Point> approx;
+        double peri = arcLength(bestHull, true);
+        for (double eps = 0.02; eps <= 0.1 && approx.size() != 4; eps += 0.01) {
+            approxPolyDP(bestHull, approx, eps * peri, true);
+        }
+
+        vector<Point2f> corners;
+        if (approx.size() == 4) {
+            for (const Point& p : approx) corners.push_back(Point2f(p));
+        }
+        else {
+            Point2f box[4];
+            minAreaRect(bestHull).points(box);
+            corners.assign(box, box + 4);
+        }
+
+        // 按 x+y 最小/最大确定左上/右下，按 y-x 最小/最大确定右上/左下
+        quad.assign(4, Point2f());
+        auto bySum = [](const Point2f& a, const Point2f& b) { return a.x + a.y < b.x + b.y; };
+        auto byDiff = [](const Point2f& a, const Point2f& b) { return a.y - a.x < b.y - b.x; };
+        quad[0] = *min_element(corners.begin(), corners.end(), bySum);
+        quad[2] = *max_element(corners.begin(), corners.end(), bySum);
+        quad[1] = *min_element(corners.begin(), corners.end(), byDiff);
+        quad[3] = *max_element(corners.begin(), corners.end(), byDiff);
+        for (Point2f& p : quad) p *= (float)(1.0 / s);
+        return true;
+    }
+
+    /*********************************************************
+     * 按 Lab 值选择颜色：落在多个阈值盒内时取体积最小（最具体）的，
+     * 都不在时取距离最近且不超过 maxDistance 的盒；返回颜色下标，失败为 -1
+     * 设置了颜色模型时改为取最近的颜色中心
+     *********************************************************/
+    int classifyLab(const Vec3b& lab, double maxDistance = 30) const {
+        if (colorModel.valid) {
+            float v[3] = { (float)lab[0], (float)lab[1], (float)lab[2] };
+            return colorModel.nearest(v);
+        }
+
+        int best = -1;
+        double bestVolume = 0, bestDistance = maxDistance * maxDistance;
+        bool inside = false;
+        for (size_t ci = 0; ci < colorTable.size(); ci++) {
+            const ColorRange& c = colorTable[ci];
+            double d2 = 0, volume = 1;
+            for (int k = 0; k < 3; k++) {
+                double lo = c.minVal[k], hi = c.maxVal[k];
+                double v = lab[k];
+                double d = v < lo ? lo - v : (v > hi ? v - hi : 0);
+                d2 += d * d;
+                volume *= hi - lo + 1;
+            }
+            if (d2 == 0) {
+                if (!inside || volume < bestVolume) {
+                    best = (int)ci;
+                    bestVolume = volume;
+                }
+                inside = true;
+            }
+            else if (!inside && d2 <= bestDistance) {
+                best = (int)ci;
+                bestDistance = d2;
+            }
+        }
+        return best;
+    }
+
+    /*********************************************************
+     * 透视校正：把四边形内的魔方面变换到 n 格整的正方形（边长 quadCell(n) * n）
+     * 并转为 Lab，返回原图到校正图的单应矩阵
+     *********************************************************/
+    Mat warpFace(const Mat& img, const vector<Point2f>& quad, int n, Mat& faceLab) const {
+        int side = quadCell(n) * n;
+        float q = (float)side;
+        vector<Point2f> square = { Point2f(0, 0), Point2f(q, 0), Point2f(q, q), Point2f(0, q) };
+        Mat H = getPerspectiveTransform(quad, square);
+        Mat face;
+        warpPerspective(img, face, H, Size(side, side), INTER_LINEAR);
+        cvtColor(face, faceLab, COLOR_BGR2Lab);
+        return H;
+    }
+
+    /*********************************************************
+     * Lab 图像 inner 区域的逐通道中位数（对反光、边框残留稳健），
+     * channel 为调用方复用的缓冲
+     *********************************************************/
+    static Vec3b medianLab(const Mat& lab, const Rect& inner, vector<uchar> channel[3]) {
+        for (int k = 0; k < 3; k++) channel[k].clear();
+        for (int y = inner.y; y < inner.y + inner.height; y++) {
+            const Vec3b* p = lab.ptr<Vec3b>(y);
+            for (int x = inner.x; x < inner.x + inner.width; x++) {
+                for (int k = 0; k < 3; k++) channel[k].push_back(p[x][k]);
+            }
+        }
+        Vec3b median;
+        for (int k = 0; k < 3; k++) {
+            auto mid = channel[k].begin() + channel[k].size() / 2;
+            nth_element(channel[k].begin(), mid, channel[k].end());
+            median[k] = *mid;
+        }
+        return median;
+    }
+
+    /*********************************************************
+     * 四边形检测：透视校正魔方面到 quadCell(N) * N 见方，分成 N x N 格，
+     * 每格取中央 40% 区域的 Lab 逐通道中位数分类；
+     * 色块的中心、边界框由格子经逆变换回原图得到，行列直接确定
+     * 找不到四边形时返回 false
+     *********************************************************/
+    template<int N>
+    bool analyzeFaceQuad(const Mat& img, Mat& outputImg, bool draw, vector<ColorBlock>& blocks) const {
+        vector<Point2f> quad;
+        Mat faceLab, H;
+        {
+            ScopedStageTimer timer(metrics, STAGE_CLASSIFY);
+            if (!findFaceQuad(img, quad)) return false;
+            H = warpFace(img, quad, N, faceLab);
+        }
+
+        ScopedStageTimer extractTimer(metrics, STAGE_EXTRACT);
+        Mat Hinv = H.inv();
+        int cell = quadCell(N);
+        int inset = cell * 3 / 10;
+        vector<uchar> channel[3];
+        vector<vector<Point>> gridLines;
+        vector<pair<Rect, size_t>> labelBoxes;
+
+        for (int row = 0; row < N; row++) {
+            for (int col = 0; col < N; col++) {
+                Rect inner(col * cell + inset, row * cell + inset, cell - 2 * inset, cell - 2 * inset);
+                Vec3b median = medianLab(faceLab, inner, channel);
+
+                // 格子四角与中心映射回原图
+                vector<Point2f> canonical = {
+                    Point2f((float)(col * cell), (float)(row * cell)), Point2f((float)((col + 1) * cell), (float)(row * cell)),
+                    Point2f((float)((col + 1) * cell), (float)((row + 1) * cell)), Point2f((float)(col * cell), (float)((row + 1) * cell)),
+                    Point2f((col + 0.5f) * cell, (row + 0.5f) * cell)
+                };
+                vector<Point2f> corners;
+                perspectiveTransform(canonical, corners, Hinv);
+                vector<Point> outline(corners.begin(), corners.begin() + 4);
+
+                int ci = classifyLab(median);
+                if (ci < 0) {
+                    if (metrics) metrics->addRejectedContour();
+                    continue;
+                }
+
+                ColorBlock block;
+                block.center = corners[4];
+                block.colorName = colorTable[ci].name;
+                block.colorValue = colorTable[ci].drawColor;
+                block.boundingBox = boundingRect(outline);
+                block.area = contourArea(outline);
+                block.row = row;
+                block.col = col;
+                blocks.push_back(block);
+                if (metrics) metrics->addColorHit(ci);
+
+                if (draw) {
+                    gridLines.push_back(outline);
+                    labelBoxes.push_back({ block.boundingBox, (size_t)ci });
+                }
+            }
+        }
+
+        if (draw) {
+            ScopedStageTimer overlayTimer(metrics, STAGE_OVERLAY);
+            vector<vector<Point>> outline = { vector<Point>(quad.begin(), quad.end()) };
+            polylines(outputImg, outline, true, Scalar(0, 255, 0), 5, LINE_AA);
+            polylines(outputImg, gridLines, true, Scalar(0, 255, 0), 2, LINE_AA);
+            for (const auto& label : labelBoxes) {
+                const Rect& boundRect = label.first;
+                const ColorRange& c = colorTable[label.second];
+                // 标签放在格子内左上角（格子紧挨着，放在上方会被相邻格遮住）
+                rectangle(outputImg, Point(boundRect.x + 8, boundRect.y + 8),
+                    Point(boundRect.x + 90, boundRect.y + 33), Scalar(0, 0, 0), FILLED);
+                putText(outputImg, c.name, Point(boundRect.x + 10, boundRect.y + 28),
+                    FONT_HERSHEY_SIMPLEX, 1.0, Scalar(255, 255, 255), 2);
+            }
+        }
+        return true;
+    }
+
+    /*********************************************************
+     * 检测并分析所有颜色色块
+     * 构造完成后分析器只读，可在多个线程中同时调用；
+     * classifyMs 非空时返回查表分类 + 形态学耗时（毫秒）
+     * 每次调用使用临时的帧上下文；高帧率场景请用下面带 FrameContext 的版本
+     *********************************************************/
+    vector<ColorBlock> analyzeCubeFace(const Mat& img, Mat& outputImg, bool draw = true,
+        double* classifyMs = nullptr) const {
+        FrameContext ctx;
+        return analyzeCubeFace(img, ctx, outputImg, draw, classifyMs);
+    }
+
+    /*********************************************************
+     * 检测并分析所有颜色色块，全部中间结果放在调用线程自己的 ctx 中；
+     * 返回的色块即 ctx.blocks，在下一次使用同一 ctx 分析前有效
+     *********************************************************/
+    const vector<ColorBlock>& analyzeCubeFace(const Mat& img, FrameContext& ctx, Mat& outputImg,
+        bool draw = true, double* classifyMs = nullptr) const {
+        return analyzeGridFace<3>(img, ctx, ctx.grid, outputImg, draw, classifyMs);
+    }
+
+    /*********************************************************
+     * 按 N x N 网格检测并分析一个面（N = 2..7，编译期确定）：
+     * 色块面积范围按 N 换算，网格拟合结果写入 grid；
+     * 其余同 analyzeCubeFace（它就是 N = 3 的实例）。
+     * N != 3 只作为库内的模板接口提供：命令行、识别服务、C 接口、
+     * 求解与回归测试都只处理 3x3；基准测试的 grid_sizes 只覆盖网格拟合与矩阵填充
+     *********************************************************/
+    template<int N>
+    const vector<ColorBlock>& analyzeGridFace(const Mat& img, FrameContext& ctx, LatticeFitN<N>& grid,
+        Mat& outputImg, bool draw = true, double* classifyMs = nullptr) const {
+        vector<ColorBlock>& allBlocks = ctx.blocks;
+        allBlocks.clear();
+        ctx.quadFound = false;
+
+        // 四边形模式：成功时直接得到带行列的色块，不再分割与分网格
+        if (detectMode == DETECT_QUAD) {
+            int64 t0 = getTickCount();
+            bool found = analyzeFaceQuad<N>(img, outputImg, draw, allBlocks);
+            ctx.quadFound = found;
+            if (classifyMs) {
+                *classifyMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+            }
+            if (found) {
+                // 四边形已确定网格，置信度只看有效格子数
+                grid = LatticeFitN<N>();
+                grid.ok = true;
+                grid.matched = (int)allBlocks.size();
+                grid.confidence = (float)allBlocks.size() / (N * N);
+                if (metrics) metrics->recordFace(allBlocks.size());
+                return allBlocks;
+            }
+            if (verbose) {
+                cout << "警告：未找到魔方面轮廓，改用全图分割" << endl;
+            }
+            allBlocks.clear();
+        }
+
+        int levels, scale;
+        double minArea, maxArea;
+        bool streaming = streamRows > 0;
+        {
+            ScopedStageTimer timer(metrics, STAGE_CLASSIFY);
+            int64 t0 = getTickCount();
+
+            // 金字塔粗层：缩小后再检测，形态学核随之缩小
+            levels = resolvePyramidLevels(img);
+            scale = 1 << levels;
+            if (streaming) {
+                // 条带流式：缩放、分类、开运算与连通域统计一遍完成，不保留整幅位掩码
+                gridAreaLimits<N>((double)(img.rows / scale) * (img.cols / scale), minArea, maxArea);
+                streamRegions(img, levels, max(1, 2 >> levels), minArea, maxArea, ctx.strip);
+                if (metrics) {
+                    for (int i = 0; i < ctx.strip.regions.rejected; i++) metrics->addRejectedContour();
+                }
+            }
+            else {
+                if (levels > 0) {
+                    resize(img, ctx.work, Size(img.cols / scale, img.rows / scale), 0, 0, INTER_AREA);
+                }
+                const Mat& work = levels > 0 ? ctx.work : img;
+
+                // 查表单遍分类 + 形态学开运算去噪（六种颜色一起处理，可按水平分块并行）
+                segmentLabelsTiled(work, ctx.labels, max(1, 2 >> levels), ctx);
+
+                // 面积阈值按检测层的图像面积与网格大小换算
+                gridAreaLimits<N>((double)work.rows * work.cols, minArea, maxArea);
+            }
+
+            if (classifyMs) {
+                *classifyMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+            }
+        }
+
+        ScopedStageTimer extractTimer(metrics, STAGE_EXTRACT);
+        if (streaming) {
+            blocksFromOutlines(img, levels, draw, outputImg, ctx, ctx.strip.regions.outlines, ctx.strip.regions.points);
+        }
+        else if (extractBackend == EXTRACT_COMPONENTS) {
+            extractByComponents(img, levels, minArea, maxArea, draw, outputImg, ctx);
+        }
+        else {
+            extractByContours(img, levels, minArea, maxArea, draw, outputImg, ctx);
+        }
+
+        if (metrics) metrics->recordFace(allBlocks.size());
+
+        // 拟合 N x N 网格：去掉离群与多余的色块，缺失的格子按格子中心的分类结果补上
+        size_t detected = allBlocks.size();
+        {
+            ScopedStageTimer gridTimer(metrics, STAGE_GRID);
+            grid = assignToGrid<N>(allBlocks);
+            if (grid.ok && grid.matched < N * N) {
+                if (streaming) inferMissingCellsStreaming(grid, img, levels, ctx.strip, allBlocks);
+                else inferMissingCells(grid, ctx.labels, scale, allBlocks);
+            }
+        }
+
+        if (verbose && !grid.ok) {
+            cout << "警告：检测到 " << detected << " 个色块，无法拟合 " << N << "x" << N << " 网格" << endl;
+        }
+        else if (verbose && (detected != N * N || grid.matched < N * N)) {
+            cout << "警告：检测到 " << detected << " 个色块，网格匹配 " << grid.matched << "/" << N * N << " 格，补出 "
+                << allBlocks.size() - grid.matched << " 格，置信度 " << fixed << setprecision(2)
+                << grid.confidence << defaultfloat << endl;
+        }
+
+        return allBlocks;
+    }
+
+    /*********************************************************
+     * 采集一个面九个色面的 Lab 样本（行优先），用于颜色标定
+     * 优先用四边形检测：不依赖颜色阈值，阈值漂移时仍能取到九格；
+     * 找不到四边形时退回到分割，只有检测到 9 个色块才算成功
+     *********************************************************/
+    bool sampleFace(const Mat& img, vector<Vec3b>& samples) const {
+        samples.assign(9, Vec3b());
+        vector<uchar> channel[3];
+
+        vector<Point2f> quad;
+        if (findFaceQuad(img, quad)) {
+            Mat faceLab;
+            warpFace(img, quad, 3, faceLab);
+            int cell = quadCell(3);
+            int inset = cell * 3 / 10;
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    Rect inner(col * cell + inset, row * cell + inset, cell - 2 * inset, cell - 2 * inset);
+                    samples[row * 3 + col] = medianLab(faceLab, inner, channel);
+                }
+            }
+            return true;
+        }
+
+        Mat unused;
+        vector<ColorBlock> blocks = analyzeCubeFace(img, unused, false);
+        if (blocks.size() != 9) return false;
+        for (const ColorBlock& block : blocks) {
+            // 边界框中央 40% 的区域
+            const Rect& box = block.boundingBox;
+            Rect inner(box.x + box.width * 3 / 10, box.y + box.height * 3 / 10,
+                max(1, box.width * 2 / 5), max(1, box.height * 2 / 5));
+            inner &= Rect(0, 0, img.cols, img.rows);
+            if (inner.empty()) return false;
+            Mat lab;
+            cvtColor(img(inner), lab, COLOR_BGR2Lab);
+            samples[block.row * 3 + block.col] = medianLab(lab, Rect(0, 0, lab.cols, lab.rows), channel);
+        }
+        return true;
+    }
+
+    /*********************************************************
+     * 由六个面的样本（输入顺序，每面 9 个）拟合颜色模型：
+     * 54 个色面按中心块聚为 6 组、每组 9 个，
+     * 再按与 colorTable 阈值盒的距离为各组命名
+     *********************************************************/
+    ColorCalibrator::Result calibrate(const vector<vector<Vec3b>>& faceSamples, const string& profile,
+        ColorModel& model) const {
+        float samples[ColorCalibrator::SAMPLES][3];
+        for (int f = 0; f < ColorCalibrator::FACES; f++) {
+            for (int i = 0; i < ColorCalibrator::STICKERS; i++) {
+                for (int k = 0; k < 3; k++) {
+                    samples[f * ColorCalibrator::STICKERS + i][k] = faceSamples[f][i][k];
+                }
+            }
+        }
+
+        float lo[ColorCalibrator::FACES][3], hi[ColorCalibrator::FACES][3];
+        for (int c = 0; c < ColorCalibrator::FACES; c++) {
+            for (int k = 0; k < 3; k++) {
+                lo[c][k] = (float)colorTable[c].minVal[k];
+                hi[c][k] = (float)colorTable[c].maxVal[k];
+            }
+        }
+        return ColorCalibrator::fit(samples, lo, hi, profile, model);
+    }
+
+    /*********************************************************
+     * 将色块分配到 N x N 网格（默认 3x3）：对任意数量的色块中心拟合网格（允许旋转、
+     * 缺格、离群点和一格里分裂出的多个色块，见 LatticeFitterN），
+     * 每格保留最近的一个色块，其余移除，结果按行列排序。
+     * 返回拟合结果；拟合失败时色块保持原样，行列为 -1
+     * （只用栈上数组，不分配堆内存）
+     *********************************************************/
+    template<int N = 3>
+    LatticeFitN<N> assignToGrid(vector<ColorBlock>& blocks) const {
+        typedef LatticeFitN<N> Fit;
+
+        // 超过上限时只用面积最大的色块
+        if (blocks.size() > Fit::MAX_POINTS) {
+            nth_element(blocks.begin(), blocks.begin() + Fit::MAX_POINTS, blocks.end(),
+                [](const ColorBlock& a, const ColorBlock& b) { return a.area > b.area; });
+        }
+
+        float points[Fit::MAX_POINTS][2], sizes[Fit::MAX_POINTS];
+        int n = min((int)blocks.size(), Fit::MAX_POINTS);
+        for (int k = 0; k < n; k++) {
+            points[k][0] = blocks[k].center.x;
+            points[k][1] = blocks[k].center.y;
+            sizes[k] = (float)sqrt(blocks[k].area);
+        }
+
+        Fit fit = LatticeFitterN<N>::fit(points, sizes, n);
+        for (auto& block : blocks) {
+            block.row = block.col = -1;
+        }
+        if (!fit.ok) return fit;
+
+        for (int k = 0; k < n; k++) {
+            if (fit.cellOf[k] >= 0) {
+                blocks[k].row = fit.cellOf[k] / N;
+                blocks[k].col = fit.cellOf[k] % N;
+            }
+        }
+        blocks.erase(remove_if(blocks.begin(), blocks.end(),
+            [](const ColorBlock& b) { return b.row < 0; }), blocks.end());
+
+        // 按网格位置排序
+        sort(blocks.begin(), blocks.end(), compareColorBlocks);
+        return fit;
+    }
+
+    /*********************************************************
+     * 补出网格中缺失的格子：在检测层位掩码上统计格子中心附近
+     * （边长为格距 40% 的方窗）各颜色的像素数，超过一半的颜色即为该格颜色；
+     * 没有占多数的颜色时该格留空。补出的色块 inferred 为真、面积为 0
+     *********************************************************/
+    template<int N>
+    void inferMissingCells(const LatticeFitN<N>& fit, const Mat& labels, int scale, vector<ColorBlock>& blocks) const {
+        float pitch = fit.pitch();
+        int radius = max(1, cvRound(pitch * 0.2f / scale));
+        Rect bounds(0, 0, labels.cols, labels.rows);
+        size_t before = blocks.size();
+
+        for (int cell = 0; cell < N * N; cell++) {
+            if (fit.pointOfCell[cell] >= 0) continue;
+            int row = cell / N, col = cell % N;
+            float x, y;
+            fit.cellCenter(row, col, x, y);
+
+            Rect window = Rect(cvRound(x / scale) - radius, cvRound(y / scale) - radius,
+                2 * radius + 1, 2 * radius + 1) & bounds;
+            if (window.area() == 0) continue;
+
+            int best = majorityColor(labels, window);
+            if (best >= 0) blocks.push_back(inferredBlock(x, y, pitch, best, row, col));
+        }
+
+        if (blocks.size() != before) {
+            sort(blocks.begin(), blocks.end(), compareColorBlocks);
+        }
+    }
+
+    /*********************************************************
+     * 流式模式的补格：没有整幅位掩码，取格子窗口外扩 2*radius（开运算光晕）的
+     * 小块，缩放到检测层后分割，再按同样的规则取多数颜色。
+     * 光晕只在图像边界处截断，窗口内的位掩码与整幅分割相同
+     *********************************************************/
+    template<int N>
+    void inferMissingCellsStreaming(const LatticeFitN<N>& fit, const Mat& img, int levels, StripScratch& s,
+        vector<ColorBlock>& blocks) const {
+        int scale = 1 << levels;
+        int halo = 2 * max(1, 2 >> levels);
+        float pitch = fit.pitch();
+        int radius = max(1, cvRound(pitch * 0.2f / scale));
+        Rect bounds(0, 0, img.cols / scale, img.rows / scale);
+        size_t before = blocks.size();
+
+        for (int cell = 0; cell < N * N; cell++) {
+            if (fit.pointOfCell[cell] >= 0) continue;
+            int row = cell / N, col = cell % N;
+            float x, y;
+            fit.cellCenter(row, col, x, y);
+
+            Rect window = Rect(cvRound(x / scale) - radius, cvRound(y / scale) - radius,
+                2 * radius + 1, 2 * radius + 1) & bounds;
+            if (window.area() == 0) continue;
+
+            Rect patch = Rect(window.x - halo, window.y - halo, window.width + 2 * halo, window.height + 2 * halo) & bounds;
+            Mat src = img(patch);
+            if (levels > 0) {
+                resize(img(Rect(patch.x * scale, patch.y * scale, patch.width * scale, patch.height * scale)),
+                    s.patch, patch.size(), 0, 0, INTER_AREA);
+                src = s.patch;
+            }
+            segmentLabels(src, s.patchLabels, halo / 2, s.patchRaw, s.patchEroded, s.patchTmp);
+
+            int best = majorityColor(s.patchLabels, window - patch.tl());
+            if (best >= 0) blocks.push_back(inferredBlock(x, y, pitch, best, row, col));
+        }
+
+        if (blocks.size() != before) {
+            sort(blocks.begin(), blocks.end(), compareColorBlocks);
+        }
+    }
+
+    // 窗口内超过一半像素带有的颜色（位掩码），没有时返回 -1
+    int majorityColor(const Mat& labels, const Rect& window) const {
+        int counts[8] = { 0 };
+        for (int wy = window.y; wy < window.y + window.height; wy++) {
+            const uchar* p = labels.ptr<uchar>(wy) + window.x;
+            for (int wx = 0; wx < window.width; wx++) {
+                for (int ci = 0; ci < (int)colorTable.size(); ci++) {
+                    counts[ci] += (p[wx] >> ci) & 1;
+                }
+            }
+        }
+        int best = 0;
+        for (int ci = 1; ci < (int)colorTable.size(); ci++) {
+            if (counts[ci] > counts[best]) best = ci;
+        }
+        return counts[best] * 2 > window.area() ? best : -1;
+    }
+
+    // 补出的色块：中心为格子中心，边界框为格距的 80%，面积为 0
+    ColorBlock inferredBlock(float x, float y, float pitch, int color, int row, int col) const {
+        ColorBlock block;
+        block.center = Point2f(x, y);
+        block.colorName = colorTable[color].name;
+        block.colorValue = colorTable[color].drawColor;
+        int half = cvRound(pitch * 0.4f);
+        block.boundingBox = Rect(cvRound(x) - half, cvRound(y) - half, 2 * half, 2 * half);
+        block.area = 0;
+        block.row = row;
+        block.col = col;
+        block.inferred = true;
+        return block;
+    }
+
+    /*********************************************************
+     * 创建颜色矩阵（3x3）并打印
+     *********************************************************/
+    vector<vector<char>> createColorMatrix(const vector<ColorBlock>& blocks) const {
+        vector<vector<char>> colorMatrix;
+        fillColorMatrix(blocks, colorMatrix);
+        return colorMatrix;
+    }
+
+    /*********************************************************
+     * 把颜色矩阵写入已有的 3x3 矩阵（容量足够时不分配）
+     *********************************************************/
+    void fillColorMatrix(const vector<ColorBlock>& blocks, vector<vector<char>>& colorMatrix) const {
+        colorMatrix.resize(3);
+        for (auto& row : colorMatrix) {
+            row.assign(3, ' ');
+        }
+
+        for (const auto& block : blocks) {
+            if (block.row >= 0 && block.row < 3 && block.col >= 0 && block.col < 3) {
+                // 只读查找，避免 operator[] 修改映射表
+                auto it = colorCodes.find(block.colorName);
+                if (it != colorCodes.end()) {
+                    colorMatrix[block.row][block.col] = it->second;
+                }
+            }
+        }
+    }
+
+    /*********************************************************
+     * 把颜色矩阵写入定长的 N x N 矩阵（不分配堆内存）
+     *********************************************************/
+    template<int N>
+    void fillColorMatrix(const vector<ColorBlock>& blocks, FaceMatrix<N>& colorMatrix) const {
+        colorMatrix.clear();
+        for (const auto& block : blocks) {
+            if (block.row >= 0 && block.row < N && block.col >= 0 && block.col < N) {
+                auto it = colorCodes.find(block.colorName);
+                if (it != colorCodes.end()) {
+                    colorMatrix.at(block.row, block.col) = it->second;
+                }
+            }
+        }
+    }
+
+    /*********************************************************
+     * 检查整个魔方的颜色统计：每种颜色应恰好出现9次
+     *********************************************************/
+    bool checkColorTotals(const vector<vector<vector<char>>>& allColorMatrices) const {
+        map<char, int> colorCount;
+        for (const auto& matrix : allColorMatrices) {
+            for (const auto& row : matrix) {
+                for (char color : row) {
+                    colorCount[color]++;
+                }
+            }
+        }
+
+        bool ok = true;
+        for (const auto& c : colorTable) {
+            auto it = colorCount.find(c.code);
+            if (it == colorCount.end() || it->second != 9) {
+                ok = false;
+            }
+        }
+
+        if (metrics) metrics->recordCube(ok);
+        return ok;
+    }
+
+    /*********************************************************
+     * 检查 N 阶魔方的颜色统计：每种颜色应恰好出现 N*N 次
+     *********************************************************/
+    template<int N>
+    bool checkColorTotals(const CubeMatrices<N>& faces) const {
+        int colorCount[128] = { 0 };
+        for (const auto& face : faces) {
+            for (char color : face.cells) {
+                colorCount[(unsigned char)color & 127]++;
+            }
+        }
+
+        bool ok = true;
+        for (const auto& c : colorTable) {
+            if (colorCount[(unsigned char)c.code & 127] != N * N) {
+                ok = false;
+            }
+        }
+
+        if (metrics) metrics->recordCube(ok);
+        return ok;
+    }
+
+    /*********************************************************
+     * 获取颜色映射表
+     *********************************************************/
+    map<string, Scalar> getColorMap() const {
+        map<string, Scalar> colorMap;
+        for (const auto& c : colorTable) {
+            colorMap[c.name] = c.drawColor;
+        }
+        return colorMap;
+    }
+
+    /*********************************************************
+     * 获取颜色阈值表（下标与颜色位掩码的位一一对应）
+     *********************************************************/
+    const vector<ColorRange>& getColorTable() const {
+        return colorTable;
+    }
+
+    /*********************************************************
+     * 获取颜色代码字符串（第 i 个字符为颜色阈值表第 i 项的代码）
+     *********************************************************/
+    string getColorCodeString() const {
+        string codes;
+        for (const auto& c : colorTable) {
+            codes += c.code;
+        }
+        return codes;
+    }
+
+    /*********************************************************
+     * 获取颜色代码映射表
+     *********************************************************/
+    map<char, Scalar> getColorCodeMap() const {
+        map<char, Scalar> colorCodeMap;
+        for (const auto& c : colorTable) {
+            colorCodeMap[c.code] = c.drawColor;
+        }
+        return colorCodeMap;
+    }
+};
+
+/*************************************************************
+ * 色块标准化和魔方展开图绘制类
+ *************************************************************/
+class CubeVisualizer {
+private:
+    // 布局常量（编译期确定）
+    static constexpr int blockSize = 60;                    // 每个色块的大小（像素）
+    static constexpr int margin = 10;                       // 画布边缘与面之间、面与面之间的边距
+    static constexpr int labelHeight = 25;                  // 标准化面底部标签栏的高度
+    static constexpr int atlasPad = 4;                      // 色块模板四周多留的像素（容纳边框外溢）
+    static_assert(atlasPad <= margin, "色块模板不能超出画布");
+
+    // 标准魔方展开图布局：(列, 行)，每个单位是一个面的大小+边距
+    static constexpr int facePositions[6][2] = {
+        { 1, 0 },  // Up: 第0行第1列
+        { 0, 1 },  // Left: 第1行第0列
+        { 1, 1 },  // Front: 第1行第1列
+        { 2, 1 },  // Right: 第1行第2列
+        { 3, 1 },  // Back: 第1行第3列
+        { 1, 2 }   // Down: 第2行第1列
+    };
+    static constexpr const char* faceLabels[6] = { "Up", "Left", "Front", "Right", "Back", "Down" };
+
+    /*********************************************************
+     * 预光栅化模板：单通道掩码，非零像素就是对应的 rectangle/putText 会涂到的像素。
+     * 这些绘制都是不透明的单色（LINE_8，无抗锯齿），整数平移下光栅化结果不变，
+     * 所以按原来的绘制顺序逐个把掩码盖到画布上，结果与直接绘制逐像素相同
+     *********************************************************/
+    struct CellStamps {
+        Point textOrg;             // 颜色代码的文字原点（相对色块左上角）
+        double fontScale = 0;
+        int thickness = 1;
+        Mat border;                // 边框；与文字掩码一样，左上角对应色块左上角 - atlasPad
+        Mat glyphs[128];           // 可打印 ASCII 颜色代码
+        bool hasGlyph[128] = {};   // 没有模板的字符直接调用 putText
+    };
+
+    struct TextStamp {
+        string text;
+        Mat mask;
+        Point offset;              // 掩码左上角相对于文字原点的偏移
+    };
+
+    PipelineMetrics* metrics = nullptr; // 指标（为空时不记录）
+    CellStamps faceCell;                // 标准化面的色块：字号 0.7，线宽 2
+    CellStamps netCell;                 // 展开图的色块：字号 0.5，线宽 1
+    vector<TextStamp> labelStamps;      // 面名称（字号 0.6，线宽 2，两种图通用）
+
+    // 掩码紧贴边缘时文字可能被裁掉，这样的模板不用
+    static bool touchesEdge(const Mat& mask) {
+        return countNonZero(mask.row(0)) > 0 || countNonZero(mask.row(mask.rows - 1)) > 0
+            || countNonZero(mask.col(0)) > 0 || countNonZero(mask.col(mask.cols - 1)) > 0;
+    }
+
+    static CellStamps rasterizeCell(Point textOrg, double fontScale, int thickness) {
+        CellStamps cell;
+        cell.textOrg = textOrg;
+        cell.fontScale = fontScale;
+        cell.thickness = thickness;
+
+        int side = blockSize + 2 * atlasPad;
+        cell.border = Mat::zeros(side, side, CV_8UC1);
+        rectangle(cell.border, Rect(atlasPad, atlasPad, blockSize, blockSize), Scalar(255), 2);
+
+        for (int ch = 32; ch < 127; ch++) {
+            Mat glyph = Mat::zeros(side, side, CV_8UC1);
+            putText(glyph, string(1, (char)ch), textOrg + Point(atlasPad, atlasPad),
+                FONT_HERSHEY_SIMPLEX, fontScale, Scalar(255), thickness);
+            if (touchesEdge(glyph)) continue;
+            if (countNonZero(glyph) > 0) cell.glyphs[ch] = glyph;  // 空格等不留掩码
+            cell.hasGlyph[ch] = true;
+        }
+        return cell;
+    }
+
+    static TextStamp rasterizeText(const string& text, double fontScale, int thickness) {
+        int baseline = 0;
+        Size size = getTextSize(text, FONT_HERSHEY_SIMPLEX, fontScale, thickness, &baseline);
+        int pad = thickness + 4;
+
+        TextStamp stamp;
+        stamp.text = text;
+        stamp.offset = Point(-pad, -size.height - pad);
+        stamp.mask = Mat::zeros(size.height + baseline + 2 * pad, size.width + 2 * pad, CV_8UC1);
+        putText(stamp.mask, text, Point(pad, size.height + pad), FONT_HERSHEY_SIMPLEX, fontScale, Scalar(255), thickness);
+        if (touchesEdge(stamp.mask)) stamp.mask.release();
+        return stamp;
+    }
+
+    // 把掩码盖到画布的 topLeft 处，超出画布的部分裁掉（与直接绘制时的裁剪一致）
+    static void stamp(Mat& canvas, const Mat& mask, Point topLeft, const Scalar& color) {
+        if (mask.empty()) return;
+        Rect target = Rect(topLeft, mask.size()) & Rect(0, 0, canvas.cols, canvas.rows);
+        if (target.empty()) return;
+        Rect source(target.x - topLeft.x, target.y - topLeft.y, target.width, target.height);
+        canvas(target).setTo(color, mask(source));
+    }
+
+    static Scalar blockColorOf(const map<char, Scalar>& colorCodeMap, char colorCode) {
+        auto it = colorCodeMap.find(colorCode);
+        return it != colorCodeMap.end() ? it->second : Scalar(128, 128, 128); // 默认灰色
+    }
+
+    // 绘制一个色块：填充 → 边框 → 颜色代码，顺序与直接绘制相同
+    static void drawCell(Mat& canvas, const CellStamps& cell, int x, int y, char colorCode, const Scalar& color) {
+        canvas(Rect(x, y, blockSize, blockSize)).setTo(color);
+        Point patch(x - atlasPad, y - atlasPad);
+        stamp(canvas, cell.border, patch, Scalar(50, 50, 50));
+
+        unsigned char ch = (unsigned char)colorCode;
+        if (ch < 128 && cell.hasGlyph[ch]) {
+            stamp(canvas, cell.glyphs[ch], patch, Scalar(0, 0, 0));
+        }
+        else {
+            putText(canvas, string(1, colorCode), Point(x, y) + cell.textOrg,
+                FONT_HERSHEY_SIMPLEX, cell.fontScale, Scalar(0, 0, 0), cell.thickness);
+        }
+    }
+
+    // 绘制面名称：常用面名用模板，其它名称直接调用 putText
+    void drawLabel(Mat& canvas, const string& text, Point org) const {
+        for (const TextStamp& s : labelStamps) {
+            if (s.text == text && !s.mask.empty()) {
+                stamp(canvas, s.mask, org + s.offset, Scalar(0, 0, 0));
+                return;
+            }
+        }
+        putText(canvas, text, org, FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 0, 0), 2);
+    }
+
+    /*********************************************************
+     * 用模板拼出 N x N 标准化面（canvas 为原始尺寸），
+     * colorAt(row, col) 返回该格的颜色代码
+     *********************************************************/
+    template<int N, typename ColorAt>
+    void stampStandardFace(Mat& canvas, ColorAt colorAt, const map<char, Scalar>& colorCodeMap,
+        const string& faceName) const {
+        canvas.setTo(Scalar(240, 240, 240));  // 浅灰色背景
+        for (int row = 0; row < N; row++) {
+            for (int col = 0; col < N; col++) {
+                char colorCode = colorAt(row, col);
+                drawCell(canvas, faceCell, margin + col * blockSize, margin + row * blockSize,
+                    colorCode, blockColorOf(colorCodeMap, colorCode));
+            }
+        }
+        if (!faceName.empty()) {
+            drawLabel(canvas, faceName, Point(margin, canvas.rows - margin / 2));
+        }
+    }
+
+    /*********************************************************
+     * 直接用 rectangle/putText 绘制 N x N 标准化面，布局按 canvas 尺寸缩放
+     *********************************************************/
+    template<int N, typename ColorAt>
+    void paintStandardFace(Mat& canvas, ColorAt colorAt, const map<char, Scalar>& colorCodeMap,
+        const string& faceName) const {
+        Size natural = standardFaceSize(faceName, N);
+        double sx = (double)canvas.cols / natural.width;
+        double sy = (double)canvas.rows / natural.height;
+        double s = min(sx, sy);
+
+        canvas.setTo(Scalar(240, 240, 240));  // 浅灰色背景
+
+        // 绘制每个色块
+        for (int row = 0; row < N; row++) {
+            for (int col = 0; col < N; col++) {
+                char colorCode = colorAt(row, col);
+
+                // 获取颜色
+                Scalar blockColor = blockColorOf(colorCodeMap, colorCode);
+
+                // 计算位置
+                int x0 = cvRound((margin + col * blockSize) * sx);
+                int y0 = cvRound((margin + row * blockSize) * sy);
+                int x1 = cvRound((margin + (col + 1) * blockSize) * sx);
+                int y1 = cvRound((margin + (row + 1) * blockSize) * sy);
+                Rect cell(x0, y0, x1 - x0, y1 - y0);
+
+                // 绘制色块
+                rectangle(canvas, cell, blockColor, FILLED);
+
+                // 绘制边框
+                rectangle(canvas, cell, Scalar(50, 50, 50), max(1, cvRound(2 * s)));  // 深灰色边框
+
+                // 在中心绘制颜色代码
+                string codeStr(1, colorCode);
+                putText(canvas,
+                    codeStr,
+                    Point(x0 + cell.width / 3, y0 + 2 * cell.height / 3),
+                    FONT_HERSHEY_SIMPLEX,
+                    0.7 * s,
+                    Scalar(0, 0, 0),  // 黑色文字
+                    max(1, cvRound(2 * s)));
+            }
+        }
+
+        // 添加面名称标签（如果有）
+        if (!faceName.empty()) {
+            putText(canvas,
+                faceName,
+                Point(cvRound(margin * sx), canvas.rows - cvRound(margin / 2 * sy)),
+                FONT_HERSHEY_SIMPLEX,
+                0.6 * s,
+                Scalar(0, 0, 0),  // 黑色文字
+                max(1, cvRound(2 * s)));
+        }
+    }
+
+    /*********************************************************
+     * 用模板拼出 N 阶魔方展开图到 canvas（尺寸不符时重新分配），
+     * colorAt(face, row, col) 按展开图顺序取颜色代码
+     *********************************************************/
+    template<int N, typename ColorAt>
+    void stampCubeNet(Mat& canvas, int faces, ColorAt colorAt, const map<char, Scalar>& colorCodeMap) const {
+        canvas.create(cubeNetSize(N), CV_8UC3);
+        canvas.setTo(Scalar(240, 240, 240)); // 浅灰色背景
+
+        for (int i = 0; i < faces && i < 6; i++) {
+            stampNetPanel<N>(canvas, i, [&](int r, int c) { return colorAt(i, r, c); }, colorCodeMap);
+
+            // 添加面标签
+            drawLabel(canvas, faceLabels[i], netPanelOrigin(i, N) + Point(5, -5));
+        }
+    }
+
+    // 展开图第 i 个面左上角色块的位置
+    static Point netPanelOrigin(int i, int n) {
+        const int faceSpan = blockSize * n + margin;
+        return Point(margin + facePositions[i][0] * faceSpan, margin + facePositions[i][1] * faceSpan);
+    }
+
+    // 展开图中一个面的 N x N 个色块（模板只写各自格子和四周的边框外溢，重画时结果与首次绘制相同）
+    template<int N, typename ColorAt>
+    void stampNetPanel(Mat& canvas, int i, ColorAt colorAt, const map<char, Scalar>& colorCodeMap) const {
+        Point origin = netPanelOrigin(i, N);
+        for (int r = 0; r < N; r++) {
+            for (int c = 0; c < N; c++) {
+                char colorCode = colorAt(r, c);
+                drawCell(canvas, netCell, origin.x + c * blockSize, origin.y + r * blockSize,
+                    colorCode, blockColorOf(colorCodeMap, colorCode));
+            }
+        }
+    }
+
+    /*********************************************************
+     * 直接用 rectangle/putText 绘制 N 阶魔方展开图
+     *********************************************************/
+    template<int N, typename ColorAt>
+    Mat paintCubeNet(int faces, ColorAt colorAt, const map<char, Scalar>& colorCodeMap) const {
+        const int faceSpan = blockSize * N + margin;
+        Mat cubeNet(cubeNetSize(N), CV_8UC3);
+        cubeNet.setTo(Scalar(240, 240, 240)); // 浅灰色背景
+
+        for (int i = 0; i < faces && i < 6; i++) {
+            int x = margin + facePositions[i][0] * faceSpan;
+            int y = margin + facePositions[i][1] * faceSpan;
+
+            // 绘制单个面
+            for (int r = 0; r < N; r++) {
+                for (int c = 0; c < N; c++) {
+                    char colorCode = colorAt(i, r, c);
+                    Scalar color = blockColorOf(colorCodeMap, colorCode);
+
+                    Rect blockRect(x + c * blockSize, y + r * blockSize, blockSize, blockSize);
+                    rectangle(cubeNet, blockRect, color, FILLED);
+                    rectangle(cubeNet, blockRect, Scalar(50, 50, 50), 2);
+
+                    // 显示颜色代码
+                    string codeStr(1, colorCode);
+                    putText(cubeNet, codeStr,
+                        Point(x + c * blockSize + blockSize / 4,
+                            y + r * blockSize + 3 * blockSize / 4),
+                        FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0), 1);
+                }
+            }
+
+            // 添加面标签
+            putText(cubeNet, faceLabels[i], Point(x + 5, y - 5),
+                FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 0, 0), 2);
+        }
+
+        return cubeNet;
+    }
+
+public:
+    /*********************************************************
+     * 构造时一次性光栅化所有模板（约两百次小图上的 putText）
+     *********************************************************/
+    CubeVisualizer()
+        : faceCell(rasterizeCell(Point(blockSize / 3, 2 * blockSize / 3), 0.7, 2)),
+          netCell(rasterizeCell(Point(blockSize / 4, 3 * blockSize / 4), 0.5, 1)) {
+        for (const char* label : faceLabels) {
+            labelStamps.push_back(rasterizeText(label, 0.6, 2));
+        }
+    }
+
+    /*********************************************************
+     * 设置指标记录对象（为空时关闭）
+     *********************************************************/
+    void setMetrics(PipelineMetrics* m) {
+        metrics = m;
+    }
+
+    /*********************************************************
+     * 标准化面的原始尺寸（n x n 个色块 + 边距 + 可选的标签栏）
+     *********************************************************/
+    static Size standardFaceSize(const string& faceName, int n = 3) {
+        int label = faceName.empty() ? 0 : labelHeight;
+        return Size(blockSize * n + margin * 2, blockSize * n + margin * 2 + label);
+    }
+
+    /*********************************************************
+     * n 阶魔方展开图的尺寸（标准 4x3 网格布局，色块大小与 n 无关）
+     *********************************************************/
+    static Size cubeNetSize(int n = 3) {
+        int faceSpan = blockSize * n + margin;  // 一个面加边距的宽度
+        return Size(4 * faceSpan + margin, 3 * faceSpan + margin);
+    }
+
+    /*********************************************************
+     * 在 canvas 上绘制标准化面，布局按 canvas 尺寸相对原始尺寸缩放。
+     * canvas 为原始尺寸时用预光栅化模板拼出（与直接绘制逐像素一致），
+     * 其它尺寸直接绘制
+     *********************************************************/
+    void renderStandardFace(Mat& canvas, const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap, const string& faceName) const {
+        auto colorAt = [&](int row, int col) { return colorMatrix[row][col]; };
+        if (canvas.size() != standardFaceSize(faceName)) {
+            paintStandardFace<3>(canvas, colorAt, colorCodeMap, faceName);
+            return;
+        }
+        stampStandardFace<3>(canvas, colorAt, colorCodeMap, faceName);
+    }
+
+    template<int N>
+    void renderStandardFace(Mat& canvas, const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap, const string& faceName) const {
+        auto colorAt = [&](int row, int col) { return colorMatrix.at(row, col); };
+        if (canvas.size() != standardFaceSize(faceName, N)) {
+            paintStandardFace<N>(canvas, colorAt, colorCodeMap, faceName);
+            return;
+        }
+        stampStandardFace<N>(canvas, colorAt, colorCodeMap, faceName);
+    }
+
+    /*********************************************************
+     * 直接用 rectangle/putText 绘制标准化面（任意尺寸；
+     * 原始尺寸时也作为模板绘制的对照）
+     *********************************************************/
+    void renderStandardFaceDirect(Mat& canvas, const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap, const string& faceName) const {
+        paintStandardFace<3>(canvas, [&](int row, int col) { return colorMatrix[row][col]; },
+            colorCodeMap, faceName);
+    }
+
+    template<int N>
+    void renderStandardFaceDirect(Mat& canvas, const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap, const string& faceName) const {
+        paintStandardFace<N>(canvas, [&](int row, int col) { return colorMatrix.at(row, col); },
+            colorCodeMap, faceName);
+    }
+
+    /*********************************************************
+     * 绘制单个标准化的魔方面到 canvas（尺寸不符时重新分配，否则复用）
+     *********************************************************/
+    void drawStandardFace(const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName, Mat& canvas) const {
+        ScopedStageTimer timer(metrics, STAGE_STANDARD_FACE);
+        canvas.create(standardFaceSize(faceName), CV_8UC3);
+        renderStandardFace(canvas, colorMatrix, colorCodeMap, faceName);
+    }
+
+    template<int N>
+    void drawStandardFace(const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName, Mat& canvas) const {
+        ScopedStageTimer timer(metrics, STAGE_STANDARD_FACE);
+        canvas.create(standardFaceSize(faceName, N), CV_8UC3);
+        renderStandardFace(canvas, colorMatrix, colorCodeMap, faceName);
+    }
+
+    /*********************************************************
+     * 绘制单个标准化的魔方面
+     *********************************************************/
+    Mat drawStandardFace(const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName = "") const {
+        Mat faceImg;
+        drawStandardFace(colorMatrix, colorCodeMap, faceName, faceImg);
+        return faceImg;
+    }
+
+    template<int N>
+    Mat drawStandardFace(const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName = "") const {
+        Mat faceImg;
+        drawStandardFace(colorMatrix, colorCodeMap, faceName, faceImg);
+        return faceImg;
+    }
+
+    /*********************************************************
+     * 用预光栅化模板绘制魔方展开图（标准4x3网格布局）到 canvas，
+     * 尺寸不符时重新分配，否则复用
+     *********************************************************/
+    void drawCubeNet(const vector<vector<vector<char>>>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap, Mat& canvas) const {
+        ScopedStageTimer timer(metrics, STAGE_CUBE_NET);
+        stampCubeNet<3>(canvas, (int)allColorMatrices.size(),
+            [&](int face, int row, int col) { return allColorMatrices[face][row][col]; }, colorCodeMap);
+    }
+
+    template<int N>
+    void drawCubeNet(const CubeMatrices<N>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap, Mat& canvas) const {
+        ScopedStageTimer timer(metrics, STAGE_CUBE_NET);
+        stampCubeNet<N>(canvas, 6,
+            [&](int face, int row, int col) { return allColorMatrices[face].at(row, col); }, colorCodeMap);
+    }
+
+    /*********************************************************
+     * 在已有的三阶展开图上只重画第 panel 个面（展开图顺序）的色块，
+     * 其余面与标签不动。canvas 须为 cubeNetSize() 的 BGR 图，否则返回 false
+     *********************************************************/
+    bool redrawCubeNetPanel(Mat& canvas, int panel, const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap) const {
+        if (canvas.size() != cubeNetSize() || canvas.type() != CV_8UC3 || panel < 0 || panel >= 6) return false;
+        ScopedStageTimer timer(metrics, STAGE_CUBE_NET);
+        stampNetPanel<3>(canvas, panel, [&](int row, int col) { return colorMatrix[row][col]; }, colorCodeMap);
+        return true;
+    }
+
+    template<int N>
+    bool redrawCubeNetPanel(Mat& canvas, int panel, const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap) const {
+        if (canvas.size() != cubeNetSize(N) || canvas.type() != CV_8UC3 || panel < 0 || panel >= 6) return false;
+        ScopedStageTimer timer(metrics, STAGE_CUBE_NET);
+        stampNetPanel<N>(canvas, panel, [&](int row, int col) { return colorMatrix.at(row, col); }, colorCodeMap);
+        return true;
+    }
+
+    /*********************************************************
+     * 绘制魔方展开图（使用标准4x3网格布局）
+     *********************************************************/
+    Mat drawCubeNet(const vector<vector<vector<char>>>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap) const {
+        Mat cubeNet;
+        drawCubeNet(allColorMatrices, colorCodeMap, cubeNet);
+        return cubeNet;
+    }
+
+    template<int N>
+    Mat drawCubeNet(const CubeMatrices<N>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap) const {
+        Mat cubeNet;
+        drawCubeNet(allColorMatrices, colorCodeMap, cubeNet);
+        return cubeNet;
+    }
+
+    /*********************************************************
+     * 直接用 rectangle/putText 绘制魔方展开图（模板绘制的对照）
+     *********************************************************/
+    Mat drawCubeNetDirect(const vector<vector<vector<char>>>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap) const {
+        return paintCubeNet<3>((int)allColorMatrices.size(),
+            [&](int face, int row, int col) { return allColorMatrices[face][row][col]; }, colorCodeMap);
+    }
+
+    template<int N>
+    Mat drawCubeNetDirect(const CubeMatrices<N>& allColorMatrices,
+        const map<char, Scalar>& colorCodeMap) const {
+        return paintCubeNet<N>(6,
+            [&](int face, int row, int col) { return allColorMatrices[face].at(row, col); }, colorCodeMap);
+    }
+
+    /*********************************************************
+     * 对比图的尺寸（左右两半各 400x400）
+     *********************************************************/
+    static Size comparisonSize() {
+        return Size(800, 400);
+    }
+
+    /*********************************************************
+     * 创建检测结果与标准化结果的对比图到 combined（尺寸不符时重新分配，否则复用）
+     * 两半都直接在目标尺寸上生成：检测图缩放进左半区域，
+     * 标准化面在右半区域按目标尺寸重绘，不再放大一张小图
+     *********************************************************/
+    void createComparisonImage(const Mat& detectionImg,
+        const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName, Mat& combined) const {
+        composeComparison(detectionImg, colorMatrix, colorCodeMap, faceName, combined);
+    }
+
+    template<int N>
+    void createComparisonImage(const Mat& detectionImg,
+        const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName, Mat& combined) const {
+        composeComparison(detectionImg, colorMatrix, colorCodeMap, faceName, combined);
+    }
+
+    /*********************************************************
+     * 创建检测结果与标准化结果的对比图
+     *********************************************************/
+    Mat createComparisonImage(const Mat& detectionImg,
+        const vector<vector<char>>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName) const {
+        Mat combined;
+        createComparisonImage(detectionImg, colorMatrix, colorCodeMap, faceName, combined);
+        return combined;
+    }
+
+    template<int N>
+    Mat createComparisonImage(const Mat& detectionImg,
+        const FaceMatrix<N>& colorMatrix,
+        const map<char, Scalar>& colorCodeMap,
+        const string& faceName) const {
+        Mat combined;
+        createComparisonImage(detectionImg, colorMatrix, colorCodeMap, faceName, combined);
+        return combined;
+    }
+
+private:
+    // 对比图的公共实现，Matrix 为嵌套 vector 或 FaceMatrix<N>
+    template<class Matrix>
+    void composeComparison(const Mat& detectionImg, const Matrix& colorMatrix,
+        const map<char, Scalar>& colorCodeMap, const string& faceName, Mat& combined) const {
+        ScopedStageTimer timer(metrics, STAGE_COMPARISON);
+
+        int targetHeight = comparisonSize().height;
+        int targetWidth = comparisonSize().width / 2;
+
+        // 创建组合图像
+        combined.create(comparisonSize(), CV_8UC3);
+
+        // 将检测图像缩放到左侧（直接写入 ROI）
+        Mat leftROI = combined(Rect(0, 0, targetWidth, targetHeight));
+        resize(detectionImg, leftROI, leftROI.size());
+
+        // 在右侧按目标尺寸绘制标准化面
+        Mat rightROI = combined(Rect(targetWidth, 0, targetWidth, targetHeight));
+        renderStandardFace(rightROI, colorMatrix, colorCodeMap, faceName);
+    }
+};
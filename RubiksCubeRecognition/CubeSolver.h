@@ -0,0 +1,606 @@
+﻿#pragma once
+
+#include "CubeState.h"
+#include "PlatformUtil.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+/*************************************************************
+ * 两阶段（Kociemba）求解器
+ * 阶段1：把魔方转入子群 H = <U, D, R2, L2, F2, B2>
+ *        坐标：角块朝向 twist、棱块朝向 flip、中层棱位置 slice
+ * 阶段2：只用 H 中的转动还原
+ *        坐标：角块排列、上下层棱块排列、中层棱块排列
+ * 转动表和剪枝表只构建一次并写入带版本号的二进制文件，
+ * 之后的运行直接 mmap 该文件；表只读，可被多个线程共享
+ *************************************************************/
+class CubeSolver {
+public:
+    static const uint32_t TABLE_VERSION = 1;
+
+    static const int N_MOVES = 18;     // U U2 U' R R2 R' F F2 F' D D2 D' L L2 L' B B2 B'
+    static const int N_TWIST = 2187;   // 3^7
+    static const int N_FLIP = 2048;    // 2^11
+    static const int N_SLICE = 495;    // C(12,4)
+    static const int N_CPERM = 40320;  // 8!
+    static const int N_EPERM = 40320;  // 8!
+    static const int N_SPERM = 24;     // 4!
+
+    struct Result {
+        bool solved = false;
+        std::vector<int> moves;  // 转动编号（face * 3 + 次数 - 1）
+        int phase1Length = 0;
+        double ms = 0;           // 求解耗时（毫秒）
+        uint64_t nodes = 0;      // 展开的搜索节点数
+
+        std::string text() const {
+            std::string s;
+            for (size_t i = 0; i < moves.size(); i++) {
+                if (i) s += ' ';
+                s += moveName(moves[i]);
+            }
+            return s;
+        }
+    };
+
+private:
+    // 表文件头；各段偏移由 layout() 确定性计算，加载时逐项核对
+    static const int SECTION_COUNT = 10;
+    struct TableFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint64_t totalSize;
+        uint64_t offsets[SECTION_COUNT];
+    };
+
+    enum Section {
+        SEC_TWIST_MOVE, SEC_FLIP_MOVE, SEC_SLICE_MOVE, SEC_CPERM_MOVE, SEC_EPERM_MOVE, SEC_SPERM_MOVE,
+        SEC_PRUNE_TWIST_SLICE, SEC_PRUNE_FLIP_SLICE, SEC_PRUNE_CPERM_SPERM, SEC_PRUNE_EPERM_SPERM
+    };
+
+    const uint16_t* twistMove = nullptr;
+    const uint16_t* flipMove = nullptr;
+    const uint16_t* sliceMove = nullptr;
+    const uint16_t* cpermMove = nullptr;
+    const uint16_t* epermMove = nullptr;
+    const uint16_t* spermMove = nullptr;
+    const uint8_t* pruneTwistSlice = nullptr;
+    const uint8_t* pruneFlipSlice = nullptr;
+    const uint8_t* pruneCpermSperm = nullptr;
+    const uint8_t* pruneEpermSperm = nullptr;
+
+    std::vector<uint8_t> ownedTables; // 新建时表存放在这里
+    MappedFile mapped;                // mmap 的表文件
+
+    bool fromCache = false;
+    double loadMs = 0;
+
+    /*********************************************************
+     * 块层转动与坐标
+     *********************************************************/
+    static CubieCube identity() {
+        CubieCube c;
+        for (int i = 0; i < 8; i++) { c.cp[i] = (uint8_t)i; c.co[i] = 0; }
+        for (int i = 0; i < 12; i++) { c.ep[i] = (uint8_t)i; c.eo[i] = 0; }
+        return c;
+    }
+
+    // a * b：先做 a 再做 b
+    static CubieCube multiply(const CubieCube& a, const CubieCube& b) {
+        CubieCube c;
+        for (int i = 0; i < 8; i++) {
+            c.cp[i] = a.cp[b.cp[i]];
+            c.co[i] = (uint8_t)((a.co[b.cp[i]] + b.co[i]) % 3);
+        }
+        for (int i = 0; i < 12; i++) {
+            c.ep[i] = a.ep[b.ep[i]];
+            c.eo[i] = (uint8_t)((a.eo[b.ep[i]] + b.eo[i]) % 2);
+        }
+        return c;
+    }
+
+    // 六个面的基本转动（顺时针 90 度）
+    static const CubieCube& faceMove(int face) {
+        static const CubieCube moves[6] = {
+            // U
+            { { 3, 0, 1, 2, 4, 5, 6, 7 }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+              { 3, 0, 1, 2, 4, 5, 6, 7, 8, 9, 10, 11 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+            // R
+            { { 4, 1, 2, 0, 7, 5, 6, 3 }, { 2, 0, 0, 1, 1, 0, 0, 2 },
+              { 8, 1, 2, 3, 11, 5, 6, 7, 4, 9, 10, 0 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+            // F
+            { { 1, 5, 2, 3, 0, 4, 6, 7 }, { 1, 2, 0, 0, 2, 1, 0, 0 },
+              { 0, 9, 2, 3, 4, 8, 6, 7, 1, 5, 10, 11 }, { 0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 0 } },
+            // D
+            { { 0, 1, 2, 3, 5, 6, 7, 4 }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+              { 0, 1, 2, 3, 5, 6, 7, 4, 8, 9, 10, 11 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+            // L
+            { { 0, 2, 6, 3, 4, 1, 5, 7 }, { 0, 1, 2, 0, 0, 2, 1, 0 },
+              { 0, 1, 10, 3, 4, 5, 9, 7, 8, 2, 6, 11 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+            // B
+            { { 0, 1, 3, 7, 4, 5, 2, 6 }, { 0, 0, 1, 2, 0, 0, 2, 1 },
+              { 0, 1, 2, 11, 4, 5, 6, 10, 8, 9, 3, 7 }, { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1 } }
+        };
+        return moves[face];
+    }
+
+    static CubieCube applyMove(const CubieCube& c, int move) {
+        CubieCube r = c;
+        for (int k = 0; k <= move % 3; k++) {
+            r = multiply(r, faceMove(move / 3));
+        }
+        return r;
+    }
+
+    static int binomial(int n, int k) {
+        if (k < 0 || k > n) return 0;
+        int r = 1;
+        for (int i = 1; i <= k; i++) {
+            r = r * (n - k + i) / i;
+        }
+        return r;
+    }
+
+    static int permRank(const uint8_t* p, int n) {
+        int rank = 0;
+        for (int i = 0; i < n; i++) {
+            int smaller = 0;
+            for (int j = i + 1; j < n; j++) {
+                if (p[j] < p[i]) smaller++;
+            }
+            rank = rank * (n - i) + smaller;
+        }
+        return rank;
+    }
+
+    static void permUnrank(int rank, uint8_t* p, int n) {
+        int digits[12];
+        for (int i = n - 1; i >= 0; i--) {
+            digits[i] = rank % (n - i);
+            rank /= (n - i);
+        }
+        bool used[12] = {};
+        for (int i = 0; i < n; i++) {
+            int k = digits[i];
+            for (int v = 0; v < n; v++) {
+                if (used[v]) continue;
+                if (k-- == 0) {
+                    p[i] = (uint8_t)v;
+                    used[v] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    static int getTwist(const CubieCube& c) {
+        int t = 0;
+        for (int i = 0; i < 7; i++) t = t * 3 + c.co[i];
+        return t;
+    }
+
+    static void setTwist(CubieCube& c, int t) {
+        int sum = 0;
+        for (int i = 6; i >= 0; i--) {
+            c.co[i] = (uint8_t)(t % 3);
+            sum += c.co[i];
+            t /= 3;
+        }
+        c.co[7] = (uint8_t)((3 - sum % 3) % 3);
+    }
+
+    static int getFlip(const CubieCube& c) {
+        int f = 0;
+        for (int i = 0; i < 11; i++) f = f * 2 + c.eo[i];
+        return f;
+    }
+
+    static void setFlip(CubieCube& c, int f) {
+        int sum = 0;
+        for (int i = 10; i >= 0; i--) {
+            c.eo[i] = (uint8_t)(f & 1);
+            sum += c.eo[i];
+            f >>= 1;
+        }
+        c.eo[11] = (uint8_t)(sum & 1);
+    }
+
+    // 中层棱（编号 8..11）所在位置的组合编号；还原状态为 0
+    static int getSlice(const CubieCube& c) {
+        int x = 0, k = 0;
+        for (int q = 0; q < 12; q++) {
+            if (c.ep[11 - q] >= 8) {
+                k++;
+                x += binomial(q, k);
+            }
+        }
+        return x;
+    }
+
+    static void setSlice(CubieCube& c, int x) {
+        bool slicePos[12] = {};
+        for (int k = 4; k >= 1; k--) {
+            int q = k - 1;
+            while (binomial(q + 1, k) <= x) q++;
+            x -= binomial(q, k);
+            slicePos[11 - q] = true;
+        }
+        int nextSlice = 8, nextOther = 0;
+        for (int i = 0; i < 12; i++) {
+            c.ep[i] = (uint8_t)(slicePos[i] ? nextSlice++ : nextOther++);
+        }
+    }
+
+    static int getCperm(const CubieCube& c) { return permRank(c.cp, 8); }
+    static void setCperm(CubieCube& c, int x) { permUnrank(x, c.cp, 8); }
+
+    static int getEperm(const CubieCube& c) { return permRank(c.ep, 8); }
+    static void setEperm(CubieCube& c, int x) {
+        permUnrank(x, c.ep, 8);
+        for (int i = 8; i < 12; i++) c.ep[i] = (uint8_t)i;
+    }
+
+    static int getSperm(const CubieCube& c) {
+        uint8_t p[4];
+        for (int i = 0; i < 4; i++) p[i] = (uint8_t)(c.ep[8 + i] - 8);
+        return permRank(p, 4);
+    }
+
+    static void setSperm(CubieCube& c, int x) {
+        uint8_t p[4];
+        permUnrank(x, p, 4);
+        for (int i = 0; i < 8; i++) c.ep[i] = (uint8_t)i;
+        for (int i = 0; i < 4; i++) c.ep[8 + i] = (uint8_t)(8 + p[i]);
+    }
+
+    static bool isPhase2Move(int m) {
+        int face = m / 3;
+        return face == 0 || face == 3 || m % 3 == 1;
+    }
+
+    // 同一面不连续转；对面只允许 U 在 D 前、R 在 L 前、F 在 B 前
+    static bool skipMove(int face, int lastFace) {
+        return face == lastFace || face == lastFace - 3;
+    }
+
+    /*********************************************************
+     * 表文件布局
+     *********************************************************/
+    static void layout(uint64_t offsets[SECTION_COUNT], uint64_t& total) {
+        const uint64_t sizes[SECTION_COUNT] = {
+            (uint64_t)N_TWIST * N_MOVES * 2, (uint64_t)N_FLIP * N_MOVES * 2, (uint64_t)N_SLICE * N_MOVES * 2,
+            (uint64_t)N_CPERM * N_MOVES * 2, (uint64_t)N_EPERM * N_MOVES * 2, (uint64_t)N_SPERM * N_MOVES * 2,
+            (uint64_t)N_TWIST * N_SLICE, (uint64_t)N_FLIP * N_SLICE,
+            (uint64_t)N_CPERM * N_SPERM, (uint64_t)N_EPERM * N_SPERM
+        };
+        uint64_t pos = (sizeof(TableFileHeader) + 63) & ~63ull;
+        for (int i = 0; i < SECTION_COUNT; i++) {
+            offsets[i] = pos;
+            pos = (pos + sizes[i] + 63) & ~63ull;
+        }
+        total = pos;
+    }
+
+    void bindTables(const uint8_t* base) {
+        const TableFileHeader* h = (const TableFileHeader*)base;
+        twistMove = (const uint16_t*)(base + h->offsets[SEC_TWIST_MOVE]);
+        flipMove = (const uint16_t*)(base + h->offsets[SEC_FLIP_MOVE]);
+        sliceMove = (const uint16_t*)(base + h->offsets[SEC_SLICE_MOVE]);
+        cpermMove = (const uint16_t*)(base + h->offsets[SEC_CPERM_MOVE]);
+        epermMove = (const uint16_t*)(base + h->offsets[SEC_EPERM_MOVE]);
+        spermMove = (const uint16_t*)(base + h->offsets[SEC_SPERM_MOVE]);
+        pruneTwistSlice = base + h->offsets[SEC_PRUNE_TWIST_SLICE];
+        pruneFlipSlice = base + h->offsets[SEC_PRUNE_FLIP_SLICE];
+        pruneCpermSperm = base + h->offsets[SEC_PRUNE_CPERM_SPERM];
+        pruneEpermSperm = base + h->offsets[SEC_PRUNE_EPERM_SPERM];
+    }
+
+    static bool headerValid(const TableFileHeader* h, uint64_t fileSize) {
+        uint64_t offsets[SECTION_COUNT], total;
+        layout(offsets, total);
+        if (memcmp(h->magic, "RCSOLVE1", 8) != 0) return false;
+        if (h->version != TABLE_VERSION || h->sectionCount != SECTION_COUNT) return false;
+        if (h->totalSize != total || fileSize != total) return false;
+        for (int i = 0; i < SECTION_COUNT; i++) {
+            if (h->offsets[i] != offsets[i]) return false;
+        }
+        return true;
+    }
+
+    /*********************************************************
+     * 构建转动表与剪枝表
+     *********************************************************/
+    template<typename Get, typename Set>
+    static void buildMoveTable(uint16_t* table, int size, bool phase2Only, Get get, Set set) {
+        for (int x = 0; x < size; x++) {
+            CubieCube c = identity();
+            set(c, x);
+            for (int m = 0; m < N_MOVES; m++) {
+                if (phase2Only && !isPhase2Move(m)) {
+                    table[x * N_MOVES + m] = 0;
+                    continue;
+                }
+                table[x * N_MOVES + m] = (uint16_t)get(applyMove(c, m));
+            }
+        }
+    }
+
+    // 按层广度优先填充剪枝表：表项为到目标（下标 0）的最少步数
+    static void buildPruneTable(uint8_t* table, const uint16_t* moveA, int sizeA,
+        const uint16_t* moveB, int sizeB, bool phase2Only) {
+        int total = sizeA * sizeB;
+        memset(table, 0xFF, total);
+        table[0] = 0;
+        int filled = 1;
+        for (uint8_t depth = 0; filled < total; depth++) {
+            int before = filled;
+            for (int i = 0; i < total; i++) {
+                if (table[i] != depth) continue;
+                int a = i / sizeB, b = i % sizeB;
+                for (int m = 0; m < N_MOVES; m++) {
+                    if (phase2Only && !isPhase2Move(m)) continue;
+                    int j = moveA[a * N_MOVES + m] * sizeB + moveB[b * N_MOVES + m];
+                    if (table[j] == 0xFF) {
+                        table[j] = (uint8_t)(depth + 1);
+                        filled++;
+                    }
+                }
+            }
+            if (filled == before) break;
+        }
+    }
+
+    void buildTables() {
+        uint64_t offsets[SECTION_COUNT], total;
+        layout(offsets, total);
+        ownedTables.assign((size_t)total, 0);
+        uint8_t* base = ownedTables.data();
+
+        TableFileHeader* h = (TableFileHeader*)base;
+        memcpy(h->magic, "RCSOLVE1", 8);
+        h->version = TABLE_VERSION;
+        h->sectionCount = SECTION_COUNT;
+        h->totalSize = total;
+        for (int i = 0; i < SECTION_COUNT; i++) h->offsets[i] = offsets[i];
+
+        uint16_t* tw = (uint16_t*)(base + offsets[SEC_TWIST_MOVE]);
+        uint16_t* fl = (uint16_t*)(base + offsets[SEC_FLIP_MOVE]);
+        uint16_t* sl = (uint16_t*)(base + offsets[SEC_SLICE_MOVE]);
+        uint16_t* cp = (uint16_t*)(base + offsets[SEC_CPERM_MOVE]);
+        uint16_t* ep = (uint16_t*)(base + offsets[SEC_EPERM_MOVE]);
+        uint16_t* sp = (uint16_t*)(base + offsets[SEC_SPERM_MOVE]);
+
+        buildMoveTable(tw, N_TWIST, false, getTwist, setTwist);
+        buildMoveTable(fl, N_FLIP, false, getFlip, setFlip);
+        buildMoveTable(sl, N_SLICE, false, getSlice, setSlice);
+        buildMoveTable(cp, N_CPERM, false, getCperm, setCperm);
+        buildMoveTable(ep, N_EPERM, true, getEperm, setEperm);
+        buildMoveTable(sp, N_SPERM, true, getSperm, setSperm);
+
+        buildPruneTable(base + offsets[SEC_PRUNE_TWIST_SLICE], tw, N_TWIST, sl, N_SLICE, false);
+        buildPruneTable(base + offsets[SEC_PRUNE_FLIP_SLICE], fl, N_FLIP, sl, N_SLICE, false);
+        buildPruneTable(base + offsets[SEC_PRUNE_CPERM_SPERM], cp, N_CPERM, sp, N_SPERM, true);
+        buildPruneTable(base + offsets[SEC_PRUNE_EPERM_SPERM], ep, N_EPERM, sp, N_SPERM, true);
+
+        bindTables(base);
+    }
+
+    /*********************************************************
+     * 映射表文件（只读）
+     *********************************************************/
+    bool mapFile(const std::string& path) {
+        if (!mapped.open(path)) return false;
+        if (mapped.size() < sizeof(TableFileHeader) ||
+            !headerValid((const TableFileHeader*)mapped.data(), mapped.size())) {
+            mapped.close();
+            return false;
+        }
+        bindTables(mapped.data());
+        return true;
+    }
+
+    /*********************************************************
+     * 搜索
+     *********************************************************/
+    struct SearchContext {
+        CubieCube start;
+        int moves[32];
+        int maxLength;
+        int length;
+        int phase1Length;
+        uint64_t nodes;
+        uint64_t nodeLimit;
+    };
+
+    int phase1Heuristic(int twist, int flip, int slice) const {
+        return std::max(pruneTwistSlice[twist * N_SLICE + slice], pruneFlipSlice[flip * N_SLICE + slice]);
+    }
+
+    int phase2Heuristic(int cperm, int eperm, int sperm) const {
+        return std::max(pruneCpermSperm[cperm * N_SPERM + sperm], pruneEpermSperm[eperm * N_SPERM + sperm]);
+    }
+
+    bool searchPhase1(SearchContext& ctx, int twist, int flip, int slice, int depth, int togo, int lastFace) const {
+        int h = phase1Heuristic(twist, flip, slice);
+        if (h > togo) return false;
+        if (togo == 0) {
+            return startPhase2(ctx, depth);
+        }
+        // 已在子群 H 中时不再继续阶段1（更短的阶段1已经尝试过）
+        if (h == 0) return false;
+
+        for (int m = 0; m < N_MOVES; m++) {
+            int face = m / 3;
+            if (skipMove(face, lastFace)) continue;
+            if (++ctx.nodes > ctx.nodeLimit) return false;
+
+            ctx.moves[depth] = m;
+            if (searchPhase1(ctx, twistMove[twist * N_MOVES + m], flipMove[flip * N_MOVES + m],
+                sliceMove[slice * N_MOVES + m], depth + 1, togo - 1, face)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool startPhase2(SearchContext& ctx, int depth1) const {
+        CubieCube c = ctx.start;
+        for (int i = 0; i < depth1; i++) {
+            c = applyMove(c, ctx.moves[i]);
+        }
+        int cperm = getCperm(c), eperm = getEperm(c), sperm = getSperm(c);
+        int lastFace = depth1 > 0 ? ctx.moves[depth1 - 1] / 3 : -1;
+
+        int maxDepth2 = std::min(ctx.maxLength - depth1, 18);
+        for (int d2 = phase2Heuristic(cperm, eperm, sperm); d2 <= maxDepth2; d2++) {
+            if (searchPhase2(ctx, cperm, eperm, sperm, depth1, d2, lastFace)) {
+                ctx.phase1Length = depth1;
+                return true;
+            }
+            if (ctx.nodes > ctx.nodeLimit) return false;
+        }
+        return false;
+    }
+
+    bool searchPhase2(SearchContext& ctx, int cperm, int eperm, int sperm, int depth, int togo, int lastFace) const {
+        int h = phase2Heuristic(cperm, eperm, sperm);
+        if (h > togo) return false;
+        if (togo == 0) {
+            if (cperm == 0 && eperm == 0 && sperm == 0) {
+                ctx.length = depth;
+                return true;
+            }
+            return false;
+        }
+
+        for (int m = 0; m < N_MOVES; m++) {
+            if (!isPhase2Move(m)) continue;
+            int face = m / 3;
+            if (skipMove(face, lastFace)) continue;
+            if (++ctx.nodes > ctx.nodeLimit) return false;
+
+            ctx.moves[depth] = m;
+            if (searchPhase2(ctx, cpermMove[cperm * N_MOVES + m], epermMove[eperm * N_MOVES + m],
+                spermMove[sperm * N_MOVES + m], depth + 1, togo - 1, face)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    CubeSolver() {}
+
+    CubeSolver(const CubeSolver&) = delete;
+    CubeSolver& operator=(const CubeSolver&) = delete;
+
+    /*********************************************************
+     * 加载求解表：优先 mmap 缓存文件，文件不存在、版本或大小不符时
+     * 重新构建并写入该文件。返回 false 表示表不可用
+     *********************************************************/
+    bool load(const std::string& path) {
+        auto t0 = std::chrono::steady_clock::now();
+        mapped.close();
+        ownedTables.clear();
+
+        fromCache = mapFile(path);
+        if (!fromCache) {
+            buildTables();
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (out) {
+                out.write((const char*)ownedTables.data(), (std::streamsize)ownedTables.size());
+            }
+        }
+
+        loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return twistMove != nullptr;
+    }
+
+    bool loadedFromCache() const { return fromCache; }
+    double getLoadMs() const { return loadMs; }
+
+    static std::string moveName(int m) {
+        static const char faces[6] = { 'U', 'R', 'F', 'D', 'L', 'B' };
+        static const char* suffix[3] = { "", "2", "'" };
+        return std::string(1, faces[m / 3]) + suffix[m % 3];
+    }
+
+    /*********************************************************
+     * 求解一个魔方：返回总长度不超过 maxLength 的第一个解
+     *********************************************************/
+    Result solve(const CubieCube& cube, int maxLength = 23, uint64_t nodeLimit = 100000000) const {
+        auto t0 = std::chrono::steady_clock::now();
+        Result result;
+        maxLength = std::min(maxLength, 30);
+
+        SearchContext ctx;
+        ctx.start = cube;
+        ctx.nodes = 0;
+        ctx.nodeLimit = nodeLimit;
+        ctx.maxLength = maxLength;
+        ctx.length = 0;
+        ctx.phase1Length = 0;
+
+        int twist = getTwist(cube), flip = getFlip(cube), slice = getSlice(cube);
+        for (int depth1 = 0; depth1 <= maxLength && ctx.nodes <= nodeLimit; depth1++) {
+            if (searchPhase1(ctx, twist, flip, slice, 0, depth1, -1)) {
+                result.solved = true;
+                result.moves.assign(ctx.moves, ctx.moves + ctx.length);
+                result.phase1Length = ctx.phase1Length;
+                break;
+            }
+        }
+
+        result.nodes = ctx.nodes;
+        result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return result;
+    }
+
+    /*********************************************************
+     * 并行求解一批魔方（共享只读表）
+     *********************************************************/
+    std::vector<Result> solveBatch(const std::vector<CubieCube>& cubes, int threads, int maxLength = 23) const {
+        std::vector<Result> results(cubes.size());
+        std::atomic<size_t> next{ 0 };
+        auto worker = [&] {
+            for (size_t i = next++; i < cubes.size(); i = next++) {
+                results[i] = solve(cubes[i], maxLength);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (int t = 1; t < std::max(1, threads); t++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& th : pool) {
+            th.join();
+        }
+        return results;
+    }
+
+    /*********************************************************
+     * 把转动序列作用在块层状态上（用于校验解）
+     *********************************************************/
+    static CubieCube applyMoves(CubieCube c, const std::vector<int>& moves) {
+        for (int m : moves) {
+            c = applyMove(c, m);
+        }
+        return c;
+    }
+
+    static bool isSolved(const CubieCube& c) {
+        CubieCube id = identity();
+        return memcmp(c.cp, id.cp, 8) == 0 && memcmp(c.co, id.co, 8) == 0 &&
+            memcmp(c.ep, id.ep, 12) == 0 && memcmp(c.eo, id.eo, 12) == 0;
+    }
+};
@@ -0,0 +1,387 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "FaceMatrix.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*************************************************************
+ * 块（cubie）层表示：角块/棱块的排列与朝向
+ * 编号沿用 Kociemba 的约定：
+ *   角块 URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB
+ *   棱块 UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR
+ *************************************************************/
+struct CubieCube {
+    uint8_t cp[8];   // 角块排列
+    uint8_t co[8];   // 角块朝向（0..2）
+    uint8_t ep[12];  // 棱块排列
+    uint8_t eo[12];  // 棱块朝向（0..1）
+};
+
+/*************************************************************
+ * 魔方状态：54 个色面，每个 3 位，定长、无堆分配，可哈希、可比较
+ * 色面顺序为标准 URFDLB：U1..U9, R1..R9, F1..F9, D1..D9, L1..L9, B1..B9，
+ * 每面按展开图中的行优先顺序（与 drawCubeNet 的布局一致）。
+ * 色面取值为颜色阈值表的下标（0..5），UNKNOWN 表示未识别。
+ *************************************************************/
+class CubeState {
+public:
+    static const int FACELETS = 54;
+    static const uint8_t UNKNOWN = 7;
+
+    // 校验结果
+    enum Validation {
+        VALID,
+        INCOMPLETE,       // 存在未识别的色面
+        BAD_COLOR_COUNT,  // 某种颜色不是恰好 9 个
+        BAD_CENTERS,      // 六个中心块颜色不互异
+        BAD_CORNERS,      // 角块颜色组合不存在或重复
+        BAD_EDGES,        // 棱块颜色组合不存在或重复
+        CORNER_TWIST,     // 角块朝向和不为 0 (mod 3)
+        EDGE_FLIP,        // 棱块朝向和不为 0 (mod 2)
+        PARITY            // 角块与棱块排列奇偶性不一致
+    };
+
+private:
+    // 每个字存 21 个色面（63 位），第三个字只用 12 个，其余字段保持 UNKNOWN
+    static const int PER_WORD = 21;
+    static const uint64_t LOW_BITS = 0x1249249249249249ull; // 每个 3 位字段的最低位
+
+    uint64_t words[3];
+
+    static int popcount64(uint64_t x) {
+#ifdef _MSC_VER
+        return (int)__popcnt64(x);
+#else
+        return __builtin_popcountll(x);
+#endif
+    }
+
+    // 一个字中等于 color 的字段数（SWAR：异或后判断 3 位字段是否全零）
+    static int countInWord(uint64_t w, uint8_t color) {
+        uint64_t x = w ^ (LOW_BITS * color);
+        uint64_t nonZero = (x | (x >> 1) | (x >> 2)) & LOW_BITS;
+        return PER_WORD - popcount64(nonZero);
+    }
+
+    // 角块/棱块所在的色面下标与各位置的标准颜色（以面编号 U=0 R=1 F=2 D=3 L=4 B=5 表示）
+    static const uint8_t (&cornerFacelet())[8][3] {
+        static const uint8_t table[8][3] = {
+            { 8,  9, 20 }, { 6, 18, 38 }, { 0, 36, 47 }, { 2, 45, 11 },
+            { 29, 26, 15 }, { 27, 44, 24 }, { 33, 53, 42 }, { 35, 17, 51 }
+        };
+        return table;
+    }
+
+    static const uint8_t (&edgeFacelet())[12][2] {
+        static const uint8_t table[12][2] = {
+            { 5, 10 }, { 7, 19 }, { 3, 37 }, { 1, 46 }, { 32, 16 }, { 28, 25 },
+            { 30, 43 }, { 34, 52 }, { 23, 12 }, { 21, 41 }, { 50, 39 }, { 48, 14 }
+        };
+        return table;
+    }
+
+    static const uint8_t (&cornerColor())[8][3] {
+        static const uint8_t table[8][3] = {
+            { 0, 1, 2 }, { 0, 2, 4 }, { 0, 4, 5 }, { 0, 5, 1 },
+            { 3, 2, 1 }, { 3, 4, 2 }, { 3, 5, 4 }, { 3, 1, 5 }
+        };
+        return table;
+    }
+
+    static const uint8_t (&edgeColor())[12][2] {
+        static const uint8_t table[12][2] = {
+            { 0, 1 }, { 0, 2 }, { 0, 4 }, { 0, 5 }, { 3, 1 }, { 3, 2 },
+            { 3, 4 }, { 3, 5 }, { 2, 1 }, { 2, 4 }, { 5, 4 }, { 5, 1 }
+        };
+        return table;
+    }
+
+    static int permutationParity(const uint8_t* p, int n) {
+        int inversions = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (p[i] > p[j]) inversions++;
+            }
+        }
+        return inversions & 1;
+    }
+
+public:
+    CubeState() {
+        words[0] = words[1] = words[2] = LOW_BITS * UNKNOWN;
+    }
+
+    uint8_t get(int i) const {
+        return (uint8_t)((words[i / PER_WORD] >> (3 * (i % PER_WORD))) & 7);
+    }
+
+    void set(int i, uint8_t color) {
+        int shift = 3 * (i % PER_WORD);
+        uint64_t& w = words[i / PER_WORD];
+        w = (w & ~(7ull << shift)) | ((uint64_t)(color & 7) << shift);
+    }
+
+    /*********************************************************
+     * 由六个面的颜色矩阵构建（矩阵按输入顺序 Front, Back, Left, Right, Up, Down）
+     * colorCodes[i] 为颜色阈值表第 i 项的颜色代码，例如 "RYGBWP"
+     *********************************************************/
+    static CubeState fromMatrices(const std::vector<std::vector<std::vector<char>>>& matrices,
+        const std::string& colorCodes) {
+        // URFDLB 中每个面在输入顺序中的下标
+        static const int inputFace[6] = { 4, 3, 0, 5, 2, 1 };
+
+        CubeState state;
+        for (int face = 0; face < 6; face++) {
+            int idx = inputFace[face];
+            if (idx >= (int)matrices.size()) continue;
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++) {
+                    size_t code = colorCodes.find(matrices[idx][r][c]);
+                    if (code != std::string::npos) {
+                        state.set(face * 9 + r * 3 + c, (uint8_t)code);
+                    }
+                }
+            }
+        }
+        return state;
+    }
+
+    static CubeState fromMatrices(const CubeMatrices<3>& matrices, const std::string& colorCodes) {
+        static const int inputFace[6] = { 4, 3, 0, 5, 2, 1 };
+
+        CubeState state;
+        for (int face = 0; face < 6; face++) {
+            const FaceMatrix<3>& matrix = matrices[inputFace[face]];
+            for (int i = 0; i < 9; i++) {
+                size_t code = colorCodes.find(matrix.cells[i]);
+                if (code != std::string::npos) {
+                    state.set(face * 9 + i, (uint8_t)code);
+                }
+            }
+        }
+        return state;
+    }
+
+    /*********************************************************
+     * 由块层表示构建（toCubie 的逆），colorOfFace[f] 为 URFDLB 第 f 面
+     * 中心块的颜色下标
+     *********************************************************/
+    static CubeState fromCubie(const CubieCube& cube, const uint8_t colorOfFace[6]) {
+        const auto& cf = cornerFacelet();
+        const auto& cc = cornerColor();
+        const auto& ef = edgeFacelet();
+        const auto& ec = edgeColor();
+
+        CubeState state;
+        for (int face = 0; face < 6; face++) {
+            state.set(face * 9 + 4, colorOfFace[face]);
+        }
+        for (int i = 0; i < 8; i++) {
+            for (int k = 0; k < 3; k++) {
+                state.set(cf[i][(k + cube.co[i]) % 3], colorOfFace[cc[cube.cp[i]][k]]);
+            }
+        }
+        for (int i = 0; i < 12; i++) {
+            for (int k = 0; k < 2; k++) {
+                state.set(ef[i][(k + cube.eo[i]) % 2], colorOfFace[ec[cube.ep[i]][k]]);
+            }
+        }
+        return state;
+    }
+
+    /*********************************************************
+     * 导出为六个面的颜色矩阵（fromMatrices 的逆，输入顺序
+     * Front, Back, Left, Right, Up, Down），未识别的色面为 ' '
+     *********************************************************/
+    void toMatrices(std::vector<std::vector<std::vector<char>>>& matrices, const std::string& colorCodes) const {
+        static const int inputFace[6] = { 4, 3, 0, 5, 2, 1 };
+
+        matrices.assign(6, std::vector<std::vector<char>>(3, std::vector<char>(3, ' ')));
+        for (int face = 0; face < 6; face++) {
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++) {
+                    uint8_t color = get(face * 9 + r * 3 + c);
+                    if (color < colorCodes.size()) matrices[inputFace[face]][r][c] = colorCodes[color];
+                }
+            }
+        }
+    }
+
+    void toMatrices(CubeMatrices<3>& matrices, const std::string& colorCodes) const {
+        static const int inputFace[6] = { 4, 3, 0, 5, 2, 1 };
+
+        for (int face = 0; face < 6; face++) {
+            FaceMatrix<3>& matrix = matrices[inputFace[face]];
+            matrix.clear();
+            for (int i = 0; i < 9; i++) {
+                uint8_t color = get(face * 9 + i);
+                if (color < colorCodes.size()) matrix.cells[i] = colorCodes[color];
+            }
+        }
+    }
+
+    // 某种颜色的色面数
+    int countColor(uint8_t color) const {
+        return countInWord(words[0], color) + countInWord(words[1], color) +
+            countInWord(words[2], color) - (color == UNKNOWN ? PER_WORD - 12 : 0);
+    }
+
+    /*********************************************************
+     * 转为块层表示；中心块颜色不互异或角/棱颜色组合非法时返回对应错误
+     *********************************************************/
+    Validation toCubie(CubieCube& cube) const {
+        // 颜色 -> 面编号（由中心块决定）
+        uint8_t faceOf[8];
+        for (auto& f : faceOf) f = 0xFF;
+        for (int face = 0; face < 6; face++) {
+            uint8_t center = get(face * 9 + 4);
+            if (center == UNKNOWN || faceOf[center] != 0xFF) return BAD_CENTERS;
+            faceOf[center] = (uint8_t)face;
+        }
+
+        uint8_t f[FACELETS];
+        for (int i = 0; i < FACELETS; i++) {
+            f[i] = faceOf[get(i)];
+            if (f[i] == 0xFF) return INCOMPLETE;
+        }
+
+        const auto& cf = cornerFacelet();
+        const auto& cc = cornerColor();
+        int seenCorners = 0;
+        for (int i = 0; i < 8; i++) {
+            int ori = 0;
+            while (ori < 3 && f[cf[i][ori]] != 0 && f[cf[i][ori]] != 3) ori++;
+            if (ori == 3) return BAD_CORNERS;
+
+            uint8_t col1 = f[cf[i][(ori + 1) % 3]];
+            uint8_t col2 = f[cf[i][(ori + 2) % 3]];
+            int j = 0;
+            while (j < 8 && !(cc[j][0] == f[cf[i][ori]] && cc[j][1] == col1 && cc[j][2] == col2)) j++;
+            if (j == 8 || (seenCorners & (1 << j))) return BAD_CORNERS;
+
+            seenCorners |= 1 << j;
+            cube.cp[i] = (uint8_t)j;
+            cube.co[i] = (uint8_t)ori;
+        }
+
+        const auto& ef = edgeFacelet();
+        const auto& ec = edgeColor();
+        int seenEdges = 0;
+        for (int i = 0; i < 12; i++) {
+            uint8_t a = f[ef[i][0]];
+            uint8_t b = f[ef[i][1]];
+            int j = 0;
+            int ori = -1;
+            for (; j < 12; j++) {
+                if (a == ec[j][0] && b == ec[j][1]) { ori = 0; break; }
+                if (a == ec[j][1] && b == ec[j][0]) { ori = 1; break; }
+            }
+            if (ori < 0 || (seenEdges & (1 << j))) return BAD_EDGES;
+
+            seenEdges |= 1 << j;
+            cube.ep[i] = (uint8_t)j;
+            cube.eo[i] = (uint8_t)ori;
+        }
+        return VALID;
+    }
+
+    /*********************************************************
+     * 完整校验：每色 9 个、中心互异、角/棱合法、朝向与排列奇偶可达
+     *********************************************************/
+    Validation validate() const {
+        if (countColor(UNKNOWN) > 0) return INCOMPLETE;
+        for (uint8_t color = 0; color < 6; color++) {
+            if (countColor(color) != 9) return BAD_COLOR_COUNT;
+        }
+
+        CubieCube cube;
+        Validation v = toCubie(cube);
+        if (v != VALID) return v;
+
+        int twist = 0, flip = 0;
+        for (int i = 0; i < 8; i++) twist += cube.co[i];
+        for (int i = 0; i < 12; i++) flip += cube.eo[i];
+        if (twist % 3 != 0) return CORNER_TWIST;
+        if (flip % 2 != 0) return EDGE_FLIP;
+        if (permutationParity(cube.cp, 8) != permutationParity(cube.ep, 12)) return PARITY;
+        return VALID;
+    }
+
+    static const char* validationMessage(Validation v) {
+        switch (v) {
+        case VALID:           return "合法";
+        case INCOMPLETE:      return "存在未识别的色面";
+        case BAD_COLOR_COUNT: return "颜色数量不是每种9个";
+        case BAD_CENTERS:     return "中心块颜色重复";
+        case BAD_CORNERS:     return "角块颜色组合非法";
+        case BAD_EDGES:       return "棱块颜色组合非法";
+        case CORNER_TWIST:    return "角块朝向不可达";
+        case EDGE_FLIP:       return "棱块朝向不可达";
+        case PARITY:          return "排列奇偶性不可达";
+        }
+        return "";
+    }
+
+    /*********************************************************
+     * 导出标准 URFDLB 色面字符串（按中心块把颜色映射为面字母），
+     * 无法映射的色面输出 '?'
+     *********************************************************/
+    std::string toFaceletString() const {
+        static const char faceLetters[6] = { 'U', 'R', 'F', 'D', 'L', 'B' };
+
+        char letterOf[8];
+        for (auto& l : letterOf) l = '?';
+        for (int face = 0; face < 6; face++) {
+            uint8_t center = get(face * 9 + 4);
+            if (center != UNKNOWN) letterOf[center] = faceLetters[face];
+        }
+
+        std::string s(FACELETS, '?');
+        for (int i = 0; i < FACELETS; i++) {
+            s[i] = letterOf[get(i)];
+        }
+        return s;
+    }
+
+    size_t hash() const {
+        // splitmix64 混合三个字
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (uint64_t w : words) {
+            uint64_t z = (h ^ w) + 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            h = z ^ (z >> 31);
+        }
+        return (size_t)h;
+    }
+
+    bool operator==(const CubeState& o) const {
+        return words[0] == o.words[0] && words[1] == o.words[1] && words[2] == o.words[2];
+    }
+
+    bool operator!=(const CubeState& o) const {
+        return !(*this == o);
+    }
+
+    bool operator<(const CubeState& o) const {
+        if (words[0] != o.words[0]) return words[0] < o.words[0];
+        if (words[1] != o.words[1]) return words[1] < o.words[1];
+        return words[2] < o.words[2];
+    }
+};
+
+namespace std {
+    template<> struct hash<CubeState> {
+        size_t operator()(const CubeState& s) const {
+            return s.hash();
+        }
+    };
+}
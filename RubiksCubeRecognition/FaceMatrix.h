@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+/*************************************************************
+ * N x N 颜色矩阵：定长数组按行存放颜色代码，未识别的格子为空格。
+ * 大小在编译期确定，填充与遍历都不分配堆内存。
+ * 不依赖 OpenCV 与分析器：识别库的调用方（只包含 RubiksCubeApi.h）
+ * 也用它保存 rcr_face_result::colors
+ *************************************************************/
+template<int N>
+struct FaceMatrix {
+    static constexpr int SIZE = N;
+    static constexpr int CELLS = N * N;
+    char cells[CELLS];
+
+    FaceMatrix() {
+        clear();
+    }
+
+    void clear() {
+        std::fill(cells, cells + CELLS, ' ');
+    }
+
+    // 由按行存放的 N * N 个颜色代码填充
+    void assign(const char* codes) {
+        std::memcpy(cells, codes, CELLS);
+    }
+
+    char& at(int row, int col) { return cells[row * N + col]; }
+    char at(int row, int col) const { return cells[row * N + col]; }
+
+    bool operator==(const FaceMatrix& other) const {
+        return std::memcmp(cells, other.cells, CELLS) == 0;
+    }
+    bool operator!=(const FaceMatrix& other) const {
+        return !(*this == other);
+    }
+
+    // 转成嵌套 vector（与只接受嵌套 vector 的旧接口互通）
+    std::vector<std::vector<char>> toVector() const {
+        std::vector<std::vector<char>> rows(N);
+        for (int r = 0; r < N; r++) {
+            rows[r].assign(cells + r * N, cells + (r + 1) * N);
+        }
+        return rows;
+    }
+};
+
+// 一个魔方六个面的颜色矩阵（输入顺序）
+template<int N>
+using CubeMatrices = std::array<FaceMatrix<N>, 6>;
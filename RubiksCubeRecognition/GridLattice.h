@@ -0,0 +1,356 @@
+﻿#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+/*************************************************************
+ * N x N 网格拟合结果：格子中心 = origin + col * colStep + row * rowStep
+ * colStep 大致向右、rowStep 大致向下（图像坐标），行列下标均为 0..N-1
+ *************************************************************/
+template<int N>
+struct LatticeFitN {
+    static_assert(N >= 2 && N <= 7, "网格边长须在 2..7 之间");
+    static constexpr int SIZE = N;
+    static constexpr int CELLS = N * N;
+    static constexpr int MAX_POINTS = N * N + 23;  // 3x3 时为 32：余量容纳离群点与分裂的色块
+    static constexpr int MIN_CELLS = N + 1;        // 拟合成功所需的最少有点格子数（3x3 时为 4）
+
+    bool ok = false;
+    float origin[2] = { 0, 0 };   // 第 0 行第 0 列格子中心
+    float colStep[2] = { 0, 0 };  // 列方向基向量
+    float rowStep[2] = { 0, 0 };  // 行方向基向量
+    int cellOf[MAX_POINTS];       // 每个输入点的格子下标（row * N + col），-1 为离群点
+    int pointOfCell[CELLS];       // 每个格子对应的输入点，-1 为缺失
+    int matched = 0;              // 有输入点的格子数
+    int outliers = 0;             // 未分到格子的输入点数（含同一格子里多余的点）
+    float rms = 0;                // 已分配点到格子中心的残差均方根（以格距为单位）
+    float confidence = 0;         // 0..1，综合格子覆盖率、残差与网格形状
+    double us = 0;                // 拟合耗时（微秒）
+
+    // 格子中心坐标
+    void cellCenter(int row, int col, float& x, float& y) const {
+        x = origin[0] + col * colStep[0] + row * rowStep[0];
+        y = origin[1] + col * colStep[1] + row * rowStep[1];
+    }
+
+    // 格距：两个基向量张成的平行四边形面积的平方根
+    float pitch() const {
+        return std::sqrt(std::fabs(colStep[0] * rowStep[1] - colStep[1] * rowStep[0]));
+    }
+};
+
+/*************************************************************
+ * 网格拟合：把任意数量（3x3 时通常 5..20 个）的色块中心拟合到一个 N x N 格子，
+ * 允许缺格、离群点（背景或相邻面的色块）和一格里分裂出的多个色块，
+ * 且不要求魔方面与图像坐标轴对齐
+ *
+ * 1) 假设：任取两点，把它们的差（或差的一半，即隔一格）当作一个基向量，
+ *    另一个基向量取它的垂直向量（小透视下网格近似正方形）；
+ *    在包含第一个点的 N x N 窗口中选覆盖格子最多的一个
+ * 2) 精化：用最优假设的格子下标做仿射最小二乘（原点 + 两个基向量，
+ *    吸收透视造成的缩放与错切），再重新分配，共两轮
+ * 3) 规范化方向：最接近向右的轴为列方向，另一轴取向下为行方向
+ *
+ * N 为编译期常量：所有缓冲都是定长数组，循环上界是常量，可由编译器完全展开
+ *************************************************************/
+template<int N>
+class LatticeFitterN {
+public:
+    typedef LatticeFitN<N> Fit;
+
+private:
+    static constexpr int CELLS = N * N;
+    static constexpr int RANGE = N - 1;           // 假设网格中第一个点所在窗口的偏移范围
+    static constexpr int SIDE = RANGE + N;        // 搜索范围边长：3x3 时为 5x5
+    static constexpr float INLIER_TOLERANCE = 0.3f;  // 到格子中心的残差上限（格距的比例）
+
+    struct Lattice {
+        float o[2], u[2], v[2];  // 原点与两个基向量（格子下标 (i, j) 处为 o + i*u + j*v）
+    };
+
+    // 把点换算到网格坐标（基向量构成的仿射坐标系）
+    static bool toLattice(const Lattice& L, const float* p, float& s, float& t) {
+        float det = L.u[0] * L.v[1] - L.u[1] * L.v[0];
+        if (std::fabs(det) < 1e-6f) return false;
+        float qx = p[0] - L.o[0], qy = p[1] - L.o[1];
+        s = (qx * L.v[1] - qy * L.v[0]) / det;
+        t = (L.u[0] * qy - L.u[1] * qx) / det;
+        return true;
+    }
+
+    /*********************************************************
+     * 按网格分配点：每个点取最近的格子（下标 -range..N-1），残差超限为离群；
+     * 同一格子多个点时保留残差最小的。在包含格子 (0, 0) 的 N x N 窗口中
+     * 选覆盖最多的一个，返回其格子数，窗口左上角下标写入 i0/j0
+     * （range 为 0 时窗口固定为 0..N-1）
+     *********************************************************/
+    static int assign(const Lattice& L, const float (*points)[2], int n, int range,
+        int cellOf[], int pointOfCell[], float& residualSum, int& i0, int& j0) {
+        const int side = range + N;    // range = N - 1 时为 SIDE x SIDE
+        int best[SIDE * SIDE];
+        float bestRes[SIDE * SIDE];
+        std::fill(best, best + side * side, -1);
+
+        float pitch = std::sqrt(std::fabs(L.u[0] * L.v[1] - L.u[1] * L.v[0]));
+        for (int k = 0; k < n; k++) {
+            cellOf[k] = -1;
+            float s, t;
+            if (!toLattice(L, points[k], s, t)) continue;
+            int i = (int)std::lround(s), j = (int)std::lround(t);
+            if (i < -range || i > N - 1 || j < -range || j > N - 1) continue;
+
+            float dx = points[k][0] - (L.o[0] + i * L.u[0] + j * L.v[0]);
+            float dy = points[k][1] - (L.o[1] + i * L.u[1] + j * L.v[1]);
+            float res = std::sqrt(dx * dx + dy * dy) / pitch;
+            if (res > INLIER_TOLERANCE) continue;
+
+            int cell = (j + range) * side + (i + range);
+            if (best[cell] < 0 || res < bestRes[cell]) {
+                best[cell] = k;
+                bestRes[cell] = res;
+            }
+        }
+
+        // 选覆盖格子最多的 N x N 窗口；相同时（N 为奇数）优先中心格有点的窗口（中心块总在），
+        // 再取残差和较小者
+        int bestCount = 0;
+        bool bestCenter = false;
+        float bestSum = 0;
+        i0 = j0 = 0;
+        for (int wj = -range; wj <= 0; wj++) {
+            for (int wi = -range; wi <= 0; wi++) {
+                int count = 0;
+                float sum = 0;
+                for (int j = wj; j < wj + N; j++) {
+                    for (int i = wi; i < wi + N; i++) {
+                        int cell = (j + range) * side + (i + range);
+                        if (best[cell] >= 0) {
+                            count++;
+                            sum += bestRes[cell];
+                        }
+                    }
+                }
+                bool center = N % 2 == 1 && best[(wj + N / 2 + range) * side + (wi + N / 2 + range)] >= 0;
+                if (count > bestCount || (count == bestCount && count > 0
+                    && (center > bestCenter || (center == bestCenter && sum < bestSum)))) {
+                    bestCount = count;
+                    bestCenter = center;
+                    bestSum = sum;
+                    i0 = wi;
+                    j0 = wj;
+                }
+            }
+        }
+
+        residualSum = 0;
+        std::fill(pointOfCell, pointOfCell + CELLS, -1);
+        for (int j = 0; j < N; j++) {
+            for (int i = 0; i < N; i++) {
+                int cell = (j + j0 + range) * side + (i + i0 + range);
+                if (best[cell] < 0) continue;
+                pointOfCell[j * N + i] = best[cell];
+                cellOf[best[cell]] = j * N + i;
+                residualSum += bestRes[cell] * bestRes[cell];
+            }
+        }
+        return bestCount;
+    }
+
+    /*********************************************************
+     * 仿射最小二乘：p = o + i*u + j*v，x、y 分别解 3x3 正规方程。
+     * 已分配的点共线（只有一行或一列）时无法确定，返回 false
+     *********************************************************/
+    static bool refine(const float (*points)[2], const int pointOfCell[CELLS], Lattice& L) {
+        double A[3][3] = {}, bx[3] = {}, by[3] = {};
+        for (int cell = 0; cell < CELLS; cell++) {
+            int k = pointOfCell[cell];
+            if (k < 0) continue;
+            double f[3] = { 1.0, (double)(cell % N), (double)(cell / N) };
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++) A[a][b] += f[a] * f[b];
+                bx[a] += f[a] * points[k][0];
+                by[a] += f[a] * points[k][1];
+            }
+        }
+
+        // 克拉默法则
+        auto det3 = [](const double M[3][3]) {
+            return M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+                - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+                + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0]);
+        };
+        double d = det3(A);
+        if (std::fabs(d) < 1e-9) return false;
+
+        double sx[3], sy[3];
+        for (int c = 0; c < 3; c++) {
+            double Mx[3][3], My[3][3];
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++) {
+                    Mx[a][b] = b == c ? bx[a] : A[a][b];
+                    My[a][b] = b == c ? by[a] : A[a][b];
+                }
+            }
+            sx[c] = det3(Mx) / d;
+            sy[c] = det3(My) / d;
+        }
+        L = { { (float)sx[0], (float)sy[0] }, { (float)sx[1], (float)sy[1] }, { (float)sx[2], (float)sy[2] } };
+        return true;
+    }
+
+    // 形状因子：两个基向量长度比与夹角偏离正方形过多时降低置信度
+    static float shapeFactor(const Lattice& L) {
+        float lu = std::hypot(L.u[0], L.u[1]), lv = std::hypot(L.v[0], L.v[1]);
+        if (lu <= 0 || lv <= 0) return 0;
+        float aspect = std::min(lu, lv) / std::max(lu, lv);
+        float skew = std::fabs(L.u[0] * L.v[0] + L.u[1] * L.v[1]) / (lu * lv);
+        float a = std::min(1.0f, std::max(0.0f, (aspect - 0.5f) / 0.3f));  // 0.8 以上不扣分
+        float s = std::min(1.0f, std::max(0.0f, (0.5f - skew) / 0.3f));    // 夹角 78° 以上不扣分
+        return a * s;
+    }
+
+public:
+    /*********************************************************
+     * 拟合 N x N 网格
+     * points：色块中心（最多 MAX_POINTS 个，多余的忽略）
+     * sizes：色块边长的估计（如面积的平方根），用来限定格距范围
+     * 至少 MIN_CELLS（N + 1）个格子有点、且不全在一条线上才算成功：
+     * 多于一行或一列的点数，单行单列的点无法确定另一个方向的格距
+     *********************************************************/
+    static Fit fit(const float (*points)[2], const float* sizes, int n) {
+        auto t0 = std::chrono::steady_clock::now();
+        Fit result;
+        n = std::min(n, Fit::MAX_POINTS);
+        std::fill(result.cellOf, result.cellOf + Fit::MAX_POINTS, -1);
+        std::fill(result.pointOfCell, result.pointOfCell + CELLS, -1);
+
+        if (n >= 3) {
+            // 格距范围：色块边长中位数的 0.8 ~ 2.5 倍（色块之间有缝隙）
+            float sorted[Fit::MAX_POINTS];
+            std::copy(sizes, sizes + n, sorted);
+            std::nth_element(sorted, sorted + n / 2, sorted + n);
+            float side = sorted[n / 2];
+            float minPitch = 0.8f * side, maxPitch = 2.5f * side;
+
+            Lattice best = {};
+            int bestCount = 0;
+            float bestSum = 0;
+            int cellOf[Fit::MAX_POINTS], pointOfCell[CELLS];
+            for (int a = 0; a < n; a++) {
+                for (int b = a + 1; b < n; b++) {
+                    for (int step = 1; step <= 2; step++) {
+                        float ux = (points[b][0] - points[a][0]) / step;
+                        float uy = (points[b][1] - points[a][1]) / step;
+                        float len = std::hypot(ux, uy);
+                        if (len < minPitch || len > maxPitch) continue;
+
+                        Lattice L = { { points[a][0], points[a][1] }, { ux, uy }, { -uy, ux } };
+                        float sum;
+                        int i0, j0;
+                        int count = assign(L, points, n, RANGE, cellOf, pointOfCell, sum, i0, j0);
+                        if (count > bestCount || (count == bestCount && count > 0 && sum < bestSum)) {
+                            bestCount = count;
+                            bestSum = sum;
+                            best = L;
+                            // 原点移到窗口左上角的格子
+                            best.o[0] += i0 * ux + j0 * -uy;
+                            best.o[1] += i0 * uy + j0 * ux;
+                        }
+                    }
+                }
+            }
+
+            if (bestCount >= Fit::MIN_CELLS) {
+                float sum = 0;
+                int count = 0, i0, j0;
+                for (int round = 0; round < 2; round++) {
+                    count = assign(best, points, n, 0, result.cellOf, result.pointOfCell, sum, i0, j0);
+                    Lattice refined = best;
+                    if (!refine(points, result.pointOfCell, refined)) break;  // 点共线时保留假设网格
+                    best = refined;
+                }
+                count = assign(best, points, n, 0, result.cellOf, result.pointOfCell, sum, i0, j0);
+
+                if (count >= Fit::MIN_CELLS) {
+                    result.ok = true;
+                    result.matched = count;
+                    result.rms = std::sqrt(sum / count);
+                    result.confidence = (float)count / CELLS * std::exp(-(result.rms / 0.15f) * (result.rms / 0.15f))
+                        * shapeFactor(best);
+                    canonicalize(best, result);
+                }
+            }
+        }
+
+        if (!result.ok) {
+            std::fill(result.cellOf, result.cellOf + Fit::MAX_POINTS, -1);
+            std::fill(result.pointOfCell, result.pointOfCell + CELLS, -1);
+        }
+        for (int k = 0; k < n; k++) {
+            if (result.cellOf[k] < 0) result.outliers++;
+        }
+        result.us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        return result;
+    }
+
+private:
+    /*********************************************************
+     * 规范化方向：四个候选轴 ±u、±v 中最接近向右的作列方向，
+     * 另一轴取 y 分量为正的方向作行方向，格子下标随之变换
+     *********************************************************/
+    static void canonicalize(const Lattice& L, Fit& result) {
+        const float* axes[2] = { L.u, L.v };
+        int colAxis = 0, colSign = 1;
+        float bestX = -2;
+        for (int a = 0; a < 2; a++) {
+            float len = std::hypot(axes[a][0], axes[a][1]);
+            for (int sign = -1; sign <= 1; sign += 2) {
+                float x = sign * axes[a][0] / len;
+                if (x > bestX) {
+                    bestX = x;
+                    colAxis = a;
+                    colSign = sign;
+                }
+            }
+        }
+        int rowAxis = 1 - colAxis;
+        int rowSign = axes[rowAxis][1] >= 0 ? 1 : -1;
+
+        // 拟合坐标 (i, j) -> 规范坐标 (col, row)
+        auto mapCell = [&](int cell) {
+            int ij[2] = { cell % N, cell / N };
+            int col = colSign > 0 ? ij[colAxis] : N - 1 - ij[colAxis];
+            int row = rowSign > 0 ? ij[rowAxis] : N - 1 - ij[rowAxis];
+            return row * N + col;
+        };
+
+        int pointOfCell[CELLS];
+        std::fill(pointOfCell, pointOfCell + CELLS, -1);
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (result.pointOfCell[cell] >= 0) pointOfCell[mapCell(cell)] = result.pointOfCell[cell];
+        }
+        std::copy(pointOfCell, pointOfCell + CELLS, result.pointOfCell);
+        for (int k = 0; k < Fit::MAX_POINTS; k++) {
+            if (result.cellOf[k] >= 0) result.cellOf[k] = mapCell(result.cellOf[k]);
+        }
+
+        for (int c = 0; c < 2; c++) {
+            result.colStep[c] = colSign * axes[colAxis][c];
+            result.rowStep[c] = rowSign * axes[rowAxis][c];
+        }
+        // 新原点：原拟合坐标下规范格子 (0, 0) 所在位置
+        int i = 0, j = 0;
+        int ij[2];
+        ij[colAxis] = colSign > 0 ? 0 : N - 1;
+        ij[rowAxis] = rowSign > 0 ? 0 : N - 1;
+        i = ij[0];
+        j = ij[1];
+        result.origin[0] = L.o[0] + i * L.u[0] + j * L.v[0];
+        result.origin[1] = L.o[1] + i * L.u[1] + j * L.v[1];
+    }
+};
+
+// 标准三阶魔方
+typedef LatticeFitN<3> LatticeFit;
+typedef LatticeFitterN<3> LatticeFitter;
@@ -0,0 +1,254 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "PlatformUtil.h"
+
+using namespace std;
+using namespace cv;
+
+/*************************************************************
+ * 图像加载、内容摘要与输出约定：识别程序自己的文件 I/O，
+ * 不依赖分析器（只通过 RubiksCubeApi.h 调用识别库的程序也用它）
+ *************************************************************/
+
+// 输入图像顺序对应的面名称
+const vector<string> faceNames = { "Front", "Back", "Left", "Right", "Up", "Down" };
+
+// 输出级别：每一级只做它需要的绘制工作
+enum OutputLevel {
+    OUTPUT_NONE,      // 不输出图像，也不逐个打印颜色代码
+    OUTPUT_CODES,     // 只输出颜色代码
+    OUTPUT_STANDARD,  // 颜色代码 + 标准化面与展开图
+    OUTPUT_FULL       // 另加检测叠加图与对比图
+};
+
+// 解析输出级别名称（none/codes/standard/full），无法识别时返回 false
+inline bool parseOutputLevel(const string& name, OutputLevel& level) {
+    static const char* names[] = { "none", "codes", "standard", "full" };
+    for (int i = 0; i < 4; i++) {
+        if (name == names[i]) {
+            level = (OutputLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*************************************************************
+ * 64 位内容摘要（XXH64 算法，按小端读取）：
+ * 用作结果缓存的键，每 32 字节四路并行累加，速度远高于图像解码
+ *************************************************************/
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+    static const uint64_t P1 = 11400714785074694791ull, P2 = 14029467366897019727ull,
+        P3 = 1609587929392839161ull, P4 = 9650029242287828579ull, P5 = 2870177450012600261ull;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto lane = [&](uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; };
+    auto read64 = [](const uchar* p) { uint64_t v; memcpy(&v, p, 8); return v; };
+
+    const uchar* p = (const uchar*)data;
+    const uchar* end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+        for (; p + 32 <= end; p += 32) {
+            for (int i = 0; i < 4; i++) v[i] = lane(v[i], read64(p + 8 * i));
+        }
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        for (int i = 0; i < 4; i++) h = (h ^ lane(0, v[i])) * P1 + P4;
+    }
+    else {
+        h = seed + P5;
+    }
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ lane(0, read64(p)), 27) * P1 + P4;
+    if (p + 4 <= end) {
+        uint32_t k;
+        memcpy(&k, p, 4);
+        h = rotl(h ^ (uint64_t)k * P1, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotl(h ^ (uint64_t)*p * P5, 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*************************************************************
+ * 单张图像的加载统计
+ *************************************************************/
+struct LoadStats {
+    double decodeMs = 0;     // 映射 + 解码耗时（毫秒）
+    int reduce = 1;          // 解码时的缩小倍数（1/2/4/8）
+    Size fullSize;           // 文件头中的原图尺寸（未知时为 0x0）
+    size_t decodedBytes = 0; // 解码结果本身占用的字节数（这张图独占的内存）
+    size_t peakRssBytes = 0; // 解码完成后的进程峰值常驻内存
+};
+
+/*************************************************************
+ * 图像加载类
+ * 文件先内存映射，再由 imdecode 直接从映射区解码（无中间拷贝）；
+ * JPEG 可在解码时按 1/2、1/4、1/8 缩小（IMREAD_REDUCED_COLOR_*）
+ *************************************************************/
+class ImageLoader {
+private:
+    bool verbose; // 是否打印加载信息（批处理模式下关闭）
+    int reduce = 1; // 解码缩小倍数：1/2/4/8，0 表示按色块尺寸自动选择
+
+    // 自动选择时，最小色块（面积 = minStickerFraction * 图像面积）缩小后的边长下限
+    int targetStickerPx = 40;
+    double minStickerFraction = 15000.0 / (1024 * 1024);
+
+    static uint32_t readBigEndian(const uchar* p, int bytes) {
+        uint32_t v = 0;
+        for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+        return v;
+    }
+
+public:
+    ImageLoader(bool verbose = true) : verbose(verbose) {}
+
+    /*********************************************************
+     * 设置解码缩小倍数（1/2/4/8，0 = 自动）
+     *********************************************************/
+    void setReduce(int factor) {
+        reduce = (factor == 0 || factor == 2 || factor == 4 || factor == 8) ? factor : 1;
+    }
+
+    int getReduce() const {
+        return reduce;
+    }
+
+    /*********************************************************
+     * 设置自动选择的依据：最小色块的面积比例与缩小后的目标边长
+     *********************************************************/
+    void setStickerTarget(int minSidePx, double minAreaFraction) {
+        targetStickerPx = minSidePx;
+        minStickerFraction = minAreaFraction;
+    }
+
+    /*********************************************************
+     * 只解析文件头得到图像尺寸（支持 JPEG 与 PNG），失败返回 false
+     *********************************************************/
+    static bool readImageSize(const uchar* data, size_t size, int& width, int& height) {
+        // PNG：签名 8 字节后紧跟 IHDR
+        static const uchar pngSig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        if (size >= 24 && memcmp(data, pngSig, 8) == 0) {
+            width = (int)readBigEndian(data + 16, 4);
+            height = (int)readBigEndian(data + 20, 4);
+            return true;
+        }
+
+        // JPEG：逐段扫描到 SOF 段（C0..CF，除 C4/C8/CC）
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+        size_t pos = 2;
+        while (pos + 9 < size) {
+            if (data[pos] != 0xFF) return false;
+            uchar marker = data[pos + 1];
+            if (marker == 0xFF) { pos++; continue; }
+            if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { pos += 2; continue; }
+
+            size_t segment = readBigEndian(data + pos + 2, 2);
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                height = (int)readBigEndian(data + pos + 5, 2);
+                width = (int)readBigEndian(data + pos + 7, 2);
+                return true;
+            }
+            pos += 2 + segment;
+        }
+        return false;
+    }
+
+    /*********************************************************
+     * 按原图尺寸选择缩小倍数：最小色块缩小后边长不低于目标值
+     *********************************************************/
+    int chooseReduce(int width, int height) const {
+        if (reduce != 0) return reduce;
+        if (width <= 0 || height <= 0) return 1;
+
+        double minSticker = sqrt(minStickerFraction * width * height);
+        for (int factor = 8; factor > 1; factor /= 2) {
+            if (minSticker / factor >= targetStickerPx) return factor;
+        }
+        return 1;
+    }
+
+    /*********************************************************
+     * 从内存中的编码数据解码（数据由调用方持有，不做拷贝）
+     *********************************************************/
+    Mat decodeBuffer(const uchar* data, size_t size, LoadStats* stats = nullptr) const {
+        int64 t0 = getTickCount();
+
+        int width = 0, height = 0;
+        bool known = readImageSize(data, size, width, height);
+        int factor = chooseReduce(width, height);
+
+        static const int flags[4] = { IMREAD_COLOR, IMREAD_REDUCED_COLOR_2, IMREAD_REDUCED_COLOR_4, IMREAD_REDUCED_COLOR_8 };
+        int flag = flags[factor == 8 ? 3 : factor == 4 ? 2 : factor == 2 ? 1 : 0];
+
+        // 直接包装外部缓冲区的 Mat 头
+        Mat encoded(1, (int)size, CV_8U, const_cast<uchar*>(data));
+        Mat img = imdecode(encoded, flag);
+
+        if (stats) {
+            stats->decodeMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+            stats->reduce = factor;
+            stats->fullSize = known ? Size(width, height) : Size();
+            stats->decodedBytes = img.total() * img.elemSize();
+            stats->peakRssBytes = peakRssBytes();
+        }
+        return img;
+    }
+
+    // 加载图像（无内部状态，可在多个线程中同时调用）
+    Mat loadImage(const string& filename, LoadStats* stats = nullptr) const {
+        MappedFile file;
+        file.open(filename);
+        return loadImage(filename, file, stats);
+    }
+
+    // 解码调用方已映射的文件（调用方先用映射的字节查结果缓存，未命中才解码）；
+    // file 未打开时按加载失败处理
+    Mat loadImage(const string& filename, const MappedFile& file, LoadStats* stats = nullptr) const {
+        LoadStats local;
+        LoadStats& st = stats ? *stats : local;
+        int64 t0 = getTickCount();
+
+        Mat img;
+        if (file.isOpen()) {
+            img = decodeBuffer(file.data(), file.size(), &st);
+            st.decodeMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+        }
+
+        if (img.empty()) {
+            cout << "无法加载图像：" << filename << endl;
+        }
+        else if (verbose) {
+            cout << "成功加载图像：" << filename << "（" << img.cols << "x" << img.rows;
+            if (st.reduce > 1) cout << "，解码缩小 1/" << st.reduce;
+            cout << "，解码 " << st.decodeMs << " ms，峰值内存 " << st.peakRssBytes / (1024 * 1024) << " MB）" << endl;
+        }
+        return img;
+    }
+};
+
+/*************************************************************
+ * 计算百分位数（最近秩法）
+ *************************************************************/
+inline double percentile(vector<double> values, double p) {
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    size_t rank = (size_t)ceil(p / 100.0 * values.size());
+    return values[min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
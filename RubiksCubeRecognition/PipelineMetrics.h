@@ -0,0 +1,212 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+
+/*************************************************************
+ * 流水线指标：阶段耗时直方图 + 计数器
+ * 全部为定长数组上的 relaxed 原子操作，热路径上不加锁、不分配内存，
+ * 多个线程可共享同一个实例
+ *************************************************************/
+enum MetricStage {
+    STAGE_CLASSIFY,       // 缩放 + 查表分类 + 形态学
+    STAGE_EXTRACT,        // 逐色轮廓提取与色块计算（含 STAGE_OVERLAY）
+    STAGE_OVERLAY,        // 检测图上的虚线轮廓与标签
+    STAGE_GRID,           // assignToGrid
+    STAGE_STANDARD_FACE,  // drawStandardFace
+    STAGE_CUBE_NET,       // drawCubeNet
+    STAGE_COMPARISON,     // createComparisonImage
+    STAGE_COUNT
+};
+
+class PipelineMetrics {
+public:
+    static const int MAX_COLORS = 8;
+    static const int BUCKET_COUNT = 13; // 最后一个桶为 +Inf
+
+private:
+    struct StageHistogram {
+        std::atomic<uint64_t> buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> sumNs{ 0 };
+
+        StageHistogram() {
+            for (auto& b : buckets) b.store(0);
+        }
+    };
+
+    StageHistogram stages[STAGE_COUNT];
+    std::atomic<uint64_t> colorHits[MAX_COLORS];
+    std::atomic<uint64_t> contoursRejected{ 0 };
+    std::atomic<uint64_t> facesTotal{ 0 };
+    std::atomic<uint64_t> facesBadBlockCount{ 0 };
+    std::atomic<uint64_t> cubesTotal{ 0 };
+    std::atomic<uint64_t> cubesBadColorTotals{ 0 };
+    std::vector<std::string> colorNames;
+
+    // 直方图桶上界（纳秒）：0.1ms ~ 1s
+    static const uint64_t* bucketBoundsNs() {
+        static const uint64_t bounds[BUCKET_COUNT - 1] = {
+            100000, 500000, 1000000, 2000000, 5000000, 10000000, 20000000,
+            50000000, 100000000, 200000000, 500000000, 1000000000
+        };
+        return bounds;
+    }
+
+    static const char* stageName(int stage) {
+        static const char* names[STAGE_COUNT] = {
+            "classify", "extract", "overlay", "grid", "standard_face", "cube_net", "comparison"
+        };
+        return names[stage];
+    }
+
+public:
+    explicit PipelineMetrics(const std::vector<std::string>& colorNames) : colorNames(colorNames) {
+        if (this->colorNames.size() > MAX_COLORS) this->colorNames.resize(MAX_COLORS);
+        for (auto& c : colorHits) c.store(0);
+    }
+
+    /*********************************************************
+     * 记录接口（热路径）
+     *********************************************************/
+    void observe(MetricStage stage, uint64_t ns) {
+        StageHistogram& h = stages[stage];
+        const uint64_t* bounds = bucketBoundsNs();
+        int b = 0;
+        while (b < BUCKET_COUNT - 1 && ns > bounds[b]) b++;
+        h.buckets[b].fetch_add(1, std::memory_order_relaxed);
+        h.count.fetch_add(1, std::memory_order_relaxed);
+        h.sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void addColorHit(size_t colorIndex) {
+        if (colorIndex < MAX_COLORS) colorHits[colorIndex].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void addRejectedContour() {
+        contoursRejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordFace(size_t blockCount) {
+        facesTotal.fetch_add(1, std::memory_order_relaxed);
+        if (blockCount != 9) facesBadBlockCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordCube(bool colorTotalsOk) {
+        cubesTotal.fetch_add(1, std::memory_order_relaxed);
+        if (!colorTotalsOk) cubesBadColorTotals.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*********************************************************
+     * 导出为 Prometheus 文本格式
+     *********************************************************/
+    std::string toPrometheus() const {
+        std::ostringstream out;
+        out << std::setprecision(9);
+
+        out << "# HELP rubiks_stage_duration_seconds Pipeline stage wall time (extract includes overlay).\n";
+        out << "# TYPE rubiks_stage_duration_seconds histogram\n";
+        const uint64_t* bounds = bucketBoundsNs();
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            uint64_t cumulative = 0;
+            for (int b = 0; b < BUCKET_COUNT; b++) {
+                cumulative += stages[s].buckets[b].load(std::memory_order_relaxed);
+                out << "rubiks_stage_duration_seconds_bucket{stage=\"" << stageName(s) << "\",le=\"";
+                if (b < BUCKET_COUNT - 1) out << bounds[b] / 1e9;
+                else out << "+Inf";
+                out << "\"} " << cumulative << "\n";
+            }
+            out << "rubiks_stage_duration_seconds_sum{stage=\"" << stageName(s) << "\"} "
+                << stages[s].sumNs.load(std::memory_order_relaxed) / 1e9 << "\n";
+            out << "rubiks_stage_duration_seconds_count{stage=\"" << stageName(s) << "\"} "
+                << stages[s].count.load(std::memory_order_relaxed) << "\n";
+        }
+
+        out << "# HELP rubiks_contours_rejected_total Contours rejected by the area filter.\n";
+        out << "# TYPE rubiks_contours_rejected_total counter\n";
+        out << "rubiks_contours_rejected_total " << contoursRejected.load() << "\n";
+
+        out << "# HELP rubiks_faces_total Faces analyzed.\n";
+        out << "# TYPE rubiks_faces_total counter\n";
+        out << "rubiks_faces_total " << facesTotal.load() << "\n";
+
+        out << "# HELP rubiks_faces_bad_block_count_total Faces whose block count was not 9.\n";
+        out << "# TYPE rubiks_faces_bad_block_count_total counter\n";
+        out << "rubiks_faces_bad_block_count_total " << facesBadBlockCount.load() << "\n";
+
+        out << "# HELP rubiks_color_hits_total Accepted blocks per color.\n";
+        out << "# TYPE rubiks_color_hits_total counter\n";
+        for (size_t i = 0; i < colorNames.size(); i++) {
+            out << "rubiks_color_hits_total{color=\"" << colorNames[i] << "\"} " << colorHits[i].load() << "\n";
+        }
+
+        out << "# HELP rubiks_cubes_total Cubes checked for color totals.\n";
+        out << "# TYPE rubiks_cubes_total counter\n";
+        out << "rubiks_cubes_total " << cubesTotal.load() << "\n";
+
+        out << "# HELP rubiks_cubes_bad_color_totals_total Cubes where some color did not appear exactly 9 times.\n";
+        out << "# TYPE rubiks_cubes_bad_color_totals_total counter\n";
+        out << "rubiks_cubes_bad_color_totals_total " << cubesBadColorTotals.load() << "\n";
+
+        return out.str();
+    }
+
+    /*********************************************************
+     * 导出为一行 JSON（追加写入即为 JSON lines）
+     *********************************************************/
+    std::string toJsonLine() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(4);
+
+        long long ts = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        out << "{\"ts_ms\":" << ts
+            << ",\"faces_total\":" << facesTotal.load()
+            << ",\"faces_bad_block_count\":" << facesBadBlockCount.load()
+            << ",\"contours_rejected\":" << contoursRejected.load()
+            << ",\"cubes_total\":" << cubesTotal.load()
+            << ",\"cubes_bad_color_totals\":" << cubesBadColorTotals.load()
+            << ",\"color_hits\":{";
+        for (size_t i = 0; i < colorNames.size(); i++) {
+            out << (i ? "," : "") << "\"" << colorNames[i] << "\":" << colorHits[i].load();
+        }
+        out << "},\"stages\":{";
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            out << (s ? "," : "") << "\"" << stageName(s) << "\":{\"count\":"
+                << stages[s].count.load() << ",\"sum_ms\":" << stages[s].sumNs.load() / 1e6 << "}";
+        }
+        out << "}}";
+        return out.str();
+    }
+};
+
+/*************************************************************
+ * 作用域计时器：metrics 为空时不计时
+ *************************************************************/
+class ScopedStageTimer {
+private:
+    PipelineMetrics* metrics;
+    MetricStage stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedStageTimer(PipelineMetrics* metrics, MetricStage stage) : metrics(metrics), stage(stage) {
+        if (metrics) start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedStageTimer() {
+        if (metrics) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            metrics->observe(stage, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+};
@@ -0,0 +1,344 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*************************************************************
+ * 只读内存映射文件（POSIX mmap / Windows MapViewOfFile）
+ * 映射在对象析构或 close() 时释放，不可复制
+ *************************************************************/
+class MappedFile {
+private:
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#endif
+
+public:
+    MappedFile() {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 映射整个文件；文件不存在、为空或映射失败时返回 false
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappingHandle) {
+            close();
+            return false;
+        }
+        base = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        length = (size_t)size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base = (const uint8_t*)p;
+        length = (size_t)st.st_size;
+#endif
+        if (!base) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap(const_cast<uint8_t*>(base), length);
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    bool isOpen() const { return base != nullptr; }
+};
+
+/*************************************************************
+ * 进程峰值常驻内存（字节），取不到时返回 0
+ *************************************************************/
+inline size_t peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return (size_t)pmc.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;         // macOS 以字节为单位
+#else
+    return (size_t)usage.ru_maxrss * 1024;  // Linux 以 KB 为单位
+#endif
+#endif
+}
+
+/*************************************************************
+ * 本地流套接字（AF_UNIX；Windows 10 起同样支持），阻塞读写
+ * 用于识别服务与客户端之间的通信；可移动、不可复制
+ *************************************************************/
+class LocalSocket {
+public:
+#ifdef _WIN32
+    typedef SOCKET Handle;
+    static constexpr Handle INVALID = INVALID_SOCKET;
+#else
+    typedef int Handle;
+    static constexpr Handle INVALID = -1;
+#endif
+
+private:
+    Handle fd = INVALID;
+
+    explicit LocalSocket(Handle h) : fd(h) {}
+
+    // Windows 需要先初始化 Winsock（进程内只做一次）
+    static bool startup() {
+#ifdef _WIN32
+        static bool ok = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+    static bool makeAddress(const std::string& path, sockaddr_un& addr) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+        memcpy(addr.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+public:
+    LocalSocket() {}
+
+    ~LocalSocket() {
+        close();
+    }
+
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    LocalSocket(LocalSocket&& other) noexcept : fd(other.fd) {
+        other.fd = INVALID;
+    }
+
+    LocalSocket& operator=(LocalSocket&& other) noexcept {
+        if (this != &other) {
+            close();
+            fd = other.fd;
+            other.fd = INVALID;
+        }
+        return *this;
+    }
+
+    // 在 path 上监听（先删除残留的套接字文件）
+    bool listen(const std::string& path, int backlog = 64) {
+        close();
+        sockaddr_un addr;
+        if (!startup() || !makeAddress(path, addr)) return false;
+        removeFile(path);
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == INVALID) return false;
+        if (::bind(fd, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, backlog) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool connect(const std::string& path) {
+        close();
+        sockaddr_un addr;
+        if (!startup() || !makeAddress(path, addr)) return false;
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == INVALID) return false;
+        if (::connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // 最多等待 timeoutMs 接受一个连接；超时或出错返回 false
+    bool accept(LocalSocket& client, int timeoutMs) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(fd, &readSet);
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        if (::select((int)fd + 1, &readSet, nullptr, nullptr, &tv) <= 0) return false;
+
+        Handle h = ::accept(fd, nullptr, nullptr);
+        if (h == INVALID) return false;
+        client = LocalSocket(h);
+        return true;
+    }
+
+    // 读满 n 个字节；对端关闭或出错时返回 false
+    bool readAll(void* buffer, size_t n) {
+        char* p = (char*)buffer;
+        while (n > 0) {
+            int chunk = (int)(n < (1u << 30) ? n : (1u << 30));
+            auto got = ::recv(fd, p, chunk, 0);
+            if (got <= 0) return false;
+            p += got;
+            n -= (size_t)got;
+        }
+        return true;
+    }
+
+    bool writeAll(const void* buffer, size_t n) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL; // 对端已关闭时不产生 SIGPIPE
+#else
+        const int flags = 0;
+#endif
+        const char* p = (const char*)buffer;
+        while (n > 0) {
+            int chunk = (int)(n < (1u << 30) ? n : (1u << 30));
+            auto sent = ::send(fd, p, chunk, flags);
+            if (sent <= 0) return false;
+            p += sent;
+            n -= (size_t)sent;
+        }
+        return true;
+    }
+
+    // 关闭读写方向，使阻塞在 recv 上的线程返回
+    void shutdown() {
+        if (fd == INVALID) return;
+#ifdef _WIN32
+        ::shutdown(fd, SD_BOTH);
+#else
+        ::shutdown(fd, SHUT_RDWR);
+#endif
+    }
+
+    // 只关闭读方向：阻塞在读上的线程返回，写方向仍可发出已在处理的响应
+    void shutdownRead() {
+        if (fd == INVALID) return;
+#ifdef _WIN32
+        ::shutdown(fd, SD_RECEIVE);
+#else
+        ::shutdown(fd, SHUT_RD);
+#endif
+    }
+
+    void close() {
+        if (fd == INVALID) return;
+#ifdef _WIN32
+        ::closesocket(fd);
+#else
+        ::close(fd);
+#endif
+        fd = INVALID;
+    }
+
+    bool isOpen() const { return fd != INVALID; }
+
+    static void removeFile(const std::string& path) {
+#ifdef _WIN32
+        DeleteFileA(path.c_str());
+#else
+        ::unlink(path.c_str());
+#endif
+    }
+};
+
+/*************************************************************
+ * 运行命令行并读取其标准输出（POSIX popen / Windows _popen），
+ * 返回进程的退出码，无法启动时返回 -1
+ *************************************************************/
+inline int runCommand(const std::string& command, std::string& output) {
+    output.clear();
+#ifdef _WIN32
+    // cmd /c 会去掉整行最外层的一对引号，多包一层以保留程序路径的引号
+    FILE* pipe = _popen(("\"" + command + "\"").c_str(), "r");
+#else
+    FILE* pipe = popen(command.c_str(), "r");
+#endif
+    if (!pipe) return -1;
+
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+#ifdef _WIN32
+    return _pclose(pipe);
+#else
+    int status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
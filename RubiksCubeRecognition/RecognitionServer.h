@@ -0,0 +1,380 @@
+﻿#pragma once
+
+#include "ImageIO.h"
+#include "CubeState.h"
+#include "ServerProtocol.h"
+#include "../RubiksCubeLib/RubiksCubeApi.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <atomic>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+/*************************************************************
+ * 有界队列：满时 tryPush 立即失败（由调用方回复“忙”，形成背压），
+ * pop 阻塞到有元素或队列关闭且为空
+ *************************************************************/
+template<typename T>
+class BoundedQueue {
+private:
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    mutex queueMutex;
+    condition_variable notEmpty;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    bool tryPush(T&& item) {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            if (closed || items.size() >= capacity) return false;
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+    // 关闭后不再接受新元素，已有元素仍可取出
+    void close() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+    }
+
+    size_t size() {
+        lock_guard<mutex> lock(queueMutex);
+        return items.size();
+    }
+};
+
+/*************************************************************
+ * 延迟直方图：对数分桶（每个二倍程 16 个桶，相对误差约 4%），
+ * 内存固定，常驻服务的统计不随请求数增长。分位数取所在桶的上界
+ *************************************************************/
+class LatencyHistogram {
+private:
+    static const int SUB_BUCKETS = 16;
+    static const int BUCKETS = 32 * SUB_BUCKETS; // 1 微秒到约 71 分钟
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    double maxMs = 0;
+
+    static int bucketOf(double ms) {
+        double us = max(1.0, ms * 1000.0);
+        return min((int)(log2(us) * SUB_BUCKETS), BUCKETS - 1);
+    }
+
+public:
+    void record(double ms) {
+        counts[bucketOf(ms)]++;
+        total++;
+        maxMs = max(maxMs, ms);
+    }
+
+    uint64_t count() const { return total; }
+
+    double percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(p / 100.0 * total));
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) return min(exp2((b + 1) / (double)SUB_BUCKETS) / 1000.0, maxMs);
+        }
+        return maxMs;
+    }
+};
+
+struct ServerOptions {
+    string socketPath = "rubiks.sock"; // 监听的本地套接字路径
+    int workers = 0;                   // 工作线程数，0 = 全部硬件线程
+    int queueCapacity = 64;            // 等待处理的请求上限，超出时回复 busy
+    int maxConnections = 64;           // 同时保持的连接上限，超出时新连接立即关闭
+    bool logRequests = true;           // 是否逐个请求打印延迟
+};
+
+/*************************************************************
+ * 常驻识别服务：识别库句柄（查找表）与解码器只初始化一次，
+ * 每个连接一个读线程把请求放入有界队列，固定数量的工作线程
+ * 解码六张图、一次 rcr_analyze_batch 识别六个面，并把结果以紧凑 JSON 写回该连接。
+ * 连接数有上限，每个读线程最多缓存一个请求（见 ServerProtocol 的大小限制），
+ * 所以服务的内存上限约为 (连接数 + 队列容量) x MAX_REQUEST_BYTES
+ *************************************************************/
+class RecognitionServer {
+private:
+    // 一个客户端连接：读线程独占读方向，写方向由各工作线程加锁共享
+    struct Connection {
+        LocalSocket socket;
+        mutex writeMutex;
+        int id = 0;
+
+        bool send(const ServerProtocol::Response& response) {
+            lock_guard<mutex> lock(writeMutex);
+            return ServerProtocol::writeResponse(socket, response);
+        }
+    };
+
+    struct Session {
+        shared_ptr<Connection> connection;
+        thread reader;
+        atomic<bool> done{ false };
+    };
+
+    struct Job {
+        shared_ptr<Connection> connection;
+        ServerProtocol::Request request;
+        int64 receivedTicks = 0;
+    };
+
+    rcr_analyzer* library;
+    const ImageLoader& loader;
+    ServerOptions options;
+    BoundedQueue<Job> queue;
+
+    mutex logMutex;
+    LatencyHistogram latencies;     // 已完成请求的总延迟（毫秒）
+    atomic<int> served{ 0 };
+    atomic<int> rejected{ 0 };      // 队列满被拒绝
+    int refusedConnections = 0;     // 超过连接上限被关闭的连接
+    atomic<int> failed{ 0 };        // 格式或解码错误
+
+    static double elapsedMs(int64 from) {
+        return (getTickCount() - from) * 1000.0 / getTickFrequency();
+    }
+
+    /*********************************************************
+     * 读线程：逐个读取请求放入队列；队列满时直接回复 busy
+     *********************************************************/
+    void readLoop(Session& session) {
+        shared_ptr<Connection> conn = session.connection;
+        for (;;) {
+            Job job;
+            if (!ServerProtocol::readRequest(conn->socket, job.request)) break;
+            job.receivedTicks = getTickCount();
+            job.connection = conn;
+
+            uint32_t id = job.request.id;
+            if (!queue.tryPush(std::move(job))) {
+                rejected++;
+                ServerProtocol::Response busy;
+                busy.id = id;
+                busy.status = ServerProtocol::STATUS_BUSY;
+                busy.body = "{\"id\":" + to_string(id) + ",\"status\":\"busy\"}";
+                if (!conn->send(busy)) break;
+            }
+        }
+        session.done = true;
+    }
+
+    /*********************************************************
+     * 工作线程：颜色矩阵在该线程处理的所有请求之间复用，
+     * 帧上下文由识别库的句柄在各次调用之间复用
+     *********************************************************/
+    void workLoop() {
+        vector<Mat> images(ServerProtocol::FACES);
+        rcr_image views[ServerProtocol::FACES];
+        rcr_face_result results[ServerProtocol::FACES];
+        CubeMatrices<3> matrices;
+        string colorCodes = rcr_color_codes(library);
+
+        Job job;
+        while (queue.pop(job)) {
+            double queueMs = elapsedMs(job.receivedTicks);
+            int64 start = getTickCount();
+
+            ServerProtocol::Response response;
+            response.id = job.request.id;
+            int blockCounts[6] = { 0 };
+            float confidence[6] = { 0 };
+            if (job.request.images.size() != ServerProtocol::FACES) {
+                response.status = ServerProtocol::STATUS_BAD_REQUEST;
+            }
+            else {
+                for (int f = 0; f < 6; f++) {
+                    const vector<uint8_t>& data = job.request.images[f];
+                    Mat& img = images[f];
+                    try {
+                        img = data.empty() ? Mat() : loader.decodeBuffer(data.data(), data.size());
+                    }
+                    catch (const cv::Exception&) {
+                        img.release();
+                    }
+                    if (img.empty()) {
+                        response.status = ServerProtocol::STATUS_DECODE_ERROR;
+                        break;
+                    }
+                    views[f] = { img.data, img.cols, img.rows, (int64_t)img.step };
+                }
+            }
+            if (response.status == ServerProtocol::STATUS_OK) {
+                int code = rcr_analyze_batch(library, ServerProtocol::FACES, views, sizeof(rcr_image),
+                    results, sizeof(rcr_face_result), nullptr, 0);
+                if (code != RCR_OK) {
+                    response.status = ServerProtocol::STATUS_INTERNAL_ERROR;
+                }
+                for (int f = 0; f < 6 && code == RCR_OK; f++) {
+                    matrices[f].assign(results[f].colors);
+                    blockCounts[f] = results[f].block_count;
+                    confidence[f] = results[f].grid_confidence;
+                }
+            }
+            for (Mat& img : images) img.release();
+            double processMs = elapsedMs(start);
+
+            // 正文：{"id":..,"status":"ok","faces":[...],"blocks":[...],"confidence":[...],"state":"..","valid":..,
+            //       "queue_ms":..,"process_ms":..}
+            ostringstream body;
+            body << fixed << setprecision(3);
+            body << "{\"id\":" << response.id << ",\"status\":\"" << ServerProtocol::statusName(response.status) << "\"";
+            bool valid = false;
+            if (response.status == ServerProtocol::STATUS_OK) {
+                body << ",\"faces\":[";
+                for (int f = 0; f < 6; f++) {
+                    body << (f ? ",\"" : "\"");
+                    for (char color : matrices[f].cells) body << (color == ' ' ? '.' : color);
+                    body << "\"";
+                }
+                body << "],\"blocks\":[";
+                for (int f = 0; f < 6; f++) body << (f ? "," : "") << blockCounts[f];
+                body << "],\"confidence\":[";
+                for (int f = 0; f < 6; f++) body << (f ? "," : "") << confidence[f];
+                CubeState state = CubeState::fromMatrices(matrices, colorCodes);
+                valid = state.validate() == CubeState::VALID;
+                body << "],\"state\":\"" << state.toFaceletString() << "\",\"valid\":" << (valid ? "true" : "false");
+            }
+            body << ",\"queue_ms\":" << queueMs << ",\"process_ms\":" << processMs << "}";
+            response.body = body.str();
+
+            bool sent = job.connection->send(response);
+            double totalMs = elapsedMs(job.receivedTicks);
+            if (response.status == ServerProtocol::STATUS_OK) served++;
+            else failed++;
+
+            {
+                lock_guard<mutex> lock(logMutex);
+                latencies.record(totalMs);
+                if (options.logRequests) {
+                    cout << fixed << setprecision(2) << "请求 #" << job.connection->id << "/" << response.id
+                        << "：" << ServerProtocol::statusName(response.status)
+                        << (response.status == ServerProtocol::STATUS_OK ? (valid ? "，合法" : "，不合法") : "")
+                        << "，排队 " << queueMs << " ms，处理 " << processMs << " ms，总计 " << totalMs << " ms"
+                        << (sent ? "" : "（连接已断开）") << endl;
+                }
+            }
+            job = Job();
+        }
+    }
+
+    // 回收读线程已退出的连接（排队中的请求仍持有连接，写完响应后释放）
+    static void reapSessions(list<unique_ptr<Session>>& sessions) {
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            if ((*it)->done) {
+                (*it)->reader.join();
+                it = sessions.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+public:
+    // library 在服务运行期间须保持有效；各工作线程共用同一句柄
+    RecognitionServer(rcr_analyzer* library, const ImageLoader& loader, const ServerOptions& options)
+        : library(library), loader(loader), options(options), queue((size_t)max(1, options.queueCapacity)) {}
+
+    /*********************************************************
+     * 运行服务直到 stop 变为真：停止接受连接，关闭各连接的读方向并等读线程退出，
+     * 处理完已入队的请求、发出响应后再关闭连接。监听失败返回 false
+     *********************************************************/
+    bool run(const atomic<bool>& stop) {
+        LocalSocket listener;
+        if (!listener.listen(options.socketPath)) {
+            cerr << "错误：无法监听 " << options.socketPath << endl;
+            return false;
+        }
+
+        int workerCount = options.workers > 0 ? options.workers : (int)max(1u, thread::hardware_concurrency());
+        vector<thread> workers;
+        for (int i = 0; i < workerCount; i++) {
+            workers.emplace_back([this] { workLoop(); });
+        }
+        size_t maxConnections = (size_t)max(1, options.maxConnections);
+        cout << "识别服务：监听 " << options.socketPath << "，" << workerCount << " 个工作线程，队列上限 "
+            << options.queueCapacity << "，连接上限 " << maxConnections << endl;
+
+        int64 start = getTickCount();
+        list<unique_ptr<Session>> sessions;
+        int nextId = 1;
+        while (!stop) {
+            LocalSocket client;
+            if (listener.accept(client, 200)) {
+                // 先回收已断开的连接，再按上限决定是否接纳
+                reapSessions(sessions);
+                if (sessions.size() >= maxConnections) {
+                    refusedConnections++;
+                    client.close();
+                }
+                else {
+                    auto session = make_unique<Session>();
+                    session->connection = make_shared<Connection>();
+                    session->connection->socket = std::move(client);
+                    session->connection->id = nextId++;
+                    Session* s = session.get();
+                    session->reader = thread([this, s] { readLoop(*s); });
+                    sessions.push_back(std::move(session));
+                }
+            }
+            reapSessions(sessions);
+        }
+
+        // 停止顺序：不再读新请求 -> 读线程退出 -> 队列关闭 -> 工作线程处理完已入队请求并写回 -> 关闭连接
+        listener.close();
+        LocalSocket::removeFile(options.socketPath);
+        for (auto& session : sessions) {
+            session->connection->socket.shutdownRead();
+        }
+        for (auto& session : sessions) {
+            session->reader.join();
+        }
+        queue.close();
+        for (auto& w : workers) {
+            w.join();
+        }
+        for (auto& session : sessions) {
+            session->connection->socket.shutdown();
+            session->connection->socket.close();
+        }
+
+        double wallMs = elapsedMs(start);
+        cout << "\n============== 服务统计 ==============\n";
+        cout << fixed << setprecision(2);
+        cout << "完成: " << served << "，拒绝(busy): " << rejected << "，错误: " << failed
+            << "，超过连接上限: " << refusedConnections << endl;
+        if (latencies.count() > 0) {
+            cout << "请求延迟: p50 " << latencies.percentile(50) << " ms, p99 " << latencies.percentile(99)
+                << " ms, 最大 " << latencies.percentile(100) << " ms" << endl;
+            cout << "吞吐量: " << served * 1000.0 / wallMs << " 个魔方/秒" << endl;
+        }
+        return true;
+    }
+};
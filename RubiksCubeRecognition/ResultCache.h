@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include "ImageIO.h"
+#include "../RubiksCubeLib/RubiksCubeApi.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+/*************************************************************
+ * 按内容寻址的识别结果缓存（磁盘持久化）
+ * 键 = 编码后图像字节的摘要 + 分析器与解码设置的摘要，
+ * 值 = 识别库给出的 rcr_face_result 原样（含状态、色块数与九个格子，
+ * 网格拟合失败的面也一样缓存，命中时与重新分析得到的结果逐字节相同）。
+ * 每个条目一个文件：<目录>/<设置摘要>/<内容摘要>.bin，设置改变后自然失效。
+ * 写入先写临时文件再改名，读者（其他线程或进程）只会看到完整的条目；
+ * 读取用只读内存映射，校验不通过的条目按未命中处理，随后被重新写入。
+ * 条目不做淘汰：每条几百字节，但每个文件至少占一个文件系统块
+ * （常见为 4 KB），一百万个面约 4 GB；设置改变后旧的设置子目录不再被读取，
+ * 可以连同不再需要的条目整个删除。目录无法创建时 isOpen() 为假，调用方应停用缓存
+ *************************************************************/
+class ResultCache {
+public:
+    static const uint32_t CACHE_VERSION = 2;
+
+private:
+    struct EntryHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t resultSize;    // sizeof(rcr_face_result)，结构体布局改变时条目失效
+        uint64_t contentHash;
+        uint64_t settingsHash;
+    };
+
+    filesystem::path directory;     // 当前设置对应的子目录
+    uint64_t settings = 0;
+    uint64_t tempSeed = 0;          // 临时文件名的随机前缀（区分进程）
+    string openError;               // 创建目录失败的原因（为空表示可用）
+
+    atomic<uint64_t> hits{ 0 };
+    atomic<uint64_t> misses{ 0 };
+    atomic<uint64_t> writes{ 0 };
+    atomic<uint64_t> tempCounter{ 0 };
+
+    static string hex(uint64_t value) {
+        static const char digits[] = "0123456789abcdef";
+        string s(16, '0');
+        for (int i = 15; i >= 0; i--, value >>= 4) {
+            s[i] = digits[value & 15];
+        }
+        return s;
+    }
+
+    filesystem::path entryPath(uint64_t contentHash) const {
+        return directory / (hex(contentHash) + ".bin");
+    }
+
+    // 校验映射的条目并取出结果；任何字段不符都返回 false
+    bool decodeEntry(const uint8_t* data, size_t size, uint64_t contentHash, rcr_face_result& result) const {
+        if (size != sizeof(EntryHeader) + sizeof(rcr_face_result)) return false;
+        EntryHeader h;
+        memcpy(&h, data, sizeof(h));
+        if (memcmp(h.magic, "RCCACHE2", 8) != 0 || h.version != CACHE_VERSION) return false;
+        if (h.resultSize != sizeof(rcr_face_result)) return false;
+        if (h.contentHash != contentHash || h.settingsHash != settings) return false;
+        memcpy(&result, data + sizeof(EntryHeader), sizeof(result));
+        return true;
+    }
+
+public:
+    /*********************************************************
+     * 打开缓存目录：设置摘要由分析器设置（颜色阈值、模型与检测设置的摘要，
+     * 见 rcr_settings_hash）和解码缩小倍数共同决定，需在颜色标定之后构造
+     *********************************************************/
+    ResultCache(const string& root, uint64_t analyzerSettings, const ImageLoader& loader) {
+        int64_t reduce = loader.getReduce();
+        settings = hashBytes(&reduce, sizeof(reduce), analyzerSettings);
+        directory = filesystem::path(root) / hex(settings);
+        error_code ec;
+        filesystem::create_directories(directory, ec);
+        if (ec) openError = ec.message();
+        tempSeed = ((uint64_t)random_device{}() << 32) ^ random_device{}();
+    }
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /*********************************************************
+     * 查找编码内容摘要为 contentHash 的图像的结果（可多线程同时调用）
+     *********************************************************/
+    bool lookup(uint64_t contentHash, rcr_face_result& result) {
+        MappedFile file;
+        if (file.open(entryPath(contentHash).string()) && decodeEntry(file.data(), file.size(), contentHash, result)) {
+            hits++;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    /*********************************************************
+     * 写入一个面的结果（可多线程、多进程同时调用；同一条目
+     * 并发写入时内容相同，后改名的覆盖先改名的）
+     *********************************************************/
+    bool store(uint64_t contentHash, const rcr_face_result& result) {
+        uint8_t buffer[sizeof(EntryHeader) + sizeof(rcr_face_result)];
+        EntryHeader h = {};
+        memcpy(h.magic, "RCCACHE2", 8);
+        h.version = CACHE_VERSION;
+        h.resultSize = sizeof(rcr_face_result);
+        h.contentHash = contentHash;
+        h.settingsHash = settings;
+        memcpy(buffer, &h, sizeof(h));
+        memcpy(buffer + sizeof(h), &result, sizeof(result));
+
+        filesystem::path target = entryPath(contentHash);
+        filesystem::path temp = target;
+        temp += ".tmp" + hex(tempSeed + tempCounter++);
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out.write((const char*)buffer, (streamsize)sizeof(buffer))) return false;
+        }
+        error_code ec;
+        filesystem::rename(temp, target, ec);
+        if (ec) {
+            filesystem::remove(temp, ec);
+            return false;
+        }
+        writes++;
+        return true;
+    }
+
+    bool isOpen() const { return openError.empty(); }
+    const string& getOpenError() const { return openError; }
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    uint64_t getWrites() const { return writes; }
+    // 缓存目录对应的设置摘要（分析器设置 + 解码缩小倍数）
+    uint64_t getSettings() const { return settings; }
+    string getDirectory() const { return directory.string(); }
+    string getEntryPath(uint64_t contentHash) const { return entryPath(contentHash).string(); }
+
+    double hitRate() const {
+        uint64_t total = hits + misses;
+        return total ? (double)hits / total : 0.0;
+    }
+};
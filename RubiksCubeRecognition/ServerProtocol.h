@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include "PlatformUtil.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*************************************************************
+ * 识别服务协议：本地流套接字上的长度前缀二进制帧，整数均为小端
+ *   请求：magic "RCRQ" | id u32 | 图像数 u32 | 每张图：长度 u32 + 编码数据
+ *   响应：magic "RCRS" | id u32 | 状态 u32 | 正文长度 u32 + 正文（紧凑 JSON）
+ * 一个连接上可连续发送多个请求，响应按完成顺序返回，用 id 对应。
+ * 单个请求最多 6 张图、合计不超过 MAX_REQUEST_BYTES，超限的帧直接断开连接，
+ * 因此每个连接的读线程最多只为一个请求持有 MAX_REQUEST_BYTES 内存
+ *************************************************************/
+class ServerProtocol {
+public:
+    static const uint32_t REQUEST_MAGIC = 0x51524352;   // "RCRQ"
+    static const uint32_t RESPONSE_MAGIC = 0x53524352;  // "RCRS"
+    static const uint32_t FACES = 6;
+    static const uint32_t MAX_IMAGE_BYTES = 16u << 20;  // 单张图上限 16 MB
+    static const uint32_t MAX_REQUEST_BYTES = 48u << 20; // 一个请求全部图像合计上限 48 MB
+    static const uint32_t MAX_BODY_BYTES = 1u << 20;
+
+    enum Status : uint32_t {
+        STATUS_OK = 0,
+        STATUS_BUSY = 1,          // 队列已满，请稍后重试
+        STATUS_BAD_REQUEST = 2,   // 图像数少于 6
+        STATUS_DECODE_ERROR = 3,  // 有图像无法解码
+        STATUS_INTERNAL_ERROR = 4 // 识别库返回错误
+    };
+
+    struct Request {
+        uint32_t id = 0;
+        std::vector<std::vector<uint8_t>> images;
+    };
+
+    struct Response {
+        uint32_t id = 0;
+        uint32_t status = STATUS_OK;
+        std::string body;
+    };
+
+    static const char* statusName(uint32_t status) {
+        switch (status) {
+        case STATUS_OK:           return "ok";
+        case STATUS_BUSY:         return "busy";
+        case STATUS_BAD_REQUEST:  return "bad_request";
+        case STATUS_DECODE_ERROR: return "decode_error";
+        case STATUS_INTERNAL_ERROR: return "internal_error";
+        }
+        return "unknown";
+    }
+
+private:
+    static void put32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+    }
+
+    static bool read32(LocalSocket& socket, uint32_t& v) {
+        uint8_t b[4];
+        if (!socket.readAll(b, 4)) return false;
+        v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+        return true;
+    }
+
+public:
+    /*********************************************************
+     * 读取一个请求；连接关闭或帧格式错误（magic 不符、图像数超过 6、长度超限）时
+     * 返回 false，此时连接已无法继续同步，应关闭。图像数少于 6 的请求照常读出，由调用方回复错误
+     *********************************************************/
+    static bool readRequest(LocalSocket& socket, Request& request) {
+        uint32_t magic, count;
+        if (!read32(socket, magic) || magic != REQUEST_MAGIC) return false;
+        if (!read32(socket, request.id) || !read32(socket, count) || count > FACES) return false;
+
+        request.images.resize(count);
+        uint64_t total = 0;
+        for (auto& image : request.images) {
+            uint32_t length;
+            if (!read32(socket, length) || length > MAX_IMAGE_BYTES) return false;
+            total += length;
+            if (total > MAX_REQUEST_BYTES) return false;
+            image.resize(length);
+            if (length > 0 && !socket.readAll(image.data(), length)) return false;
+        }
+        return true;
+    }
+
+    static bool writeRequest(LocalSocket& socket, const Request& request) {
+        std::vector<uint8_t> header;
+        put32(header, REQUEST_MAGIC);
+        put32(header, request.id);
+        put32(header, (uint32_t)request.images.size());
+        if (!socket.writeAll(header.data(), header.size())) return false;
+
+        for (const auto& image : request.images) {
+            header.clear();
+            put32(header, (uint32_t)image.size());
+            if (!socket.writeAll(header.data(), header.size())) return false;
+            if (!image.empty() && !socket.writeAll(image.data(), image.size())) return false;
+        }
+        return true;
+    }
+
+    static bool readResponse(LocalSocket& socket, Response& response) {
+        uint32_t magic, length;
+        if (!read32(socket, magic) || magic != RESPONSE_MAGIC) return false;
+        if (!read32(socket, response.id) || !read32(socket, response.status) || !read32(socket, length)) {
+            return false;
+        }
+        if (length > MAX_BODY_BYTES) return false;
+        response.body.resize(length);
+        return length == 0 || socket.readAll(&response.body[0], length);
+    }
+
+    // 整个响应拼成一次写入，多个线程向同一连接写响应时只需在外面加锁
+    static bool writeResponse(LocalSocket& socket, const Response& response) {
+        std::vector<uint8_t> frame;
+        frame.reserve(16 + response.body.size());
+        put32(frame, RESPONSE_MAGIC);
+        put32(frame, response.id);
+        put32(frame, response.status);
+        put32(frame, (uint32_t)response.body.size());
+        frame.insert(frame.end(), response.body.begin(), response.body.end());
+        return socket.writeAll(frame.data(), frame.size());
+    }
+};
@@ -1,461 +1,1203 @@
-﻿#include <opencv2/opencv.hpp>
+﻿#include "ImageIO.h"
+#include "FaceMatrix.h"
+#include "CubeState.h"
+#include "CubeSolver.h"
+#include "RecognitionServer.h"
+#include "ResultCache.h"
+#include "BatchPipeline.h"
+#include "../RubiksCubeLib/RubiksCubeApi.h"
 #include <iostream>
 #include <vector>
+#include <array>
 #include <string>
 #include <map>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <unordered_set>
+#include <memory>
+#include <csignal>
 
 using namespace std;
 using namespace cv;
 
 /*************************************************************
- * 数据结构
+ * 批处理：一个魔方（六张图）的任务与结果
  *************************************************************/
-struct ColorRange {
-    Scalar minVal;     // LAB 最小阈值
-    Scalar maxVal;     // LAB 最大阈值
-    string name;       // 颜色名称
-    Scalar drawColor;  // 绘制颜色
-    char code;         // 颜色代码（用于输出）
+struct CubeJob {
+    string name;                                // 魔方名称（用于输出目录）
+    vector<string> files;                       // 六张图，顺序同 faceNames
+    CubeMatrices<3> colorMatrices;              // 每个面的颜色矩阵
+    vector<int> blockCounts;                    // 每个面检测到的色块数
+    vector<float> gridConfidence;               // 每个面的网格拟合置信度
+    vector<int> loaded;                         // 每个面是否加载成功（各线程写不同元素，不用 vector<bool>）
+    vector<int> cached;                         // 每个面是否命中结果缓存（未解码、未分析）
+    vector<int> reused;                         // 命中缓存且已有的标准面可直接沿用（不绘制、不写入）
+    vector<uint64_t> renderKeys;                // 六个标准面与展开图（下标 6）的绘制键，见 renderKey
+    vector<uint64_t> storedKeys;                // 上次运行记录的绘制键（输出目录中的 .render_keys）
+    vector<int> written;                        // 本次写入或沿用了哪些输出（各线程写不同元素）
+    vector<LoadStats> loadStats;                // 每个面的解码耗时、缩小倍数、解码内存与峰值内存
 };
 
-struct ColorBlock {
-    Point2f center;    // 色块中心点
-    string colorName;  // 颜色名称
-    Scalar colorValue; // 颜色值
-    Rect boundingBox;  // 边界框
-    int row;           // 3x3网格中的行索引
-    int col;           // 3x3网格中的列索引
-    double area;       // 面积
+/*************************************************************
+ * 批处理流水线中流动的任务：一个面，或一个魔方的展开图（face = -1）。
+ * 图像随任务在阶段之间传递，不再需要时立即释放
+ *************************************************************/
+struct FaceTask {
+    CubeJob* cube = nullptr;
+    int face = -1;
+    uint64_t contentHash = 0; // 编码字节的摘要（写结果缓存用）
+    Mat img;          // 解码结果（分析后释放）
+    Mat processed;    // 检测叠加图（full 级别，由识别库写入）
+    Mat standard;     // 标准面或展开图
+    Mat comparison;   // 对比图（full 级别）
+};
+
+struct BatchOptions {
+    string input;             // 清单文件或目录
+    string outputDir = "output";
+    int threads = 0;          // 分析阶段的线程数（0 = 自动，见 splitStageWidths）
+    int decodeThreads = 0;    // 预读与解码阶段的线程数（0 = 自动）
+    int renderThreads = 0;    // 绘制阶段的线程数（0 = 自动）
+    int writeThreads = 0;     // 编码与写文件阶段的线程数（0 = 自动）
+    int stageQueue = 0;       // 阶段之间的队列容量（0 = 自动）
+    int segmentThreads = 1;   // 单张图分割的分块并行数（1 = 串行）
+    int streamRows = 0;       // 条带流式分割的每条行数（0 = 关闭）
+    OutputLevel outputLevel = OUTPUT_FULL; // 输出级别（决定做哪些绘制与保存；full 的叠加绘制每面仍有分配）
+    int decodeReduce = 1;     // 解码缩小倍数（1/2/4/8，0 = 按色块尺寸自动选择）
+    int32_t extract = RCR_EXTRACT_CONTOURS; // 色块提取后端
+    int32_t detect = RCR_DETECT_SEGMENT;    // 检测模式
+    int pyramidLevels = 0;    // 金字塔检测层数（-1 = 自动）
+    bool refine = false;      // 粗层检测后是否在原图上细化
+    string metricsFile;       // 指标输出文件（为空时不记录指标）
+    string metricsFormat = "prom"; // prom（Prometheus 文本）或 jsonl（追加一行 JSON）
+    bool solve = false;       // 是否对合法状态求解
+    string solverTables = "solver_tables.bin"; // 求解表缓存文件
+    int maxSolveLength = 23;  // 解的最大步数
+    string profile;           // 颜色标定配置名（为空时使用固定阈值）
+    string calibrationDir = "calibration"; // 颜色模型缓存目录
+    bool recalibrate = false; // 忽略缓存，重新标定
+    string cacheDir;          // 识别结果缓存目录（为空时不使用缓存）
 };
 
 /*************************************************************
- * 图像加载类
+ * 颜色模型缓存文件：每个相机/光照配置一个
  *************************************************************/
-class ImageLoader {
-public:
-    // 加载图像
-    Mat loadImage(const string& filename) {
-        Mat img = imread(filename);
-        if (img.empty()) {
-            cout << "无法加载图像：" << filename << endl;
-        }
-        else {
-            cout << "成功加载图像：" << filename << endl;
-        }
-        return img;
+static string colorModelPath(const string& dir, const string& profile) {
+    return (filesystem::path(dir) / (profile + ".txt")).string();
+}
+
+/*************************************************************
+ * 命令行的色块提取后端与检测模式名称 -> 识别库选项
+ *************************************************************/
+static bool parseExtractName(const string& name, int32_t& backend) {
+    if (name == "contours") backend = RCR_EXTRACT_CONTOURS;
+    else if (name == "components") backend = RCR_EXTRACT_COMPONENTS;
+    else return false;
+    return true;
+}
+
+static bool parseDetectName(const string& name, int32_t& mode) {
+    if (name == "segment") mode = RCR_DETECT_SEGMENT;
+    else if (name == "quad") mode = RCR_DETECT_QUAD;
+    else return false;
+    return true;
+}
+
+/*************************************************************
+ * Mat 与识别库图像、画布描述之间的包装（不复制像素）
+ *************************************************************/
+static rcr_image imageView(const Mat& img) {
+    return { img.data, img.cols, img.rows, (int64_t)img.step };
+}
+
+static rcr_canvas canvasView(Mat& img) {
+    return { img.data, img.cols, img.rows, (int64_t)img.step };
+}
+
+// 六个面的颜色矩阵（输入顺序）-> 54 个颜色代码
+static void cubeCodes(const CubeMatrices<3>& matrices, char codes[54]) {
+    for (int f = 0; f < 6; f++) {
+        memcpy(codes + f * 9, matrices[f].cells, 9);
     }
-};
+}
 
 /*************************************************************
- * 色块检测与分析类
+ * 识别库句柄：各模式只通过 C 接口分析、绘制与导出指标，
+ * 不再自己构造分析器，查找表只在库内构建一次
  *************************************************************/
-class CubeFaceAnalyzer {
-private:
-    vector<ColorRange> colorTable; // 六种魔方颜色阈值
-    map<string, char> colorCodes;  // 颜色名称到代码的映射
+using LibraryAnalyzer = unique_ptr<rcr_analyzer, void(*)(rcr_analyzer*)>;
 
-public:
-    CubeFaceAnalyzer() {
-        // 初始化颜色阈值表，包含六个颜色的LAB范围
-        colorTable = {
-            {{  0,146, 92}, { 94,187,155}, "Red",    Scalar(0,0,255), 'R'},
-            {{139, 80,146}, {255,111,255}, "Yellow", Scalar(0,255,255), 'Y'},
-            {{ 82, 42,  0}, {177,101,169}, "Green",  Scalar(0,255,0), 'G'},
-            {{  0,  0,  0}, {255,255, 94}, "Blue",   Scalar(255,0,0), 'B'},
-            {{160,127, 90}, {226,177,110}, "White",  Scalar(255,255,255), 'W'},
-            {{ 87,158,106}, {163,255,172}, "Pink",   Scalar(203,192,255), 'P'}
-        };
+static LibraryAnalyzer createLibrary(const rcr_options& options) {
+    rcr_analyzer* handle = nullptr;
+    int status = rcr_create(&options, &handle);
+    if (status != RCR_OK) {
+        cerr << "错误：识别库初始化失败（" << rcr_status_message(status) << "）" << endl;
+    }
+    return LibraryAnalyzer(handle, rcr_destroy);
+}
+
+/*************************************************************
+ * 批处理与服务模式的库选项：流水线的分析阶段（或服务的工作线程）
+ * 自己开线程，库内不再并行
+ *************************************************************/
+static rcr_options libraryOptions(const BatchOptions& opt) {
+    rcr_options options;
+    rcr_default_options(&options);
+    options.threads = 1;
+    options.segment_threads = opt.segmentThreads;
+    options.pyramid_levels = opt.pyramidLevels;
+    options.refine = opt.refine ? 1 : 0;
+    options.extract_backend = opt.extract;
+    options.detect_mode = opt.detect;
+    options.stream_rows = opt.streamRows;
+    options.collect_metrics = opt.metricsFile.empty() ? 0 : 1;
+    return options;
+}
+
+/*************************************************************
+ * 颜色模型缓存文件的读写：文本格式由识别库生成与解析（颜色按名称对应），
+ * 这里只负责文件
+ *************************************************************/
+static bool loadColorModel(const rcr_analyzer* library, const string& path, float centers[18], float radii[6]) {
+    ifstream in(path);
+    if (!in) return false;
+    stringstream text;
+    text << in.rdbuf();
+    return rcr_parse_color_model(library, text.str().c_str(), centers, radii) == RCR_OK;
+}
+
+static bool saveColorModel(const rcr_analyzer* library, const string& path, const string& profile,
+    const float centers[18], const float radii[6]) {
+    string text;
+    size_t length = 0;
+    int status = rcr_format_color_model(library, centers, radii, profile.c_str(), nullptr, 0, &length);
+    while (status == RCR_ERROR_BUFFER_TOO_SMALL) {
+        text.resize(length + 1);
+        status = rcr_format_color_model(library, centers, radii, profile.c_str(), &text[0], text.size(), &length);
+    }
+    if (status != RCR_OK) return false;
+    text.resize(length);
+
+    ofstream out(path, ios::trunc);
+    out << text;
+    return (bool)out;
+}
+
+static bool applyColorModel(rcr_analyzer* library, const float centers[18], const float radii[6]) {
+    int status = rcr_set_color_model(library, centers, radii);
+    if (status != RCR_OK) {
+        cout << "警告：颜色模型无法使用（" << rcr_status_message(status) << "），使用固定阈值" << endl;
+    }
+    return status == RCR_OK;
+}
+
+/*************************************************************
+ * 只读取已缓存的颜色模型（视频流与服务模式），没有缓存时保持固定阈值
+ *************************************************************/
+static void applyCachedColorModel(rcr_analyzer* library, const string& dir, const string& profile) {
+    float centers[18], radii[6];
+    string path = colorModelPath(dir, profile);
+    if (!loadColorModel(library, path, centers, radii)) {
+        cout << "警告：没有找到颜色模型 " << path << "，使用固定阈值（可先用 --batch --profile 标定）" << endl;
+        return;
+    }
+    if (applyColorModel(library, centers, radii)) {
+        cout << "颜色模型：已读取 " << path << endl;
+    }
+}
 
-        // 初始化颜色代码映射
-        for (auto& c : colorTable) {
-            colorCodes[c.name] = c.code;
+/*************************************************************
+ * 准备颜色模型：优先读取该配置的缓存；没有缓存或要求重新标定时，
+ * 用第一个能标定的魔方（rcr_calibrate）拟合，并写入缓存。
+ * 失败时库保持固定阈值
+ *************************************************************/
+static void prepareColorModel(rcr_analyzer* library, const ImageLoader& loader,
+    const vector<CubeJob>& jobs, const BatchOptions& opt) {
+    string path = colorModelPath(opt.calibrationDir, opt.profile);
+    float centers[18], radii[6];
+
+    if (!opt.recalibrate && loadColorModel(library, path, centers, radii)) {
+        if (applyColorModel(library, centers, radii)) {
+            cout << "颜色模型：已读取 " << path << endl;
         }
+        return;
     }
 
-    /*********************************************************
-     * 绘制虚线轮廓
-     *********************************************************/
-    void drawDashedContour(Mat& img, const vector<Point>& contour, Scalar color) {
-        int segments = 8;      // 增加分段数，让虚线更密集
-        int thickness = 5;     // 线条粗度
+    for (const CubeJob& job : jobs) {
+        vector<Mat> images(6);
+        rcr_image views[6];
+        bool complete = true;
+        for (int f = 0; f < 6 && complete; f++) {
+            images[f] = loader.loadImage(job.files[f]);
+            complete = !images[f].empty();
+            views[f] = imageView(images[f]);
+        }
+        if (!complete) continue;
+
+        int32_t iterations = 0;
+        int64 start = getTickCount();
+        int status = rcr_calibrate(library, views, sizeof(rcr_image), centers, radii, &iterations);
+        double ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+        if (status != RCR_OK) {
+            cout << "颜色标定：" << job.name << " 无法标定（" << rcr_status_message(status) << "），跳过" << endl;
+            continue;
+        }
 
-        for (int i = 0; i < contour.size(); i++) {
-            Point p1 = contour[i];
-            Point p2 = contour[(i + 1) % contour.size()];
+        filesystem::create_directories(opt.calibrationDir);
+        bool saved = saveColorModel(library, path, opt.profile, centers, radii);
+        applyColorModel(library, centers, radii);
+        cout << "颜色标定：用 " << job.name << " 拟合，" << iterations << " 轮，"
+            << ms << " ms；" << (saved ? "已缓存到 " + path : "无法写入 " + path) << endl;
+        return;
+    }
+    cout << "警告：没有魔方能采集到全部 54 个色面，颜色标定失败，使用固定阈值" << endl;
+}
 
-            for (int k = 0; k < segments; k++) {
-                float t1 = k / (float)segments;
-                float t2 = (k + 0.5f) / (float)segments;  // 虚线的一半长度
+/*************************************************************
+ * 绘制键：把已有的输出文件与生成它的内容和设置绑定。
+ * 标准面的键 = 输入编码字节的摘要 + 分析器与解码设置的摘要，
+ * 展开图的键由六个面的键合成；任一摘要未知时为 0，0 永远不匹配。
+ * 每个魔方的输出目录中有一个 .render_keys，每行“文件名 十六进制键”
+ *************************************************************/
+static const char* const renderKeysFile = ".render_keys";
 
-                Point s = p1 + (p2 - p1) * t1;
-                Point e = p1 + (p2 - p1) * t2;
+static uint64_t renderKey(uint64_t contentHash, uint64_t settings) {
+    return contentHash ? hashBytes(&contentHash, sizeof(contentHash), settings) : 0;
+}
 
-                line(img, s, e, color, thickness, LINE_AA); // 使用抗锯齿
-            }
+static uint64_t netRenderKey(const vector<uint64_t>& faceKeys) {
+    for (int f = 0; f < 6; f++) {
+        if (faceKeys[f] == 0) return 0;
+    }
+    return hashBytes(faceKeys.data(), 6 * sizeof(uint64_t));
+}
+
+// 输出文件名：0..5 为标准面，6 为展开图
+static string renderOutputName(int index) {
+    return index < 6 ? "standard_" + faceNames[index] + ".jpg" : "cube_net.jpg";
+}
+
+static void readRenderKeys(const filesystem::path& dir, vector<uint64_t>& keys) {
+    keys.assign(7, 0);
+    ifstream in(dir / renderKeysFile);
+    string name, hex;
+    while (in >> name >> hex) {
+        for (int i = 0; i < 7; i++) {
+            if (name == renderOutputName(i)) keys[i] = strtoull(hex.c_str(), nullptr, 16);
         }
     }
+}
 
-    /*********************************************************
-     * 比较函数：用于色块排序（先按行，再按列）
-     *********************************************************/
-    static bool compareColorBlocks(const ColorBlock& a, const ColorBlock& b) {
-        if (a.row != b.row) {
-            return a.row < b.row;
+static void writeRenderKeys(const filesystem::path& dir, const vector<uint64_t>& keys) {
+    ofstream out(dir / renderKeysFile, ios::trunc);
+    for (int i = 0; i < 7; i++) {
+        out << renderOutputName(i) << " " << hex << setw(16) << setfill('0') << keys[i] << dec << "\n";
+    }
+}
+
+/*************************************************************
+ * 导出识别库记录的指标：prom 格式覆盖写入，jsonl 格式追加一行
+ *************************************************************/
+static void exportMetrics(const rcr_analyzer* library, const string& path, const string& format) {
+    int32_t kind = format == "jsonl" ? RCR_METRICS_JSONL : RCR_METRICS_PROMETHEUS;
+    string text;
+    size_t length = 0;
+    int status = rcr_export_metrics(library, kind, nullptr, 0, &length);
+    while (status == RCR_ERROR_BUFFER_TOO_SMALL) {
+        text.resize(length + 1);
+        status = rcr_export_metrics(library, kind, &text[0], text.size(), &length);
+    }
+    if (status != RCR_OK) {
+        cerr << "错误：无法导出指标（" << rcr_status_message(status) << "）" << endl;
+        return;
+    }
+    text.resize(length);
+
+    if (kind == RCR_METRICS_JSONL) {
+        ofstream out(path, ios::app);
+        out << text << "\n";
+    }
+    else {
+        ofstream out(path, ios::trunc);
+        out << text;
+    }
+    cout << "指标已保存到 " << path << endl;
+}
+
+/*************************************************************
+ * 批处理：读取输入
+ * 清单文件：每行一个魔方，六个图像路径（可选第七列为魔方名称），'#' 开头为注释
+ * 目录：若目录下有 cubeface1..6.jpg 则视为一个魔方，否则每个子目录为一个魔方
+ *************************************************************/
+static bool hasCubeFaces(const filesystem::path& dir) {
+    for (int i = 1; i <= 6; i++) {
+        if (!filesystem::exists(dir / ("cubeface" + to_string(i) + ".jpg"))) {
+            return false;
         }
-        return a.col < b.col;
     }
+    return true;
+}
+
+static CubeJob makeDirectoryJob(const filesystem::path& dir) {
+    CubeJob job;
+    job.name = dir.filename().string();
+    for (int i = 1; i <= 6; i++) {
+        job.files.push_back((dir / ("cubeface" + to_string(i) + ".jpg")).string());
+    }
+    return job;
+}
 
-    /*********************************************************
-     * 检测并分析所有颜色色块
-     *********************************************************/
-    vector<ColorBlock> analyzeCubeFace(Mat& img, Mat& outputImg, bool draw = true) {
-        vector<ColorBlock> allBlocks;
-        Mat imgLab;
-        cvtColor(img, imgLab, COLOR_BGR2Lab); // 转LAB颜色空间
-
-        for (auto& c : colorTable) {
-            Mat mask;
-            inRange(imgLab, c.minVal, c.maxVal, mask); // 阈值分割
-
-            // 形态学处理去噪
-            morphologyEx(mask, mask, MORPH_OPEN, Mat(), Point(-1, -1), 2);
-
-            // 提取轮廓
-            vector<vector<Point>> contours;
-            vector<Vec4i> hierarchy;
-            findContours(mask, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-            for (int i = 0; i < contours.size(); i++) {
-                double area = contourArea(contours[i]);
-                if (area < 15000 || area > 150000) continue; // 过滤掉小面积噪声轮廓、阴影轮廓
-
-                // 轮廓逼近
-                float peri = arcLength(contours[i], true);
-                vector<Point> approx;
-                approxPolyDP(contours[i], approx, 0.002 * peri, true);
-
-                // 绘制虚线轮廓
-                if (draw) {
-                    drawDashedContour(outputImg, approx, c.drawColor);
+static vector<CubeJob> collectJobs(const string& input) {
+    vector<CubeJob> jobs;
+    filesystem::path inputPath(input);
+
+    if (filesystem::is_directory(inputPath)) {
+        if (hasCubeFaces(inputPath)) {
+            jobs.push_back(makeDirectoryJob(inputPath));
+        }
+        else {
+            vector<filesystem::path> dirs;
+            for (const auto& entry : filesystem::directory_iterator(inputPath)) {
+                if (entry.is_directory() && hasCubeFaces(entry.path())) {
+                    dirs.push_back(entry.path());
                 }
+            }
+            sort(dirs.begin(), dirs.end());
+            for (const auto& dir : dirs) {
+                jobs.push_back(makeDirectoryJob(dir));
+            }
+        }
+        return jobs;
+    }
 
-                // 计算中心点
-                Moments m = moments(contours[i]);
-                Point2f center(m.m10 / m.m00, m.m01 / m.m00);
+    ifstream manifest(input);
+    if (!manifest) {
+        cout << "无法打开输入：" << input << endl;
+        return jobs;
+    }
 
-                // 创建色块信息
-                ColorBlock block;
-                block.center = center;
-                block.colorName = c.name;
-                block.colorValue = c.drawColor;
-                block.boundingBox = boundingRect(approx);
-                block.area = area;
+    string line;
+    int lineNo = 0;
+    while (getline(manifest, line)) {
+        lineNo++;
+        if (line.empty() || line[0] == '#') continue;
+
+        istringstream iss(line);
+        vector<string> fields;
+        string field;
+        while (iss >> field) {
+            fields.push_back(field);
+        }
+        if (fields.empty()) continue;
+        if (fields.size() < 6) {
+            cout << "清单第 " << lineNo << " 行少于6个图像路径，已跳过" << endl;
+            continue;
+        }
 
-                allBlocks.push_back(block);
+        CubeJob job;
+        job.files.assign(fields.begin(), fields.begin() + 6);
+        job.name = fields.size() > 6 ? fields[6] : "cube" + to_string(jobs.size() + 1);
+        jobs.push_back(job);
+    }
+    return jobs;
+}
 
-                // 标注颜色名称
-                if (draw) {
-                    Rect boundRect = block.boundingBox;
+/*************************************************************
+ * 批处理各阶段的线程数（解码、分析、绘制、写入）：显式指定的保持不变，
+ * 其余阶段各先分一个线程，再按 2:4:1:1 分掉剩下的硬件线程，
+ * 取整的余数给权重最大的自动阶段，使默认宽度之和等于核数。
+ * 只有核数少于阶段数（或显式宽度已占满核数）时总数才会超过核数
+ *************************************************************/
+static array<int, 4> splitStageWidths(const BatchOptions& opt) {
+    const int weights[4] = { 2, 4, 1, 1 };
+    array<int, 4> widths = { opt.decodeThreads, opt.threads, opt.renderThreads, opt.writeThreads };
+    bool automatic[4];
+    int remaining = (int)max(1u, thread::hardware_concurrency());
+    int weightSum = 0, largest = -1;
+    for (int i = 0; i < 4; i++) {
+        automatic[i] = widths[i] <= 0;
+        if (automatic[i]) {
+            widths[i] = 1;
+            weightSum += weights[i];
+            if (largest < 0 || weights[i] > weights[largest]) largest = i;
+        }
+        remaining -= widths[i];
+    }
+    if (largest < 0 || remaining <= 0) return widths;
+
+    int assigned = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!automatic[i]) continue;
+        int extra = remaining * weights[i] / weightSum;
+        widths[i] += extra;
+        assigned += extra;
+    }
+    widths[largest] += remaining - assigned;
+    return widths;
+}
 
-                    // 在文字下加黑色背景条（增强对比）
-                    rectangle(outputImg, Point(boundRect.x - 2, boundRect.y - 25),
-                        Point(boundRect.x + 80, boundRect.y), Scalar(0, 0, 0), FILLED);
+/*************************************************************
+ * 无界面批处理模式：不调用任何 HighGUI 函数。
+ * 四个阶段由有界无锁队列连接，各阶段线程数独立配置：
+ *   解码（映射文件、查结果缓存、解码）-> 分析（每个面解码后立即单独
+ *   rcr_analyze_batch，full 级别同时由库写出检测叠加图）
+ *   -> 绘制（识别库绘制标准面、对比图、展开图）-> 写入（JPEG 编码与写文件）
+ * 分析、绘制与指标都在识别库内，main 只负责读写文件与调度。
+ * 队列满时上游等待，解码后的图像数量因此有上限；
+ * 同一魔方的各面在分析阶段的多个线程上并行，只有展开图要等六个面都有结果
+ *************************************************************/
+int runBatch(const BatchOptions& opt) {
+    vector<CubeJob> jobs = collectJobs(opt.input);
+    if (jobs.empty()) {
+        cout << "没有找到可处理的魔方图像：" << opt.input << endl;
+        return 1;
+    }
 
-                    // 白色文字，字号更大
-                    putText(outputImg, c.name, Point(boundRect.x, boundRect.y - 5),
-                        FONT_HERSHEY_SIMPLEX, 1.0, Scalar(255, 255, 255), 2);
-                }
+    array<int, 4> widths = splitStageWidths(opt);
+    int decodeThreads = widths[0], threads = widths[1], renderThreads = widths[2], writeThreads = widths[3];
+    int queueCapacity = opt.stageQueue > 0 ? opt.stageQueue :
+        2 * max({ decodeThreads, threads, renderThreads, writeThreads });
+
+    // 识别库句柄在颜色标定之后只读，所有线程共享
+    ImageLoader loader(false);
+    loader.setReduce(opt.decodeReduce);
+    rcr_options options = libraryOptions(opt);
+    LibraryAnalyzer library = createLibrary(options);
+    if (!library) return 1;
+    if (!opt.profile.empty()) {
+        prepareColorModel(library.get(), loader, jobs, opt);
+    }
+    string colorCodes = rcr_color_codes(library.get());
+    float minConfidence = options.min_grid_confidence;
+
+    // 结果缓存的键包含颜色模型，需在标定之后打开；
+    // full 级别的检测叠加图需要解码后的图像，不使用缓存
+    unique_ptr<ResultCache> cache;
+    if (!opt.cacheDir.empty()) {
+        if (opt.outputLevel == OUTPUT_FULL) {
+            cout << "警告：full 级别需要检测叠加图，结果缓存只用于 none/codes/standard 级别" << endl;
+        }
+        else {
+            cache = make_unique<ResultCache>(opt.cacheDir, rcr_settings_hash(library.get()), loader);
+            if (!cache->isOpen()) {
+                cout << "警告：无法创建结果缓存目录 " << cache->getDirectory() << "（" << cache->getOpenError()
+                    << "），本次不使用缓存" << endl;
+                cache.reset();
             }
         }
+    }
 
-        // 如果找到了9个色块，将它们分配到3x3网格
-        if (allBlocks.size() == 9) {
-            assignToGrid(allBlocks);
-        }
-        else {
-            cout << "警告：检测到 " << allBlocks.size() << " 个色块，期望9个" << endl;
+    bool overlay = opt.outputLevel == OUTPUT_FULL;  // 只有 full 级别需要检测叠加图
+    bool render = opt.outputLevel >= OUTPUT_STANDARD;
+    int64_t reduce = loader.getReduce();
+    uint64_t renderSettings = hashBytes(&reduce, sizeof(reduce), rcr_settings_hash(library.get()));
+
+    StageStats decodeStage("decode", decodeThreads), analyzeStage("analyze", threads),
+        renderStage("render", renderThreads), writeStage("write", writeThreads);
+    // 队列容量向上取整为 2 的幂，输出实际容量
+    LockFreeQueue<FaceTask*> toAnalyze(queueCapacity), toRender(queueCapacity), toWrite(queueCapacity);
+
+    cout << "批处理：" << jobs.size() << " 个魔方，解码/分析/绘制/写入 " << decodeThreads << "/" << threads
+        << "/" << renderThreads << "/" << writeThreads << " 个线程（" << thread::hardware_concurrency()
+        << " 个硬件线程），队列容量 " << toAnalyze.capacity() << endl;
+    cout << "分析：识别库 C 接口 v" << rcr_api_version() << "，每个面解码后单独分析" << endl;
+
+    for (auto& job : jobs) {
+        for (auto& matrix : job.colorMatrices) matrix.clear();
+        job.blockCounts.assign(6, 0);
+        job.gridConfidence.assign(6, 0.0f);
+        job.loaded.assign(6, 0);
+        job.cached.assign(6, 0);
+        job.reused.assign(6, 0);
+        job.renderKeys.assign(7, 0);
+        job.written.assign(7, 0);
+        job.loadStats.assign(6, LoadStats());
+        if (render) {
+            // 先读出上次的绘制键再删掉：本次中途退出时，已被覆盖的输出不会再被误认为沿用
+            filesystem::path dir = filesystem::path(opt.outputDir) / job.name;
+            filesystem::create_directories(dir);
+            readRenderKeys(dir, job.storedKeys);
+            error_code ec;
+            filesystem::remove(dir / renderKeysFile, ec);
         }
+    }
 
-        return allBlocks;
+    // 每个魔方 7 个任务：六个面 + 展开图；
+    // facesLeft 为还没有最终结果（分析完、命中缓存或加载失败）的面数
+    vector<FaceTask> tasks(jobs.size() * 7);
+    vector<atomic<int>> facesLeft(jobs.size());
+    for (size_t j = 0; j < jobs.size(); j++) {
+        for (int f = 0; f < 7; f++) {
+            tasks[j * 7 + f].cube = &jobs[j];
+            tasks[j * 7 + f].face = f < 6 ? f : -1;
+        }
+        facesLeft[j] = 6;
     }
 
-    /*********************************************************
-     * 将色块分配到3x3网格
-     *********************************************************/
-    void assignToGrid(vector<ColorBlock>& blocks) {
-        // 按照Y坐标（行）排序
-        vector<Point2f> centers;
-        for (auto& block : blocks) {
-            centers.push_back(block.center);
+    atomic<int> reusedFaces{ 0 }, netSkipped{ 0 }, failedFaces{ 0 };
+
+    // 一个面有了最终结果；六个面都有结果的魔方把展开图交给绘制阶段
+    // （计数的 seq_cst 递减使各面写入的颜色矩阵对绘制展开图的线程可见）
+    auto faceDone = [&](CubeJob& cube, StageWorker& worker) {
+        size_t j = &cube - jobs.data();
+        if (--facesLeft[j] == 0 && render) worker.emit(toRender, &tasks[j * 7 + 6]);
+    };
+
+    // 1) 解码：文件先映射，用编码字节的摘要查结果缓存，未命中时直接从同一映射解码，
+    //    解码成功的面立即进入分析阶段；命中的面跳过分析，直接进入绘制阶段；
+    //    已有的标准面由同一内容、同一设置绘制（绘制键相同）时连绘制与写入也跳过
+    auto decodeFace = [&](FaceTask& task, StageWorker& worker) {
+        CubeJob& cube = *task.cube;
+        int f = task.face;
+
+        MappedFile file;
+        file.open(cube.files[f]);
+        bool hit = false;
+        rcr_face_result cached;
+        if ((cache || render) && file.isOpen()) {
+            task.contentHash = hashBytes(file.data(), file.size());
+            cube.renderKeys[f] = renderKey(task.contentHash, renderSettings);
+            hit = cache && cache->lookup(task.contentHash, cached);
+        }
+        if (!hit) {
+            task.img = loader.loadImage(cube.files[f], file, &cube.loadStats[f]);
+            if (task.img.empty()) {
+                faceDone(cube, worker);
+                return;
+            }
+            cube.loaded[f] = 1;
+            worker.emit(toAnalyze, &task);
+            return;
         }
 
-        // 找到Y坐标的分割点（将9个点分成3行）
-        vector<float> yCoords;
-        for (auto& center : centers) {
-            yCoords.push_back(center.y);
+        cube.loaded[f] = 1;
+        cube.cached[f] = 1;
+        cube.colorMatrices[f].assign(cached.colors);
+        cube.blockCounts[f] = cached.block_count;
+        cube.gridConfidence[f] = cached.grid_confidence;
+        filesystem::path standard = filesystem::path(opt.outputDir) / cube.name / renderOutputName(f);
+        if (render && cube.renderKeys[f] != 0 && cube.storedKeys[f] == cube.renderKeys[f]
+            && filesystem::exists(standard)) {
+            cube.reused[f] = 1;
+            cube.written[f] = 1;
+            reusedFaces++;
         }
-        sort(yCoords.begin(), yCoords.end());
+        else if (render) {
+            worker.emit(toRender, &task);
+        }
+        faceDone(cube, worker);
+    };
 
-        // 确定行阈值
-        float rowThreshold1 = yCoords[2] + (yCoords[3] - yCoords[2]) / 2;
-        float rowThreshold2 = yCoords[5] + (yCoords[6] - yCoords[5]) / 2;
+    // 2) 分析：一个面一次 rcr_analyze_batch，帧上下文在库内的池中复用；
+    //    full 级别同时请库把检测叠加图写入该面的 processed。调用失败时该面的颜色保持空格
+    auto analyzeFace = [&](FaceTask* task, StageWorker& worker) {
+        CubeJob& cube = *task->cube;
+        int f = task->face;
+        if (overlay) task->processed.create(task->img.size(), CV_8UC3);
+        rcr_image image = imageView(task->img);
+        rcr_canvas canvas = canvasView(task->processed);
+        rcr_face_result result;
+        int status = rcr_analyze_batch(library.get(), 1, &image, sizeof(rcr_image),
+            &result, sizeof(rcr_face_result), overlay ? &canvas : nullptr, sizeof(rcr_canvas));
+        task->img.release();
+        if (status == RCR_OK) {
+            cube.colorMatrices[f].assign(result.colors);
+            cube.blockCounts[f] = result.block_count;
+            cube.gridConfidence[f] = result.grid_confidence;
+            if (cache && task->contentHash != 0) cache->store(task->contentHash, result);
+        }
+        else {
+            failedFaces++;
+            task->processed.release();
+        }
+        if (render) worker.emit(toRender, task);
+        faceDone(cube, worker);
+    };
 
-        // 为每个色块分配行索引
-        for (auto& block : blocks) {
-            if (block.center.y < rowThreshold1) {
-                block.row = 0;
+    // 3) 绘制：识别库把标准面与对比图，或展开图直接画进任务的图像。
+    //    六个面都沿用、且已有展开图的绘制键相同时展开图也沿用；否则整张重画
+    //    （已写出的 JPEG 不再读回修补，避免反复有损编码）。
+    //    绘制失败的图像释放掉，写入阶段跳过
+    auto renderTask = [&](FaceTask* task, StageWorker& worker) {
+        CubeJob& cube = *task->cube;
+        int32_t width = 0, height = 0;
+        if (task->face < 0) {
+            char codes[54];
+            cubeCodes(cube.colorMatrices, codes);
+            cube.renderKeys[6] = netRenderKey(cube.renderKeys);
+            bool allReused = all_of(cube.reused.begin(), cube.reused.end(), [](int r) { return r != 0; });
+            if (allReused && cube.renderKeys[6] != 0 && cube.storedKeys[6] == cube.renderKeys[6]
+                && filesystem::exists(filesystem::path(opt.outputDir) / cube.name / renderOutputName(6))) {
+                cube.written[6] = 1;
+                netSkipped++;
+                return;
             }
-            else if (block.center.y < rowThreshold2) {
-                block.row = 1;
+
+            rcr_cube_net_size(&width, &height);
+            task->standard.create(height, width, CV_8UC3);
+            rcr_canvas canvas = canvasView(task->standard);
+            if (rcr_render_cube_net(library.get(), codes, RCR_NET_ALL_FACES, &canvas) != RCR_OK) {
+                task->standard.release();
             }
-            else {
-                block.row = 2;
+        }
+        else {
+            int f = task->face;
+            const char* label = faceNames[f].c_str();
+            const char* codes = cube.colorMatrices[f].cells;
+            rcr_standard_face_size(label, &width, &height);
+            task->standard.create(height, width, CV_8UC3);
+            rcr_canvas canvas = canvasView(task->standard);
+            if (rcr_render_standard_face(library.get(), codes, label, &canvas) != RCR_OK) {
+                task->standard.release();
+            }
+            if (!task->processed.empty()) {
+                rcr_comparison_size(&width, &height);
+                task->comparison.create(height, width, CV_8UC3);
+                rcr_image detection = imageView(task->processed);
+                canvas = canvasView(task->comparison);
+                if (rcr_render_comparison(library.get(), &detection, codes, label, &canvas) != RCR_OK) {
+                    task->comparison.release();
+                }
             }
         }
+        worker.emit(toWrite, task);
+    };
+
+    // 4) 写入：JPEG 编码并写文件，然后释放该任务的所有图像；
+    //    标准面与展开图写成功后才记入绘制键
+    auto writeTask = [&](FaceTask* task, StageWorker&) {
+        CubeJob& cube = *task->cube;
+        filesystem::path dir = filesystem::path(opt.outputDir) / cube.name;
+        int index = task->face < 0 ? 6 : task->face;
+        if (!task->standard.empty()) {
+            cube.written[index] = imwrite((dir / renderOutputName(index)).string(), task->standard) ? 1 : 0;
+        }
+        if (task->face >= 0) {
+            const string& name = faceNames[task->face];
+            if (!task->processed.empty()) imwrite((dir / ("processed_" + name + ".jpg")).string(), task->processed);
+            if (!task->comparison.empty()) imwrite((dir / ("comparison_" + name + ".jpg")).string(), task->comparison);
+        }
+        task->standard.release();
+        task->processed.release();
+        task->comparison.release();
+    };
 
-        // 对每一行按照X坐标（列）排序
-        for (int r = 0; r < 3; r++) {
-            vector<ColorBlock*> rowBlocks;
-            for (auto& block : blocks) {
-                if (block.row == r) {
-                    rowBlocks.push_back(&block);
+    int64 batchStart = getTickCount();
+    {
+        // 上游阶段的线程全部结束后关闭其输出队列，下游取空后随之结束
+        atomic<size_t> nextFace{ 0 };
+        size_t faceCount = jobs.size() * 6;
+        vector<thread> decoders, analyzers, renderers, writers;
+        for (int i = 0; i < decodeThreads; i++) {
+            decoders.emplace_back([&] {
+                StageWorker worker(decodeStage);
+                for (size_t index; (index = nextFace++) < faceCount;) {
+                    FaceTask& task = tasks[index / 6 * 7 + index % 6];
+                    worker.process([&] { decodeFace(task, worker); });
                 }
-            }
+            });
+        }
+        for (int i = 0; i < threads; i++) {
+            analyzers.emplace_back([&] { StageWorker(analyzeStage).run(toAnalyze, analyzeFace); });
+        }
+        for (int i = 0; i < renderThreads; i++) {
+            renderers.emplace_back([&] { StageWorker(renderStage).run(toRender, renderTask); });
+        }
+        for (int i = 0; i < writeThreads; i++) {
+            writers.emplace_back([&] { StageWorker(writeStage).run(toWrite, writeTask); });
+        }
 
-            // 按X坐标排序
-            sort(rowBlocks.begin(), rowBlocks.end(),
-                [](ColorBlock* a, ColorBlock* b) {
-                    return a->center.x < b->center.x;
-                });
+        for (auto& t : decoders) t.join();
+        toAnalyze.close();
+        for (auto& t : analyzers) t.join();
+        toRender.close();
+        for (auto& t : renderers) t.join();
+        toWrite.close();
+        for (auto& t : writers) t.join();
+    }
 
-            // 分配列索引
-            for (int c = 0; c < rowBlocks.size(); c++) {
-                rowBlocks[c]->col = c;
+    // 记录本次写入或沿用的输出由哪份内容、哪组设置绘制；没有写出的输出记 0
+    if (render) {
+        for (const CubeJob& job : jobs) {
+            vector<uint64_t> keys(7, 0);
+            for (int i = 0; i < 7; i++) {
+                if (job.written[i]) keys[i] = job.renderKeys[i];
             }
+            writeRenderKeys(filesystem::path(opt.outputDir) / job.name, keys);
         }
-
-        // 按网格位置排序
-        sort(blocks.begin(), blocks.end(), compareColorBlocks);
     }
+    double wallMs = (getTickCount() - batchStart) * 1000.0 / getTickFrequency();
+
+    // 输出每个魔方的结果（按面顺序，每面9个颜色代码）
+    unordered_set<CubeState> distinctStates;
+    int validStates = 0;
+    int images = 0;
+    int lowConfidenceFaces = 0;     // 网格置信度低于阈值、建议重拍的面
+    int decodedFaces = 0;           // 实际解码的面（不含缓存命中）
+    size_t decodedBytesSum = 0, decodedBytesMax = 0;
+    vector<CubieCube> solveCubes;   // 待求解的合法状态
+    vector<size_t> solveJobs;       // 对应的魔方下标
+    for (size_t j = 0; j < jobs.size(); j++) {
+        const CubeJob& job = jobs[j];
+        char codes[54];
+        cubeCodes(job.colorMatrices, codes);
+        bool colorTotalsOk = rcr_check_color_totals(library.get(), codes) == 1;
+        CubeState state = CubeState::fromMatrices(job.colorMatrices, colorCodes);
+        CubeState::Validation validation = state.validate();
+        if (validation == CubeState::VALID) {
+            validStates++;
+            CubieCube cube;
+            state.toCubie(cube);
+            solveCubes.push_back(cube);
+            solveJobs.push_back(j);
+        }
+        distinctStates.insert(state);
+        for (int f = 0; f < 6; f++) {
+            if (job.loaded[f]) images++;
+            if (job.loaded[f] && job.gridConfidence[f] < minConfidence) lowConfidenceFaces++;
+            if (job.loaded[f] && !job.cached[f]) {
+                decodedFaces++;
+                decodedBytesSum += job.loadStats[f].decodedBytes;
+                decodedBytesMax = max(decodedBytesMax, job.loadStats[f].decodedBytes);
+            }
+        }
 
-    /*********************************************************
-     * 创建颜色矩阵（3x3）并打印
-     *********************************************************/
-    vector<vector<char>> createColorMatrix(const vector<ColorBlock>& blocks) {
-        vector<vector<char>> colorMatrix(3, vector<char>(3, ' '));
+        // none 级别只输出汇总
+        if (opt.outputLevel < OUTPUT_CODES) continue;
 
-        for (const auto& block : blocks) {
-            if (block.row >= 0 && block.row < 3 && block.col >= 0 && block.col < 3) {
-                colorMatrix[block.row][block.col] = colorCodes[block.colorName];
+        cout << job.name << ":";
+        for (int f = 0; f < 6; f++) {
+            cout << " " << faceNames[f] << "=";
+            for (char color : job.colorMatrices[f].cells) {
+                cout << (color == ' ' ? '.' : color);
+            }
+            if (job.loaded[f] && job.blockCounts[f] != 9) {
+                cout << "(" << job.blockCounts[f] << ")";
+            }
+            if (job.loaded[f] && job.gridConfidence[f] < minConfidence) {
+                cout << "[置信度 " << fixed << setprecision(2) << job.gridConfidence[f] << "]";
             }
         }
-
-        return colorMatrix;
+        if (!colorTotalsOk) {
+            cout << " [颜色统计异常]";
+        }
+        cout << " 解码(ms)=";
+        for (int f = 0; f < 6; f++) {
+            const LoadStats& st = job.loadStats[f];
+            cout << (f ? "/" : "");
+            if (job.cached[f]) {
+                cout << "缓存";
+                continue;
+            }
+            cout << fixed << setprecision(1) << st.decodeMs;
+            if (st.reduce > 1) cout << "@1/" << st.reduce;
+        }
+        // 每个面：解码图像本身的大小，以及解码完成时的进程峰值常驻内存
+        cout << " 内存(MB)=";
+        for (int f = 0; f < 6; f++) {
+            const LoadStats& st = job.loadStats[f];
+            cout << (f ? "/" : "");
+            if (!job.loaded[f] || job.cached[f]) {
+                cout << "-";
+                continue;
+            }
+            cout << fixed << setprecision(1) << st.decodedBytes / (1024.0 * 1024.0) << "@"
+                << setprecision(0) << st.peakRssBytes / (1024.0 * 1024.0);
+        }
+        cout << " 状态=" << state.toFaceletString() << "（" << CubeState::validationMessage(validation) << "）";
+        cout << endl;
+    }
+    cout << "合法魔方: " << validStates << " / " << jobs.size()
+        << "，不同状态: " << distinctStates.size() << endl;
+    if (lowConfidenceFaces > 0) {
+        cout << "网格置信度低于 " << fixed << setprecision(2) << minConfidence
+            << " 的面: " << lowConfidenceFaces << "（建议重拍）" << endl;
     }
 
-    /*********************************************************
-     * 获取颜色映射表
-     *********************************************************/
-    map<string, Scalar> getColorMap() const {
-        map<string, Scalar> colorMap;
-        for (const auto& c : colorTable) {
-            colorMap[c.name] = c.drawColor;
+    // 并行求解合法状态（各线程共享只读的求解表）
+    if (opt.solve && !solveCubes.empty()) {
+        CubeSolver solver;
+        if (!solver.load(opt.solverTables)) {
+            cerr << "错误：无法加载求解表 " << opt.solverTables << endl;
+            return 1;
+        }
+        cout << "\n求解表" << (solver.loadedFromCache() ? "映射" : "构建") << "耗时: "
+            << fixed << setprecision(2) << solver.getLoadMs() << " ms（" << opt.solverTables << "）" << endl;
+
+        int64 solveStart = getTickCount();
+        vector<CubeSolver::Result> results = solver.solveBatch(solveCubes, threads, opt.maxSolveLength);
+        double solveWallMs = (getTickCount() - solveStart) * 1000.0 / getTickFrequency();
+
+        vector<double> latencies;
+        uint64_t totalNodes = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            const CubeSolver::Result& r = results[i];
+            cout << jobs[solveJobs[i]].name << ": ";
+            if (r.solved) {
+                cout << r.text() << "（" << r.moves.size() << " 步";
+            }
+            else {
+                cout << "未找到解（";
+            }
+            cout << "，" << r.ms << " ms，" << r.nodes << " 个节点）" << endl;
+            latencies.push_back(r.ms);
+            totalNodes += r.nodes;
         }
-        return colorMap;
+        cout << "求解: " << results.size() << " 个，墙钟 " << solveWallMs << " ms，延迟 p50 "
+            << percentile(latencies, 50) << " ms / p99 " << percentile(latencies, 99) << " ms，平均节点 "
+            << totalNodes / results.size() << endl;
     }
 
-    /*********************************************************
-     * 获取颜色代码映射表
-     *********************************************************/
-    map<char, Scalar> getColorCodeMap() const {
-        map<char, Scalar> colorCodeMap;
-        for (const auto& c : colorTable) {
-            colorCodeMap[c.code] = c.drawColor;
+    // 输出各阶段的占用率与等待时间（各线程累加）以及吞吐量；
+    // 占用率最高的阶段限制吞吐量，等待输出多说明下游是瓶颈，等待输入多说明上游是瓶颈
+    cout << "\n============== 流水线阶段 ==============\n";
+    cout << fixed << setprecision(2);
+    const StageStats* bottleneck = nullptr;
+    for (const StageStats* stage : { &decodeStage, &analyzeStage, &renderStage, &writeStage }) {
+        if (stage->items == 0) continue;
+        double busyMs = stage->busyNs / 1e6;
+        cout << setw(8) << stage->name << ": " << stage->width << " 线程, " << stage->items << " 项, 忙碌 "
+            << busyMs << " ms（平均 " << busyMs / stage->items << " ms）, 占用率 "
+            << 100.0 * stage->occupancy(wallMs) << "%, 等待输入 " << stage->starvedNs / 1e6
+            << " ms, 等待输出 " << stage->blockedNs / 1e6 << " ms, 输入队列平均深度 " << stage->meanDepth() << endl;
+        if (!bottleneck || stage->occupancy(wallMs) > bottleneck->occupancy(wallMs)) bottleneck = stage;
+    }
+    if (bottleneck) {
+        cout << "瓶颈阶段: " << bottleneck->name << endl;
+    }
+    cout << "总耗时（墙钟）: " << wallMs << " ms" << endl;
+    cout << "吞吐量: " << images * 1000.0 / wallMs << " 张/秒（" << images << " 张）" << endl;
+    cout << "峰值内存: " << peakRssBytes() / (1024.0 * 1024.0) << " MB" << endl;
+    if (decodedFaces > 0) {
+        cout << "每张图解码内存: 平均 " << decodedBytesSum / (1024.0 * 1024.0) / decodedFaces << " MB，最大 "
+            << decodedBytesMax / (1024.0 * 1024.0) << " MB（" << decodedFaces << " 张）" << endl;
+    }
+    if (cache) {
+        cout << "结果缓存: 命中 " << cache->getHits() << " / " << cache->getHits() + cache->getMisses()
+            << "（" << 100.0 * cache->hitRate() << "%），写入 " << cache->getWrites()
+            << "（" << cache->getDirectory() << "）" << endl;
+        if (render) {
+            cout << "沿用已有输出: 标准面 " << reusedFaces << " 张，展开图 " << netSkipped << " 张" << endl;
         }
-        return colorCodeMap;
     }
-};
+
+    if (failedFaces > 0) {
+        cout << "识别库调用失败: " << failedFaces << " 个面（按未识别处理）" << endl;
+    }
+
+    if (!opt.metricsFile.empty()) {
+        exportMetrics(library.get(), opt.metricsFile, opt.metricsFormat);
+    }
+
+    return 0;
+}
 
 /*************************************************************
- * 色块标准化和魔方展开图绘制类
+ * 视频流模式：时域网格跟踪
+ * 保存最近一次成功的 3x3 网格，后续帧只复查九个色块 ROI
+ * （rcr_classify_pixels），跟踪丢失时才回退到全图检测（rcr_analyze_batch）
  *************************************************************/
-class CubeVisualizer {
+class CubeFaceTracker {
 private:
-    int blockSize = 60; // 每个色块的大小（像素）
+    rcr_analyzer* library;
+    string colorCodes;            // 第 i 个字符为颜色位掩码第 i 位对应的颜色
+    Mat sampleLabels, sampleMask; // ROI 复查的分类结果与主色掩码
+    rcr_face_result grid;         // 最近一次成功的网格（9 个格子都有颜色）
+    bool tracking = false;
+    FaceMatrix<3> colorMatrix;
+    double minMatchRatio = 0.6;   // ROI 内主色像素比例低于此值视为跟踪丢失
+    double sampleFraction = 0.6;  // 在边界框中心取多大比例的区域采样
 
 public:
-    /*********************************************************
-     * 绘制单个标准化的魔方面
-     *********************************************************/
-    Mat drawStandardFace(const vector<vector<char>>& colorMatrix,
-        const map<char, Scalar>& colorCodeMap,
-        const string& faceName = "") {
-        int margin = 10;
-        int labelHeight = faceName.empty() ? 0 : 25;
-
-        // 创建图像
-        Mat faceImg(blockSize * 3 + margin * 2 + labelHeight,
-            blockSize * 3 + margin * 2,
-            CV_8UC3,
-            Scalar(240, 240, 240));  // 浅灰色背景
-
-        // 绘制每个色块
-        for (int row = 0; row < 3; row++) {
-            for (int col = 0; col < 3; col++) {
-                char colorCode = colorMatrix[row][col];
+    explicit CubeFaceTracker(rcr_analyzer* library)
+        : library(library), colorCodes(rcr_color_codes(library)) {}
 
-                // 获取颜色
-                Scalar blockColor = Scalar(128, 128, 128); // 默认灰色
-                if (colorCodeMap.find(colorCode) != colorCodeMap.end()) {
-                    blockColor = colorCodeMap.at(colorCode);
-                }
+    bool hasGrid() const {
+        return tracking;
+    }
 
-                // 计算位置
-                int x = margin + col * blockSize;
-                int y = margin + row * blockSize;
-
-                // 绘制色块
-                rectangle(faceImg,
-                    Rect(x, y, blockSize, blockSize),
-                    blockColor,
-                    FILLED);
-
-                // 绘制边框
-                rectangle(faceImg,
-                    Rect(x, y, blockSize, blockSize),
-                    Scalar(50, 50, 50),  // 深灰色边框
-                    2);
-
-                // 在中心绘制颜色代码
-                string codeStr(1, colorCode);
-                putText(faceImg,
-                    codeStr,
-                    Point(x + blockSize / 3, y + 2 * blockSize / 3),
-                    FONT_HERSHEY_SIMPLEX,
-                    0.7,
-                    Scalar(0, 0, 0),  // 黑色文字
-                    2);
-            }
+    /*********************************************************
+     * 处理一帧，返回颜色矩阵（在下一帧之前有效）；
+     * redetected 表示本帧是否做了全图检测
+     *********************************************************/
+    const FaceMatrix<3>& processFrame(const Mat& frame, bool& redetected) {
+        redetected = false;
+        if (!tracking || !trackGrid(frame)) {
+            redetected = true;
+            rcr_image image = imageView(frame);
+            int status = rcr_analyze_batch(library, 1, &image, sizeof(rcr_image),
+                &grid, sizeof(rcr_face_result), nullptr, 0);
+            // 九格齐全（含网格补出的格子）且置信度足够才开始跟踪
+            tracking = status == RCR_OK && grid.status == RCR_FACE_OK && grid.block_count == 9;
         }
 
-        // 添加面名称标签（如果有）
-        if (!faceName.empty()) {
-            putText(faceImg,
-                faceName,
-                Point(margin, faceImg.rows - margin / 2),
-                FONT_HERSHEY_SIMPLEX,
-                0.6,
-                Scalar(0, 0, 0),  // 黑色文字
-                2);
+        // 未检测到网格时矩阵为全空格
+        for (int i = 0; i < 9; i++) {
+            colorMatrix.cells[i] = tracking ? grid.cells[i].color : ' ';
         }
-
-        return faceImg;
+        return colorMatrix;
     }
 
+private:
     /*********************************************************
-     * 绘制魔方展开图（使用标准4x3网格布局）
+     * 只复查九个色块的中心区域：统计各颜色像素比例并跟随主色质心微调位置。
+     * 任一色块主色比例不足时返回 false（跟踪丢失）
      *********************************************************/
-    Mat drawCubeNet(const vector<vector<vector<char>>>& allColorMatrices,
-        const map<char, Scalar>& colorCodeMap) {
-        int margin = 10;
-
-        // 计算画布尺寸：4x3网格布局
-        int cols = 4 * (blockSize * 3 + margin) + margin;
-        int rows = 3 * (blockSize * 3 + margin) + margin;
-        Mat cubeNet = Mat::zeros(rows, cols, CV_8UC3);
-        cubeNet.setTo(Scalar(240, 240, 240)); // 浅灰色背景
-
-        // 标准魔方展开图布局：
-        // 位置: (列, 行) 每个单位是一个面的大小+边距
-        vector<Point> facePositions = {
-            Point(1, 0),  // Up: 第0行第1列
-            Point(0, 1),  // Left: 第1行第0列
-            Point(1, 1),  // Front: 第1行第1列
-            Point(2, 1),  // Right: 第1行第2列
-            Point(3, 1),  // Back: 第1行第3列
-            Point(1, 2)   // Down: 第2行第1列
-        };
-
-        vector<string> faceLabels = { "Up", "Left", "Front", "Right", "Back", "Down" };
-
-        for (int i = 0; i < allColorMatrices.size() && i < 6; i++) {
-            Point pos = facePositions[i];
-            int x = margin + pos.x * (blockSize * 3 + margin);
-            int y = margin + pos.y * (blockSize * 3 + margin);
-
-            // 绘制单个面
-            for (int r = 0; r < 3; r++) {
-                for (int c = 0; c < 3; c++) {
-                    char colorCode = allColorMatrices[i][r][c];
-                    Scalar color = Scalar(128, 128, 128); // 默认灰色
-
-                    if (colorCodeMap.find(colorCode) != colorCodeMap.end()) {
-                        color = colorCodeMap.at(colorCode);
+    bool trackGrid(const Mat& frame) {
+        Rect frameRect(0, 0, frame.cols, frame.rows);
+        size_t colors = min(colorCodes.size(), (size_t)8);
+
+        for (rcr_cell& cell : grid.cells) {
+            int w = (int)(cell.width * sampleFraction);
+            int h = (int)(cell.height * sampleFraction);
+            Rect sample = Rect((int)cell.center_x - w / 2, (int)cell.center_y - h / 2, w, h) & frameRect;
+            if (sample.area() <= 0) return false;
+
+            // 各色块 ROI 尺寸不同，结果写入同一块缓冲左上角的子区域，避免反复分配
+            if (sampleLabels.rows < sample.height || sampleLabels.cols < sample.width) {
+                Size size(max(sampleLabels.cols, sample.width), max(sampleLabels.rows, sample.height));
+                sampleLabels.create(size, CV_8UC1);
+                sampleMask.create(size, CV_8UC1);
+            }
+            Rect sub(0, 0, sample.width, sample.height);
+            Mat labels = sampleLabels(sub);
+            Mat mask = sampleMask(sub);
+            rcr_image roi = imageView(frame(sample));
+            if (rcr_classify_pixels(library, &roi, labels.data, (int64_t)labels.step) != RCR_OK) return false;
+
+            // 统计每种颜色的像素数（颜色最多 8 种，对应位掩码的 8 位）
+            int counts[8] = { 0 };
+            for (int y = 0; y < labels.rows; y++) {
+                const uchar* p = labels.ptr<uchar>(y);
+                for (int x = 0; x < labels.cols; x++) {
+                    for (size_t ci = 0; ci < colors; ci++) {
+                        if (p[x] & (1 << ci)) counts[ci]++;
                     }
+                }
+            }
 
-                    Rect blockRect(x + c * blockSize, y + r * blockSize, blockSize, blockSize);
-                    rectangle(cubeNet, blockRect, color, FILLED);
-                    rectangle(cubeNet, blockRect, Scalar(50, 50, 50), 2);
-
-                    // 显示颜色代码
-                    string codeStr(1, colorCode);
-                    putText(cubeNet, codeStr,
-                        Point(x + c * blockSize + blockSize / 4,
-                            y + r * blockSize + 3 * blockSize / 4),
-                        FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0), 1);
+            // 优先保持原来的颜色（颜色范围有重叠），否则取像素最多的颜色
+            int total = sample.area();
+            int best = (int)(max_element(counts, counts + colors) - counts);
+            for (size_t ci = 0; ci < colors; ci++) {
+                if (colorCodes[ci] == cell.color && counts[ci] >= minMatchRatio * total) {
+                    best = (int)ci;
+                    break;
                 }
             }
+            if (counts[best] < minMatchRatio * total) return false;
+
+            // 跟随主色像素的质心移动色块
+            bitwise_and(labels, Scalar(1 << best), mask);
+            Moments m = moments(mask, true);
+            if (m.m00 > 0) {
+                Point2f centroid((float)(sample.x + m.m10 / m.m00), (float)(sample.y + m.m01 / m.m00));
+                Point2f shift = centroid - Point2f(cell.center_x, cell.center_y);
+                cell.center_x = centroid.x;
+                cell.center_y = centroid.y;
+                cell.x += cvRound(shift.x);
+                cell.y += cvRound(shift.y);
+            }
 
-            // 添加面标签
-            putText(cubeNet, faceLabels[i], Point(x + 5, y - 5),
-                FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 0, 0), 2);
+            cell.color = colorCodes[best];
         }
+        return true;
+    }
+};
+
+struct VideoOptions {
+    string source;            // 视频文件路径或摄像头编号
+    int maxFrames = 0;        // 0 表示处理到视频结束
+    int threads = 0;          // OpenCV 内部线程数（1 = 单核）
+    int segmentThreads = 1;   // 单张图分割的分块并行数（1 = 串行）
+    int streamRows = 0;       // 条带流式分割的每条行数（0 = 关闭）
+    int pyramidLevels = -1;   // 全图检测时的金字塔层数（默认自动）
+    int32_t extract = RCR_EXTRACT_CONTOURS; // 色块提取后端
+    int32_t detect = RCR_DETECT_SEGMENT;    // 检测模式
+    string metricsFile;       // 指标输出文件（为空时不记录指标）
+    string metricsFormat = "prom";
+    string profile;           // 颜色标定配置名（只读取缓存的模型）
+    string calibrationDir = "calibration";
+};
 
-        return cubeNet;
+/*************************************************************
+ * 视频流模式：从视频文件或 V4L2 设备读取帧并跟踪魔方面
+ *************************************************************/
+int runVideo(const VideoOptions& opt) {
+    VideoCapture cap;
+    bool isDevice = !opt.source.empty() &&
+        all_of(opt.source.begin(), opt.source.end(), [](char ch) { return isdigit((unsigned char)ch); });
+    if (isDevice) {
+#ifdef _WIN32
+        cap.open(atoi(opt.source.c_str()));
+#else
+        cap.open(atoi(opt.source.c_str()), CAP_V4L2);
+#endif
+    }
+    else {
+        cap.open(opt.source);
+    }
+    if (!cap.isOpened()) {
+        cout << "无法打开视频源：" << opt.source << endl;
+        return 1;
     }
 
-    /*********************************************************
-     * 创建检测结果与标准化结果的对比图
-     *********************************************************/
-    Mat createComparisonImage(const Mat& detectionImg,
-        const Mat& standardFace,
-        const string& faceName) {
-        // 调整图像尺寸以匹配
-        Mat resizedDetection, resizedStandard;
-        int targetHeight = 400;
-        int targetWidth = 400;
+    if (opt.threads > 0) {
+        setNumThreads(opt.threads);
+    }
 
-        resize(detectionImg, resizedDetection, Size(targetWidth, targetHeight));
-        resize(standardFace, resizedStandard, Size(targetWidth, targetHeight));
+    rcr_options options;
+    rcr_default_options(&options);
+    options.segment_threads = opt.segmentThreads;
+    options.pyramid_levels = opt.pyramidLevels;
+    options.extract_backend = opt.extract;
+    options.detect_mode = opt.detect;
+    options.stream_rows = opt.streamRows;
+    options.collect_metrics = opt.metricsFile.empty() ? 0 : 1;
+    LibraryAnalyzer library = createLibrary(options);
+    if (!library) return 1;
+    if (!opt.profile.empty()) {
+        applyCachedColorModel(library.get(), opt.calibrationDir, opt.profile);
+    }
+    CubeFaceTracker tracker(library.get());
+
+    cout << "视频流模式：" << opt.source << endl;
+
+    vector<double> latencies;
+    FaceMatrix<3> lastMatrix;
+    int redetections = 0;
+    Mat frame;
+
+    int64 start = getTickCount();
+    while (opt.maxFrames <= 0 || (int)latencies.size() < opt.maxFrames) {
+        if (!cap.read(frame) || frame.empty()) break;
+
+        int64 t = getTickCount();
+        bool redetected = false;
+        const FaceMatrix<3>& colorMatrix = tracker.processFrame(frame, redetected);
+        latencies.push_back((getTickCount() - t) * 1000.0 / getTickFrequency());
+        if (redetected) redetections++;
+
+        // 颜色矩阵变化时输出
+        if (colorMatrix != lastMatrix) {
+            cout << "帧 " << latencies.size() - 1 << ": ";
+            for (char color : colorMatrix.cells) {
+                cout << (color == ' ' ? '.' : color);
+            }
+            cout << (tracker.hasGrid() ? "" : "（未检测到完整网格）") << endl;
+            lastMatrix = colorMatrix;
+        }
+    }
+    double wallMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
 
-        // 创建组合图像
-        Mat combined(targetHeight, targetWidth * 2, CV_8UC3, Scalar(240, 240, 240));
+    if (latencies.empty()) {
+        cout << "没有读取到任何帧" << endl;
+        return 1;
+    }
+
+    double processMs = 0;
+    for (double ms : latencies) processMs += ms;
+    size_t frames = latencies.size();
+
+    cout << "\n============== 视频流统计 ==============\n";
+    cout << fixed << setprecision(2);
+    cout << "帧数: " << frames << "（" << frame.cols << "x" << frame.rows << "）" << endl;
+    cout << "持续帧率（含解码）: " << frames * 1000.0 / wallMs << " fps" << endl;
+    cout << "处理帧率（不含解码）: " << frames * 1000.0 / processMs << " fps" << endl;
+    cout << "单帧延迟: p50 " << percentile(latencies, 50) << " ms, p90 " << percentile(latencies, 90)
+        << " ms, p99 " << percentile(latencies, 99) << " ms, 最大 " << percentile(latencies, 100) << " ms" << endl;
+    cout << "全图重新检测: " << redetections << " 次（" << 100.0 * redetections / frames << "% 的帧）" << endl;
+
+    if (!opt.metricsFile.empty()) {
+        exportMetrics(library.get(), opt.metricsFile, opt.metricsFormat);
+    }
 
-        // 将检测图像放在左侧
-        Mat leftROI = combined(Rect(0, 0, targetWidth, targetHeight));
-        resizedDetection.copyTo(leftROI);
+    return 0;
+}
 
-        // 将标准化图像放在右侧
-        Mat rightROI = combined(Rect(targetWidth, 0, targetWidth, targetHeight));
-        resizedStandard.copyTo(rightROI);
+/*************************************************************
+ * 服务模式：常驻进程，识别库句柄（查找表）只初始化一次，
+ * 通过本地套接字接收六张编码图像并返回识别结果；Ctrl+C / SIGTERM 退出
+ *************************************************************/
+static atomic<bool> stopRequested{ false };
+
+static void onStopSignal(int) {
+    stopRequested = true;
+}
+
+int runServe(const BatchOptions& opt, const ServerOptions& serverOpt) {
+    ImageLoader loader(false);
+    loader.setReduce(opt.decodeReduce);
+    LibraryAnalyzer library = createLibrary(libraryOptions(opt));
+    if (!library) return 1;
+    if (!opt.profile.empty()) {
+        applyCachedColorModel(library.get(), opt.calibrationDir, opt.profile);
+    }
 
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
 
+    RecognitionServer server(library.get(), loader, serverOpt);
+    return server.run(stopRequested) ? 0 : 1;
+}
 
-        return combined;
+/*************************************************************
+ * 解析批处理各阶段的线程数：解码,分析,绘制,写入（0 = 自动），失败返回 false
+ *************************************************************/
+static bool parseStageWidths(const string& text, BatchOptions& opt) {
+    int* widths[4] = { &opt.decodeThreads, &opt.threads, &opt.renderThreads, &opt.writeThreads };
+    stringstream ss(text);
+    string item;
+    int count = 0;
+    while (getline(ss, item, ',')) {
+        if (count == 4 || item.empty() || !all_of(item.begin(), item.end(), ::isdigit)) return false;
+        *widths[count++] = atoi(item.c_str());
     }
-};
+    return count == 4;
+}
+
+static void printUsage(const char* prog) {
+    cout << "用法：" << endl;
+    cout << "  " << prog << "                       交互模式（处理 data/cubeface1..6.jpg）" << endl;
+    cout << "  " << prog << " --batch <清单|目录> [--output 目录] [--threads N] [--segment-threads N]" << endl;
+    cout << "        [--stages 解码,分析,绘制,写入] [--stage-queue N]" << endl;
+    cout << "        [--output-level none|codes|standard|full] [--no-images] [--decode-reduce 1|2|4|8|auto]" << endl;
+    cout << "        [--stream-rows N]（条带流式分割，忽略 --extract；解码后的整幅输入图像不在条带内存之内）" << endl;
+    cout << "        [--pyramid N|auto] [--refine] [--extract contours|components] [--detect segment|quad]" << endl;
+    cout << "        [--metrics 文件 [--metrics-format prom|jsonl]]" << endl;
+    cout << "        [--solve [--solver-tables 文件] [--max-length N]]" << endl;
+    cout << "        [--profile 配置名 [--calibration-dir 目录] [--recalibrate]]" << endl;
+    cout << "        [--cache 目录]（结果缓存只用于 none/codes/standard 级别，full 级别不使用）" << endl;
+    cout << "  " << prog << " --video <文件|设备编号> [--max-frames N] [--threads N] [--segment-threads N]" << endl;
+    cout << "        [--pyramid N|auto] [--extract contours|components] [--detect segment|quad] [--stream-rows N]" << endl;
+    cout << "        [--profile 配置名 [--calibration-dir 目录]]" << endl;
+    cout << "        [--metrics 文件 [--metrics-format prom|jsonl]]" << endl;
+    cout << "  " << prog << " --serve <套接字路径> [--threads N] [--segment-threads N] [--queue N] [--quiet]" << endl;
+    cout << "        [--max-connections N]" << endl;
+    cout << "        [--decode-reduce 1|2|4|8|auto] [--pyramid N|auto] [--extract contours|components]" << endl;
+    cout << "        [--detect segment|quad] [--stream-rows N] [--profile 配置名 [--calibration-dir 目录]]" << endl;
+}
 
 /*************************************************************
- * 主程序
+ * 交互模式：六张图作为一批交给识别库，检测叠加图、标准面、
+ * 对比图与展开图都由库绘制
  *************************************************************/
-int main() {
+int runInteractive() {
     ImageLoader loader;
-    CubeFaceAnalyzer analyzer;
-    CubeVisualizer visualizer;
-
-    // 获取颜色映射
-    map<char, Scalar> colorCodeMap = analyzer.getColorCodeMap();
+    rcr_options options;
+    rcr_default_options(&options);
+    options.threads = 6;
+    LibraryAnalyzer library = createLibrary(options);
+    if (!library) return 1;
+    string colorCodes = rcr_color_codes(library.get());
 
     // 六张魔方图像
     vector<string> filenames = {
@@ -467,54 +1209,76 @@ int main() {
         "data/cubeface6.jpg"
     };
 
-    vector<string> faceNames = { "Front", "Back", "Left", "Right", "Up", "Down" };
-    vector<vector<vector<char>>> allColorMatrices; // 存储所有面的颜色矩阵
-    vector<Mat> standardFaces; // 存储标准化后的面
+    // 存储所有面的颜色矩阵，加载或识别失败的面为全空格
+    CubeMatrices<3> allColorMatrices;
 
     // 创建输出目录
-    system("mkdir -p output");
+    filesystem::create_directories("output");
 
     cout << "===== 魔方颜色检测程序 =====" << endl;
     cout << "注意：请确保图像文件位于 data/ 目录下" << endl << endl;
 
-    // 处理每个面
-    for (int i = 0; i < filenames.size(); i++) {
-        cout << "\n============== 处理第 " << (i + 1) << " 张图 (" << faceNames[i] << ") ==============\n";
-
-        // 1) 加载图像
-        Mat img = loader.loadImage(filenames[i]);
-        if (img.empty()) continue;
-
-        // 2) 克隆原图，用于处理
-        Mat processedImg = img.clone();
+    // 1) 加载六张图像，成功加载的面作为一批提交，库同时写出检测叠加图
+    Mat images[6], processed[6];
+    rcr_image views[6];
+    rcr_canvas overlays[6];
+    rcr_face_result results[6];
+    int batchFaces[6];
+    size_t count = 0;
+    for (int i = 0; i < 6; i++) {
+        images[i] = loader.loadImage(filenames[i]);
+        if (images[i].empty()) continue;
+        processed[i].create(images[i].size(), CV_8UC3);
+        batchFaces[count] = i;
+        views[count] = imageView(images[i]);
+        overlays[count] = canvasView(processed[i]);
+        count++;
+    }
 
-        // 3) 分析魔方面，检测色块
-        vector<ColorBlock> blocks = analyzer.analyzeCubeFace(img, processedImg, true);
+    int64 analyzeStart = getTickCount();
+    int status = rcr_analyze_batch(library.get(), count, views, sizeof(rcr_image),
+        results, sizeof(rcr_face_result), overlays, sizeof(rcr_canvas));
+    double analyzeMs = (getTickCount() - analyzeStart) * 1000.0 / getTickFrequency();
+    if (status != RCR_OK) {
+        cerr << "错误：识别失败（" << rcr_status_message(status) << "）" << endl;
+        return 1;
+    }
+    cout << "分析 " << count << " 个面耗时：" << analyzeMs << " ms" << endl;
 
-        cout << "检测到 " << blocks.size() << " 个色块" << endl;
+    // 处理每个面
+    for (size_t k = 0; k < count; k++) {
+        int i = batchFaces[k];
+        const rcr_face_result& result = results[k];
+        const char* label = faceNames[i].c_str();
+        cout << "\n============== 处理第 " << (i + 1) << " 张图 (" << faceNames[i] << ") ==============\n";
+        cout << "检测到 " << result.block_count << " 个色块" << endl;
 
-        // 4) 创建颜色矩阵并打印
-        vector<vector<char>> colorMatrix = analyzer.createColorMatrix(blocks);
+        // 2) 保存颜色矩阵并打印
+        FaceMatrix<3>& colorMatrix = allColorMatrices[i];
+        colorMatrix.assign(result.colors);
 
         cout << "颜色矩阵 (" << faceNames[i] << "):" << endl;
         for (int row = 0; row < 3; row++) {
             for (int col = 0; col < 3; col++) {
-                cout << colorMatrix[row][col] << " ";
+                cout << colorMatrix.at(row, col) << " ";
             }
             cout << endl;
         }
 
-        // 5) 保存颜色矩阵
-        allColorMatrices.push_back(colorMatrix);
-
-        // 6) 创建标准化面
-        Mat standardFace = visualizer.drawStandardFace(colorMatrix, colorCodeMap, faceNames[i]);
-        standardFaces.push_back(standardFace);
+        // 3) 创建标准化面与检测结果的对比图
+        int32_t width = 0, height = 0;
+        rcr_standard_face_size(label, &width, &height);
+        Mat standardFace(height, width, CV_8UC3);
+        rcr_canvas canvas = canvasView(standardFace);
+        rcr_render_standard_face(library.get(), result.colors, label, &canvas);
 
-        // 7) 创建检测结果与标准化结果的对比图
-        Mat comparison = visualizer.createComparisonImage(processedImg, standardFace, faceNames[i]);
+        rcr_comparison_size(&width, &height);
+        Mat comparison(height, width, CV_8UC3);
+        rcr_image detection = imageView(processed[i]);
+        canvas = canvasView(comparison);
+        rcr_render_comparison(library.get(), &detection, result.colors, label, &canvas);
 
-        // 8) 显示和保存结果
+        // 4) 显示和保存结果
         string windowName = "Face " + to_string(i + 1) + " - " + faceNames[i];
         imshow(windowName, comparison);
 
@@ -523,7 +1287,7 @@ int main() {
         string standardPath = "output/standard_" + faceNames[i] + ".jpg";
         string comparisonPath = "output/comparison_" + faceNames[i] + ".jpg";
 
-        imwrite(processedPath, processedImg);
+        imwrite(processedPath, processed[i]);
         imwrite(standardPath, standardFace);
         imwrite(comparisonPath, comparison);
 
@@ -537,23 +1301,16 @@ int main() {
         destroyAllWindows();
     }
 
-    // 9) 绘制完整的魔方展开图
-    if (allColorMatrices.size() >= 1) {
-        // 重新排序颜色矩阵以匹配展开图布局：Up, Left, Front, Right, Back, Down
-        vector<vector<vector<char>>> reorderedMatrices;
-        vector<string> reorderedNames = { "Up", "Left", "Front", "Right", "Back", "Down" };
+    // 5) 绘制完整的魔方展开图（库按 Up, Left, Front, Right, Back, Down 布局）
+    if (count >= 1) {
+        char codes[54];
+        cubeCodes(allColorMatrices, codes);
 
-        // 原始顺序：Front, Back, Left, Right, Up, Down
-        // 新顺序：Up(4), Left(2), Front(0), Right(3), Back(1), Down(5)
-        vector<int> order = { 4, 2, 0, 3, 1, 5 };
-
-        for (int idx : order) {
-            if (idx < allColorMatrices.size()) {
-                reorderedMatrices.push_back(allColorMatrices[idx]);
-            }
-        }
-
-        Mat cubeNet = visualizer.drawCubeNet(reorderedMatrices, colorCodeMap);
+        int32_t width = 0, height = 0;
+        rcr_cube_net_size(&width, &height);
+        Mat cubeNet(height, width, CV_8UC3);
+        rcr_canvas canvas = canvasView(cubeNet);
+        rcr_render_cube_net(library.get(), codes, RCR_NET_ALL_FACES, &canvas);
         imshow("魔方展开图", cubeNet);
 
         // 保存魔方展开图
@@ -566,7 +1323,7 @@ int main() {
             cout << "\n面 " << faceNames[i] << ":" << endl;
             for (int row = 0; row < 3; row++) {
                 for (int col = 0; col < 3; col++) {
-                    cout << allColorMatrices[i][row][col] << " ";
+                    cout << allColorMatrices[i].at(row, col) << " ";
                 }
                 cout << endl;
             }
@@ -576,11 +1333,9 @@ int main() {
         cout << "\n============== 颜色分组统计 ==============\n";
         map<char, int> colorCount;
         for (const auto& matrix : allColorMatrices) {
-            for (const auto& row : matrix) {
-                for (char color : row) {
-                    if (color != ' ') {
-                        colorCount[color]++;
-                    }
+            for (char color : matrix.cells) {
+                if (color != ' ') {
+                    colorCount[color]++;
                 }
             }
         }
@@ -589,6 +1344,34 @@ int main() {
         for (const auto& pair : colorCount) {
             cout << "颜色 " << pair.first << ": " << pair.second << " 个色块" << endl;
         }
+        if (rcr_check_color_totals(library.get(), codes) != 1) {
+            cout << "警告：颜色统计不符合每种颜色9个色块" << endl;
+        }
+
+        // 输出标准 URFDLB 色面字符串及可达性校验
+        CubeState state = CubeState::fromMatrices(allColorMatrices, colorCodes);
+        cout << "\n魔方状态（URFDLB）：" << state.toFaceletString() << endl;
+        CubeState::Validation validation = state.validate();
+        cout << "状态校验：" << CubeState::validationMessage(validation) << endl;
+
+        // 两阶段求解（求解表首次运行时构建并缓存到 solver_tables.bin）
+        if (validation == CubeState::VALID) {
+            CubeSolver solver;
+            if (solver.load("solver_tables.bin")) {
+                CubieCube cube;
+                state.toCubie(cube);
+                CubeSolver::Result result = solver.solve(cube);
+                cout << "求解表" << (solver.loadedFromCache() ? "映射" : "构建") << "耗时: "
+                    << solver.getLoadMs() << " ms" << endl;
+                if (result.solved) {
+                    cout << "解法（" << result.moves.size() << " 步）：" << result.text() << endl;
+                }
+                else {
+                    cout << "未找到解" << endl;
+                }
+                cout << "求解耗时: " << result.ms << " ms，展开节点: " << result.nodes << endl;
+            }
+        }
 
         waitKey(0);
         destroyAllWindows();
@@ -598,4 +1381,145 @@ int main() {
     cout << "所有结果已保存到 output/ 目录下" << endl;
 
     return 0;
-}
\ No newline at end of file
+}
+
+/*************************************************************
+ * 主程序
+ *************************************************************/
+int main(int argc, char** argv) {
+    if (argc == 1) {
+        return runInteractive();
+    }
+
+    BatchOptions opt;
+    VideoOptions videoOpt;
+    ServerOptions serverOpt;
+    bool batch = false;
+    bool video = false;
+    bool serve = false;
+    bool extractGiven = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) {
+            batch = true;
+            opt.input = argv[++i];
+        }
+        else if (arg == "--video" && i + 1 < argc) {
+            video = true;
+            videoOpt.source = argv[++i];
+        }
+        else if (arg == "--serve" && i + 1 < argc) {
+            serve = true;
+            serverOpt.socketPath = argv[++i];
+        }
+        else if (arg == "--queue" && i + 1 < argc) {
+            serverOpt.queueCapacity = atoi(argv[++i]);
+        }
+        else if (arg == "--max-connections" && i + 1 < argc) {
+            serverOpt.maxConnections = atoi(argv[++i]);
+        }
+        else if (arg == "--quiet") {
+            serverOpt.logRequests = false;
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            opt.outputDir = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = videoOpt.threads = serverOpt.workers = atoi(argv[++i]);
+        }
+        else if (arg == "--stages" && i + 1 < argc) {
+            if (!parseStageWidths(argv[++i], opt)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--stage-queue" && i + 1 < argc) {
+            opt.stageQueue = atoi(argv[++i]);
+        }
+        else if (arg == "--segment-threads" && i + 1 < argc) {
+            opt.segmentThreads = videoOpt.segmentThreads = atoi(argv[++i]);
+        }
+        else if (arg == "--stream-rows" && i + 1 < argc) {
+            opt.streamRows = videoOpt.streamRows = atoi(argv[++i]);
+        }
+        else if (arg == "--output-level" && i + 1 < argc) {
+            if (!parseOutputLevel(argv[++i], opt.outputLevel)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--decode-reduce" && i + 1 < argc) {
+            string factor = argv[++i];
+            opt.decodeReduce = factor == "auto" ? 0 : atoi(factor.c_str());
+        }
+        else if (arg == "--no-images") {
+            opt.outputLevel = OUTPUT_CODES;
+        }
+        else if (arg == "--pyramid" && i + 1 < argc) {
+            string levels = argv[++i];
+            opt.pyramidLevels = videoOpt.pyramidLevels = levels == "auto" ? -1 : atoi(levels.c_str());
+        }
+        else if (arg == "--extract" && i + 1 < argc) {
+            if (!parseExtractName(argv[++i], opt.extract)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            videoOpt.extract = opt.extract;
+            extractGiven = true;
+        }
+        else if (arg == "--detect" && i + 1 < argc) {
+            if (!parseDetectName(argv[++i], opt.detect)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            videoOpt.detect = opt.detect;
+        }
+        else if (arg == "--refine") {
+            opt.refine = true;
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            opt.metricsFile = videoOpt.metricsFile = argv[++i];
+        }
+        else if (arg == "--metrics-format" && i + 1 < argc) {
+            opt.metricsFormat = videoOpt.metricsFormat = argv[++i];
+        }
+        else if (arg == "--solve") {
+            opt.solve = true;
+        }
+        else if (arg == "--solver-tables" && i + 1 < argc) {
+            opt.solverTables = argv[++i];
+        }
+        else if (arg == "--max-length" && i + 1 < argc) {
+            opt.maxSolveLength = atoi(argv[++i]);
+        }
+        else if (arg == "--profile" && i + 1 < argc) {
+            opt.profile = videoOpt.profile = argv[++i];
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            opt.cacheDir = argv[++i];
+        }
+        else if (arg == "--calibration-dir" && i + 1 < argc) {
+            opt.calibrationDir = videoOpt.calibrationDir = argv[++i];
+        }
+        else if (arg == "--recalibrate") {
+            opt.recalibrate = true;
+        }
+        else if (arg == "--max-frames" && i + 1 < argc) {
+            videoOpt.maxFrames = atoi(argv[++i]);
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if ((int)batch + (int)video + (int)serve != 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (opt.streamRows > 0 && extractGiven) {
+        cerr << "警告：--stream-rows 打开时总是用游程统计提取色块，--extract 被忽略" << endl;
+    }
+    if (serve) return runServe(opt, serverOpt);
+    return video ? runVideo(videoOpt) : runBatch(opt);
+}
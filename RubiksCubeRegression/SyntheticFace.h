@@ -0,0 +1,355 @@
+﻿#pragma once
+
+#include "../RubiksCubeRecognition/CubeRecognition.h"
+#include "../RubiksCubeRecognition/CubeState.h"
+
+#include <sstream>
+#include <iomanip>
+
+/*************************************************************
+ * 合成魔方面的生成参数：每个面在这些范围内独立随机取值
+ *************************************************************/
+struct SyntheticOptions {
+    int minSide = 480;              // 图像短边范围（像素）
+    int maxSide = 1600;
+    double minFaceFraction = 0.6;   // 魔方面边长占短边的比例（过小时色块低于面积下限）
+    double maxFaceFraction = 0.85;
+    double maxRotation = 30;        // 面内旋转上限（度），超过 45 度时上下方向有歧义
+    double perspective = 0.08;      // 四角随机偏移占边长的比例（透视/梯形）
+    double tint = 0.10;             // 各通道增益的随机偏差（光源色温）
+    double lighting = 0.25;         // 亮度与光照梯度的随机幅度
+    double noise = 6;               // 高斯噪声标准差上限（灰度级）
+    double blur = 1.0;              // 高斯模糊 sigma 上限（失焦）
+    int minJpegQuality = 50;
+    int maxJpegQuality = 95;
+    int clutter = 3;                // 背景中小块彩色干扰物的最大数量（远小于色块面积下限）
+    double lightBody = 0;           // 浅色底座（白色塑料）的面所占比例，其余为黑色底座
+    double busyBackground = 0;      // 背景铺满大块深浅交替图形的面所占比例
+};
+
+/*************************************************************
+ * 一个合成面：JPEG 编码数据、真值颜色矩阵与实际采用的参数
+ *************************************************************/
+struct SyntheticFace {
+    vector<uchar> jpeg;
+    vector<vector<char>> truth;     // 3x3 颜色代码，行列与图像中的方向一致
+    Size size;
+    double rotation = 0;            // 度
+    double perspective = 0;         // 实际抽到的四角偏移中绝对值最大的一个（占边长的比例）
+    double noise = 0;
+    double blur = 0;
+    Vec3d gains = Vec3d(1, 1, 1);   // B, G, R 通道增益（不含亮度梯度）
+    int jpegQuality = 0;
+    bool lightBody = false;         // 浅色底座
+    bool busyBackground = false;    // 杂乱背景
+
+    // 参数的单行描述（写在真值文件的注释行里，parseDescription 可读回）
+    string describe() const {
+        ostringstream out;
+        out << fixed << setprecision(3);
+        out << "size=" << size.width << "x" << size.height << " rot=" << rotation << " persp=" << perspective
+            << " gains=" << gains[0] << "," << gains[1] << "," << gains[2] << " noise=" << noise
+            << " blur=" << blur << " jpeg=" << jpegQuality << " body=" << (lightBody ? "light" : "dark")
+            << " bg=" << (busyBackground ? "busy" : "plain");
+        return out.str();
+    }
+
+    void parseDescription(const string& text) {
+        istringstream in(text);
+        string token;
+        while (in >> token) {
+            size_t eq = token.find('=');
+            if (eq == string::npos) continue;
+            string key = token.substr(0, eq);
+            const char* value = token.c_str() + eq + 1;
+            if (key == "size") sscanf(value, "%dx%d", &size.width, &size.height);
+            else if (key == "rot") rotation = atof(value);
+            else if (key == "persp") perspective = atof(value);
+            else if (key == "gains") sscanf(value, "%lf,%lf,%lf", &gains[0], &gains[1], &gains[2]);
+            else if (key == "noise") noise = atof(value);
+            else if (key == "blur") blur = atof(value);
+            else if (key == "jpeg") jpegQuality = atoi(value);
+            else if (key == "body") lightBody = strcmp(value, "light") == 0;
+            else if (key == "bg") busyBackground = strcmp(value, "busy") == 0;
+        }
+    }
+};
+
+/*************************************************************
+ * 合成魔方面生成器：从均匀随机的合法魔方状态出发，
+ * 把每个面画成黑色（或浅色）底座上的 3x3 圆角贴纸，再经旋转、透视、
+ * 光源色温与亮度梯度、噪声、模糊和 JPEG 压缩得到一张“照片”。
+ * 贴纸颜色取自真实照片中实测的参考色（与分析器的阈值和查找表无关，
+ * 因此测得的准确率不会因为“用分析器自己的颜色定义出题”而虚高），
+ * 各种扰动再把颜色推向边界。构造后只读，可被多个线程共享
+ *************************************************************/
+class SyntheticFaceGenerator {
+private:
+    SyntheticOptions options;
+    string colorCodes;
+    vector<vector<Vec3b>> palettes;  // 每种颜色可用的贴纸 BGR 值
+
+    static constexpr int cellSize = 200;          // 标准面上每格边长
+    static constexpr int faceSize = 3 * cellSize;
+
+    static int permutationParity(const uint8_t* p, int n) {
+        int inversions = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (p[i] > p[j]) inversions++;
+            }
+        }
+        return inversions & 1;
+    }
+
+    /*********************************************************
+     * 参考色（BGR）：data/cubeface1..6.jpg 中 54 张贴纸各取中心
+     * 61x61 区域的均值，按色相与明度人工归类，每种颜色正好 9 张。
+     * 只按颜色代码对应，分析器换阈值或标定模型时参考色不变
+     *********************************************************/
+    static const map<char, vector<Vec3b>>& referenceColors() {
+        static const map<char, vector<Vec3b>> colors = {
+            { 'R', { {43,30,121}, {43,25,127}, {48,26,111}, {52,28,138}, {45,24,123}, {39,21,128}, {42,23,116}, {41,26,121}, {33,18,103} } },
+            { 'Y', { {94,215,158}, {85,196,140}, {77,225,174}, {106,220,163}, {97,209,146}, {100,215,152}, {99,225,169}, {96,223,163}, {92,214,144} } },
+            { 'G', { {82,173,5}, {73,168,6}, {70,161,5}, {80,168,5}, {72,162,5}, {90,165,4}, {94,158,4}, {94,170,5}, {79,151,8} } },
+            { 'B', { {199,108,8}, {194,104,6}, {197,105,7}, {190,98,5}, {179,88,4}, {187,98,18}, {206,117,20}, {194,103,6}, {184,93,5} } },
+            { 'W', { {239,191,166}, {229,181,154}, {241,198,176}, {243,189,164}, {241,186,158}, {235,181,151}, {220,170,141}, {229,175,142}, {217,164,130} } },
+            { 'P', { {100,73,243}, {104,69,231}, {118,79,248}, {124,83,248}, {113,75,243}, {123,82,248}, {129,87,248}, {131,87,248}, {132,89,248} } }
+        };
+        return colors;
+    }
+
+    void buildPalettes(const CubeFaceAnalyzer& analyzer) {
+        const auto& reference = referenceColors();
+        palettes.assign(colorCodes.size(), vector<Vec3b>());
+        for (size_t ci = 0; ci < colorCodes.size(); ci++) {
+            auto it = reference.find(colorCodes[ci]);
+            if (it != reference.end()) {
+                palettes[ci] = it->second;
+                continue;
+            }
+            cerr << "警告：颜色 " << colorCodes[ci] << " 没有参考色，改用其绘制颜色" << endl;
+            Scalar c = analyzer.getColorTable()[ci].drawColor;
+            palettes[ci].push_back(Vec3b((uchar)c[0], (uchar)c[1], (uchar)c[2]));
+        }
+    }
+
+    static void fillRoundedRect(Mat& img, Rect box, int radius, const Scalar& color) {
+        rectangle(img, Rect(box.x + radius, box.y, box.width - 2 * radius, box.height), color, FILLED);
+        rectangle(img, Rect(box.x, box.y + radius, box.width, box.height - 2 * radius), color, FILLED);
+        int x0 = box.x + radius, x1 = box.x + box.width - 1 - radius;
+        int y0 = box.y + radius, y1 = box.y + box.height - 1 - radius;
+        for (Point c : { Point(x0, y0), Point(x1, y0), Point(x0, y1), Point(x1, y1) }) {
+            circle(img, c, radius, color, FILLED, LINE_AA);
+        }
+    }
+
+    // 标准正视图：黑色或浅灰白色底座 + 3x3 圆角贴纸（每张贴纸在该颜色的参考色中随机取一个）
+    Mat drawCanonicalFace(const vector<vector<char>>& matrix, bool lightBody, RNG& rng) const {
+        Mat face(faceSize, faceSize, CV_8UC3, lightBody ? Scalar(212, 214, 216) : Scalar(18, 18, 20));
+        int gap = cellSize * 8 / 100;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                size_t ci = colorCodes.find(matrix[r][c]);
+                if (ci == string::npos) continue;
+                const vector<Vec3b>& palette = palettes[ci];
+                Vec3b p = palette[rng.uniform(0, (int)palette.size())];
+                Rect box(c * cellSize + gap, r * cellSize + gap, cellSize - 2 * gap, cellSize - 2 * gap);
+                fillRoundedRect(face, box, cellSize / 10, Scalar(p[0], p[1], p[2]));
+            }
+        }
+        return face;
+    }
+
+    // 中性色背景：暖灰底色 + 低频纹理，避开各颜色的阈值范围；
+    // 杂乱背景另铺大块深浅交替的矩形与粗线条（书本、键盘、桌面花纹）
+    void drawBackground(Mat& img, bool busy, RNG& rng) const {
+        double base = rng.uniform(50.0, 200.0);
+        double warm = rng.uniform(0.0, 12.0);
+        img.setTo(Scalar(base - warm, base, base + warm * 0.5));
+
+        Mat texture(8, 8, CV_8UC1);
+        for (int y = 0; y < texture.rows; y++) {
+            for (int x = 0; x < texture.cols; x++) {
+                texture.at<uchar>(y, x) = (uchar)rng.uniform(0, 40);
+            }
+        }
+        Mat smooth;
+        resize(texture, smooth, img.size(), 0, 0, INTER_CUBIC);
+        for (int y = 0; y < img.rows; y++) {
+            Vec3b* row = img.ptr<Vec3b>(y);
+            const uchar* t = smooth.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; x++) {
+                int d = t[x] - 20;
+                for (int k = 0; k < 3; k++) row[x][k] = saturate_cast<uchar>(row[x][k] + d);
+            }
+        }
+        if (!busy) return;
+
+        int shortSide = min(img.cols, img.rows);
+        int shapes = rng.uniform(12, 30);
+        for (int i = 0; i < shapes; i++) {
+            double gray = rng.uniform(0, 2) ? rng.uniform(10.0, 60.0) : rng.uniform(190.0, 245.0);
+            Scalar color(gray, gray, gray);
+            Point a(rng.uniform(0, img.cols), rng.uniform(0, img.rows));
+            if (rng.uniform(0, 3)) {
+                int w = (int)(shortSide * rng.uniform(0.05, 0.4)), h = (int)(shortSide * rng.uniform(0.05, 0.4));
+                rectangle(img, Rect(a.x - w / 2, a.y - h / 2, w, h), color, FILLED);
+            }
+            else {
+                Point b(rng.uniform(0, img.cols), rng.uniform(0, img.rows));
+                line(img, a, b, color, max(2, (int)(shortSide * rng.uniform(0.01, 0.04))), LINE_AA);
+            }
+        }
+    }
+
+public:
+    SyntheticFaceGenerator(const CubeFaceAnalyzer& analyzer, const SyntheticOptions& options = SyntheticOptions())
+        : options(options), colorCodes(analyzer.getColorCodeString()) {
+        buildPalettes(analyzer);
+    }
+
+    const SyntheticOptions& getOptions() const {
+        return options;
+    }
+
+    // 每种颜色的参考色数量（用于报告）
+    vector<size_t> paletteSizes() const {
+        vector<size_t> sizes;
+        for (const auto& p : palettes) sizes.push_back(p.size());
+        return sizes;
+    }
+
+    /*********************************************************
+     * 均匀随机的合法块层状态：随机排列与朝向，再修正朝向和与排列奇偶
+     *********************************************************/
+    static CubieCube randomCube(RNG& rng) {
+        CubieCube cube;
+        for (int i = 0; i < 8; i++) cube.cp[i] = (uint8_t)i;
+        for (int i = 0; i < 12; i++) cube.ep[i] = (uint8_t)i;
+        for (int i = 7; i > 0; i--) swap(cube.cp[i], cube.cp[rng.uniform(0, i + 1)]);
+        for (int i = 11; i > 0; i--) swap(cube.ep[i], cube.ep[rng.uniform(0, i + 1)]);
+        if (permutationParity(cube.cp, 8) != permutationParity(cube.ep, 12)) {
+            swap(cube.ep[10], cube.ep[11]);
+        }
+
+        int twist = 0, flip = 0;
+        for (int i = 0; i < 7; i++) {
+            cube.co[i] = (uint8_t)rng.uniform(0, 3);
+            twist += cube.co[i];
+        }
+        cube.co[7] = (uint8_t)((3 - twist % 3) % 3);
+        for (int i = 0; i < 11; i++) {
+            cube.eo[i] = (uint8_t)rng.uniform(0, 2);
+            flip += cube.eo[i];
+        }
+        cube.eo[11] = (uint8_t)(flip % 2);
+        return cube;
+    }
+
+    /*********************************************************
+     * 由种子生成一个魔方的六个面（输入顺序 Front, Back, Left, Right, Up, Down）。
+     * 每个面的随机数由 (seed, 面下标) 决定，结果与线程调度无关
+     *********************************************************/
+    CubeState renderCube(uint64 seed, vector<SyntheticFace>& faces) const {
+        RNG rng(seed * 7 + 1);
+        static const uint8_t colorOfFace[6] = { 0, 1, 2, 3, 4, 5 };
+        CubeState truth = CubeState::fromCubie(randomCube(rng), colorOfFace);
+
+        vector<vector<vector<char>>> matrices;
+        truth.toMatrices(matrices, colorCodes);
+        faces.resize(6);
+        for (int f = 0; f < 6; f++) {
+            RNG faceRng(seed * 7 + 2 + f);
+            renderFace(matrices[f], faceRng, faces[f]);
+        }
+        return truth;
+    }
+
+    /*********************************************************
+     * 渲染一个面：背景 -> 干扰物 -> 透视变换后的魔方面 -> 光照 ->
+     * 噪声 -> 模糊 -> JPEG 编码
+     *********************************************************/
+    void renderFace(const vector<vector<char>>& matrix, RNG& rng, SyntheticFace& out) const {
+        const SyntheticOptions& o = options;
+        out.truth = matrix;
+
+        // 尺寸：短边随机，长宽比 1:1 或 4:3（横竖随机）
+        int shortSide = rng.uniform(o.minSide, o.maxSide + 1);
+        int longSide = rng.uniform(0, 2) ? shortSide : shortSide * 4 / 3;
+        out.size = rng.uniform(0, 2) ? Size(longSide, shortSide) : Size(shortSide, longSide);
+
+        // 场景类型：比例为 0 时不消耗随机数，已有种子生成的图像不变
+        out.lightBody = o.lightBody > 0 && rng.uniform(0.0, 1.0) < o.lightBody;
+        out.busyBackground = o.busyBackground > 0 && rng.uniform(0.0, 1.0) < o.busyBackground;
+
+        Mat img(out.size, CV_8UC3);
+        drawBackground(img, out.busyBackground, rng);
+
+        // 旋转与透视后的外接范围不超过短边的 95%，避免角块被裁掉
+        out.rotation = rng.uniform(-o.maxRotation, o.maxRotation);
+        double angle = out.rotation * CV_PI / 180, cs = cos(angle), sn = sin(angle);
+        double spread = fabs(cs) + fabs(sn) + 2 * o.perspective;
+        double side = min(shortSide * rng.uniform(o.minFaceFraction, o.maxFaceFraction), shortSide * 0.95 / spread);
+        double sticker = side / 3 * 0.84;
+
+        // 干扰物：远小于色块面积下限的彩色小方块，大多会被魔方面盖住或被面积过滤掉
+        int clutter = o.clutter > 0 ? rng.uniform(0, o.clutter + 1) : 0;
+        for (int i = 0; i < clutter; i++) {
+            const vector<Vec3b>& palette = palettes[rng.uniform(0, (int)palettes.size())];
+            Vec3b p = palette[rng.uniform(0, (int)palette.size())];
+            int s = max(2, (int)(sticker * rng.uniform(0.1, 0.3)));
+            Point at(rng.uniform(0, max(1, img.cols - s)), rng.uniform(0, max(1, img.rows - s)));
+            rectangle(img, Rect(at.x, at.y, s, s), Scalar(p[0], p[1], p[2]), FILLED);
+        }
+
+        // 魔方面：中心偏移、旋转、四角随机偏移（透视）
+        Mat face = drawCanonicalFace(matrix, out.lightBody, rng);
+        double slack = max(0.0, (shortSide * 0.95 - side * spread) / 2);
+        Point2f center((float)(img.cols / 2.0 + rng.uniform(-1.0, 1.0) * slack),
+            (float)(img.rows / 2.0 + rng.uniform(-1.0, 1.0) * slack));
+        Point2f src[4] = { Point2f(0, 0), Point2f((float)faceSize, 0),
+            Point2f((float)faceSize, (float)faceSize), Point2f(0, (float)faceSize) };
+        Point2f dst[4];
+        static const int corner[4][2] = { {-1,-1}, {1,-1}, {1,1}, {-1,1} };
+        out.perspective = 0;
+        for (int k = 0; k < 4; k++) {
+            double dx = rng.uniform(-o.perspective, o.perspective), dy = rng.uniform(-o.perspective, o.perspective);
+            out.perspective = max(out.perspective, max(fabs(dx), fabs(dy)));
+            double x = corner[k][0] * side / 2 + dx * side;
+            double y = corner[k][1] * side / 2 + dy * side;
+            dst[k] = Point2f((float)(center.x + x * cs - y * sn), (float)(center.y + x * sn + y * cs));
+        }
+        Mat H = getPerspectiveTransform(src, dst);
+        warpPerspective(face, img, H, img.size(), INTER_LINEAR, BORDER_TRANSPARENT);
+
+        // 光照：各通道增益（色温）× 四角双线性插值的亮度梯度，同时叠加高斯噪声
+        for (int k = 0; k < 3; k++) out.gains[k] = 1 + rng.uniform(-o.tint, o.tint);
+        double brightness = 1 + rng.uniform(-o.lighting, o.lighting) * 0.5;
+        double cornerGain[4];
+        for (double& g : cornerGain) g = brightness * (1 + rng.uniform(-o.lighting, o.lighting) * 0.5);
+        out.noise = rng.uniform(0.0, o.noise);
+        for (int y = 0; y < img.rows; y++) {
+            Vec3b* row = img.ptr<Vec3b>(y);
+            double fy = img.rows > 1 ? (double)y / (img.rows - 1) : 0;
+            double left = cornerGain[0] * (1 - fy) + cornerGain[3] * fy;
+            double right = cornerGain[1] * (1 - fy) + cornerGain[2] * fy;
+            for (int x = 0; x < img.cols; x++) {
+                double fx = img.cols > 1 ? (double)x / (img.cols - 1) : 0;
+                double gain = left * (1 - fx) + right * fx;
+                for (int k = 0; k < 3; k++) {
+                    double n = out.noise > 0 ? rng.gaussian(out.noise) : 0;
+                    row[x][k] = saturate_cast<uchar>(row[x][k] * gain * out.gains[k] + n);
+                }
+            }
+        }
+
+        out.blur = rng.uniform(0.0, o.blur);
+        if (out.blur >= 0.3) {
+            GaussianBlur(img, img, Size(0, 0), out.blur);
+        }
+
+        out.jpegQuality = rng.uniform(o.minJpegQuality, o.maxJpegQuality + 1);
+        imencode(".jpg", img, out.jpeg, { IMWRITE_JPEG_QUALITY, out.jpegQuality });
+    }
+};
@@ -0,0 +1,487 @@
+﻿#include "SyntheticFace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+using namespace cv;
+
+/*************************************************************
+ * 端到端回归测试：用合成魔方面（已知真值）跑完整识别流程
+ * （JPEG 解码 -> analyzeCubeFace -> fillColorMatrix），
+ * 同时报告识别准确率与吞吐量/延迟，性能改动与正确性一起跟踪。
+ * 也可把数据集写入目录（--batch 可直接读取），或评估已写出的数据集
+ *************************************************************/
+struct RegressionOptions {
+    int cubes = 500;                // 合成魔方数（每个 6 个面）
+    uint64 seed = 1;                // 第 i 个魔方的种子为 seed + i
+    int threads = 0;                // 0 = 全部硬件线程
+    int chunk = 32;                 // 每批生成/评估的魔方数（限制内存占用）
+    string writeDir;                // 非空时把生成的数据集写入该目录
+    string evaluateDir;             // 非空时评估该目录下已有的数据集，不再生成
+    string outputFile;              // 结果 JSON（为空时不写）
+    double minStickerAccuracy = 0;  // 贴纸准确率低于此值时返回 2（0 = 不检查）
+    int listFailures = 10;          // 打印的识别错误面数上限
+
+    int decodeReduce = 1;
+    int pyramidLevels = 0;
+    ExtractBackend extract = EXTRACT_CONTOURS;
+    DetectMode detect = DETECT_SEGMENT;
+    int segmentThreads = 1;
+
+    SyntheticOptions synth;
+};
+
+// 一个魔方样本：名称与六个面（输入顺序 Front, Back, Left, Right, Up, Down）
+struct CubeSample {
+    string name;
+    vector<SyntheticFace> faces;
+};
+
+// 一个面的识别结果
+struct FaceOutcome {
+    vector<vector<char>> matrix;
+    float confidence = 0;
+    double latencyMs = 0;  // 解码 + 分析 + 填充颜色矩阵
+    bool decoded = false;
+    bool quadFound = false;  // 四边形模式：找到了魔方面四边形（否则回退到全图分割）
+};
+
+// 按某个生成参数分桶的统计
+struct Bucket {
+    string dimension;
+    string label;
+    int faces = 0;
+    int correct = 0;
+};
+
+struct RegressionReport {
+    int cubes = 0, faces = 0, stickers = 0;
+    int correctStickers = 0, missingStickers = 0;
+    int correctFaces = 0, correctCubes = 0, validCubes = 0;
+    int decodeErrors = 0;
+    int quadFound = 0;           // 四边形模式下找到四边形的面数
+    double confidenceSum = 0;
+    vector<double> latencies;
+    double evaluateWallMs = 0;   // 评估阶段的墙钟时间（不含生成与写盘）
+    double generateWallMs = 0;
+    vector<vector<int>> confusion; // [真值颜色][识别颜色]，最后一列为未识别
+    vector<Bucket> buckets;
+    int failuresListed = 0;
+};
+
+/*************************************************************
+ * 简单的并行循环：threads 个线程按原子计数器领取下标
+ *************************************************************/
+template<typename Fn>
+static void parallelFor(int count, int threads, Fn&& fn) {
+    atomic<int> next{ 0 };
+    auto worker = [&](int t) {
+        for (int i = next++; i < count; i = next++) fn(i, t);
+    };
+    vector<thread> pool;
+    for (int t = 1; t < min(threads, count); t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+static string matrixString(const vector<vector<char>>& m) {
+    string s;
+    for (const auto& row : m) {
+        for (char c : row) s += c == ' ' ? '.' : c;
+    }
+    return s;
+}
+
+/*************************************************************
+ * 数据集文件：<目录>/cubeNNNNN/cubeface1..6.jpg，
+ * 同名 .txt 为真值（三行颜色代码 + 一行以 # 开头的生成参数）
+ *************************************************************/
+static bool writeSample(const string& dir, const CubeSample& sample) {
+    filesystem::path cubeDir = filesystem::path(dir) / sample.name;
+    filesystem::create_directories(cubeDir);
+    for (size_t f = 0; f < sample.faces.size(); f++) {
+        const SyntheticFace& face = sample.faces[f];
+        string stem = "cubeface" + to_string(f + 1);
+        ofstream image(cubeDir / (stem + ".jpg"), ios::binary);
+        image.write((const char*)face.jpeg.data(), face.jpeg.size());
+        ofstream truth(cubeDir / (stem + ".txt"));
+        for (const auto& row : face.truth) {
+            truth << string(row.begin(), row.end()) << "\n";
+        }
+        truth << "# " << face.describe() << "\n";
+        if (!image || !truth) return false;
+    }
+    return true;
+}
+
+static bool readSample(const filesystem::path& cubeDir, CubeSample& sample) {
+    sample.name = cubeDir.filename().string();
+    sample.faces.assign(6, SyntheticFace());
+    for (int f = 0; f < 6; f++) {
+        SyntheticFace& face = sample.faces[f];
+        string stem = "cubeface" + to_string(f + 1);
+        ifstream image(cubeDir / (stem + ".jpg"), ios::binary);
+        ifstream truth(cubeDir / (stem + ".txt"));
+        if (!image || !truth) return false;
+        face.jpeg.assign(istreambuf_iterator<char>(image), istreambuf_iterator<char>());
+
+        string line;
+        while (getline(truth, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                face.parseDescription(line.substr(1));
+            }
+            else if (line.size() == 3 && face.truth.size() < 3) {
+                face.truth.push_back(vector<char>(line.begin(), line.end()));
+            }
+        }
+        if (face.truth.size() != 3) return false;
+    }
+    return true;
+}
+
+static vector<filesystem::path> listSampleDirs(const string& dir) {
+    vector<filesystem::path> dirs;
+    for (const auto& entry : filesystem::directory_iterator(dir)) {
+        if (entry.is_directory() && filesystem::exists(entry.path() / "cubeface1.txt")) {
+            dirs.push_back(entry.path());
+        }
+    }
+    sort(dirs.begin(), dirs.end());
+    return dirs;
+}
+
+/*************************************************************
+ * 分桶：按分辨率、旋转角、JPEG 质量、噪声、底座颜色与背景
+ * 统计整面识别正确率
+ *************************************************************/
+static void addToBuckets(vector<Bucket>& buckets, const SyntheticFace& face, bool correct) {
+    int shortSide = min(face.size.width, face.size.height);
+    double rotation = fabs(face.rotation);
+    pair<string, string> keys[6] = {
+        { "short_side", shortSide < 720 ? "<720" : shortSide < 1080 ? "720-1079" : ">=1080" },
+        { "rotation", rotation < 10 ? "<10" : rotation < 20 ? "10-20" : ">=20" },
+        { "jpeg_quality", face.jpegQuality < 65 ? "<65" : face.jpegQuality < 80 ? "65-79" : ">=80" },
+        { "noise", face.noise < 2 ? "<2" : face.noise < 4 ? "2-4" : ">=4" },
+        { "body", face.lightBody ? "light" : "dark" },
+        { "background", face.busyBackground ? "busy" : "plain" }
+    };
+    for (const auto& key : keys) {
+        auto it = find_if(buckets.begin(), buckets.end(), [&](const Bucket& b) {
+            return b.dimension == key.first && b.label == key.second;
+        });
+        if (it == buckets.end()) {
+            buckets.push_back({ key.first, key.second });
+            it = buckets.end() - 1;
+        }
+        it->faces++;
+        if (correct) it->correct++;
+    }
+}
+
+/*************************************************************
+ * 评估一批魔方：各线程用自己的帧上下文解码并识别，
+ * 再在主线程里对照真值累计统计
+ *************************************************************/
+static void evaluateChunk(const vector<CubeSample>& samples, const RegressionOptions& opt, int threads,
+    const CubeFaceAnalyzer& analyzer, const ImageLoader& loader, vector<FrameContext>& contexts,
+    RegressionReport& report) {
+    int faceCount = (int)samples.size() * 6;
+    vector<FaceOutcome> outcomes(faceCount);
+
+    int64 start = getTickCount();
+    parallelFor(faceCount, threads, [&](int i, int t) {
+        const SyntheticFace& face = samples[i / 6].faces[i % 6];
+        FaceOutcome& out = outcomes[i];
+        FrameContext& ctx = contexts[t];
+        int64 t0 = getTickCount();
+        Mat img;
+        try {
+            img = loader.decodeBuffer(face.jpeg.data(), face.jpeg.size());
+        }
+        catch (const cv::Exception&) {
+            img.release();
+        }
+        if (!img.empty()) {
+            Mat unused;
+            analyzer.fillColorMatrix(analyzer.analyzeCubeFace(img, ctx, unused, false), out.matrix);
+            out.confidence = ctx.grid.confidence;
+            out.quadFound = ctx.quadFound;
+            out.decoded = true;
+        }
+        out.latencyMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+    });
+    report.evaluateWallMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    string codes = analyzer.getColorCodeString();
+    for (size_t c = 0; c < samples.size(); c++) {
+        const CubeSample& sample = samples[c];
+        vector<vector<vector<char>>> matrices(6), truths(6);
+        bool cubeCorrect = true;
+        for (int f = 0; f < 6; f++) {
+            const SyntheticFace& face = sample.faces[f];
+            FaceOutcome& out = outcomes[c * 6 + f];
+            report.faces++;
+            report.latencies.push_back(out.latencyMs);
+            report.confidenceSum += out.confidence;
+            if (out.quadFound) report.quadFound++;
+            if (!out.decoded) {
+                report.decodeErrors++;
+                out.matrix.assign(3, vector<char>(3, ' '));
+            }
+
+            bool faceCorrect = true;
+            for (int r = 0; r < 3; r++) {
+                for (int k = 0; k < 3; k++) {
+                    char expected = face.truth[r][k], actual = out.matrix[r][k];
+                    size_t ti = codes.find(expected), ai = codes.find(actual);
+                    report.stickers++;
+                    if (actual == expected) report.correctStickers++;
+                    else faceCorrect = false;
+                    if (ai == string::npos) report.missingStickers++;
+                    if (ti != string::npos) {
+                        report.confusion[ti][ai == string::npos ? codes.size() : ai]++;
+                    }
+                }
+            }
+            if (faceCorrect) report.correctFaces++;
+            else cubeCorrect = false;
+            addToBuckets(report.buckets, face, faceCorrect);
+
+            if (!faceCorrect && report.failuresListed < opt.listFailures) {
+                report.failuresListed++;
+                cout << "识别错误：" << sample.name << " " << faceNames[f] << " 真值 " << matrixString(face.truth)
+                    << " 识别 " << matrixString(out.matrix) << fixed << setprecision(2) << " 置信度 " << out.confidence
+                    << "（" << face.describe() << "）" << endl;
+            }
+            matrices[f] = out.matrix;
+        }
+
+        report.cubes++;
+        if (cubeCorrect) report.correctCubes++;
+        if (CubeState::fromMatrices(matrices, codes).validate() == CubeState::VALID) report.validCubes++;
+    }
+}
+
+static void writeJson(ostream& out, const RegressionOptions& opt, const RegressionReport& r, const string& codes) {
+    double sumMs = 0;
+    for (double ms : r.latencies) sumMs += ms;
+    out << fixed << setprecision(4);
+    out << "{\n";
+    out << "  \"source\": \"" << (opt.evaluateDir.empty() ? "synthetic" : "directory") << "\",\n";
+    out << "  \"seed\": " << opt.seed << ",\n";
+    out << "  \"cubes\": " << r.cubes << ",\n";
+    out << "  \"faces\": " << r.faces << ",\n";
+    out << "  \"sticker_accuracy\": " << (r.stickers ? (double)r.correctStickers / r.stickers : 0.0) << ",\n";
+    out << "  \"missing_sticker_rate\": " << (r.stickers ? (double)r.missingStickers / r.stickers : 0.0) << ",\n";
+    out << "  \"face_accuracy\": " << (r.faces ? (double)r.correctFaces / r.faces : 0.0) << ",\n";
+    out << "  \"cube_accuracy\": " << (r.cubes ? (double)r.correctCubes / r.cubes : 0.0) << ",\n";
+    out << "  \"valid_state_rate\": " << (r.cubes ? (double)r.validCubes / r.cubes : 0.0) << ",\n";
+    out << "  \"decode_errors\": " << r.decodeErrors << ",\n";
+    out << "  \"detect\": \"" << (opt.detect == DETECT_QUAD ? "quad" : "segment") << "\",\n";
+    if (opt.detect == DETECT_QUAD) {
+        out << "  \"quad_found_rate\": " << (r.faces ? (double)r.quadFound / r.faces : 0.0) << ",\n";
+    }
+    out << "  \"mean_confidence\": " << (r.faces ? r.confidenceSum / r.faces : 0.0) << ",\n";
+    out << "  \"throughput_faces_per_s\": " << (r.evaluateWallMs > 0 ? r.faces * 1000.0 / r.evaluateWallMs : 0.0) << ",\n";
+    out << "  \"latency_mean_ms\": " << (r.latencies.empty() ? 0.0 : sumMs / r.latencies.size()) << ",\n";
+    out << "  \"latency_p50_ms\": " << percentile(r.latencies, 50) << ",\n";
+    out << "  \"latency_p99_ms\": " << percentile(r.latencies, 99) << ",\n";
+    out << "  \"evaluate_wall_ms\": " << r.evaluateWallMs << ",\n";
+    out << "  \"generate_wall_ms\": " << r.generateWallMs << ",\n";
+    out << "  \"buckets\": [\n";
+    for (size_t i = 0; i < r.buckets.size(); i++) {
+        const Bucket& b = r.buckets[i];
+        out << "    {\"dimension\": \"" << b.dimension << "\", \"label\": \"" << b.label << "\", "
+            << "\"faces\": " << b.faces << ", "
+            << "\"face_accuracy\": " << (b.faces ? (double)b.correct / b.faces : 0.0) << "}"
+            << (i + 1 < r.buckets.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"confusion\": {\n";
+    for (size_t ti = 0; ti < codes.size(); ti++) {
+        out << "    \"" << codes[ti] << "\": {";
+        for (size_t ai = 0; ai <= codes.size(); ai++) {
+            out << "\"" << (ai < codes.size() ? string(1, codes[ai]) : string("missing")) << "\": "
+                << r.confusion[ti][ai] << (ai < codes.size() ? ", " : "");
+        }
+        out << "}" << (ti + 1 < codes.size() ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* prog) {
+    cerr << "用法：" << prog << " [--cubes N] [--seed N] [--threads N] [--write 目录] [--evaluate 目录]" << endl;
+    cerr << "        [--output 结果.json] [--min-accuracy 0..1] [--list-failures N]" << endl;
+    cerr << "        [--decode-reduce 1|2|4|8|auto] [--pyramid N|auto] [--extract contours|components]" << endl;
+    cerr << "        [--detect segment|quad] [--segment-threads N]" << endl;
+    cerr << "        [--min-side N] [--max-side N] [--rotation 度] [--perspective 比例] [--tint 比例]" << endl;
+    cerr << "        [--lighting 比例] [--noise 标准差] [--blur sigma] [--jpeg 最低,最高] [--clutter N]" << endl;
+    cerr << "        [--light-body 比例] [--busy-background 比例]" << endl;
+    cerr << "四边形模式的回归：--detect quad --light-body 0.5 --busy-background 0.5" << endl;
+    cerr << "（按 body / background 分桶报告，并统计找到四边形的面所占比例）" << endl;
+}
+
+int main(int argc, char** argv) {
+    RegressionOptions opt;
+    SyntheticOptions& s = opt.synth;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--cubes" && hasValue) opt.cubes = max(1, atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) opt.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && hasValue) opt.threads = atoi(argv[++i]);
+        else if (arg == "--write" && hasValue) opt.writeDir = argv[++i];
+        else if (arg == "--evaluate" && hasValue) opt.evaluateDir = argv[++i];
+        else if (arg == "--output" && hasValue) opt.outputFile = argv[++i];
+        else if (arg == "--min-accuracy" && hasValue) opt.minStickerAccuracy = atof(argv[++i]);
+        else if (arg == "--list-failures" && hasValue) opt.listFailures = atoi(argv[++i]);
+        else if (arg == "--decode-reduce" && hasValue) {
+            string factor = argv[++i];
+            opt.decodeReduce = factor == "auto" ? 0 : atoi(factor.c_str());
+        }
+        else if (arg == "--pyramid" && hasValue) {
+            string levels = argv[++i];
+            opt.pyramidLevels = levels == "auto" ? -1 : atoi(levels.c_str());
+        }
+        else if (arg == "--extract" && hasValue && parseExtractBackend(argv[i + 1], opt.extract)) i++;
+        else if (arg == "--detect" && hasValue && parseDetectMode(argv[i + 1], opt.detect)) i++;
+        else if (arg == "--segment-threads" && hasValue) opt.segmentThreads = atoi(argv[++i]);
+        else if (arg == "--min-side" && hasValue) s.minSide = max(64, atoi(argv[++i]));
+        else if (arg == "--max-side" && hasValue) s.maxSide = max(64, atoi(argv[++i]));
+        else if (arg == "--rotation" && hasValue) s.maxRotation = atof(argv[++i]);
+        else if (arg == "--perspective" && hasValue) s.perspective = atof(argv[++i]);
+        else if (arg == "--tint" && hasValue) s.tint = atof(argv[++i]);
+        else if (arg == "--lighting" && hasValue) s.lighting = atof(argv[++i]);
+        else if (arg == "--noise" && hasValue) s.noise = atof(argv[++i]);
+        else if (arg == "--blur" && hasValue) s.blur = atof(argv[++i]);
+        else if (arg == "--jpeg" && hasValue) {
+            if (sscanf(argv[++i], "%d,%d", &s.minJpegQuality, &s.maxJpegQuality) != 2) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--clutter" && hasValue) s.clutter = max(0, atoi(argv[++i]));
+        else if (arg == "--light-body" && hasValue) s.lightBody = atof(argv[++i]);
+        else if (arg == "--busy-background" && hasValue) s.busyBackground = atof(argv[++i]);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    s.maxSide = max(s.minSide, s.maxSide);
+
+    int threads = opt.threads > 0 ? opt.threads : (int)max(1u, thread::hardware_concurrency());
+    ImageLoader loader(false);
+    loader.setReduce(opt.decodeReduce);
+    CubeFaceAnalyzer analyzer;
+    analyzer.setVerbose(false);
+    analyzer.setPyramid(opt.pyramidLevels, false);
+    analyzer.setExtractBackend(opt.extract);
+    analyzer.setSegmentThreads(opt.segmentThreads);
+    analyzer.setDetectMode(opt.detect);
+    SyntheticFaceGenerator generator(analyzer, opt.synth);
+    string codes = analyzer.getColorCodeString();
+
+    vector<filesystem::path> sampleDirs;
+    int total = opt.cubes;
+    if (!opt.evaluateDir.empty()) {
+        sampleDirs = listSampleDirs(opt.evaluateDir);
+        total = (int)sampleDirs.size();
+        if (total == 0) {
+            cerr << "目录中没有数据集：" << opt.evaluateDir << endl;
+            return 1;
+        }
+        cout << "评估数据集 " << opt.evaluateDir << "：" << total << " 个魔方，" << threads << " 个线程" << endl;
+    }
+    else {
+        vector<size_t> sizes = generator.paletteSizes();
+        cout << "合成 " << total << " 个魔方（" << total * 6 << " 个面），种子 " << opt.seed << "，"
+            << threads << " 个线程；各颜色参考色数";
+        for (size_t ci = 0; ci < sizes.size(); ci++) cout << " " << codes[ci] << ":" << sizes[ci];
+        cout << endl;
+    }
+
+    RegressionReport report;
+    report.confusion.assign(codes.size(), vector<int>(codes.size() + 1, 0));
+    vector<FrameContext> contexts(threads);
+    vector<CubeSample> samples;
+    for (int first = 0; first < total; first += opt.chunk) {
+        int count = min(opt.chunk, total - first);
+        samples.assign(count, CubeSample());
+
+        int64 t0 = getTickCount();
+        bool ok = true;
+        if (!opt.evaluateDir.empty()) {
+            for (int c = 0; c < count; c++) {
+                if (!readSample(sampleDirs[first + c], samples[c])) {
+                    cerr << "无法读取样本：" << sampleDirs[first + c].string() << endl;
+                    ok = false;
+                }
+            }
+        }
+        else {
+            parallelFor(count, threads, [&](int c, int) {
+                char name[32];
+                snprintf(name, sizeof(name), "cube%05d", first + c);
+                samples[c].name = name;
+                generator.renderCube(opt.seed + first + c, samples[c].faces);
+            });
+            report.generateWallMs += (getTickCount() - t0) * 1000.0 / getTickFrequency();
+            if (!opt.writeDir.empty()) {
+                for (const CubeSample& sample : samples) {
+                    if (!writeSample(opt.writeDir, sample)) {
+                        cerr << "无法写入：" << opt.writeDir << "/" << sample.name << endl;
+                        return 1;
+                    }
+                }
+            }
+        }
+        if (!ok) return 1;
+
+        evaluateChunk(samples, opt, threads, analyzer, loader, contexts, report);
+        cerr << "\r已评估 " << first + count << " / " << total << " 个魔方" << flush;
+    }
+    cerr << endl;
+
+    double stickerAccuracy = report.stickers ? (double)report.correctStickers / report.stickers : 0;
+    cout << fixed << setprecision(2);
+    cout << "\n============== 回归结果 ==============\n";
+    cout << "贴纸准确率: " << stickerAccuracy * 100 << "%（未识别 " << report.missingStickers << " / "
+        << report.stickers << "）" << endl;
+    cout << "整面正确: " << report.correctFaces << " / " << report.faces << "，整个魔方正确: " << report.correctCubes
+        << " / " << report.cubes << "，状态合法: " << report.validCubes << " / " << report.cubes << endl;
+    cout << "吞吐量: " << report.faces * 1000.0 / max(1e-9, report.evaluateWallMs) << " 面/秒，延迟 p50 "
+        << percentile(report.latencies, 50) << " ms，p99 " << percentile(report.latencies, 99) << " ms" << endl;
+    if (opt.detect == DETECT_QUAD) {
+        cout << "找到四边形: " << report.quadFound << " / " << report.faces << " 面（其余回退到全图分割）" << endl;
+    }
+    for (const Bucket& b : report.buckets) {
+        cout << "  " << setw(12) << left << b.dimension << setw(10) << b.label << right
+            << b.correct << " / " << b.faces << " 面正确" << endl;
+    }
+
+    if (!opt.outputFile.empty()) {
+        ofstream out(opt.outputFile);
+        writeJson(out, opt, report, codes);
+        cerr << "结果已保存到 " << opt.outputFile << endl;
+    }
+
+    if (opt.minStickerAccuracy > 0 && stickerAccuracy < opt.minStickerAccuracy) {
+        cerr << "错误：贴纸准确率 " << stickerAccuracy * 100 << "% 低于要求的 "
+            << opt.minStickerAccuracy * 100 << "%" << endl;
+        return 2;
+    }
+    return 0;
+}